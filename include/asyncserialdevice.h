@@ -5,37 +5,159 @@
 #include <QQueue>
 #include <QTimer>
 #include <QSerialPort>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <memory>
+
+#include "serialstats.h"
+
+// splits the bytes read from a device into individual responses
+class ResponseFramer
+{
+public:
+    virtual ~ResponseFramer() = default;
+    // length of the complete response at the start of buffer (0 if more data is needed)
+    virtual int frame_length(const QByteArray &buffer) const = 0;
+    virtual void reset() {} // the buffer was cleared (framers that keep scan state restart)
+};
+
+// responses that end with a terminating character (e.g. '\r')
+class TerminatorFramer : public ResponseFramer
+{
+public:
+    explicit TerminatorFramer(char terminator) : terminator(terminator) {}
+    int frame_length(const QByteArray &buffer) const override
+    {
+        const int i = buffer.indexOf(terminator);
+        return (i < 0) ? 0 : i + 1;
+    }
+
+private:
+    const char terminator;
+};
+
+// JSON objects (brace matched, ignoring braces in strings) mixed with lines of text.
+// Scanning picks up where the last call stopped, so a large object that arrives
+// over many reads is only scanned once.
+class JsonFramer : public ResponseFramer
+{
+public:
+    explicit JsonFramer(char textTerminator = '\n') : textTerminator(textTerminator) {}
+    int frame_length(const QByteArray &buffer) const override;
+    void reset() override;
+
+private:
+    void restart() const;
+
+    const char textTerminator;
+    mutable int scanned {0};
+    mutable int depth {0};
+    mutable bool started {false}; // found the first non-whitespace character
+    mutable bool isJson {false};
+    mutable bool inString {false};
+    mutable bool escaped {false};
+};
 
 class AsyncSerialDevice : public QObject
 {
     Q_OBJECT
 public:
+    enum class Priority
+    {
+        Normal,
+        Urgent // sent ahead of any queued normal commands (e.g. stop commands)
+    };
+
     explicit AsyncSerialDevice(const QString& portName, QObject *parent = nullptr);
     bool is_connected() const; // returns whether the device is connected or not
     void set_port_name(const QString &portName); // sets the port number for the device
+    QString device_name() const;
+
+    // latency and throughput of the commands sent (safe to read from any thread)
+    const SerialStats &statistics() const;
+    void reset_statistics();
 
 signals:
     void response(const QString &s); // emit info to be printed to console window
     void error(const QString &s); // error messages
     void timeout(const QString &s); // timeout errors
+    void bulk_write_progress(qint64 bytesWritten, qint64 totalBytes, double bytesPerSecond);
+    void bulk_write_failed(const QString &reason); // the device didn't get all of a bulk write, it has to be sent again
 
 protected:
-    void write(const QByteArray &data); // add command to queue for writing
-    void write_next(); // send next command in queue
+    // add command to queue for writing. timeout_ms is how long to wait for the
+    // response once the command is sent (-1 uses defaultTimeout_ms)
+    void write(const QByteArray &data, Priority priority = Priority::Normal, int timeout_ms = -1);
+    // write a large command in chunks, keeping about two chunks buffered in the port so the
+    // link never idles. The timeout restarts whenever a chunk goes out, so it only catches a
+    // stalled transfer. Nothing else is sent until the device answers the transfer. If the port
+    // won't take a chunk the transfer is abandoned (see abort_bulk), a device stream has no
+    // offsets so a transfer can't be resumed part way
+    void write_bulk(const QByteArray &data, int chunkSize, int timeout_ms = -1);
+    // drops what the port hasn't sent of the bulk write in flight and the commands queued behind
+    // it, holds the queue until the device has given up on the rest and emits bulk_write_failed
+    void abort_bulk(const QString &reason);
+    bool bulk_in_flight() const;
+    void write_next(); // the oldest command in flight was answered, send the next command(s) in queue
     void clear_command_queue(); // clear the queue
 
+    // number of commands that can be sent before their responses come back.
+    // only use > 1 for devices that buffer commands and answer them in order
+    void set_window_size(int numCommands);
+    void set_framer(std::unique_ptr<ResponseFramer> responseFramer); // how responses are split up in readData
+    bool take_response(QByteArray &frame); // removes the next complete response from readData (needs a framer)
+    void read_serial_data(); // append everything waiting on the port to readData
+    QByteArray take_unframed(); // removes everything left in readData, complete or not
+
+    QByteArray pending_command() const; // oldest command still waiting on a response
+    int num_in_flight() const;
+
 protected:
-    QByteArray prevWrite; // stores the last command sent
     QSerialPort *serialPort {nullptr}; // handle for the serial port
     QTimer *timer {nullptr}; // timer for managing timeout
     QByteArray readData; // data of response from device
     QString name {"Serial Device"}; // name of the device
+    int defaultTimeout_ms {3000}; // response timeout in milliseconds
 
 private:
-    QQueue<QByteArray> writeQueue; // queue of commands to write to the serial device
-    bool isWriteReady {true}; // keeps track of if the device is ready to receive another command
-    const int readTimeout_ms {3000}; // timeout time in milliseconds
+    struct Command
+    {
+        QByteArray data;
+        int timeout_ms {0};
+        QDeadlineTimer deadline; // set when the command is written
+        QElapsedTimer queuedTimer;
+        QElapsedTimer sentTimer;
+        qint64 sentTime_ns {0}; // on the event timeline clock
+        int chunkSize {0}; // > 0 for bulk writes
+    };
 
+    struct BulkTransfer
+    {
+        bool active {false};
+        QByteArray data;
+        int chunkSize {0};
+        int timeout_ms {0};
+        qint64 offset {0};  // bytes handed to the port
+        qint64 written {0}; // bytes the port reports as written
+        bool sent {false};  // all written, waiting on the device's answer
+        QElapsedTimer elapsed;
+    };
+
+    void send_queued(); // write queued commands until the window is full
+    void restart_timeout(); // time out at the earliest deadline of the commands in flight
+    void write_bulk_chunks();
+    void handle_bytes_written(qint64 bytes);
+
+private:
+    QQueue<Command> urgentQueue; // commands that jump ahead of writeQueue
+    QQueue<Command> writeQueue; // queue of commands to write to the serial device
+    QQueue<Command> inFlight; // commands written that haven't been answered yet (oldest first)
+    int windowSize {1};
+    std::unique_ptr<ResponseFramer> framer;
+    SerialStats stats;
+    BulkTransfer bulk; // commands queued behind a bulk write wait until it is fully written
+    bool sendHeld {false}; // set for a moment after a bulk write is abandoned
+    const int bulkAbortQuiet_ms {200};
 };
 
 #endif // ASYNCSERIALDEVICE_H
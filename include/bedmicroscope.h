@@ -4,6 +4,11 @@
 #include <QObject>
 #include <opencv2/opencv.hpp>
 #include <QImage>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
 
 class BedMicroscope : public QObject
 {
@@ -15,13 +20,75 @@ public:
     bool open_capture(int index);
     void disconnect_camera();
     QImage get_frame();
-    bool is_connected() { return cap.isOpened(); }
+    bool is_connected();
     void save_image(const QString& filename);
 
+    // mean of n consecutive grayscale frames (empty if the camera couldn't be read)
+    cv::Mat grab_average(int n);
 
 private:
+    QMutex m_mutex; // the live view and the scanner read the camera from different threads
     cv::VideoCapture cap;
     cv::Mat frame;
 };
 
+struct BedScanSettings
+{
+    int numX {1};
+    int numY {1};
+    double xSpacing_mm {0.0};
+    double ySpacing_mm {0.0};
+    int framesPerTile {5};
+    int mosaicDownsample {8};
+    double pixelSize_um {0.0}; // microscope image scale, 0 places tiles edge to edge
+    QString folder;
+    int bedID {0};
+};
+Q_DECLARE_METATYPE(BedScanSettings)
+
+// Captures the tiles of a bed scan on its own thread. As soon as a tile's frames
+// are averaged, the tile done handler tells the motion controller to move on,
+// while the tile is written to disk on a writer thread and added to a downsampled
+// mosaic of the bed.
+class BedScanner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BedScanner(BedMicroscope *microscope);
+    ~BedScanner();
+
+    static QString tile_file_path(const BedScanSettings &settings, const QString &position);
+    // runs on the scanner's thread after each tile's frames are in, returns false if the
+    // motion controller couldn't be told. Set it before a scan starts
+    void set_tile_done_handler(std::function<bool()> handler);
+
+public slots:
+    void start(const BedScanSettings &settings);
+    void capture_tile(const QString &position); // position is "<column letter><row number>", e.g. "b03"
+    void finish();
+
+signals:
+    void tile_captured(const QString &position);
+    void mosaic_updated(const QImage &mosaic);
+    void scan_finished(const QString &mosaicFile);
+    void print_to_output_window(QString s);
+
+private slots:
+    void cleanup();
+
+private:
+    void add_to_mosaic(const cv::Mat &tile, int nx, int ny);
+
+private:
+    BedMicroscope *m_microscope {nullptr};
+    std::unique_ptr<QThread> m_thread;
+    QThreadPool m_writers;
+
+    std::function<bool()> m_tileDone;
+    BedScanSettings m_settings;
+    cv::Mat m_mosaic;
+    int m_numTiles {0};
+    bool m_running {false};
+};
+
 #endif // BEDMICROSCOPE_H
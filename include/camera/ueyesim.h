@@ -0,0 +1,65 @@
+#ifndef UEYESIM_H
+#define UEYESIM_H
+
+/*
+ * Simulated uEye camera backend.
+ *
+ * Built instead of the IDS ueye_api / ueye_tools libraries when the project is
+ * configured with -DUEYE_SIMULATOR=ON. It implements the subset of the uEye C API
+ * used by Camera, EventThread and DropletObservationWidget, so the acquisition,
+ * recording and live-analysis paths can run without a physical camera.
+ * Only ueye.h / ueye_tools.h from the IDS SDK are needed at compile time.
+ *
+ * The simulator is configured from environment variables when the first camera
+ * is opened (or from UEyeSim::set_config() before that):
+ *
+ *   UEYE_SIM_SOURCE        video file to play back (looped). If empty, frames
+ *                          are synthesized from the parametric droplet model
+ *   UEYE_SIM_WIDTH         sensor width in pixels (default 2048)
+ *   UEYE_SIM_HEIGHT        sensor height in pixels (default 2048)
+ *   UEYE_SIM_FPS           initial frame rate (default 30)
+ *   UEYE_SIM_MAX_FPS       fastest frame rate the sensor allows (default 150)
+ *   UEYE_SIM_TRIGGER_HZ    rate of the simulated hardware trigger input (default 100)
+ *   UEYE_SIM_DROP_RATE     probability [0,1] that a frame is dropped by the "camera" (default 0)
+ *   UEYE_SIM_DROP_SPEED    droplet travel per frame in pixels (default 12)
+ *   UEYE_SIM_SATELLITES    number of satellite droplets trailing the main drop (default 0)
+ *   UEYE_SIM_SEED          random seed for noise and dropped frames (default 1)
+ */
+
+#include <cstdint>
+#include <string>
+
+namespace UEyeSim
+{
+
+struct Config
+{
+    std::string sourceVideo;
+    int sensorWidth {2048};
+    int sensorHeight {2048};
+    double frameRate {30.0};
+    double maxFrameRate {150.0};
+    double hardwareTriggerRate_Hz {100.0};
+    double dropRate {0.0};
+    double dropletSpeed_px {12.0};
+    int numSatellites {0};
+    unsigned int seed {1};
+};
+
+struct Stats
+{
+    std::uint64_t framesGenerated {0}; // frames the sensor produced
+    std::uint64_t framesDropped {0};   // frames discarded by dropped-frame injection
+    std::uint64_t framesLost {0};      // frames lost because every sequence buffer was locked
+    std::uint64_t triggersIgnored {0}; // triggers that arrived while the sensor was busy or not capturing
+};
+
+Config config_from_environment();
+void set_config(const Config &config); // applies to cameras opened afterwards
+Config config();
+Stats stats();
+void reset_stats();
+
+}
+
+#endif // UEYESIM_H
@@ -2,6 +2,8 @@
 #define DMC4080_H
 
 #include <QObject>
+#include <QMutex>
+#include <string>
 #include <string_view>
 #include "gmessagepoller.h"
 #include "gmessagehandler.h"
@@ -20,6 +22,14 @@ public:
     void connect_to_motion_controller(bool homeZAxis);
     void disconnect_controller();
 
+    // Sets a variable that a running program waits on, e.g. to tell it the host
+    // has finished a request. It goes out on its own connection with a timeout
+    // and is read back, returns false if the controller didn't take it.
+    bool set_program_variable(const std::string &name, int value);
+    // Halts the downloaded program and stops the motion it started, for when
+    // it can no longer be told to end on its own. Uses the same connection.
+    bool halt_program();
+
 public:
     // the computer ethernet port needs to be set to 192.168.42.10
     const char *address; // IP address of motion controller
@@ -31,7 +41,10 @@ public:
     GCon g {0}; // Handle for connection to Galil Motion Controller
 
 private:
+    bool open_variable_connection(); // with variableMutex held
 
+    GCon gVariables {0}; // connection for set_program_variable, opened on first use
+    QMutex variableMutex;
 };
 
 #endif // DMC4080_H
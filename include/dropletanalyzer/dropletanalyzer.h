@@ -51,8 +51,27 @@ struct DropTrackingData
     double velocity_m_s {0.0};
     double intercept {0.0};
     double drop_angle_rad {0.0};
+    double satellites {0.0};  // median number of extra droplets in frames where a droplet was found
 };
 
+// metadata recorded for each frame of a strobe sweep video
+struct StrobeFrameStamp
+{
+    quint64 cameraTimestamp_100ns {0}; // device timestamp from the camera image info
+    int commandedDelay_us {-1};        // last strobe delay sent to the JetDrive before the frame arrived
+    int strobeDelay_us {-1};           // last strobe delay acknowledged by the JetDrive before the frame arrived
+    qint64 commandTime_us {-1};        // time the commanded delay was sent (relative to sweep start)
+    qint64 ackTime_us {-1};            // time the acknowledged delay was received
+    qint64 arrivalTime_us {-1};        // time the frame was received from the camera
+    // frames that arrive while a strobe delay change is still in flight can't be trusted
+    bool is_valid() const {return strobeDelay_us >= 0 && strobeDelay_us == commandedDelay_us;}
+};
+
+// the frame stamps for a video are stored in a .csv file next to the video
+inline std::string frame_stamp_file_path(const std::string& videoPath) {return videoPath + ".frames.csv";}
+bool write_frame_stamps(const std::string& filePath, const std::vector<StrobeFrameStamp>& stamps);
+std::vector<StrobeFrameStamp> read_frame_stamps(const std::string& filePath);
+
 class DropletAnalyzer : public QObject
 {
    Q_OBJECT
@@ -74,6 +93,8 @@ signals:
 public slots:
    DropletCameraSettings& camera_settings();
    void load_video(const std::string& filename);
+   // same as load_video() but with grayscale frames already in memory (e.g. straight from the camera)
+   void load_frames(const std::vector<cv::Mat>& frames, const std::vector<StrobeFrameStamp>& stamps);
    int get_number_of_frames();
    void show_frame(int frameNum);
    void update_view_settings(const DropViewSettings& viewSettings);
@@ -83,6 +104,8 @@ public slots:
    void set_nozzle_diameter(double diameter);
    double get_strobe_step_time();
    void set_strobe_step_time(double stepTime);
+   void set_frame_stamps(const std::vector<StrobeFrameStamp>& stamps);
+   std::vector<StrobeFrameStamp> get_frame_stamps();
    DropTrackingData get_droplet_tracking_data();
    void detect_nozzle();
    void estimate_image_scale();
@@ -101,6 +124,9 @@ private slots:
    void filter_data_by_residuals(double threshold);
    void rotate_data_by_angle(double angle_rad);
    void calculate_droplet_velocity();
+   void count_satellites();
+   bool has_frame_stamps() const;
+   double frame_time_us(int frame) const;
 
 private:
    QMutex m_mutex;
@@ -111,6 +137,7 @@ private:
    cv::Mat m_medianFrame;
    double m_nozzleTipDiameter_um {0.0};
    double m_strobeStepTime_us {0.0};
+   std::vector<StrobeFrameStamp> m_frameStamps;
    const cv::Point m_noTrackPoint = cv::Point(-100, 100);
    cv::Point m_originPoint = cv::Point(0,0);
 
@@ -0,0 +1,101 @@
+#ifndef EVENTTIMELINE_H
+#define EVENTTIMELINE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One timeline that every subsystem (serial devices, motion controller,
+// gclib messages, camera) records into, all on the same monotonic clock.
+// Recording is lock-free and never blocks, so it is safe from the print thread
+// and the camera event thread. The newest events overwrite the oldest ones.
+// The timeline exports to Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+namespace Timeline
+{
+
+struct Event
+{
+    enum class Phase : char
+    {
+        Instant = 'i',  // something happened (frame captured, message received)
+        Complete = 'X', // something took time (command sent -> ack, motion)
+        Counter = 'C'   // a value over time
+    };
+
+    qint64 time_ns {0};
+    qint64 duration_ns {0};
+    double value {0.0};
+    quint32 thread {0};
+    Phase phase {Phase::Instant};
+    char category[16] {};
+    char name[40] {};
+    char detail[72] {};
+};
+
+class EventTimeline
+{
+public:
+    static EventTimeline &instance();
+
+    // ns since the application started (steady clock)
+    static qint64 now_ns();
+
+    void instant(std::string_view category, std::string_view name, std::string_view detail = {});
+    void complete(std::string_view category, std::string_view name, qint64 start_ns, std::string_view detail = {});
+    void counter(std::string_view category, std::string_view name, double value);
+
+    void set_enabled(bool enabled) {m_enabled.store(enabled, std::memory_order_relaxed);}
+    bool is_enabled() const {return m_enabled.load(std::memory_order_relaxed);}
+    void clear();
+
+    // events currently held, oldest first
+    std::vector<Event> snapshot() const;
+    size_t capacity() const {return capacity_;}
+    bool export_chrome_trace(const std::string &filePath) const;
+
+    // shows up as the thread's name in the trace (call from the thread)
+    static void name_current_thread(const std::string &name);
+
+private:
+    EventTimeline();
+    Event &begin_event(Event::Phase phase, std::string_view category, std::string_view name, quint64 &index);
+    void end_event(quint64 index);
+
+    static constexpr size_t capacity_ {1 << 16};
+
+    // seq is 2 * index + 1 while the slot is being written and 2 * index + 2 once
+    // it is complete, so a reader can tell a finished event from one in progress
+    // or one that has been overwritten while it was being copied
+    struct Slot
+    {
+        std::atomic<quint64> seq {0};
+        Event event;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<quint64> m_next {0};
+    std::atomic<bool> m_enabled {true};
+};
+
+// records a complete event covering its own lifetime
+class ScopedEvent
+{
+public:
+    ScopedEvent(std::string_view category, std::string_view name, std::string_view detail = {}) :
+        m_category(category), m_name(name), m_detail(detail), m_start(EventTimeline::now_ns()) {}
+    ~ScopedEvent() {EventTimeline::instance().complete(m_category, m_name, m_start, m_detail);}
+
+private:
+    std::string m_category;
+    std::string m_name;
+    std::string m_detail;
+    qint64 m_start {0};
+};
+
+}
+
+#endif // EVENTTIMELINE_H
@@ -0,0 +1,86 @@
+#ifndef FRAMEMETRICS_H
+#define FRAMEMETRICS_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QRect>
+#include <QElapsedTimer>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "camera.h"
+
+struct FrameMetricsSettings
+{
+    int decimation {4};          // analyze every n-th pixel in x and y
+    int publishInterval_ms {250};
+    int saturationLevel {250};   // pixels at or above this count as saturated
+    QRect focusAOI;              // full-resolution image coordinates, empty = whole image
+    QRect nozzleAOI;             // region around the nozzle tip, empty = top sixth of the image
+};
+
+struct FrameMetrics
+{
+    static constexpr int numBins {64};
+
+    double sharpness {0.0};         // variance of the Laplacian over the focus AOI
+    double meanIntensity {0.0};     // 0-255
+    double saturatedFraction {0.0}; // fraction of pixels at or above the saturation level
+    double nozzleContrast {0.0};    // (p95 - p5) / (p95 + p5) over the nozzle AOI
+    std::array<quint32, numBins> histogram {};
+
+    int framesAnalyzed {0};  // frames averaged into these metrics
+    int framesSkipped {0};   // frames that arrived while a frame was still being analyzed
+    double analysisTime_ms {0.0}; // mean time to analyze one frame
+};
+Q_DECLARE_METATYPE(FrameMetrics)
+
+// Image-based focus and exposure metrics for live camera frames.
+// frame_received() is called directly from the camera event thread and only makes
+// a decimated copy of the frame; the metrics are computed on this object's own thread
+// and averaged until they are published, so capture is never held up.
+class FrameMetricsProcessor : public QObject
+{
+    Q_OBJECT
+public:
+    FrameMetricsProcessor();
+    ~FrameMetricsProcessor();
+
+    void set_settings(const FrameMetricsSettings &settings);
+    FrameMetricsSettings settings() const;
+
+    static QString metrics_string(const FrameMetrics &metrics);
+
+public slots:
+    void frame_received(ImageBufferPtr buffer); // call with a direct connection
+    void reset();
+
+signals:
+    void metrics_updated(const FrameMetrics &metrics);
+
+private slots:
+    void cleanup();
+
+private:
+    void analyze(const cv::Mat &image, int decimation);
+    void publish();
+
+private:
+    mutable QMutex m_mutex;
+    FrameMetricsSettings m_settings;
+    std::unique_ptr<QThread> m_thread;
+
+    std::atomic<bool> m_busy {false};
+    std::atomic<int> m_framesSkipped {0};
+
+    // running sums since the last publish (only touched on m_thread)
+    FrameMetrics m_sum;
+    QElapsedTimer m_publishTimer;
+};
+
+#endif // FRAMEMETRICS_H
@@ -20,6 +20,9 @@ public:
 
     void connect_to_controller(std::string_view IPAddress);
     void stop();
+    // reads the position of an axis (TP) from the poller thread without touching
+    // the print thread's handle, answered with position_read
+    void read_position(char axis);
 
 protected:
     void run() override;
@@ -27,11 +30,14 @@ protected:
 signals:
     void error();
     void message(QString cmd);
+    void position_read(char axis, int counts, bool ok);
 
 protected:
     GCon g_;
     QMutex mutex_;
     QWaitCondition waitCondition_;
     bool quit_ {false};
+    std::string positionReads_; // axes waiting to be read
+    const unsigned int commandTimeout_ms_ {500};
     unsigned long sleepTime_ms_ {1};
 };
@@ -2,6 +2,7 @@
 #define JETDRIVE_H
 
 #include <QMutex>
+#include <map>
 #include "asyncserialdevice.h"
 #include "mfjdrv.h"
 
@@ -33,12 +34,11 @@ public:
 
     void set_waveform(const Waveform &waveform);
 
-    // Before sending the next command,
-    // the response packet must have been received.
-    // TODO: Implement a queue for commands that get popped off and sent when
-    // the appropriate response has been received
-    // use response_size(CMD) to get the appropriate of bytes to wait for
-    // from the response
+    // Commands are queued and sent one at a time unless a larger window is set,
+    // then up to that many are sent before their responses come back. Responses
+    // are split up with response_size(CMD). Takes effect on the next connect.
+    void set_command_window(int numCommands);
+
     void set_continuous_jetting();
     void set_single_jetting();
 
@@ -55,6 +55,9 @@ public:
     void disable_strobe();
     void set_strobe_delay(short strobeDelay_microseconds);
 
+signals:
+    void strobe_delay_acknowledged(short strobeDelay_microseconds); // device has replied to a STROBEDELAY command
+
 private:
     // consider making these virtual functions in the asyncserialdevice ??
     void handle_ready_read();
@@ -64,16 +67,23 @@ private:
     void clear_members();
     void handle_serial_error(QSerialPort::SerialPortError serialPortError);
 
+    // settings are only sent when their encoded frame differs from the last one
+    // sent to the device (call with mutex locked)
+    QByteArray encode(CMD command);
+    void send_if_changed(CMD command, Priority priority = Priority::Normal);
+
 private:
     mutable QMutex mutex;
     std::unique_ptr<CommandBuilder> cmdBuilder;
     Settings jetParams;
+    std::map<CMD, QByteArray> sentFrames; // shadow of the device settings
+    std::map<CMD, QByteArray> hotFrames;  // cached frames for STROBEDELAY, FULLFREQ and DROPS, patched in place
 
     // Members to help with initialization
     InitState initState {NOT_INITIALIZED};
     const QByteArray xCmd {"X2000"};
     short iX200 = {0};
-    int expectedResponseSize {4};
+    int commandWindow {1}; // commands in flight once initialized (the device answers in order)
 };
 
 }
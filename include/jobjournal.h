@@ -0,0 +1,59 @@
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+#include <QString>
+#include <limits>
+#include <vector>
+
+// One line of a print journal
+struct JournalEntry
+{
+    QString time;                   // ISO 8601, filled in when written
+    QString event;                  // start, resume, recoat, pass, paused, resumed, complete, cancelled, failed
+    int layer {0};                  // last layer and pass printed, pass 0 after a recoat
+    int pass {0};
+    double z_mm {std::numeric_limits<double>::quiet_NaN()}; // NaN if the controller wasn't connected
+    int yShift_rows {0};            // dither shift of the layer
+    int headFrequency_Hz {0};
+    double headVoltage {0.0};
+    double printFrequency_Hz {0.0};
+    double printSpeed_mm_s {0.0};
+    double reverseOffset_mm {0.0};
+    QString note;
+
+    bool is_checkpoint() const {return event == "recoat" || event == "pass";}
+};
+
+// What a journal says about the job it belongs to
+struct JournalState
+{
+    QString job;                    // job folder the journal was started for
+    int layerCount {0};
+    bool started {false};
+    bool complete {false};
+    JournalEntry last;              // last entry of any kind
+    JournalEntry checkpoint;        // last pass or recoat since the job was started, layer 0 if none
+};
+
+// Append-only csv log of a print job, one line per recoat and pass so a job can
+// be continued after a crash or a cancel. The file is closed after every line
+// so nothing written is lost if the program dies.
+class JobJournal
+{
+public:
+    static constexpr const char *fileName = "print_journal.csv";
+
+    bool open(const QString &path, const QString &job, int layerCount, QString &error);
+    void close() {m_path.clear();}
+    bool is_open() const {return !m_path.isEmpty();}
+    const QString &path() const {return m_path;}
+    bool write(JournalEntry entry, QString &error);
+
+    // a journal can hold several starts and resumes of the same job, the last start counts
+    static bool read(const QString &path, JournalState &state, QString &error);
+
+private:
+    QString m_path;
+};
+
+#endif // JOBJOURNAL_H
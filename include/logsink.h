@@ -0,0 +1,144 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+
+// Logging backend for the output window. Any thread can write a message
+// without locking or touching the disk; a background thread drains the
+// messages into a rotating log file and hands them to the output window,
+// which only keeps the newest ones in memory.
+namespace Log
+{
+
+enum class Severity : quint8
+{
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+const char *severity_name(Severity severity);
+
+// best guess for messages that don't say (device responses, print thread output)
+Severity severity_from_text(const QString &text);
+
+struct Entry
+{
+    qint64 time_ms {0};                // ms since epoch
+    Severity severity {Severity::Info};
+    const char *source {""};           // must outlive the entry (a literal or a metaObject()->className())
+    QString text;
+};
+
+// Bounded multi-producer single-consumer queue (Vyukov). Pushing never blocks,
+// a message is dropped if the queue is full.
+class MessageQueue
+{
+public:
+    explicit MessageQueue(size_t capacity);
+
+    bool try_push(Entry &&entry);
+    bool try_pop(Entry &entry); // consumer thread only
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq {0};
+        Entry entry;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_tail {0};
+    alignas(64) size_t m_head {0};
+};
+
+class Sink
+{
+public:
+    static Sink &instance();
+
+    // safe from any thread, never blocks
+    void write(Severity severity, const char *source, const QString &text);
+
+    // starts the writer thread, files are named <baseName>yyyy_MM_dd.txt in directory
+    void start(const QString &directory, const QString &baseName);
+    // writes whatever is still queued and joins the writer thread
+    void stop();
+
+    // messages written to disk since the last call, for the output window
+    std::vector<Entry> take_view_entries();
+
+    static constexpr qint64 maxFileSize_ {10 * 1024 * 1024};
+    static constexpr int maxBackups_ {5};
+    static constexpr size_t viewCapacity_ {20000};
+
+private:
+    Sink();
+    ~Sink();
+    void run();
+    void write_to_file(const std::vector<Entry> &batch);
+    void publish_to_view(const std::vector<Entry> &batch);
+    void open_file(const QDate &date);
+    void rotate_file();
+
+private:
+    MessageQueue m_queue;
+    std::atomic<quint64> m_dropped {0};
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_running {false};
+
+    // writer thread only
+    QString m_directory;
+    QString m_baseName;
+    QString m_filePath;
+    QDate m_fileDate;
+    std::ofstream m_file;
+    qint64 m_fileSize {0};
+
+    std::mutex m_viewMutex;
+    std::deque<Entry> m_viewEntries;
+};
+
+inline void write(Severity severity, const char *source, const QString &text)
+{
+    Sink::instance().write(severity, source, text);
+}
+
+// Newest messages for a list view. Once full, the oldest rows are removed as
+// new ones come in.
+class Model : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit Model(size_t capacity, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(const std::vector<Entry> &entries);
+    void clear();
+
+private:
+    RingBuffer<Entry> m_entries;
+};
+
+}
+
+#endif // LOGSINK_H
@@ -2,13 +2,13 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <fstream>
 #include "gmessagehandler.h"
 
 class Printer;
 class PrintThread;
 class LinePrintWidget;
 class OutputWindow;
+class SerialStatsWindow;
 class PowderSetupWidget;
 class QMessageBox;
 class BedMicroscopeWidget;
@@ -64,8 +64,12 @@ private slots:
     void connected_to_motion_controller();
 
     void print_to_output_window(QString s);
+    void print_warning_to_output_window(QString s);
+    void print_error_to_output_window(QString s);
     void on_removeBuildBox_clicked();
     void on_actionShow_Hide_Console_triggered();
+    void on_actionShow_Hide_Serial_Statistics_triggered();
+    void on_actionExport_Event_Timeline_triggered();
     void show_hide_droplet_analyzer_window();
     void generate_printing_message_box(const std::string &message);
 
@@ -96,6 +100,8 @@ private:
     LinePrintWidget *linePrintingWidget {nullptr};
     QDockWidget *dockWidget {nullptr};
     OutputWindow *outputWindow {nullptr};
+    QDockWidget *serialStatsDockWidget {nullptr};
+    SerialStatsWindow *serialStatsWindow {nullptr};
     PowderSetupWidget *powderSetupWidget {nullptr};
     JettingWidget *jettingWidget {nullptr};
     HighSpeedLineWidget *highSpeedLineWidget {nullptr};
@@ -106,8 +112,5 @@ private:
     QMessageBox *messageBox {nullptr};
     // TODO: should this go somewhere else?
     GMessageHandler *messageHandler {nullptr};
-
-
-    std::ofstream logFile;
 };
 #endif // MAINWINDOW_H
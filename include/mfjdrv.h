@@ -72,6 +72,8 @@ public:
     explicit CommandBuilder();
     const QByteArray build(CMD command,
                                    Settings &m_jetParams);
+    // DROPS goes out as two bytes, or one on older controllers when it fits
+    bool two_byte_drops(long drops) const {return gDreamController || drops > 255;}
 
 private:
 
@@ -36,7 +36,7 @@ public:
     int connect_to_misters();
     void disconnect_serial();
 
-    void send_command(CMD command);
+    void send_command(CMD command, Priority priority = Priority::Normal);
     void turn_on_misters();
     void turn_off_misters();
     void turn_on_left_mister();
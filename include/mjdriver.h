@@ -2,11 +2,54 @@
 #define MJDRIVER_H
 
 #include <QMutex>
+#include <QElapsedTimer>
+#include <QImage>
+#include <array>
+#include <limits>
+#include <vector>
 #include "asyncserialdevice.h"
 
 namespace Added_Scientific
 {
 
+// The board's JSON replies (the serial emulator in tools/serialemu answers the same way):
+//   'b' / 'B'   {"heads": [{"head": 1, "power": true, "voltage": 24.00, "temp": 30.0}, ...], "mode": 4, "position": 1200}
+//   't'         {"temps": [30.1, 29.8, 30.0, 30.2]}
+//   image data  {"image": {"head": 1, "count": 2048, "sum": 51234}} count and sum of the bytes after 'W' and the head
+
+// head temperatures reported by the board (NaN for heads that weren't reported)
+struct HeadTemperatures
+{
+    static constexpr double notReported {std::numeric_limits<double>::quiet_NaN()};
+    std::array<double, 4> temperature_C {notReported, notReported, notReported, notReported};
+};
+
+// status of a single printhead
+struct HeadStatus
+{
+    int head {0}; // 1-4
+    bool powered {false};
+    double voltage {0.0};
+    double temperature_C {HeadTemperatures::notReported};
+};
+
+struct BoardStatus
+{
+    std::vector<HeadStatus> heads;
+    int mode {-1};          // -1 if not reported
+    qint64 position {0};    // encoder counts
+};
+
+// what the board says it got of an image, checked against the upload it answers
+struct ImageReceipt
+{
+    int head {0};
+    qint64 count {0};
+    qint64 sum {0};
+
+    bool operator==(const ImageReceipt &other) const {return head == other.head && count == other.count && sum == other.sum;}
+};
+
 // class for controlling serial communications with
 // the multi-nozzle printhead from added scientific
 class Controller final : public AsyncSerialDevice
@@ -53,7 +96,8 @@ public:
     void report_head_temps();
     QByteArray convert_image(int headIdx, const QImage &image, int whiteSpace);
     void send_image_data(int headIdx, const QImage &image, int whiteSpace);
-    void reconstructed_bitmap(int headIdx, const QByteArray &imageData, int width, int height); // 12/1 added headIdx
+    void send_packed_image_data(const QByteArray &imageData); // data already in the convert_image format
+    QImage reconstructed_bitmap(const QByteArray &imageData, int width, int height); // unpack image data from convert_image to check it
 
     void create_bitmap_lines(int numLines, int width);
     void createBitmapTestLines(int numberOfLines,  int lineSpacing, int dropletSpacing, int frequency, int lineLength, int number);
@@ -68,7 +112,17 @@ public:
     void external_dropwatch_mode();
 
 
-    void write_line(const QByteArray &data); // this should really be protected, but is public for testing
+    void write_line(const QByteArray &data, Priority priority = Priority::Normal); // this should really be protected, but is public for testing
+
+    // echo JSON status to the output window, at most once every minInterval_ms
+    // (turn off when polling status at a high rate during prints)
+    void set_json_echo(bool enabled, int minInterval_ms = 500);
+
+signals:
+    void status_received(const Added_Scientific::BoardStatus &status);
+    void head_temperatures_received(const Added_Scientific::HeadTemperatures &temperatures);
+    // an image that doesn't match the one sent is also reported as a failed bulk write
+    void image_received(const Added_Scientific::ImageReceipt &receipt);
 
 protected:
 
@@ -78,8 +132,31 @@ protected:
 
     void clear_members();
     void handle_serial_error(QSerialPort::SerialPortError serialPortError);
+
+private:
+    void handle_reply(const QByteArray &frame);
+    void check_image(const ImageReceipt &receipt);
+    void echo_json(const QByteArray &frame);
+    void flush_text_reply();
+
+private:
+    // image data goes out in chunks so the 1 Mbaud link stays busy and a stalled write is retried
+    const int imageChunkSize {4096};
+
+    bool jsonEcho {true};
+    int jsonEchoInterval_ms {500};
+    QElapsedTimer jsonEchoTimer;
+    int jsonEchoSkipped {0};
+
+    // text replies don't always end in '\n', one that stops arriving for this long is complete
+    QTimer *textReplyTimer {nullptr};
+    const int textReplyQuiet_ms {50};
 };
 
 }
 
+Q_DECLARE_METATYPE(Added_Scientific::BoardStatus)
+Q_DECLARE_METATYPE(Added_Scientific::HeadTemperatures)
+Q_DECLARE_METATYPE(Added_Scientific::ImageReceipt)
+
 #endif // MJDRIVER_H
@@ -2,12 +2,14 @@
 #define OUTPUTWINDOW_H
 
 #include <QWidget>
-#include <fstream>
+#include "logsink.h"
 
 extern bool printComplete;
 extern bool atLocation;
 extern bool recoatComplete;
 
+class QTimer;
+
 namespace Ui {
 class OutputWindow;
 }
@@ -17,17 +19,24 @@ class OutputWindow : public QWidget
     Q_OBJECT
 
 public:
-    explicit OutputWindow(QWidget *parent, std::ofstream& logFile);
+    explicit OutputWindow(QWidget *parent = nullptr);
     ~OutputWindow();
+
+    void log(Log::Severity severity, const char *source, const QString &s);
+
 public slots:
+    // tagged with the class name of the object that sent it
     void print_string(QString s);
 
 private slots:
     void clear_text();
+    void refresh();
+    void copy_selection();
 
 private:
     Ui::OutputWindow *ui;
-    std::ofstream& m_logFile;
+    Log::Model *m_model {nullptr};
+    QTimer *m_refreshTimer {nullptr};
 };
 
 #endif // OUTPUTWINDOW_H
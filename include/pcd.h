@@ -2,11 +2,20 @@
 #define PCD_H
 
 #include <QMutex>
+#include <vector>
 #include "asyncserialdevice.h"
+#include "ringbuffer.h"
 
 namespace PCD
 {
 
+struct PressureSample
+{
+    qint64 time_ms {0};        // ms since epoch
+    double pressure_psig {0.0}; // measured
+    double setPoint_psig {0.0}; // as reported by the controller
+};
+
 class Controller final : public AsyncSerialDevice
 {
     Q_OBJECT
@@ -36,11 +45,27 @@ public:
     void disconnect_serial();
 
     void update_set_point(double setPoint_PSIG);
+    double set_point() const; // last set point sent
     void purge();
     void stop_purge();
 
+    // poll the measured pressure every interval_ms (0 stops polling).
+    // samples are kept in a ring buffer covering the last few hours
+    void set_telemetry_interval(int interval_ms);
+    int telemetry_interval() const;
+    std::vector<PressureSample> pressure_history() const; // oldest first
+    // what a poll sends (without the '\r') and the unit ID its data frame starts with.
+    // An Alicat controller answers its unit ID on its own, the default is unit 'a'
+    void set_telemetry_command(const QString &pollCommand, QChar unitID);
+    void clear_pressure_history();
+
+signals:
+    void pressure_sample_received(const PCD::PressureSample &sample);
+
 private:
     void initialize_pressure_controller();
+    void poll_pressure();
+    bool parse_data_frame(const QString &frame, PressureSample &sample) const;
 
     // consider making these virtual functions in the asyncserialdevice ??
     void handle_ready_read();
@@ -55,8 +80,17 @@ private:
     // Members to help with initialization
     InitState initState {NOT_INITIALIZED};
     const QString initString = "PCD";
+
+    double setPoint_psig {0.0};
+    QTimer *telemetryTimer {nullptr};
+    QString telemetryPoll {QChar(UNIT_ID)};
+    QChar telemetryUnitID {UNIT_ID};
+    static constexpr size_t maxHistorySamples {100000}; // ~5.5 hours at 5 Hz
+    RingBuffer<PressureSample> history {maxHistorySamples};
 };
 
 }
 
+Q_DECLARE_METATYPE(PCD::PressureSample)
+
 #endif // PCD_H
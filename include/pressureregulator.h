@@ -0,0 +1,65 @@
+#ifndef PRESSUREREGULATOR_H
+#define PRESSUREREGULATOR_H
+
+#include <QObject>
+#include <QTimer>
+
+class Printer;
+
+struct PressureRegulatorSettings
+{
+    enum class Source
+    {
+        DropletVelocity, // nudge the set point toward a target droplet velocity
+        ReservoirLevel   // cancel the hydrostatic head change as the reservoir axis moves
+    };
+
+    Source source {Source::DropletVelocity};
+
+    double targetVelocity_m_s {2.0};
+    double velocityGain {0.05};        // psi per m/s of velocity error, applied per measurement
+    double reservoirGain {0.00142};    // psi per mm of reservoir travel (water is 0.00142 psi/mm)
+    int reservoirPollInterval_ms {1000};
+
+    double maxStep_psi {0.05};         // largest set point change per update
+    double minSetPoint_psig {-2.0};
+    double maxSetPoint_psig {2.0};
+};
+
+// Adjusts the pressure controller set point from droplet velocity measurements
+// or from the position of the reservoir axis. Only one source is used at a time.
+class PressureRegulator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PressureRegulator(Printer *printer, QObject *parent = nullptr);
+
+    void start(const PressureRegulatorSettings &settings);
+    void stop();
+    bool is_running() const {return m_running;}
+
+public slots:
+    void droplet_velocity_measured(double velocity_m_s);
+
+signals:
+    void set_point_changed(double setPoint_psig);
+    void print_to_output_window(QString s);
+
+private:
+    void poll_reservoir();
+    void reservoir_position_read(char axis, int counts, bool ok);
+    void apply_set_point(double setPoint_psig);
+
+private:
+    Printer *mPrinter {nullptr};
+    QTimer *m_reservoirTimer {nullptr};
+    PressureRegulatorSettings m_settings;
+    bool m_running {false};
+
+    double m_baseSetPoint_psig {0.0};  // set point when the loop started
+    double m_referencePosition_mm {0.0}; // reservoir position when the loop started
+    bool m_referenceKnown {false};       // the first reading after start sets the reference
+    int m_failedReads {0};
+};
+
+#endif // PRESSUREREGULATOR_H
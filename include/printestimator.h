@@ -0,0 +1,115 @@
+#ifndef PRINTESTIMATOR_H
+#define PRINTESTIMATOR_H
+
+#include <QString>
+#include <vector>
+
+#include "printer.h"
+#include "recoatplanner.h"
+
+// One encoder pass as the MJ print job runs it (see MJPrintheadWidget::runEncoderPass)
+struct PassPlan
+{
+    int layer {1};
+    int pass {1};
+    double startX_mm {0.0};     // left edge of the image
+    double y_mm {0.0};          // axis position, head offset included
+    int columns {0};            // droplets along the pass
+    bool reversed {false};
+    int uploadBytes {0};        // image data for both heads
+    int headsLoaded {2};        // each loaded head waits for a status check
+    int yShift_rows {0};        // dither shift of the layer, already in y_mm
+};
+
+struct PrintEstimatorSettings
+{
+    double printFrequency_Hz {1000.0};
+    double printSpeed_mm_s {50.0};
+    double printAcceleration_mm_s2 {3000.0}; // runEncoderPass
+    double runwaySafetyFactor {2.0};
+
+    // moveToLocation moves Y, then X
+    double moveXAcceleration_mm_s2 {600.0};
+    double moveXSpeed_mm_s {60.0};
+    double moveYAcceleration_mm_s2 {800.0};
+    double moveYSpeed_mm_s {60.0};
+    double parkX_mm {5.0};                   // moveNozzleOffPlate
+
+    double serialBaud {1000000.0};           // MJ board, 10 bits per byte
+    double headStatusCheck_s {0.05};         // readyHeads round trip
+    double programStart_s {0.05};            // download and XQ of each motion program
+    double passSleeps_s {0.35};              // GSleeps in and around every pass
+
+    // where the recoat leaves Y until the planner knows the back limit
+    double yAfterRecoat_mm {0.0};
+};
+
+struct LayerEstimate
+{
+    int layer {1};
+    int passes {0};
+    double recoat_s {0.0};      // park and the planned recoat
+    double travel_s {0.0};      // moves to the start of each pass
+    double upload_s {0.0};
+    double printing_s {0.0};    // encoder pass motion, runways included
+    double overhead_s {0.0};    // sleeps, status checks and program starts
+
+    double total_s() const {return recoat_s + travel_s + upload_s + printing_s + overhead_s;}
+};
+
+struct JobEstimate
+{
+    std::vector<LayerEstimate> layers;
+
+    double total_s() const;
+    LayerEstimate sum() const; // every layer added together
+    QString summary() const;
+    bool write_csv(const QString &path) const;
+};
+
+// Predicts how long an MJ print job takes from the same motion the job runs:
+// trapezoidal moves with the job's accelerations and speeds, the encoder runway,
+// the image upload at the serial baud rate and the recoat the print job plans.
+class PrintEstimator
+{
+public:
+    explicit PrintEstimator(const PrintEstimatorSettings &settings = {}, const RecoatSettings &recoat = {}, const RecoatPlanner &recoatPlanner = RecoatPlanner());
+
+    // passes in print order, layers without passes still get a recoat
+    JobEstimate estimate(const std::vector<PassPlan> &passes, int layerCount) const;
+    LayerEstimate estimate_layer(int layer, const std::vector<PassPlan> &passes, double &x_mm, double &y_mm) const;
+    const PrintEstimatorSettings &settings() const {return m_settings;}
+    const RecoatPlanner &recoat_planner() const {return m_recoatPlanner;}
+    RecoatPlanner &recoat_planner() {return m_recoatPlanner;}
+
+    // time for a point to point move that starts and ends at rest
+    static double move_time(double distance_mm, double speed_mm_s, double acceleration_mm_s2, double deceleration_mm_s2);
+
+private:
+    PrintEstimatorSettings m_settings;
+    RecoatSettings m_recoat;
+    RecoatPlanner m_recoatPlanner;
+};
+
+// Scales the time left in a job by how long the finished layers really took
+// compared with their estimates.
+class EtaTracker
+{
+public:
+    void start(const JobEstimate &estimate);
+    // estimate of a layer only known once it's prepared (streamed jobs)
+    void set_layer_estimate(const LayerEstimate &layer);
+    void layer_finished(int layer, double measured_s);
+
+    double correction() const; // measured / estimated over the finished layers
+    double remaining_s() const;
+    QString status_text() const;
+
+private:
+    std::vector<double> m_estimated_s; // by layer - 1
+    std::vector<bool> m_finished;
+    double m_finishedEstimate_s {0.0};
+    double m_finishedMeasured_s {0.0};
+};
+
+#endif // PRINTESTIMATOR_H
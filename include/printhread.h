@@ -32,8 +32,9 @@ public:
     explicit PrintThread(QObject *parent = nullptr);
     ~PrintThread();
     void setup(DMC4080 *printer);
-    void execute_command(std::stringstream &ss);
-    void stop();
+    // false if the commands were refused because the last ones haven't finished
+    bool execute_command(std::stringstream &ss);
+    void stop(); // drops what is left in the queue, emits stopped()
     void print_gcmds(bool print);
 
 private:
@@ -45,6 +46,7 @@ signals:
     void response(QString s);
     void error(const std::string &text);
     void ended();
+    void stopped(); // before the ended() of the commands that were stopped
     void connected_to_controller();
 
 private:
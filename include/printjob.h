@@ -0,0 +1,304 @@
+#ifndef PRINTJOB_H
+#define PRINTJOB_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "jobjournal.h"
+#include "printestimator.h"
+#include "printpipeline.h"
+
+class QThread;
+class QTimer;
+class Printer;
+namespace Added_Scientific { class Controller; }
+
+// One pass of a print job with the image data for each head
+struct JobPass
+{
+    PassPlan plan;
+    QByteArray head1;               // in the Controller::convert_image format,
+    QByteArray head2;               // empty if the head prints nothing in this pass
+
+    // worked out by the job while the layer before is recoated
+    double runway_mm {0.0};
+    double startX_mm {0.0};         // runway included
+    double endX_mm {0.0};
+    std::string moveProgram;        // DMC programs to the start of the pass and through it
+    std::string printProgram;
+    QStringList warnings;           // shown when the pass prints
+};
+
+struct JobLayer
+{
+    int layer {1};
+    std::vector<JobPass> passes;
+    std::string program;            // every pass as one DMC program if the controller sequences them
+};
+
+// The last pass of a job that was printed, layer 0 if nothing was
+struct JobCheckpoint
+{
+    int layer {0};
+    int pass {0};
+};
+
+// Hands a print job its layers in order. next_layer() is called on the job's thread.
+class PrintJobSource
+{
+public:
+    enum class Next {Ready, Waiting, Finished, Failed};
+
+    virtual ~PrintJobSource() = default;
+    virtual bool start(QString &error) {Q_UNUSED(error); return true;}
+    virtual void stop() {}
+    virtual int layer_count() const = 0;
+    virtual Next next_layer(JobLayer &layer, QString &error) = 0;
+    // a resumed job doesn't need the layers below this one
+    virtual void skip_layers_before(int layer) {Q_UNUSED(layer);}
+};
+
+// Pass bitmaps of a job folder, plan[i] prints passFiles[i]
+class FolderJobSource : public PrintJobSource
+{
+public:
+    FolderJobSource(Added_Scientific::Controller *controller, std::vector<PassPlan> plan, QStringList passFiles, int headGapColumns, int layerCount);
+
+    int layer_count() const override {return m_layerCount;}
+    Next next_layer(JobLayer &layer, QString &error) override;
+    void skip_layers_before(int layer) override;
+
+private:
+    Added_Scientific::Controller *m_controller {nullptr}; // converts the bitmaps
+    std::vector<PassPlan> m_plan;
+    QStringList m_passFiles;
+    int m_headGapColumns {0};
+    int m_layerCount {0};
+    size_t m_next {0};
+};
+
+// Layers sliced while the job prints (see Slicer::PrintPipeline)
+class StreamingJobSource : public PrintJobSource
+{
+public:
+    using Planner = std::function<std::vector<PassPlan>(const Slicer::PreparedLayer &layer)>;
+
+    StreamingJobSource(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job,
+                       const Slicer::PipelineSettings &settings, Planner planner);
+
+    bool start(QString &error) override;
+    void stop() override;
+    int layer_count() const override {return m_pipeline.layer_count();}
+    Next next_layer(JobLayer &layer, QString &error) override;
+
+private:
+    Slicer::PrintPipeline m_pipeline;
+    Planner m_planner;
+};
+
+struct PrintJobSettings
+{
+    double printFrequency_Hz {1000.0};
+    double printSpeed_mm_s {50.0};
+    double reverseOffset_mm {0.0};  // moves -X passes onto the +X ones
+    RecoatSettings recoat;
+
+    // put back on the heads after they are power cycled
+    int headFrequency_Hz {1000};
+    double headVoltage {0.0};
+
+    // the passes move the way the estimate assumes they do and the
+    // recoat is planned by its recoat_planner() (see RecoatPlanner)
+    PrintEstimator estimator;
+    JobEstimate estimate;           // one entry per layer, filled in as layers arrive if estimateLayers
+    bool estimateLayers {false};
+
+    // every recoat and pass is logged here if set (see JobJournal)
+    QString journalPath;
+    QString jobName;
+
+    // the controller runs all passes of a layer from a pass table and only
+    // stops for the heads to be loaded, instead of a program per move
+    bool controllerSequenced {false};
+};
+
+// Runs an MJ print job on its own thread. Every step starts the next one when the
+// event it waits for comes in: the motion controller finishing a program
+// (PrintThread::ended), the heads reporting ready, or a settling timer. Nothing
+// spins, so the PC sits idle while the printer moves. The next layer is read,
+// checked and planned and its first pass loaded into the heads while the layer
+// is recoated, so printing picks up as soon as the roller is done. A pause takes
+// effect once the current layer is done, and the last pass printed is reported
+// after every pass so a job that stops can be started again after it.
+//
+// With PrintJobSettings::controllerSequenced a layer is one program that moves
+// to and prints every pass on its own. It reports each pass with an MG
+// "MJ PASS n" and waits at the start of the next one until the job sets mjHeads
+// to say that pass is in the heads, so the heads load while the stage travels.
+// A flag the program doesn't take, or a minute without a pass, halts it and
+// fails the job.
+class PrintJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Result {Complete, Cancelled, Failed};
+    Q_ENUM(Result)
+
+    explicit PrintJob(Printer *printer);
+    ~PrintJob();
+
+public slots:
+    // layers and passes up to and including resumeAfter are skipped, a checkpoint
+    // with pass 0 means that layer was recoated but none of it was printed
+    void start(std::shared_ptr<PrintJobSource> source, const PrintJobSettings &settings, const JobCheckpoint &resumeAfter);
+    void pause();
+    void resume();
+    void cancel();
+
+signals:
+    void status_changed(const QString &text);
+    void layer_started(int layer, int layerCount);
+    void checkpoint_reached(int layer, int pass);
+    void paused_changed(bool paused);
+    void job_finished(PrintJob::Result result, const QString &summary);
+    void print_to_output_window(QString s);
+
+private slots:
+    void cleanup();
+    void motion_finished();
+    void motion_stopped();
+    void head_response(const QString &response);
+    void head_timeout();
+    void head_upload_failed(const QString &reason);
+    void settled();
+    void controller_message(const QString &message);
+    void layer_program_timeout();
+
+private:
+    enum class State
+    {
+        Idle,
+        WaitingForLayer,    // the source is still preparing the next layer
+        LoadingHeads,       // image data going to the board, then a status check per head
+        Parking,            // heads moving off the plate for a recoat or a pause
+        Recoating,
+        MovingToStart,
+        Printing,
+        Settling,           // the short waits the old print loop did with GSleep
+        Paused,
+        Finished
+    };
+
+    void continue_after_layer();
+    void fetch_layer();
+    bool prepare_layer(JobLayer &layer, QString &error) const;
+    void layer_arrived();
+    void begin_layer();
+    void start_recoat();
+    void recoat();
+    void recoat_done();
+    void start_pass();
+    void announce_pass();
+    void preload_heads();
+    void load_heads(const JobPass &pass, std::function<void()> done);
+    void reload_heads();
+    void send_head();
+    void request_head_status();
+    void head_failed();
+    void recover_heads();
+    void move_to_start();
+    void arm_and_print();
+    void print_pass();
+    void pass_done();
+    void record_pass();
+    void layer_done();
+
+    std::string layer_program(const JobLayer &layer) const;
+    void start_layer_program();
+    void passes_printed(int printed);
+    void layer_program_ended();
+    void stop_layer_program();
+    void layer_program_failed(const QString &reason);
+    void park(State after);
+    void parked();
+    void finish(Result result, const QString &reason = QString());
+
+    void set_state(State state);
+    void settle(int milliseconds, std::function<void()> next);
+    // downloads the program and runs it, next is called once the controller finishes it.
+    // The job fails if the program can't be sent and ends if the printer is stopped
+    void run_program(const std::string &program, State state, std::function<void()> next);
+    void run_commands(std::stringstream &s, State state, std::function<void()> next);
+    void motion_failed(const QString &reason);
+    // calls into the MJ board have to be made on its thread, next runs back on this one after them
+    void on_controller(std::function<void(Added_Scientific::Controller *)> call, std::function<void()> next = nullptr);
+    void message(const QString &text);
+    void journal(const QString &event, const QString &note = QString());
+    double z_position_mm() const;
+    double y_position_mm() const;
+    double position_mm(const char *command, double countsPerMM) const;
+    bool read_controller(const char *command, int &value) const;
+    const JobPass &current_pass() const {return m_layer.passes[m_passIndex];}
+
+private:
+    Printer *m_printer {nullptr};
+    std::unique_ptr<QThread> m_thread;
+    QTimer *m_headTimer {nullptr};
+    QTimer *m_settleTimer {nullptr};
+    QTimer *m_layerProgramTimer {nullptr}; // no pass reported for this long, the program is stuck
+
+    std::shared_ptr<PrintJobSource> m_source;
+    PrintJobSettings m_settings;
+    JobCheckpoint m_resumeAfter;
+    JobCheckpoint m_checkpoint;
+    JobJournal m_journal;
+
+    // the printer, the heads and the source can each be busy at once,
+    // each runs its continuation when it is done
+    State m_state {State::Idle};
+    std::function<void()> m_afterMotion;
+    std::function<void()> m_afterSettle;
+    std::function<void()> m_afterHeads;
+    State m_afterPark {State::Idle};
+    Result m_result {Result::Complete};
+    QString m_reason;
+    bool m_pauseRequested {false};
+    bool m_cancelRequested {false};
+    bool m_finishing {false};
+    bool m_motionStopped {false};   // the print thread was stopped, nothing more goes to the printer
+
+    JobLayer m_layer;
+    size_t m_passIndex {0};
+    JobLayer m_next;                // read in during the recoat
+    bool m_nextReady {false};
+    bool m_sourceDone {false};
+    bool m_recoating {false};
+    int m_recoatedLayer {1};        // the powder on the bed is for this layer
+
+    std::vector<QByteArray> m_headData;
+    std::vector<QByteArray> m_headsToLoad;
+    PassPlan m_headPlan;
+    bool m_loadingHeads {false};
+    bool m_headsPreloaded {false};  // the first pass of m_next is in the heads
+    int m_headAttempt {0};
+    int m_headUpload {0};           // counts uploads, a failed one mustn't get its status checked
+    bool m_layerProgramRunning {false};
+
+    double m_z_mm {std::numeric_limits<double>::quiet_NaN()}; // read after each recoat, passes are journaled with it
+
+    EtaTracker m_eta;
+    double m_estimateX_mm {0.0};
+    double m_estimateY_mm {0.0};
+    QElapsedTimer m_jobTimer;
+    QElapsedTimer m_layerTimer;
+};
+
+#endif // PRINTJOB_H
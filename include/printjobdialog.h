@@ -0,0 +1,41 @@
+#ifndef PRINTJOBDIALOG_H
+#define PRINTJOBDIALOG_H
+
+#include <QDialog>
+
+class QLabel;
+class QProgressBar;
+class QPushButton;
+
+// Progress of a running PrintJob with buttons to pause it after the
+// current layer and to cancel it after the current pass.
+class PrintJobDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit PrintJobDialog(int layerCount, QWidget *parent = nullptr);
+
+public slots:
+    void set_status(const QString &text);
+    void set_layer(int layer, int layerCount);
+    void set_paused(bool paused);
+    void reject() override; // Esc or the close button cancel the job, it closes once the job stops
+
+signals:
+    void pause_requested();
+    void resume_requested();
+    void cancel_requested();
+
+private:
+    void pause_clicked();
+
+private:
+    QLabel *m_status {nullptr};
+    QProgressBar *m_progress {nullptr};
+    QPushButton *m_pauseButton {nullptr};
+    QPushButton *m_cancelButton {nullptr};
+    bool m_paused {false};
+};
+
+#endif // PRINTJOBDIALOG_H
@@ -0,0 +1,95 @@
+#ifndef RECOATPLANNER_H
+#define RECOATPLANNER_H
+
+#include <QString>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "printer.h"
+
+// Motion limits and bed geometry of a recoat. The defaults are the moves of
+// CMD::spread_layer. The back limit is measured by the print job after its first
+// recoat, the roller offset and fast roller speed are set in the MJ widget.
+struct RecoatProfile
+{
+    double zOffsetUnderRoller_mm {0.5};
+    double zAcceleration_mm_s2 {10.0};
+    double zSpeed_mm_s {2.0};
+
+    double yReturnAcceleration_mm_s2 {400.0};
+    double yReturnSpeed_mm_s {50.0};         // back to just before the limit once it is known
+    double yLimitJogSpeed_mm_s {50.0};       // into the back limit switch
+    double yLimitApproach_mm {5.0};
+    double yStrokeAcceleration_mm_s2 {1000.0};
+    double hopperTravel_mm {100.0};          // forward of the back limit
+    double rollerTravel_mm {175.0};          // forward of the end of the hopper stroke
+    double rollerFastSpeed_mm_s {0.0};       // roller speed away from the part, 0 keeps the traverse speed everywhere
+    double returnTravel_mm {275.0};          // assumed when the start or the back limit is unknown
+
+    double backLimitY_mm {std::numeric_limits<double>::quiet_NaN()};
+    // the roller is over the spot the heads print at Y when the stage is at Y + rollerOffsetY_mm
+    double rollerOffsetY_mm {std::numeric_limits<double>::quiet_NaN()};
+    double partMargin_mm {5.0};
+};
+
+// Y range the heads have printed over, pass positions widened by a swath
+struct RecoatBuildBox
+{
+    double swath_mm {0.0};
+    double minY_mm {std::numeric_limits<double>::quiet_NaN()};
+    double maxY_mm {std::numeric_limits<double>::quiet_NaN()};
+
+    bool is_empty() const {return std::isnan(minY_mm);}
+    void include(double y_mm);
+};
+
+struct RecoatPlan
+{
+    std::string program;            // DMC, run with the motion controller's XQ
+    double cycle_s {0.0};
+    double baseline_s {0.0};        // spread_layer from the same place with the same settings
+    double endY_mm {std::numeric_limits<double>::quiet_NaN()}; // NaN if the back limit is unknown
+    bool zRetractOverlapped {false};
+    bool rollerSpeedZoned {false};
+
+    QString summary() const;
+};
+
+// Plans the recoat of a print job as a downloaded program instead of the
+// command stream of spread_layer. Each axis already moves on the controller's
+// time optimal trapezoid, so the time comes out of the waits between them:
+// the Z raise runs during the hopper dwell, the Z retract runs during the Y
+// return when the roller stays clear of the part while Z is still up, the
+// return only jogs into the limit switch for its last few mm, and the roller
+// crosses the bed away from the part at its fast speed. Without the back limit
+// and the roller offset only the first of these is safe and the plan is
+// spread_layer with the hopper dwell and Z raise overlapped.
+class RecoatPlanner
+{
+public:
+    explicit RecoatPlanner(const RecoatProfile &profile = {}, const RecoatBuildBox &box = {});
+
+    // fromY_mm is where Y is when the recoat starts, NaN if unknown
+    RecoatPlan plan(const RecoatSettings &settings, double fromY_mm) const;
+    double baseline_time(const RecoatSettings &settings, double fromY_mm) const;
+
+    const RecoatProfile &profile() const {return m_profile;}
+    RecoatProfile &profile() {return m_profile;}
+    const RecoatBuildBox &box() const {return m_box;}
+    RecoatBuildBox &box() {return m_box;}
+
+    // time for a move that starts at speedIn and ends at speedOut, cruising at speed if it can
+    static double segment_time(double distance_mm, double speedIn_mm_s, double speed_mm_s, double speedOut_mm_s, double acceleration_mm_s2);
+    // how far a move from rest gets in the given time
+    static double distance_after(double time_s, double distance_mm, double speed_mm_s, double acceleration_mm_s2);
+
+private:
+    double return_travel(double fromY_mm) const;
+    double z_raise(const RecoatSettings &settings) const;
+
+    RecoatProfile m_profile;
+    RecoatBuildBox m_box;
+};
+
+#endif // RECOATPLANNER_H
@@ -0,0 +1,49 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+// Fixed capacity buffer that overwrites the oldest item once it is full.
+// Not thread-safe, the owner is expected to lock around it.
+template<typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity) : m_items(capacity > 0 ? capacity : 1) {}
+
+    void push(const T &item)
+    {
+        m_items[m_next] = item;
+        m_next = (m_next + 1) % m_items.size();
+        if (m_size < m_items.size()) m_size++;
+    }
+
+    // drops the n oldest items
+    void pop_front(size_t n = 1) {m_size -= (n < m_size) ? n : m_size;}
+    void clear() {m_next = 0; m_size = 0;}
+    size_t size() const {return m_size;}
+    size_t capacity() const {return m_items.size();}
+    bool empty() const {return m_size == 0;}
+    bool full() const {return m_size == m_items.size();}
+
+    // i = 0 is the oldest item
+    const T &at(size_t i) const {return m_items[(m_next + m_items.size() - m_size + i) % m_items.size()];}
+    const T &back() const {return at(m_size - 1);}
+
+    // items from oldest to newest
+    std::vector<T> to_vector() const
+    {
+        std::vector<T> v;
+        v.reserve(m_size);
+        for (size_t i = 0; i < m_size; i++) v.push_back(at(i));
+        return v;
+    }
+
+private:
+    std::vector<T> m_items;
+    size_t m_next {0}; // where the next item goes
+    size_t m_size {0};
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,61 @@
+#ifndef SERIALSTATS_H
+#define SERIALSTATS_H
+
+#include <QJsonObject>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+// Histogram of durations with power-of-two microsecond buckets.
+// Recording is lock-free so it can be read from the GUI thread
+// while a device records on its own thread.
+class LatencyHistogram
+{
+public:
+    static constexpr int numBuckets {24}; // bucket i counts [2^i, 2^(i+1)) us, the last one is open ended
+
+    struct Snapshot
+    {
+        std::array<quint64, numBuckets> counts {};
+        quint64 count {0};
+        qint64 total_us {0};
+        qint64 max_us {0};
+
+        double mean_ms() const;
+        double percentile_ms(double fraction) const; // upper edge of the bucket holding the percentile
+        QJsonObject to_json() const;
+    };
+
+    void record(qint64 duration_us);
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    std::array<std::atomic<quint64>, numBuckets> m_counts {};
+    std::atomic<quint64> m_count {0};
+    std::atomic<qint64> m_total_us {0};
+    std::atomic<qint64> m_max_us {0};
+};
+
+// Command statistics for one serial device
+class SerialStats
+{
+public:
+    SerialStats();
+
+    LatencyHistogram queueWait; // time from write() until the command is sent
+    LatencyHistogram roundTrip; // time from sending a command until its response
+    std::atomic<quint64> commandsSent {0};
+    std::atomic<quint64> timeouts {0};
+    std::atomic<quint64> bytesWritten {0};
+    std::atomic<quint64> bytesRead {0};
+
+    double elapsed_s() const; // time since the statistics were reset
+    void reset();
+    QJsonObject to_json() const;
+
+private:
+    std::atomic<qint64> m_start_ms {0};
+};
+
+#endif // SERIALSTATS_H
@@ -0,0 +1,42 @@
+#ifndef SERIALSTATSWINDOW_H
+#define SERIALSTATSWINDOW_H
+
+#include <QWidget>
+#include <QVector>
+#include <QJsonDocument>
+
+class AsyncSerialDevice;
+class QTableWidget;
+class QTimer;
+
+// Table of queue wait, round trip latency, throughput and timeouts
+// for each serial device, refreshed once a second
+class SerialStatsWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SerialStatsWindow(const QVector<AsyncSerialDevice*> &devices, QWidget *parent = nullptr);
+
+    QJsonDocument to_json() const;
+
+public slots:
+    void refresh();
+    void reset_statistics();
+    void save_json();
+
+private:
+    struct RateSample
+    {
+        quint64 bytesWritten {0};
+        quint64 bytesRead {0};
+        double time_s {0.0};
+    };
+
+    QVector<AsyncSerialDevice*> m_devices;
+    QVector<RateSample> m_lastSample; // for bytes/s since the last refresh
+    QTableWidget *m_table {nullptr};
+    QTimer *m_refreshTimer {nullptr};
+};
+
+#endif // SERIALSTATSWINDOW_H
@@ -0,0 +1,98 @@
+#ifndef SLICERDIALOG_H
+#define SLICERDIALOG_H
+
+#include <QDialog>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "layerslicer.h"
+#include "slicejob.h"
+
+class QTableWidget;
+class QDoubleSpinBox;
+class QSpinBox;
+class QCheckBox;
+class QLineEdit;
+class QSlider;
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class QTimer;
+
+// Places STL parts on the bed, previews their layers and slices them into an
+// MJ print job folder with the native slicer (replaces STL_Slicer_Dual.py), or
+// hands the scene to the MJ widget to slice while it prints.
+class SlicerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SlicerDialog(QWidget *parent = nullptr);
+    ~SlicerDialog();
+
+    // print and estimate stay off while the MJ widget has a job running
+    void set_print_job_running(bool running);
+    // estimate_requested is answered on a worker, the dialog stays busy until this
+    void estimate_finished();
+
+signals:
+    void print_to_output_window(QString s);
+    void job_sliced(QString folder);
+    void print_requested(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job, const QString &archiveFolder);
+    void estimate_requested(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job);
+
+private slots:
+    void add_models();
+    void remove_model();
+    void browse_output_folder();
+    void rebuild_preview();
+    void show_layer(int layer);
+    void slice();
+    void slice_and_print();
+    void estimate();
+    void cancel_slicing();
+
+private:
+    void add_model_row(const Slicer::Mesh &mesh);
+    std::vector<Slicer::Mesh> placed_meshes() const;
+    Slicer::SliceSettings slice_settings() const;
+    Slicer::JobSettings job_settings() const;
+    void slicing_finished(bool ok, const Slicer::JobResult &result, const QString &error, const QString &folder);
+    void set_slicing(bool slicing);
+    std::shared_ptr<Slicer::LayerSlicer> validated_slicer();
+    QString new_job_folder() const;
+
+private:
+    std::vector<Slicer::Mesh> m_models; // as loaded, in table order
+
+    QTableWidget *m_modelTable {nullptr};
+    QDoubleSpinBox *m_layerHeight {nullptr};
+    QDoubleSpinBox *m_dropletSpacing {nullptr};
+    QDoubleSpinBox *m_lineSpacing {nullptr};
+    QDoubleSpinBox *m_frequency {nullptr};
+    QDoubleSpinBox *m_startX {nullptr};
+    QDoubleSpinBox *m_startY {nullptr};
+    QCheckBox *m_yShift {nullptr};
+    QCheckBox *m_archive {nullptr};
+    QLineEdit *m_outputFolder {nullptr};
+    QSlider *m_layerSlider {nullptr};
+    QLabel *m_preview {nullptr};
+    QLabel *m_previewInfo {nullptr};
+    QProgressBar *m_progress {nullptr};
+    QPushButton *m_sliceButton {nullptr};
+    QPushButton *m_printButton {nullptr};
+    QPushButton *m_estimateButton {nullptr};
+    QPushButton *m_cancelButton {nullptr};
+    QTimer *m_previewTimer {nullptr};
+
+    std::unique_ptr<Slicer::LayerSlicer> m_previewSlicer;
+
+    std::thread m_worker;
+    std::atomic<bool> m_cancel {false};
+    bool m_slicing {false};
+    bool m_printJobRunning {false};
+};
+
+#endif // SLICERDIALOG_H
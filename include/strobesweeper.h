@@ -0,0 +1,80 @@
+#ifndef STROBESWEEPER_H
+#define STROBESWEEPER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <vector>
+
+#include "dropletanalyzer.h"
+
+namespace JetDrive { class Controller; }
+
+struct StrobeSweepSettings
+{
+    int startDelay_us {0};
+    int endDelay_us {0};
+    int stepDelay_us {1};
+    int framesPerStep {1};   // number of verified frames to collect at each strobe delay
+    int settleTime_us {0};   // frames that arrive sooner than this after an ack may have been exposed before it
+    int num_steps() const {return (stepDelay_us > 0) ? ((endDelay_us - startDelay_us) / stepDelay_us) + 1 : 1;}
+};
+
+struct StrobeSweepReport
+{
+    int numSteps {0};
+    int numFrames {0};         // frames received during the sweep
+    int numUnsettledFrames {0}; // frames received while a strobe delay change was in flight
+    double duration_s {0.0};
+    double stepRate_Hz {0.0};  // achieved sweep rate
+    std::vector<double> ackLatency_ms;  // command sent -> JetDrive ack, per step
+    std::vector<double> stepLatency_ms; // command sent -> last verified frame, per step
+};
+Q_DECLARE_METATYPE(StrobeSweepReport)
+
+// Steps the JetDrive strobe delay through a sweep in lock-step with the camera.
+// The next strobe delay is requested from the camera's frame thread as soon as
+// a frame exposed at the current delay has been received, so the sweep runs at
+// the camera's frame/trigger rate instead of the rate the GUI processes frames.
+class StrobeSweeper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StrobeSweeper(JetDrive::Controller *jetDrive, QObject *parent = nullptr);
+
+    void start(const StrobeSweepSettings &settings);
+    void stop();
+    bool is_running() const;
+
+    // call for every frame received from the camera (thread-safe)
+    // returns the stamp for the frame and advances the sweep when the current step is complete
+    StrobeFrameStamp frame_received(quint64 cameraTimestamp_100ns);
+
+    static QString report_string(const StrobeSweepReport &report);
+
+signals:
+    void request_strobe_delay(short strobeDelay_us); // queued to the JetDrive's thread
+    void progress(int completedSteps, int numSteps);
+    void sweep_complete(const StrobeSweepReport &report);
+
+private:
+    void strobe_delay_acknowledged(short strobeDelay_us);
+    void command_step();
+    void finish();
+    qint64 now_us() const {return m_clock.nsecsElapsed() / 1000;}
+
+private:
+    mutable QMutex m_mutex;
+    JetDrive::Controller *m_jetDrive {nullptr};
+
+    StrobeSweepSettings m_settings;
+    StrobeSweepReport m_report;
+    StrobeFrameStamp m_currentStamp; // strobe state applied to frames as they arrive
+    QElapsedTimer m_clock;
+
+    bool m_running {false};
+    int m_step {0};
+    int m_framesAtStep {0};
+};
+
+#endif // STROBESWEEPER_H
@@ -0,0 +1,149 @@
+#ifndef WAVEFORMSWEEPER_H
+#define WAVEFORMSWEEPER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QString>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera.h"
+#include "mfjdrv.h"
+#include "strobesweeper.h"
+
+namespace JetDrive { class Controller; }
+class DropletAnalyzer;
+
+// start/end/step of one swept parameter. An empty range keeps the current value.
+struct SweepRange
+{
+    double start {0.0};
+    double end {0.0};
+    double step {0.0};
+    bool is_empty() const {return step <= 0.0 && start == 0.0 && end == 0.0;}
+    std::vector<double> values(double currentValue) const;
+};
+
+struct WaveformSweepSettings
+{
+    SweepRange rise_us;
+    SweepRange dwell_us;
+    SweepRange fall_us;
+    SweepRange echo_us;
+    SweepRange final_us;
+    SweepRange voltage_V;     // dwell voltage
+    SweepRange frequency_Hz;
+    bool echoFollowsDwell {true}; // echo voltage = -dwell voltage
+
+    StrobeSweepSettings strobe;
+    int settleTime_ms {500};      // jetting time after a waveform change before the strobe sweep starts
+    int pointTimeout_ms {60000};  // give up on a point that doesn't finish in this time
+
+    // score (lower is better)
+    double targetVelocity_m_s {2.0};
+    double velocityWeight {1.0};  // per fraction of the target velocity
+    double angleWeight {0.1};     // per degree off vertical
+    double satelliteWeight {0.5}; // per satellite
+
+    // early termination: voltage is swept last, so once a point is too fast or makes
+    // too many satellites the higher voltages with the same timing are skipped
+    double maxVelocity_m_s {10.0};
+    double maxSatellites {3.0};
+    int minTrackedPoints {5};     // fewer tracked positions than this means no droplet
+
+    // settings file (JSON). Parameters that aren't in the file keep their defaults.
+    static bool from_json(const QByteArray &json, WaveformSweepSettings &settings, QString &error);
+};
+
+struct WaveformSweepPoint
+{
+    enum class Status {Pending, Ok, NoDroplet, TooFast, TooManySatellites, Skipped, TimedOut};
+
+    int index {0};
+    JetDrive::Waveform waveform;
+    long frequency_Hz {0};
+
+    Status status {Status::Pending};
+    int trackedPoints {0};
+    double velocity_m_s {0.0};
+    double angle_deg {0.0};
+    double satellites {0.0};
+    double score {0.0};
+
+    bool has_droplet() const {return status == Status::Ok || status == Status::TooFast || status == Status::TooManySatellites;}
+    static QString status_string(Status status);
+};
+Q_DECLARE_METATYPE(WaveformSweepPoint)
+
+// Runs a design of experiments over the JetDrive waveform. For every combination of
+// the swept parameters the waveform is applied, a strobe sweep is captured straight
+// from the camera into memory and analyzed, and the point is scored and written to
+// a single csv table. The camera settings and image scale are the same for every point.
+class WaveformSweeper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WaveformSweeper(JetDrive::Controller *jetDrive, QObject *parent = nullptr);
+    ~WaveformSweeper();
+
+    // image scale etc. are copied from the analyzer the user has already set up
+    bool start(const WaveformSweepSettings &settings, Camera *camera,
+               const DropletCameraSettings &cameraSettings, const QString &resultsFile);
+    void stop();
+    bool is_running() const {return m_running;}
+
+    static QString point_string(const WaveformSweepPoint &point);
+
+signals:
+    void point_complete(const WaveformSweepPoint &point, int numPoints);
+    void sweep_finished(const WaveformSweepPoint &bestPoint, bool stopped);
+    void print_to_output_window(QString s);
+
+private slots:
+    void run_point();
+    void start_strobe_sweep();
+    void analyze_point(int generation);
+    void point_analyzed(int generation, const DropTrackingData &data);
+    void point_timed_out();
+
+private:
+    void build_points();
+    void frame_received(ImageBufferPtr buffer);
+    void score(WaveformSweepPoint &point, const DropTrackingData &data) const;
+    void skip_hopeless_points(const WaveformSweepPoint &point);
+    void write_row(const WaveformSweepPoint &point);
+    void next_point();
+    void finish(bool stopped);
+    void restore_jet_drive();
+
+private:
+    JetDrive::Controller *m_jetDrive {nullptr};
+    Camera *m_camera {nullptr};
+    std::unique_ptr<DropletAnalyzer> m_analyzer;
+    StrobeSweeper *m_strobeSweeper {nullptr};
+    QTimer *m_timeoutTimer {nullptr};
+
+    WaveformSweepSettings m_settings;
+    JetDrive::Settings m_originalSettings; // restored when the sweep ends, however it ends
+    std::vector<WaveformSweepPoint> m_points;
+    size_t m_pointIndex {0};
+    std::atomic<int> m_generation {0}; // results from a point that was stopped or timed out are ignored
+    bool m_running {false};
+    std::ofstream m_results;
+    QElapsedTimer m_clock;
+
+    // frames are collected from the camera event thread
+    QMetaObject::Connection m_frameConnection;
+    std::atomic<bool> m_collecting {false};
+    QMutex m_frameMutex;
+    std::vector<cv::Mat> m_frames;
+    std::vector<StrobeFrameStamp> m_stamps;
+};
+
+#endif // WAVEFORMSWEEPER_H
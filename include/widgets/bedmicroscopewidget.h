@@ -4,8 +4,10 @@
 #include <QWidget>
 #include "printerwidget.h"
 #include <QTimer>
+#include <atomic>
 
 class MicroscopeWorker;
+class BedScanner;
 
 namespace Ui {
 class BedMicroscopeWidget;
@@ -25,6 +27,7 @@ public:
     void set_save_folder();
     void capture_images();
     void export_image(const QString& position);
+    void scan_finished(const QString& mosaicFile);
 
 private:
     Ui::BedMicroscopeWidget *ui;
@@ -32,6 +35,9 @@ private:
     QString saveFolderPath;
     MicroscopeWorker *worker {nullptr};
     QThread *workerThread {nullptr};
+
+    BedScanner *scanner {nullptr};
+    std::atomic<bool> isScanning {false}; // the display shows the scan mosaic instead of the live view
 };
 
 #endif // BEDMICROSCOPEWIDGET_H
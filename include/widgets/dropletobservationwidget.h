@@ -7,6 +7,12 @@
 #include <ueye.h>
 #include <camera.h>
 #include <QTimer>
+#include <QMutex>
+#include <atomic>
+#include "dropletanalyzer.h"
+#include "strobesweeper.h"
+#include "waveformsweeper.h"
+#include "framemetrics.h"
 
 class Camera;
 namespace JetDrive { class Controller; }
@@ -14,6 +20,8 @@ class PressureControllerWidget;
 class DropletAnalyzer;
 class DropletAnalyzerWidget;
 class QMainWindow;
+class QLabel;
+class QPushButton;
 class DropletAnalyzerMainWindow;
 //class DropletAnalyzerWindow;
 
@@ -48,14 +56,17 @@ private slots:
     void connect_to_camera();
     void set_settings();
     void capture_video();
-    void add_frame_to_avi(ImageBufferPtr buffer);
+    void frame_received_during_sweep(ImageBufferPtr buffer);
+    void add_frame_to_avi(ImageBufferPtr buffer, const StrobeFrameStamp &stamp, bool sweepComplete);
     void stop_avi_capture();
     void camera_closed();
     void move_to_jetting_window();
     void move_towards_middle();
     //void strobe_sweep_button_clicked();
     void start_strobe_sweep();
-    void update_strobe_sweep_offset();
+    void strobe_sweep_complete(const StrobeSweepReport &report);
+    void waveform_sweep_clicked();
+    void waveform_sweep_finished(const WaveformSweepPoint &bestPoint, bool stopped);
     void trigger_jet_clicked();
     void framerate_changed();
     void exposure_changed();
@@ -63,6 +74,7 @@ private slots:
     void jet_for_three_minutes();
     void end_jet_timer();
     void update_progress_bar();
+    void frame_metrics_updated(const FrameMetrics &metrics);
 
 private:
     Ui::DropletObservationWidget *ui;
@@ -86,16 +98,26 @@ private:
     int m_aviID{0};
 
     int m_numCapturedFrames{0};   // Keeps track of the current number of frames captured during video capture
-    int m_currentStrobeOffset{-1}; // -1 means that a strobe sweep hasn't started
 
     int m_AOIWidth{1024}; // width of droplet camera image (native resolution is 2048 x 2048)
 
     bool m_isJetting {false};
     bool m_cameraIsConnected {false};
     bool m_videoHasBeenTaken {false};
-    bool m_captureVideoWithSweep {false};
+    std::atomic<bool> m_captureVideoWithSweep {false}; // cleared from the camera event thread when the sweep completes
 
     QString m_tempFileName{};
+
+    StrobeSweeper *m_sweeper {nullptr};
+    WaveformSweeper *m_waveformSweeper {nullptr};
+    QPushButton *m_waveformSweepButton {nullptr};
+
+    std::unique_ptr<FrameMetricsProcessor> m_frameMetrics;
+    QLabel *m_frameMetricsLabel {nullptr};
+
+    // frames are added to the avi from the camera event thread
+    QMutex m_frameStampMutex;
+    std::vector<StrobeFrameStamp> m_frameStamps;   // one stamp per frame written to the avi
 };
 
 #endif // DROPLETOBSERVATIONWIDGET_H
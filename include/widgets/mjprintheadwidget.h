@@ -4,11 +4,18 @@
 #include <QWidget>
 #include "printerwidget.h"
 
-// Includes for STL slicing 06/24
-#include <QProcess>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <thread>
 
-class QProgressDialog;
+#include "printestimator.h"
+#include "printjob.h"
+#include "printpipeline.h"
+
+class PrintJobDialog;
+class SlicerDialog;
 
 
 
@@ -47,7 +54,7 @@ protected:
     void getPositionPressed();
     void getHeadTempsPressed();
     void file_name_entered();
-    void read_in_file(const QString &filename, int headIdx = 1); // 11/24 added arguments to reduce copy/pasted code. If this doesn't work delete headIdx and WhiteSpace
+    void read_in_file(const QString &filename, int headIdx = 1, bool reversed = false); // 11/24 added arguments to reduce copy/pasted code. If this doesn't work delete headIdx and WhiteSpace
     //void send_image_data(const QString &file);
 
     void send_command(const QString &command);
@@ -66,10 +73,12 @@ protected:
     void createTestBitmapsPressed();
     void variableTestPrintPressed();
     void printBMPatLocation(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, QString fileLocation);
-    void printBMPatLocationEncoder(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, QString fileName);
+    void printBMPatLocationEncoder(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, QString fileName, bool reversed = false);
+    void runEncoderPass(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, const QString &description, const std::function<bool()> &loadHeads, bool reversed = false);
     void moveToLocation(double xLocation, double yLocation, QString endMessage);
     void print(double acceleration, double speed, double endTargetMM, QString endMessage);
-    void printEnc(double acceleration, double speed, double endTargetMM, QString endMessage);
+    void printEnc(double acceleration, double speed, double endTargetMM, QString endMessage, bool reversed = false);
+    void printRegistrationTest();
     void verifyPrintStartAlignment(double xStart, double yStart);
     void zeroEncoder();
     void checkMapsPressed();
@@ -102,6 +111,7 @@ protected:
     void levelRecoat_MJ();
     void normalRecoat_MJ();
     void performRecoat(const PrintParameters* params, bool usePrintParameters);
+    RecoatSettings currentRecoatSettings(const PrintParameters* params, bool usePrintParameters) const;
     void reRollLayer();
 
 
@@ -109,6 +119,8 @@ protected:
 
 public slots:
     void on_startFullPrintButton_clicked();
+    void startStreamingPrintJob(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job, const QString &archiveFolder);
+    void estimateStreamingJob(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job);
     void cancelPrintJob();
 
 private slots:
@@ -117,9 +129,8 @@ private slots:
 
     // STL Slicing Slots
     void sliceStlButton_clicked();
-    void readPythonOutput();
-    void handlePythonError();
-    void onPythonScriptFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void estimateJobButton_clicked();
+    void resumeJobButton_clicked();
 
     void onRollerButtonClicked();
 
@@ -128,19 +139,41 @@ private:
     // Helper methods for full print job
     bool parsePrintParameters(const QString& filePath, PrintParameters& params);
     bool parseLayerShifts(const QString& filePath, std::map<int, int>& shifts);
-    void startFullPrintJob(const QString& jobFolderPath);
+    bool readFolderJob(const QString& jobFolderPath, PrintParameters& params, std::map<int, int>& layerShifts, QStringList& fileList, int& totalLayers);
+    void startFullPrintJob(const QString& jobFolderPath, bool resume = false);
+    void startPrintJob(std::function<std::shared_ptr<PrintJobSource>()> makeSource, const PrintJobSettings &settings, const JobCheckpoint &resumeAfter);
+    void printJobFinished(PrintJob::Result result, const QString &summary);
+    bool printJobBusy(); // says so in the output window if a job is running
+    PrintJobSettings printJobSettings(const PrintParameters &params, const std::vector<PassPlan> &plan = {}) const;
+    bool confirmResume(const PrintJobSettings &settings, int layerCount, const std::map<int, int> *layerShifts, JobCheckpoint &resumeAfter);
+    PrintParameters streamingPrintParameters(const Slicer::LayerSlicer &slicer, const Slicer::JobSettings &job) const;
+    Slicer::PipelineSettings streamingPipelineSettings(const PrintParameters &params, const QString &archiveFolder) const;
+
+    // Job time estimates (see printestimator.h)
+    PrintEstimator printEstimator(const PrintParameters &params, const std::vector<PassPlan> &plan = {}) const;
+    std::vector<PassPlan> planFolderJob(const PrintParameters& params, const std::map<int, int>& layerShifts, const QStringList& fileList, QStringList& passFiles) const;
+    JobEstimate estimateFolderJob(const QString& jobFolderPath, const PrintParameters& params, const std::vector<PassPlan>& plan, int totalLayers);
+    static std::vector<PassPlan> planPreparedLayer(const PrintParameters &params, const Slicer::PreparedLayer &layer);
+    static double layerBaseY(const PrintParameters &params, int yPixelShift);
     int calculate_gap(const QString& associatedBitmap); // Calculate pixel gap between heads from print parameters
     bool readyHeads(); // checks if the print heads are on
 
-    // Helpers for cancelling print job
-    volatile bool m_printJobCancelled = false;
-    QProgressDialog* m_printStatusDialog = nullptr;
+    // Print job running on its own thread, and what it needs to start again after its last checkpoint
+    std::unique_ptr<PrintJob> m_printJob;
+    PrintJobDialog *m_printJobDialog {nullptr};
+    std::function<std::shared_ptr<PrintJobSource>()> m_resumeSource;
+    PrintJobSettings m_resumeSettings;
+    std::map<int, int> m_resumeShifts; // y shift of each layer, checked against the journal on resume
+    JobCheckpoint m_checkpoint;
+    bool m_printJobRunning {false}; // from startPrintJob until job_finished, one job at a time
 
     Ui::MJPrintheadWidget *ui;
     bool encFlag;
     QTimer *m_positionTimer;
     QStringList m_encoderHistory;
-    QProcess *m_pythonProcess;          // 06/24 TODO
+    SlicerDialog *m_slicerDialog {nullptr};
+    std::thread m_estimateWorker; // slices and estimates a scene for the slicer dialog
+    std::atomic<bool> m_estimateCancel {false};
 
     bool m_isRollerOn; // State variable to track the roller's status
 
@@ -5,6 +5,14 @@
 
 #include "printerwidget.h"
 
+class QCustomPlot;
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QLineEdit;
+class QTimer;
+class PressureRegulator;
+
 namespace Ui {
 class PressureControllerWidget;
 }
@@ -19,6 +27,8 @@ public:
 
     void allow_widget_input(bool allowed) override;
 
+public slots:
+    void droplet_velocity_measured(double velocity_m_s); // feedback for the pressure loop
 
 private:
     void connect_to_pressure_controller();
@@ -30,8 +40,30 @@ private:
     void send_command(const QString &command);
     void move_reservoir();  // MAX 03/04 !!! added command
 
+    void setup_telemetry();
+    void toggle_monitoring(bool enabled);
+    void telemetry_command_changed();
+    void toggle_closed_loop(bool enabled);
+    void loop_source_changed();
+    void update_pressure_plot();
+    void save_pressure_log();
+
 private:
     Ui::PressureControllerWidget *ui;
+
+    QCustomPlot *m_pressurePlot {nullptr};
+    QTimer *m_plotTimer {nullptr};
+    QCheckBox *m_monitorCheckBox {nullptr};
+    QLineEdit *m_pollCommandLineEdit {nullptr};
+    QLineEdit *m_unitIDLineEdit {nullptr};
+    QCheckBox *m_closedLoopCheckBox {nullptr};
+    QComboBox *m_loopSourceComboBox {nullptr};
+    QDoubleSpinBox *m_targetVelocitySpinBox {nullptr};
+    QDoubleSpinBox *m_loopGainSpinBox {nullptr};
+    PressureRegulator *m_regulator {nullptr};
+
+    const int m_telemetryInterval_ms {200};
+    const double m_plotWindow_min {10.0}; // how far back the plot shows
 };
 
 #endif // PRESSURECONTROLLERWIDGET_H
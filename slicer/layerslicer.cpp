@@ -0,0 +1,246 @@
+#include "layerslicer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+namespace Slicer
+{
+
+bool LayerImage::rows_empty(int first, int last) const
+{
+    const uint8_t *begin = row(first);
+    const uint8_t *end = row(last);
+    return std::all_of(begin, end, [](uint8_t p){return p == empty;});
+}
+
+ZIndex::ZIndex(const Mesh &mesh, double z0_mm, double layerHeight_mm, int layerCount) :
+    m_offsets(static_cast<size_t>(layerCount) + 1, 0)
+{
+    if (layerCount <= 0) return;
+
+    // layer i is cut at z0 + (i + 0.5) * h and a triangle crosses it if zmin < z <= zmax,
+    // give it one extra layer either side so rounding never drops a triangle
+    auto layer_range = [&](const Triangle &t, int &first, int &last)
+    {
+        const double zmin = std::min({t.v[0].z, t.v[1].z, t.v[2].z});
+        const double zmax = std::max({t.v[0].z, t.v[1].z, t.v[2].z});
+        first = std::max(0, static_cast<int>(std::floor((zmin - z0_mm) / layerHeight_mm - 0.5)));
+        last = std::min(layerCount - 1, static_cast<int>(std::floor((zmax - z0_mm) / layerHeight_mm - 0.5)) + 1);
+    };
+
+    // count, prefix sum, then fill (no per-layer vectors)
+    int first {0}, last {0};
+    for (const auto &t : mesh.triangles)
+    {
+        layer_range(t, first, last);
+        for (int i = first; i <= last; i++) m_offsets[i + 1]++;
+    }
+    for (int i = 0; i < layerCount; i++) m_offsets[i + 1] += m_offsets[i];
+
+    m_triangles.resize(m_offsets.back());
+    std::vector<uint32_t> next(m_offsets.begin(), m_offsets.end() - 1);
+    for (uint32_t n = 0; n < mesh.triangles.size(); n++)
+    {
+        layer_range(mesh.triangles[n], first, last);
+        for (int i = first; i <= last; i++) m_triangles[next[i]++] = n;
+    }
+}
+
+LayerSlicer::LayerSlicer(std::vector<Mesh> meshes, const SliceSettings &settings) :
+    m_meshes(std::move(meshes)),
+    m_settings(settings)
+{
+    // negative parts are drawn last so they win where they overlap
+    std::stable_partition(m_meshes.begin(), m_meshes.end(),
+                          [](const Mesh &m){return m.role == Role::Positive;});
+
+    for (const auto &mesh : m_meshes) m_bounds.add(mesh.bounds());
+
+    m_width = static_cast<int>(std::ceil(m_settings.bedWidth_mm / m_settings.dropletSpacing_mm));
+    m_height = static_cast<int>(std::ceil(m_settings.bedDepth_mm / m_settings.lineSpacing_mm));
+
+    if (!m_bounds.empty && m_settings.layerHeight_mm > 0.0)
+    {
+        const double height = m_bounds.max.z - m_bounds.min.z;
+        m_layerCount = std::max(1, static_cast<int>(std::ceil(height / m_settings.layerHeight_mm - 1e-6)));
+    }
+
+    m_indices.reserve(m_meshes.size());
+    for (const auto &mesh : m_meshes)
+        m_indices.emplace_back(mesh, m_bounds.min.z, m_settings.layerHeight_mm, m_layerCount);
+}
+
+bool LayerSlicer::validate(std::string &error) const
+{
+    if (m_bounds.empty)
+    {
+        error = "The scene is empty.";
+        return false;
+    }
+    if (m_settings.layerHeight_mm <= 0.0 || m_settings.dropletSpacing_mm <= 0.0 || m_settings.lineSpacing_mm <= 0.0)
+    {
+        error = "Layer height, droplet spacing and line spacing must be positive.";
+        return false;
+    }
+
+    const Bounds &b = m_bounds;
+    if (b.min.x < 0.0f || b.max.x > m_settings.bedWidth_mm
+            || b.min.y < 0.0f || b.max.y > m_settings.bedDepth_mm
+            || b.max.z - b.min.z > m_settings.bedHeight_mm)
+    {
+        std::ostringstream s;
+        s.precision(2);
+        s << std::fixed
+          << "One or more parts are out of the bed boundaries.\n"
+          << "X: " << b.min.x << " to " << b.max.x << "\n"
+          << "Y: " << b.min.y << " to " << b.max.y << "\n"
+          << "Z: " << b.min.z << " to " << b.max.z;
+        error = s.str();
+        return false;
+    }
+    return true;
+}
+
+double LayerSlicer::layer_z(int layer) const
+{
+    return m_bounds.min.z + (layer + 0.5) * m_settings.layerHeight_mm;
+}
+
+std::vector<Segment> LayerSlicer::segments(int mesh, int layer) const
+{
+    std::vector<Segment> segments;
+    const float z = static_cast<float>(layer_z(layer));
+    const auto &triangles = m_meshes[mesh].triangles;
+
+    auto cut = [z](const Vec3 &a, const Vec3 &b, float &x, float &y)
+    {
+        const float t = (z - a.z) / (b.z - a.z);
+        x = a.x + t * (b.x - a.x);
+        y = a.y + t * (b.y - a.y);
+    };
+
+    for (auto it = m_indices[mesh].begin(layer); it != m_indices[mesh].end(layer); ++it)
+    {
+        const Triangle &t = triangles[*it];
+        // a vertex on the plane counts as above, so a plane through a vertex
+        // or an edge gives each crossing exactly once
+        const bool above[3] {t.v[0].z >= z, t.v[1].z >= z, t.v[2].z >= z};
+        const int count = above[0] + above[1] + above[2];
+        if (count == 0 || count == 3) continue;
+
+        // the vertex on its own side of the plane
+        int lone {0};
+        if (count == 1) lone = above[0] ? 0 : (above[1] ? 1 : 2);
+        else lone = !above[0] ? 0 : (!above[1] ? 1 : 2);
+        const Vec3 &a = t.v[lone];
+        const Vec3 &b = t.v[(lone + 1) % 3];
+        const Vec3 &c = t.v[(lone + 2) % 3];
+
+        Segment s;
+        cut(a, b, s.x0, s.y0);
+        cut(a, c, s.x1, s.y1);
+        segments.push_back(s);
+    }
+    return segments;
+}
+
+void LayerSlicer::fill(const std::vector<Segment> &segments, uint8_t value, LayerImage &image) const
+{
+    const double dx = m_settings.dropletSpacing_mm;
+    const double dy = m_settings.lineSpacing_mm;
+    const double depth = m_settings.bedDepth_mm;
+
+    // where each segment crosses the centre line of each bitmap row
+    struct Crossing
+    {
+        int row;
+        float x;
+        bool operator<(const Crossing &o) const {return row < o.row || (row == o.row && x < o.x);}
+    };
+    std::vector<Crossing> crossings;
+    crossings.reserve(segments.size() * 2);
+
+    for (const auto &s : segments)
+    {
+        if (s.y0 == s.y1) continue; // horizontal, its neighbours give the crossings
+        const bool up = s.y0 < s.y1;
+        const double ya = up ? s.y0 : s.y1, xa = up ? s.x0 : s.x1;
+        const double yb = up ? s.y1 : s.y0, xb = up ? s.x1 : s.x0;
+
+        // rows whose centre y = depth - (row + 0.5) * dy is in [ya, yb)
+        const int first = std::max(0, static_cast<int>(std::floor((depth - yb) / dy - 0.5)) + 1);
+        const int last = std::min(image.height - 1, static_cast<int>(std::floor((depth - ya) / dy - 0.5)));
+        const double slope = (xb - xa) / (yb - ya);
+        for (int row = first; row <= last; row++)
+        {
+            const double y = depth - (row + 0.5) * dy;
+            crossings.push_back({row, static_cast<float>(xa + (y - ya) * slope)});
+        }
+    }
+    std::sort(crossings.begin(), crossings.end());
+
+    // fill the columns whose centre is between each pair of crossings
+    size_t i {0};
+    while (i < crossings.size())
+    {
+        const int row = crossings[i].row;
+        size_t end = i;
+        while (end < crossings.size() && crossings[end].row == row) end++;
+
+        uint8_t *pixels = image.row(row);
+        // an odd count means an open contour, drop the last crossing rather than fill to the edge
+        for (size_t j = i; j + 1 < end; j += 2)
+        {
+            const int c0 = std::max(0, static_cast<int>(std::ceil(crossings[j].x / dx - 0.5)));
+            const int c1 = std::min(image.width, static_cast<int>(std::ceil(crossings[j + 1].x / dx - 0.5)));
+            if (c1 > c0) std::memset(pixels + c0, value, static_cast<size_t>(c1 - c0));
+        }
+        i = end;
+    }
+}
+
+LayerImage LayerSlicer::slice_layer(int layer) const
+{
+    LayerImage image;
+    image.index = layer;
+    image.z_mm = layer_z(layer);
+    image.width = m_width;
+    image.height = m_height;
+    image.pixels.assign(static_cast<size_t>(m_width) * m_height, LayerImage::empty);
+
+    for (size_t i = 0; i < m_meshes.size(); i++)
+    {
+        const uint8_t value = (m_meshes[i].role == Role::Negative) ? LayerImage::negative : LayerImage::positive;
+        fill(segments(static_cast<int>(i), layer), value, image);
+    }
+    return image;
+}
+
+bool LayerSlicer::slice_all(const std::function<void(LayerImage &&)> &layerDone, const std::atomic<bool> *cancel) const
+{
+    int threadCount = m_settings.threads > 0 ? m_settings.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, m_layerCount));
+
+    // each worker takes the next layer until there are none left
+    std::atomic<int> next {0};
+    auto work = [&]
+    {
+        for (int layer = next++; layer < m_layerCount; layer = next++)
+        {
+            if (cancel && cancel->load()) return;
+            layerDone(slice_layer(layer));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+
+    return !(cancel && cancel->load());
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef SLICER_LAYERSLICER_H
+#define SLICER_LAYERSLICER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+namespace Slicer
+{
+
+struct SliceSettings
+{
+    double layerHeight_mm {0.05};
+    double dropletSpacing_mm {0.05};   // x pitch of the bitmap (one drop)
+    double lineSpacing_mm {0.0705};    // y pitch of the bitmap (one nozzle)
+    double bedWidth_mm {100.0};        // x
+    double bedDepth_mm {100.0};        // y
+    double bedHeight_mm {35.0};
+    int threads {0};                   // 0 uses one per core
+};
+
+// One layer over the whole bed, 8-bit grey like the bitmaps the MJ heads print.
+// Row 0 is the back of the bed (y = bedDepth), column 0 is x = 0.
+struct LayerImage
+{
+    static constexpr uint8_t empty {255};
+    static constexpr uint8_t positive {0};   // head 1
+    static constexpr uint8_t negative {128}; // head 2
+
+    int index {0};
+    double z_mm {0.0};
+    int width {0};
+    int height {0};
+    std::vector<uint8_t> pixels;
+
+    uint8_t *row(int y) {return pixels.data() + static_cast<size_t>(y) * width;}
+    const uint8_t *row(int y) const {return pixels.data() + static_cast<size_t>(y) * width;}
+    // true if rows [first, last) are all empty
+    bool rows_empty(int first, int last) const;
+};
+
+struct Segment
+{
+    float x0, y0, x1, y1;
+};
+
+// For every layer, the triangles that cross its slicing plane, so a layer only
+// looks at the triangles it needs instead of the whole mesh.
+class ZIndex
+{
+public:
+    ZIndex() = default;
+    ZIndex(const Mesh &mesh, double z0_mm, double layerHeight_mm, int layerCount);
+
+    const uint32_t *begin(int layer) const {return m_triangles.data() + m_offsets[layer];}
+    const uint32_t *end(int layer) const {return m_triangles.data() + m_offsets[layer + 1];}
+
+private:
+    std::vector<uint32_t> m_offsets;   // layerCount + 1
+    std::vector<uint32_t> m_triangles; // triangle indices grouped by layer
+};
+
+// Slices a scene of positive and negative meshes into layer bitmaps. Layer 0 is
+// the bottom of the scene, each layer is cut through its middle and filled with
+// the even-odd rule one bitmap row at a time. Negative meshes are drawn over
+// positive ones. slice_layer() is const and can run on many threads at once.
+class LayerSlicer
+{
+public:
+    LayerSlicer(std::vector<Mesh> meshes, const SliceSettings &settings);
+
+    // false if the scene is empty or doesn't fit on the bed
+    bool validate(std::string &error) const;
+
+    const SliceSettings &settings() const {return m_settings;}
+    const std::vector<Mesh> &meshes() const {return m_meshes;}
+    Bounds bounds() const {return m_bounds;}
+    int layer_count() const {return m_layerCount;}
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+    double layer_z(int layer) const;
+
+    std::vector<Segment> segments(int mesh, int layer) const;
+    LayerImage slice_layer(int layer) const;
+
+    // Slices every layer across threads. layerDone is called from the worker
+    // threads in no particular order. Returns false if cancelled.
+    bool slice_all(const std::function<void(LayerImage &&)> &layerDone,
+                   const std::atomic<bool> *cancel = nullptr) const;
+
+private:
+    void fill(const std::vector<Segment> &segments, uint8_t value, LayerImage &image) const;
+
+private:
+    std::vector<Mesh> m_meshes;
+    std::vector<ZIndex> m_indices; // one per mesh
+    SliceSettings m_settings;
+    Bounds m_bounds;
+    int m_layerCount {0};
+    int m_width {0};
+    int m_height {0};
+};
+
+}
+
+#endif // SLICER_LAYERSLICER_H
@@ -0,0 +1,120 @@
+// Slices STL files into an MJ print job folder.
+//
+//   bjslice [options] part.stl ... [--negative part.stl ...] -o folder
+//
+// options
+//   -o <folder>               job folder (default ./scene_<date>_<time>)
+//   --negative <file>         a part printed with the second material
+//   --layer-height <mm>       default 0.05
+//   --droplet-spacing <mm>    x resolution, default 0.05
+//   --line-spacing <mm>       y resolution, default 0.0705
+//   --frequency <Hz>          print frequency, default 1000
+//   --start <x,y>             part position in mm, default 3,9
+//   --y-shift                 shift each layer by up to 90 rows to stagger pass seams
+//   --threads <n>             default one per core
+//
+// Parts are sliced where they are in their STL files and must fit on the 100 x 100 mm bed.
+
+#include "slicejob.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+
+void usage()
+{
+    std::cerr << "usage: bjslice [-o folder] [--layer-height mm] [--droplet-spacing mm] [--line-spacing mm]\n"
+                 "               [--frequency Hz] [--start x,y] [--y-shift] [--threads n]\n"
+                 "               part.stl ... [--negative part.stl ...]\n";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Slicer::SliceSettings settings;
+    Slicer::JobSettings job;
+    std::string folder;
+    std::vector<Slicer::Mesh> meshes;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char *
+        {
+            if (i + 1 >= argc)
+            {
+                usage();
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-o") folder = value();
+        else if (arg == "--layer-height") settings.layerHeight_mm = std::atof(value());
+        else if (arg == "--droplet-spacing") settings.dropletSpacing_mm = std::atof(value());
+        else if (arg == "--line-spacing") settings.lineSpacing_mm = std::atof(value());
+        else if (arg == "--frequency") job.printFrequency_Hz = std::atof(value());
+        else if (arg == "--threads") settings.threads = std::atoi(value());
+        else if (arg == "--y-shift") job.yShiftPerLayer = true;
+        else if (arg == "--start")
+        {
+            if (std::sscanf(value(), "%lf,%lf", &job.startX_mm, &job.startY_mm) != 2)
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return 0;
+        }
+        else
+        {
+            const bool negative = (arg == "--negative");
+            const std::string path = negative ? value() : arg;
+            Slicer::Mesh mesh;
+            std::string error;
+            if (!Slicer::load_stl(path, mesh, error))
+            {
+                std::cerr << error << "\n";
+                return 1;
+            }
+            mesh.role = negative ? Slicer::Role::Negative : Slicer::Role::Positive;
+            meshes.push_back(std::move(mesh));
+        }
+    }
+
+    if (meshes.empty())
+    {
+        usage();
+        return 1;
+    }
+    if (folder.empty()) folder = Slicer::default_job_name();
+
+    Slicer::LayerSlicer slicer(std::move(meshes), settings);
+    std::cout << "Slicing " << slicer.layer_count() << " layers of " << slicer.width() << " x " << slicer.height() << " pixels\n";
+
+    std::mutex printMutex;
+    auto progress = [&](int done, int total)
+    {
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::cout << "\r" << done << " / " << total << std::flush;
+    };
+
+    Slicer::JobResult result;
+    std::string error;
+    if (!Slicer::write_job(slicer, job, folder, progress, nullptr, result, error))
+    {
+        std::cerr << "\n" << error << "\n";
+        return 1;
+    }
+    std::printf("\n%d layers, %d passes (%d blank passes skipped) in %.2f s -> %s\n",
+                result.layers, result.passes, result.emptyPasses, result.seconds, folder.c_str());
+    return 0;
+}
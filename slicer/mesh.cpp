@@ -0,0 +1,145 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace Slicer
+{
+
+void Bounds::add(const Vec3 &p)
+{
+    if (empty)
+    {
+        min = max = p;
+        empty = false;
+        return;
+    }
+    min.x = std::min(min.x, p.x); max.x = std::max(max.x, p.x);
+    min.y = std::min(min.y, p.y); max.y = std::max(max.y, p.y);
+    min.z = std::min(min.z, p.z); max.z = std::max(max.z, p.z);
+}
+
+void Bounds::add(const Bounds &b)
+{
+    if (b.empty) return;
+    add(b.min);
+    add(b.max);
+}
+
+Bounds Mesh::bounds() const
+{
+    Bounds b;
+    for (const auto &t : triangles)
+        for (const auto &v : t.v) b.add(v);
+    return b;
+}
+
+void Mesh::translate(float dx, float dy, float dz)
+{
+    for (auto &t : triangles)
+    {
+        for (auto &v : t.v)
+        {
+            v.x += dx;
+            v.y += dy;
+            v.z += dz;
+        }
+    }
+}
+
+namespace
+{
+
+bool load_ascii_stl(std::istream &in, Mesh &mesh, std::string &error)
+{
+    std::string word;
+    Triangle t;
+    int vertex {0};
+    while (in >> word)
+    {
+        if (word != "vertex") continue;
+        Vec3 &v = t.v[vertex];
+        if (!(in >> v.x >> v.y >> v.z))
+        {
+            error = "malformed vertex";
+            return false;
+        }
+        if (++vertex == 3)
+        {
+            mesh.triangles.push_back(t);
+            vertex = 0;
+        }
+    }
+    if (mesh.triangles.empty())
+    {
+        error = "no facets found";
+        return false;
+    }
+    return true;
+}
+
+bool load_binary_stl(const std::string &data, Mesh &mesh, std::string &error)
+{
+    // 80 byte header, uint32 count, then 50 bytes per facet (normal, 3 vertices, attribute)
+    uint32_t count {0};
+    std::memcpy(&count, data.data() + 80, sizeof(count));
+    if (data.size() < 84 + static_cast<size_t>(count) * 50)
+    {
+        error = "file is shorter than its facet count";
+        return false;
+    }
+
+    mesh.triangles.resize(count);
+    const char *facet = data.data() + 84;
+    for (uint32_t i = 0; i < count; i++, facet += 50)
+    {
+        float f[9];
+        std::memcpy(f, facet + 12, sizeof(f)); // skip the normal, it's recomputed where needed
+        Triangle &t = mesh.triangles[i];
+        for (int j = 0; j < 3; j++) t.v[j] = {f[3 * j], f[3 * j + 1], f[3 * j + 2]};
+    }
+    return true;
+}
+
+}
+
+bool load_stl(const std::string &path, Mesh &mesh, std::string &error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    mesh.triangles.clear();
+    const size_t slash = path.find_last_of("/\\");
+    mesh.name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    if (data.size() < 84)
+    {
+        error = "file is too short to be an STL";
+        return false;
+    }
+
+    // some binary files also start with "solid", so trust the size first
+    uint32_t count {0};
+    std::memcpy(&count, data.data() + 80, sizeof(count));
+    const bool binary = (data.size() == 84 + static_cast<size_t>(count) * 50) || data.compare(0, 5, "solid") != 0;
+
+    bool ok {false};
+    if (binary) ok = load_binary_stl(data, mesh, error);
+    else
+    {
+        std::istringstream in(data);
+        ok = load_ascii_stl(in, mesh, error);
+    }
+    if (!ok) error = mesh.name + ": " + error;
+    return ok;
+}
+
+}
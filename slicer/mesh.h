@@ -0,0 +1,55 @@
+#ifndef SLICER_MESH_H
+#define SLICER_MESH_H
+
+#include <string>
+#include <vector>
+
+namespace Slicer
+{
+
+struct Vec3
+{
+    float x {0.0f};
+    float y {0.0f};
+    float z {0.0f};
+};
+
+struct Triangle
+{
+    Vec3 v[3];
+};
+
+struct Bounds
+{
+    Vec3 min;
+    Vec3 max;
+    bool empty {true};
+
+    void add(const Vec3 &p);
+    void add(const Bounds &b);
+};
+
+// What a mesh is printed with. Negative parts are printed by the second
+// head (grey pixels) and win where they overlap a positive part.
+enum class Role
+{
+    Positive,
+    Negative
+};
+
+struct Mesh
+{
+    std::string name;
+    Role role {Role::Positive};
+    std::vector<Triangle> triangles;
+
+    Bounds bounds() const;
+    void translate(float dx, float dy, float dz);
+};
+
+// Reads a binary or ASCII STL file (mm). Returns false and sets error on failure.
+bool load_stl(const std::string &path, Mesh &mesh, std::string &error);
+
+}
+
+#endif // SLICER_MESH_H
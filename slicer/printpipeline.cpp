@@ -0,0 +1,274 @@
+#include "printpipeline.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace Slicer
+{
+
+namespace
+{
+
+constexpr int bytesPerColumn {16}; // 128 nozzles
+
+uint8_t head_value(int head)
+{
+    return (head == 1) ? LayerImage::positive : LayerImage::negative;
+}
+
+}
+
+std::vector<uint8_t> pack_pass(const LayerImage &image, int top, int bottom, int head,
+                               int firstColumn, int columnCount, bool reversed, bool &empty)
+{
+    const int rows = std::min(bottom - top, bytesPerColumn * 8);
+    const uint8_t value = head_value(head);
+
+    std::vector<uint8_t> data(2 + static_cast<size_t>(columnCount) * bytesPerColumn, 0);
+    data[0] = 'W';
+    data[1] = static_cast<uint8_t>(100 + head);
+
+    // the part of the bitmap inside the pass, walked row by row so it's read in memory order
+    const int x0 = std::max(0, firstColumn);
+    const int x1 = std::min(image.width, firstColumn + columnCount);
+    empty = true;
+    if (x0 >= x1) return data;
+
+    // a reversed pass walks the bitmap columns backwards through the data
+    uint8_t *columns = data.data() + 2;
+    for (int j = 0; j < rows; j++)
+    {
+        const uint8_t *row = image.row(top + j);
+        const uint8_t bit = static_cast<uint8_t>(1 << (7 - (j & 7)));
+        for (int x = x0; x < x1; x++)
+        {
+            if (row[x] == value)
+            {
+                const int slot = reversed ? (firstColumn + columnCount - 1 - x) : (x - firstColumn);
+                columns[static_cast<size_t>(slot) * bytesPerColumn + (j >> 3)] |= bit;
+                empty = false;
+            }
+        }
+    }
+    return data;
+}
+
+void occupied_columns(const LayerImage &image, int top, int bottom, uint8_t value, int &first, int &last)
+{
+    first = image.width;
+    last = 0;
+    for (int y = top; y < bottom; y++)
+    {
+        const uint8_t *row = image.row(y);
+        // only the columns outside the extent found so far need looking at
+        for (int x = 0; x < first; x++)
+        {
+            if (row[x] == value)
+            {
+                first = x;
+                break;
+            }
+        }
+        for (int x = image.width - 1; x >= std::max(last, first); x--)
+        {
+            if (row[x] == value)
+            {
+                last = x + 1;
+                break;
+            }
+        }
+    }
+    if (first >= last) first = last = 0;
+}
+
+PrintPipeline::PrintPipeline(std::shared_ptr<const LayerSlicer> slicer, const JobSettings &job, const PipelineSettings &settings) :
+    m_slicer(std::move(slicer)),
+    m_job(fixed_seed(job)),
+    m_settings(settings)
+{
+    m_settings.lookahead = std::max(1, m_settings.lookahead);
+    m_layerCount = m_slicer->layer_count();
+    m_shifts = layer_shifts(m_job, m_layerCount);
+}
+
+PrintPipeline::~PrintPipeline()
+{
+    stop();
+}
+
+bool PrintPipeline::start(std::string &error)
+{
+    if (!m_slicer->validate(error)) return false;
+    if (!m_settings.archiveDirectory.empty() &&
+        !m_archive.create(*m_slicer, m_job, m_settings.archiveDirectory, m_shifts, error)) return false;
+
+    // more workers than layers in flight would only wait
+    int threadCount = m_slicer->settings().threads > 0 ? m_slicer->settings().threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min({threadCount, m_settings.lookahead, m_layerCount}));
+    for (int i = 0; i < threadCount; i++) m_workers.emplace_back(&PrintPipeline::work, this);
+    return true;
+}
+
+void PrintPipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_space.notify_all();
+    m_layerReady.notify_all();
+    for (auto &worker : m_workers) worker.join();
+    m_workers.clear();
+}
+
+bool PrintPipeline::try_next(PreparedLayer &layer)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_ready.find(m_nextToHand);
+        if (it == m_ready.end()) return false;
+        layer = std::move(it->second);
+        m_ready.erase(it);
+        m_nextToHand++;
+    }
+    m_space.notify_all();
+    return true;
+}
+
+bool PrintPipeline::next(PreparedLayer &layer)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_layerReady.wait(lock, [this]
+        {
+            return m_stop || m_nextToHand >= m_layerCount || m_ready.count(m_nextToHand) > 0;
+        });
+        auto it = m_ready.find(m_nextToHand);
+        if (it == m_ready.end()) return false;
+        layer = std::move(it->second);
+        m_ready.erase(it);
+        m_nextToHand++;
+    }
+    m_space.notify_all();
+    return true;
+}
+
+bool PrintPipeline::finished() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nextToHand >= m_layerCount || !m_error.empty();
+}
+
+bool PrintPipeline::failed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_error.empty();
+}
+
+std::string PrintPipeline::error() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void PrintPipeline::work()
+{
+    for (;;)
+    {
+        int index {0};
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_space.wait(lock, [this]
+            {
+                return m_stop || m_nextToSlice >= m_layerCount || m_nextToSlice < m_nextToHand + m_settings.lookahead;
+            });
+            if (m_stop || m_nextToSlice >= m_layerCount) return;
+            index = m_nextToSlice++;
+        }
+
+        LayerImage image = m_slicer->slice_layer(index);
+        PreparedLayer layer;
+        std::string error;
+        const bool ok = prepare(image, layer, error);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!ok)
+        {
+            if (m_error.empty()) m_error = error;
+            m_stop = true;
+            m_space.notify_all();
+            m_layerReady.notify_all();
+            return;
+        }
+        m_ready.emplace(index, std::move(layer));
+        m_layerReady.notify_all();
+    }
+}
+
+bool PrintPipeline::prepare(LayerImage &image, PreparedLayer &layer, std::string &error) const
+{
+    layer.index = image.index;
+    layer.yShift_rows = m_shifts[image.index];
+    layer.fullWidth = image.width;
+
+    if (!m_settings.archiveDirectory.empty())
+    {
+        int passes {0}, emptyPasses {0};
+        if (!m_archive.write_layer(image, layer.yShift_rows, m_job.nozzleCount, passes, emptyPasses, error)) return false;
+    }
+    else
+    {
+        shift_layer(image, layer.yShift_rows);
+    }
+
+    // same passes the full print job would read from divided/
+    const int count = pass_count(image.height, m_job.nozzleCount);
+    for (int pass = 1; pass <= count; pass++)
+    {
+        int top {0}, bottom {0};
+        pass_rows(image.height, m_job.nozzleCount, pass, top, bottom);
+        if (image.rows_empty(top, bottom))
+        {
+            layer.emptyPasses++;
+            continue;
+        }
+
+        // the pass only has to cover what each head prints, head 1 shifted by the head gap
+        const int lead = m_settings.head1LeadColumns;
+        int first1 {0}, last1 {0}, first2 {0}, last2 {0};
+        occupied_columns(image, top, bottom, head_value(1), first1, last1);
+        occupied_columns(image, top, bottom, head_value(2), first2, last2);
+        const bool head1Prints = (first1 < last1);
+        const bool head2Prints = (first2 < last2);
+
+        PreparedPass prepared;
+        prepared.pass = pass;
+        // the heads park for the recoat, so each layer starts in +X
+        prepared.reversed = m_settings.bidirectional && (layer.passes.size() % 2 == 1);
+        int last {0};
+        if (head1Prints && head2Prints)
+        {
+            prepared.firstColumn = std::min(first1 + lead, first2);
+            last = std::max(last1 + lead, last2);
+        }
+        else if (head1Prints)
+        {
+            prepared.firstColumn = first1 + lead;
+            last = last1 + lead;
+        }
+        else
+        {
+            prepared.firstColumn = first2;
+            last = last2;
+        }
+        prepared.width = last - prepared.firstColumn;
+
+        bool empty {false};
+        if (head1Prints) prepared.head1 = pack_pass(image, top, bottom, 1, prepared.firstColumn - lead, prepared.width, prepared.reversed, empty);
+        if (head2Prints) prepared.head2 = pack_pass(image, top, bottom, 2, prepared.firstColumn, prepared.width, prepared.reversed, empty);
+        layer.passes.push_back(std::move(prepared));
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,112 @@
+#ifndef SLICER_PRINTPIPELINE_H
+#define SLICER_PRINTPIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "layerslicer.h"
+#include "slicejob.h"
+
+namespace Slicer
+{
+
+// Packs bitmap columns [firstColumn, firstColumn + columnCount) of rows [top, bottom)
+// for one MJ head the way Controller::convert_image does: 'W', 100 + head, then 16 bytes
+// per column with the first row in the top bit. Columns outside the bitmap are blank, so
+// a negative firstColumn gives the lead-in convert_image's whiteSpace does. Head 1 prints
+// the positive pixels, head 2 the negative. reversed packs the last column first for a
+// pass printed in -X. empty is set if the head has nothing to print.
+std::vector<uint8_t> pack_pass(const LayerImage &image, int top, int bottom, int head,
+                               int firstColumn, int columnCount, bool reversed, bool &empty);
+
+// columns [first, last) of rows [top, bottom) that hold value, first == last if there are none
+void occupied_columns(const LayerImage &image, int top, int bottom, uint8_t value, int &first, int &last);
+
+// One pass cut down to the columns either head prints. Columns count along the bed in
+// droplets from the start X, head 2 prints bitmap column c at column c and head 1, which
+// trails it by the head gap, at column c + head1LeadColumns.
+struct PreparedPass
+{
+    int pass {0};                   // 1 = front of the bed, as in divided/layer_NNNN_pass_PP.bmp
+    int firstColumn {0};            // where the pass starts
+    int width {0};                  // columns in the pass, the same for both heads
+    bool reversed {false};          // printed in -X, the data starts at the last column
+    std::vector<uint8_t> head1;     // image data ready for the MJ controller,
+    std::vector<uint8_t> head2;     // empty if the head prints nothing in this pass
+};
+
+struct PreparedLayer
+{
+    int index {0};                  // 0 = bottom of the scene
+    int yShift_rows {0};
+    int emptyPasses {0};            // blank passes that were left out
+    int fullWidth {0};              // columns a pass over the whole bed would take
+    std::vector<PreparedPass> passes;
+};
+
+struct PipelineSettings
+{
+    int lookahead {2};              // layers sliced ahead of the one being printed
+    int head1LeadColumns {0};       // blank columns in front of head 1 for the gap between the heads
+    std::string archiveDirectory;   // also write the job folder here if not empty
+    bool bidirectional {false};     // every second pass of a layer prints in -X
+};
+
+// Slices a scene a few layers ahead of the printer and hands out each layer's
+// passes already shifted, split and packed for the heads, so printing can start
+// after the first layer is sliced instead of after the whole job is on disk.
+// Layers come out of try_next() or next() in order, the workers wait while
+// lookahead layers are waiting to be taken.
+class PrintPipeline
+{
+public:
+    PrintPipeline(std::shared_ptr<const LayerSlicer> slicer, const JobSettings &job, const PipelineSettings &settings);
+    ~PrintPipeline();
+
+    bool start(std::string &error);
+    void stop();
+
+    // takes the next layer if it is ready
+    bool try_next(PreparedLayer &layer);
+    // waits for the next layer, false once there are no more (all taken, failed or stopped)
+    bool next(PreparedLayer &layer);
+    // every layer has been taken, or preparing one failed
+    bool finished() const;
+    bool failed() const;
+    std::string error() const;
+
+    int layer_count() const {return m_layerCount;}
+    const std::vector<int> &shifts() const {return m_shifts;}
+
+private:
+    void work();
+    bool prepare(LayerImage &image, PreparedLayer &layer, std::string &error) const;
+
+private:
+    std::shared_ptr<const LayerSlicer> m_slicer;
+    JobSettings m_job;
+    PipelineSettings m_settings;
+    std::vector<int> m_shifts;
+    JobFolder m_archive;
+    int m_layerCount {0};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_space; // signalled when a layer is taken or on stop
+    std::condition_variable m_layerReady; // signalled when a layer is ready, on a failure or on stop
+    std::map<int, PreparedLayer> m_ready;
+    int m_nextToSlice {0};
+    int m_nextToHand {0};
+    bool m_stop {false};
+    std::string m_error;
+    std::vector<std::thread> m_workers;
+};
+
+}
+
+#endif // SLICER_PRINTPIPELINE_H
@@ -0,0 +1,294 @@
+#include "slicejob.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Slicer
+{
+
+namespace
+{
+
+void put_u16(std::vector<uint8_t> &b, size_t at, uint16_t v)
+{
+    b[at] = v & 0xFF;
+    b[at + 1] = (v >> 8) & 0xFF;
+}
+
+void put_u32(std::vector<uint8_t> &b, size_t at, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) b[at + i] = (v >> (8 * i)) & 0xFF;
+}
+
+std::string layer_name(int layer)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "layer_%04d", layer);
+    return name;
+}
+
+std::string time_string(const char *format)
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    char text[64];
+    std::strftime(text, sizeof(text), format, &tm);
+    return text;
+}
+
+bool write_parameters(const LayerSlicer &slicer, const JobSettings &job, const std::string &path)
+{
+    const SliceSettings &s = slicer.settings();
+    std::string names;
+    for (const auto &mesh : slicer.meshes())
+    {
+        if (!names.empty()) names += ", ";
+        names += mesh.name;
+    }
+
+    // same keys and layout as STL_Slicer_Dual.py so either slicer's jobs print the same way
+    std::ofstream file(path);
+    char line[256];
+    file << "--- Print Parameters ---\n"
+         << "Source STL File: " << names << "\n"
+         << "Slicing Date: " << time_string("%Y-%m-%d %H:%M:%S") << "\n\n"
+         << "--- Slicing & Resolution ---\n";
+    std::snprintf(line, sizeof(line), "Layer Height (Z): %.4f mm\n", s.layerHeight_mm); file << line;
+    std::snprintf(line, sizeof(line), "Droplet Spacing (X-axis resolution): %.4f mm\n", s.dropletSpacing_mm); file << line;
+    std::snprintf(line, sizeof(line), "Line Spacing (Y-axis resolution): %.4f mm\n\n", s.lineSpacing_mm); file << line;
+    file << "--- Printer & Motion ---\n";
+    std::snprintf(line, sizeof(line), "Print Frequency: %g Hz\n", job.printFrequency_Hz); file << line;
+    std::snprintf(line, sizeof(line), "Calculated Print Speed (X-axis): %.2f mm/s\n", job.printFrequency_Hz * s.dropletSpacing_mm); file << line;
+    file << "Nozzle Count: " << job.nozzleCount << "\n"
+         << "Y-Shift Per Layer: " << (job.yShiftPerLayer ? "True" : "False") << "\n"
+         << "Y-Shift Seed: " << job.seed << "\n\n"
+         << "--- Positioning ---\n";
+    std::snprintf(line, sizeof(line), "Part Position (Start X, Y): %.3fmm, %.3fmm\n", job.startX_mm, job.startY_mm); file << line;
+    return file.good();
+}
+
+}
+
+bool write_bmp(const std::string &path, const uint8_t *pixels, int width, int height, std::string &error)
+{
+    // BITMAPFILEHEADER + BITMAPINFOHEADER + 256 entry grey palette, rows bottom up and padded to 4 bytes
+    const uint32_t stride = (static_cast<uint32_t>(width) + 3) & ~3u;
+    const uint32_t headerSize = 14 + 40 + 256 * 4;
+    const uint32_t dataSize = stride * static_cast<uint32_t>(height);
+
+    std::vector<uint8_t> b(headerSize + dataSize, 0);
+    b[0] = 'B'; b[1] = 'M';
+    put_u32(b, 2, headerSize + dataSize);
+    put_u32(b, 10, headerSize);
+    put_u32(b, 14, 40);
+    put_u32(b, 18, static_cast<uint32_t>(width));
+    put_u32(b, 22, static_cast<uint32_t>(height));
+    put_u16(b, 26, 1);   // planes
+    put_u16(b, 28, 8);   // bits per pixel
+    put_u32(b, 34, dataSize);
+    put_u32(b, 38, 2835); // 72 dpi
+    put_u32(b, 42, 2835);
+    put_u32(b, 46, 256);
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        const size_t at = 54 + 4 * i;
+        b[at] = b[at + 1] = b[at + 2] = static_cast<uint8_t>(i);
+    }
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *src = pixels + static_cast<size_t>(height - 1 - y) * width;
+        std::copy(src, src + width, b.begin() + headerSize + static_cast<size_t>(y) * stride);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(b.data()), static_cast<std::streamsize>(b.size()));
+    if (!file.good())
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::string default_job_name()
+{
+    return "scene_" + time_string("%Y-%m-%d_%H-%M-%S");
+}
+
+std::vector<int> layer_shifts(const JobSettings &job, int layerCount)
+{
+    // picked up front so they don't depend on which thread slices a layer
+    std::vector<int> shifts(static_cast<size_t>(std::max(0, layerCount)), 0);
+    if (job.yShiftPerLayer)
+    {
+        std::mt19937 random(job.seed ? job.seed : std::random_device{}());
+        std::uniform_int_distribution<int> shift(0, job.maxYShift_rows);
+        for (auto &s : shifts) s = shift(random);
+    }
+    return shifts;
+}
+
+JobSettings fixed_seed(const JobSettings &job)
+{
+    JobSettings seeded = job;
+    std::random_device random;
+    while (seeded.seed == 0) seeded.seed = random();
+    return seeded;
+}
+
+void shift_layer(LayerImage &image, int rows)
+{
+    rows = std::min(rows, image.height);
+    if (rows <= 0) return;
+    const size_t n = static_cast<size_t>(rows) * image.width;
+    std::move_backward(image.pixels.begin(), image.pixels.end() - n, image.pixels.end());
+    std::fill(image.pixels.begin(), image.pixels.begin() + n, LayerImage::empty);
+}
+
+int pass_count(int height, int nozzleCount)
+{
+    return (height + nozzleCount - 1) / nozzleCount;
+}
+
+void pass_rows(int height, int nozzleCount, int pass, int &top, int &bottom)
+{
+    bottom = height - (pass - 1) * nozzleCount;
+    top = std::max(0, bottom - nozzleCount);
+}
+
+bool JobFolder::create(const LayerSlicer &slicer, const JobSettings &job, const std::string &directory,
+                       const std::vector<int> &shifts, std::string &error)
+{
+    const fs::path root(directory);
+    m_directory = directory;
+    m_wholeDir = root / "non-divided_non-moved";
+    m_shiftedDir = root / "non-divided";
+    m_passDir = root / "divided";
+
+    std::error_code ec;
+    for (const auto &dir : {m_wholeDir, m_shiftedDir, m_passDir})
+    {
+        fs::create_directories(dir, ec);
+        if (ec)
+        {
+            error = "could not create " + dir.string() + ": " + ec.message();
+            return false;
+        }
+    }
+
+    if (!write_parameters(slicer, job, (root / "print_parameters.txt").string()))
+    {
+        error = "could not write print_parameters.txt";
+        return false;
+    }
+
+    std::ofstream shiftLog(root / "layer_y_shifts.txt");
+    shiftLog << "Layer,Y_Shift_Pixels\n";
+    for (size_t i = 0; i < shifts.size(); i++) shiftLog << i + 1 << "," << shifts[i] << "\n";
+    if (!shiftLog.good())
+    {
+        error = "could not write layer_y_shifts.txt";
+        return false;
+    }
+    return true;
+}
+
+bool JobFolder::write_layer(LayerImage &image, int shift, int nozzleCount, int &passes, int &emptyPasses, std::string &error) const
+{
+    passes = 0;
+    emptyPasses = 0;
+    const std::string name = layer_name(image.index + 1);
+    if (!write_bmp((m_wholeDir / (name + ".bmp")).string(), image.pixels.data(), image.width, image.height, error)) return false;
+
+    shift_layer(image, shift);
+    if (!write_bmp((m_shiftedDir / (name + ".bmp")).string(), image.pixels.data(), image.width, image.height, error)) return false;
+
+    const int count = pass_count(image.height, nozzleCount);
+    for (int pass = 1; pass <= count; pass++)
+    {
+        int top {0}, bottom {0};
+        pass_rows(image.height, nozzleCount, pass, top, bottom);
+        if (image.rows_empty(top, bottom))
+        {
+            emptyPasses++;
+            continue;
+        }
+        char passName[64];
+        std::snprintf(passName, sizeof(passName), "%s_pass_%02d.bmp", name.c_str(), pass);
+        if (!write_bmp((m_passDir / passName).string(), image.row(top), image.width, bottom - top, error)) return false;
+        passes++;
+    }
+    return true;
+}
+
+bool write_job(const LayerSlicer &slicer, const JobSettings &settings, const std::string &directory,
+               const std::function<void(int, int)> &progress,
+               const std::atomic<bool> *cancel, JobResult &result, std::string &error)
+{
+    const JobSettings job = fixed_seed(settings); // saved in print_parameters.txt
+    const auto startTime = std::chrono::steady_clock::now();
+    result = JobResult();
+    if (!slicer.validate(error)) return false;
+
+    const int layerCount = slicer.layer_count();
+    const std::vector<int> shifts = layer_shifts(job, layerCount);
+    JobFolder folder;
+    if (!folder.create(slicer, job, directory, shifts, error)) return false;
+
+    std::mutex mutex; // results and the first error
+    std::atomic<int> layersDone {0};
+    std::atomic<bool> failed {false};
+    std::atomic<bool> stop {false};
+
+    auto layerDone = [&](LayerImage &&image)
+    {
+        if (cancel && cancel->load()) stop = true;
+        if (stop) return;
+
+        int passes {0}, emptyPasses {0};
+        std::string writeError;
+        const bool ok = folder.write_layer(image, shifts[image.index], job.nozzleCount, passes, emptyPasses, writeError);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            result.passes += passes;
+            result.emptyPasses += emptyPasses;
+            if (!ok && !failed)
+            {
+                failed = true;
+                stop = true;
+                error = writeError;
+            }
+        }
+        if (progress) progress(++layersDone, layerCount);
+    };
+
+    // slicing stops once a write fails or the user cancels
+    slicer.slice_all(layerDone, &stop);
+
+    result.layers = layersDone;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (failed) return false;
+    if (cancel && cancel->load())
+    {
+        error = "cancelled";
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef SLICER_SLICEJOB_H
+#define SLICER_SLICEJOB_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "layerslicer.h"
+
+namespace Slicer
+{
+
+// What the print job needs besides the bitmaps (see MJPrintheadWidget::parsePrintParameters)
+struct JobSettings
+{
+    double printFrequency_Hz {1000.0};
+    int nozzleCount {128};          // rows per pass
+    double startX_mm {3.0};
+    double startY_mm {9.0};
+    bool yShiftPerLayer {false};    // shift each layer by a random number of rows to stagger the pass seams
+    int maxYShift_rows {90};
+    unsigned int seed {0};          // for the y shifts, 0 picks one (see fixed_seed)
+};
+
+struct JobResult
+{
+    int layers {0};
+    int passes {0};                 // pass bitmaps written
+    int emptyPasses {0};            // blank passes that were skipped
+    double seconds {0.0};
+};
+
+// y shift (rows toward the front of the bed) of every layer, all 0 unless yShiftPerLayer
+std::vector<int> layer_shifts(const JobSettings &job, int layerCount);
+// job with a non-zero seed, so slicing it again (e.g. to resume it) gives the same shifts
+JobSettings fixed_seed(const JobSettings &job);
+
+// moves the layer toward the front of the bed, the rows it leaves are blank
+void shift_layer(LayerImage &image, int rows);
+
+// passes are cut from the bottom of the bitmap (front of the bed) up,
+// pass 1 prints rows [top, bottom) at the front, the last pass may be shorter
+int pass_count(int height, int nozzleCount);
+void pass_rows(int height, int nozzleCount, int pass, int &top, int &bottom);
+
+// The files the full print job reads
+//   print_parameters.txt
+//   layer_y_shifts.txt
+//   non-divided_non-moved/layer_NNNN.bmp   whole layer
+//   non-divided/layer_NNNN.bmp             whole layer after its y shift
+//   divided/layer_NNNN_pass_PP.bmp         nozzleCount rows each, blank passes are not written
+class JobFolder
+{
+public:
+    bool create(const LayerSlicer &slicer, const JobSettings &job, const std::string &directory,
+                const std::vector<int> &shifts, std::string &error);
+
+    // writes the layer, shifts it and writes it again with its passes (safe from several threads)
+    bool write_layer(LayerImage &image, int shift, int nozzleCount, int &passes, int &emptyPasses, std::string &error) const;
+
+    const std::string &directory() const {return m_directory;}
+
+private:
+    std::string m_directory;
+    std::filesystem::path m_wholeDir;
+    std::filesystem::path m_shiftedDir;
+    std::filesystem::path m_passDir;
+};
+
+// Writes an 8-bit greyscale BMP (rows given top to bottom)
+bool write_bmp(const std::string &path, const uint8_t *pixels, int width, int height, std::string &error);
+
+// "scene_yyyy-MM-dd_hh-mm-ss"
+std::string default_job_name();
+
+// Slices every layer into a JobFolder. Layer 1 is the bottom of the scene.
+// progress is called from the worker threads.
+bool write_job(const LayerSlicer &slicer, const JobSettings &job, const std::string &directory,
+               const std::function<void(int layersDone, int layerCount)> &progress,
+               const std::atomic<bool> *cancel, JobResult &result, std::string &error);
+
+}
+
+#endif // SLICER_SLICEJOB_H
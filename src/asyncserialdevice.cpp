@@ -1,5 +1,100 @@
 #include "asyncserialdevice.h"
 #include <QDebug>
+#include <QChar>
+#include <algorithm>
+#include "eventtimeline.h"
+
+namespace
+{
+
+// short description of a command for the event timeline (hex for binary protocols)
+std::string timeline_detail(const QByteArray &data)
+{
+    const int maxBytes {24};
+    const bool printable = std::all_of(data.begin(), data.end(), [](char c)
+    {
+        return (c >= 0x20 && c < 0x7F) || c == '\r' || c == '\n';
+    });
+    if (data.size() > 256) return QString("%1 bytes").arg(data.size()).toStdString();
+    if (printable) return data.trimmed().left(maxBytes * 3).toStdString();
+    return data.left(maxBytes).toHex(' ').toStdString();
+}
+
+}
+
+int JsonFramer::frame_length(const QByteArray &buffer) const
+{
+    if (scanned > buffer.size()) restart(); // buffer was cleared without a reset
+
+    const char *data = buffer.constData();
+    for (; scanned < buffer.size(); scanned++)
+    {
+        const char c = data[scanned];
+
+        if (!started)
+        {
+            if (c == '{')
+            {
+                started = true;
+                isJson = true;
+                depth = 1;
+            }
+            else if (c == textTerminator)
+            {
+                // blank line
+                const int length = scanned + 1;
+                restart();
+                return length;
+            }
+            else if (!QChar::isSpace(static_cast<uchar>(c)))
+            {
+                started = true;
+            }
+            continue;
+        }
+
+        if (!isJson)
+        {
+            if (c != textTerminator) continue;
+            const int length = scanned + 1;
+            restart();
+            return length;
+        }
+
+        if (escaped) escaped = false;
+        else if (inString)
+        {
+            if (c == '\\') escaped = true;
+            else if (c == '"') inString = false;
+        }
+        else if (c == '"') inString = true;
+        else if (c == '{' || c == '[') depth++;
+        else if ((c == '}' || c == ']') && --depth == 0)
+        {
+            const int length = scanned + 1;
+            restart();
+            return length;
+        }
+    }
+    return 0;
+}
+
+void JsonFramer::reset()
+{
+    restart();
+}
+
+void JsonFramer::restart() const
+{
+    scanned = 0;
+    depth = 0;
+    started = false;
+    isJson = false;
+    inString = false;
+    escaped = false;
+}
+
+// ====================================================================
 
 AsyncSerialDevice::AsyncSerialDevice(const QString& portName, QObject *parent) :
     QObject(parent),
@@ -8,6 +103,13 @@ AsyncSerialDevice::AsyncSerialDevice(const QString& portName, QObject *parent) :
 {
     serialPort->setPortName(portName);
     timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, [this]()
+    {
+        stats.timeouts++;
+        Timeline::EventTimeline::instance().instant("serial", name.toStdString(), "timeout");
+    });
+    connect(serialPort, &QSerialPort::bytesWritten, this, &AsyncSerialDevice::handle_bytes_written);
 }
 
 bool AsyncSerialDevice::is_connected() const
@@ -20,41 +122,247 @@ void AsyncSerialDevice::set_port_name(const QString &portName)
     serialPort->setPortName(portName);
 }
 
-void AsyncSerialDevice::write(const QByteArray &data)
+QString AsyncSerialDevice::device_name() const
+{
+    return name;
+}
+
+const SerialStats &AsyncSerialDevice::statistics() const
+{
+    return stats;
+}
+
+void AsyncSerialDevice::reset_statistics()
+{
+    stats.reset();
+}
+
+void AsyncSerialDevice::write(const QByteArray &data, Priority priority, int timeout_ms)
+{
+    if (!serialPort->isOpen())
+    {
+        emit error(QString("Can't send command. %1 is not connected").arg(name));
+        return;
+    }
+
+    Command command;
+    command.data = data;
+    command.timeout_ms = (timeout_ms < 0) ? defaultTimeout_ms : timeout_ms;
+    command.queuedTimer.start();
+
+    if (priority == Priority::Urgent) urgentQueue.enqueue(command);
+    else writeQueue.enqueue(command);
+
+    send_queued();
+}
+
+void AsyncSerialDevice::write_bulk(const QByteArray &data, int chunkSize, int timeout_ms)
 {
     if (!serialPort->isOpen())
     {
         emit error(QString("Can't send command. %1 is not connected").arg(name));
         return;
     }
-    writeQueue.enqueue(data);
-    if (isWriteReady) write_next();
+
+    Command command;
+    command.data = data;
+    command.timeout_ms = (timeout_ms < 0) ? defaultTimeout_ms : timeout_ms;
+    command.chunkSize = std::max(1, chunkSize);
+    command.queuedTimer.start();
+    writeQueue.enqueue(command);
+
+    send_queued();
 }
 
 void AsyncSerialDevice::write_next()
 {
-    if (!writeQueue.isEmpty())
+    if (!inFlight.isEmpty())
     {
-        isWriteReady = false;
-        // dequeue, store, and write the next message
-        prevWrite = writeQueue.dequeue();
-        serialPort->write(prevWrite);
-        // start timeout timer
-        // (expect a response from the device before the timer ends)
-        timer->start(readTimeout_ms);
+        const Command answered = inFlight.dequeue();
+        if (answered.chunkSize > 0) bulk = BulkTransfer(); // answered (or given up on) before it was all written
+        stats.roundTrip.record(answered.sentTimer.nsecsElapsed() / 1000);
+        // command sent -> response
+        Timeline::EventTimeline::instance().complete("serial", name.toStdString(), answered.sentTime_ns,
+                                                     timeline_detail(answered.data));
     }
+    send_queued();
+}
 
-    else // writing complete
+void AsyncSerialDevice::send_queued()
+{
+    while (!bulk.active && !sendHeld && inFlight.size() < windowSize && !(urgentQueue.isEmpty() && writeQueue.isEmpty()))
+    {
+        Command command = urgentQueue.isEmpty() ? writeQueue.dequeue() : urgentQueue.dequeue();
+        command.sentTimer.start();
+        command.sentTime_ns = Timeline::EventTimeline::now_ns();
+        stats.queueWait.record(command.queuedTimer.nsecsElapsed() / 1000);
+        stats.commandsSent++;
+        // expect a response from the device before the deadline
+        command.deadline = QDeadlineTimer(command.timeout_ms, Qt::PreciseTimer);
+
+        if (command.chunkSize > 0)
+        {
+            bulk = BulkTransfer();
+            bulk.active = true;
+            bulk.data = command.data;
+            bulk.chunkSize = command.chunkSize;
+            bulk.timeout_ms = command.timeout_ms;
+            bulk.elapsed.start();
+            inFlight.enqueue(command);
+            write_bulk_chunks();
+            break;
+        }
+
+        serialPort->write(command.data);
+        stats.bytesWritten += command.data.size();
+        inFlight.enqueue(command);
+    }
+    restart_timeout();
+}
+
+void AsyncSerialDevice::write_bulk_chunks()
+{
+    while (bulk.active && bulk.offset < bulk.data.size() && serialPort->bytesToWrite() < 2 * bulk.chunkSize)
+    {
+        const qint64 length = std::min<qint64>(bulk.chunkSize, bulk.data.size() - bulk.offset);
+        const qint64 n = serialPort->write(bulk.data.constData() + bulk.offset, length);
+        if (n <= 0)
+        {
+            abort_bulk(QString("the port would not take byte %1 of %2").arg(bulk.offset).arg(bulk.data.size()));
+            return;
+        }
+        bulk.offset += n;
+        stats.bytesWritten += n;
+    }
+}
+
+void AsyncSerialDevice::handle_bytes_written(qint64 bytes)
+{
+    if (!bulk.active || bulk.sent || inFlight.isEmpty()) return;
+
+    bulk.written = std::min<qint64>(bulk.written + bytes, bulk.data.size());
+    const double elapsed_s = std::max<qint64>(1, bulk.elapsed.nsecsElapsed()) / 1e9;
+    emit bulk_write_progress(bulk.written, bulk.data.size(), bulk.written / elapsed_s);
+
+    // the bulk command is the newest one in flight, restart its timeout while data is moving
+    inFlight.last().deadline = QDeadlineTimer(bulk.timeout_ms, Qt::PreciseTimer);
+
+    if (bulk.written >= bulk.data.size())
+    {
+        // commands queued behind the bulk write wait until the device has answered it (write_next)
+        bulk.sent = true;
+        restart_timeout();
+        return;
+    }
+
+    write_bulk_chunks();
+    restart_timeout();
+}
+
+void AsyncSerialDevice::abort_bulk(const QString &reason)
+{
+    if (!bulk.active) return;
+
+    // bytes the port still holds would land in the device part way through
+    // whatever it is sent next, and what was queued behind counted on the transfer
+    serialPort->clear(QSerialPort::Output);
+    if (!inFlight.isEmpty() && inFlight.last().chunkSize > 0) inFlight.removeLast();
+    bulk = BulkTransfer();
+    const int dropped = writeQueue.size();
+    writeQueue.clear();
+    readData.clear();
+    if (framer) framer->reset();
+
+    // the device ends a transfer once the data stops coming
+    sendHeld = true;
+    QTimer::singleShot(bulkAbortQuiet_ms, this, [this]()
+    {
+        sendHeld = false;
+        send_queued();
+    });
+    restart_timeout();
+
+    QString text = QString("%1: Bulk write abandoned, %2").arg(name, reason);
+    if (dropped > 0) text += QString(" (%1 queued command(s) dropped)").arg(dropped);
+    emit error(text);
+    emit bulk_write_failed(reason);
+}
+
+bool AsyncSerialDevice::bulk_in_flight() const
+{
+    return bulk.active;
+}
+
+void AsyncSerialDevice::restart_timeout()
+{
+    if (inFlight.isEmpty()) // writing complete
     {
-        isWriteReady = true;
         timer->stop();
+        return;
     }
+
+    qint64 remaining_ms = inFlight.head().deadline.remainingTime();
+    for (const auto &command : inFlight)
+        remaining_ms = std::min(remaining_ms, command.deadline.remainingTime());
+    timer->start(static_cast<int>(std::max<qint64>(0, remaining_ms)));
 }
 
 void AsyncSerialDevice::clear_command_queue()
 {
+    urgentQueue.clear();
     writeQueue.clear();
-    isWriteReady = true;
+    inFlight.clear();
+    bulk = BulkTransfer();
+    sendHeld = false;
+    readData.clear();
+    if (framer) framer->reset();
+    timer->stop();
+}
+
+void AsyncSerialDevice::set_window_size(int numCommands)
+{
+    windowSize = std::max(1, numCommands);
+    send_queued();
+}
+
+void AsyncSerialDevice::set_framer(std::unique_ptr<ResponseFramer> responseFramer)
+{
+    framer = std::move(responseFramer);
+}
+
+bool AsyncSerialDevice::take_response(QByteArray &frame)
+{
+    if (!framer) return false;
+    const int length = framer->frame_length(readData);
+    if (length <= 0) return false;
+    frame = readData.left(length);
+    readData.remove(0, length);
+    return true;
+}
+
+void AsyncSerialDevice::read_serial_data()
+{
+    const QByteArray data = serialPort->readAll();
+    stats.bytesRead += data.size();
+    readData.append(data);
+}
+
+QByteArray AsyncSerialDevice::take_unframed()
+{
+    QByteArray data;
+    data.swap(readData);
+    if (framer) framer->reset();
+    return data;
+}
+
+QByteArray AsyncSerialDevice::pending_command() const
+{
+    return inFlight.isEmpty() ? QByteArray() : inFlight.head().data;
+}
+
+int AsyncSerialDevice::num_in_flight() const
+{
+    return inFlight.size();
 }
 
 
@@ -1,50 +1,7 @@
 #include "bedmicroscope.h"
+#include <QRegularExpression>
 #include <vector>
 
-static int computeMedian(std::vector<uchar> elements)
-{
-    std::nth_element(elements.begin(),
-                     elements.begin() + elements.size()/2,
-                     elements.end());
-    return elements[elements.size() / 2];
-}
-
-static cv::Mat compute_median(const std::vector<cv::Mat> &vec)
-{
-    // Note: Expects the image to be CV_8UC1
-    cv::Mat medianImg(vec[0].rows, vec[0].cols, CV_8UC1);
-
-    // Calculate median with parallel execution
-    medianImg.forEach<uchar>([vec](uchar &p, const int *pos) -> void
-    {
-        std::vector<uchar> elements;
-        elements.reserve(vec.size());
-        for (int i{0}; i<vec.size(); ++i)
-            elements.emplace_back(vec[i].at<uchar>(pos[0], pos[1]));
-        p = computeMedian(elements);
-    });
-
-    return medianImg;
-}
-
-cv::Mat compute_mean(const std::vector<cv::Mat> &vec)
-{
-    // Note: Expects the images to be CV_8UC1
-    cv::Mat meanImg(vec[0].rows, vec[0].cols, CV_8UC1, cv::Scalar(0));
-
-    // Calculate mean with parallel execution
-    meanImg.forEach<uchar>([&vec](uchar &p, const int *pos) -> void
-    {
-        int sum = 0;
-        for (const auto &img : vec) {
-            sum += img.at<uchar>(pos[0], pos[1]);
-        }
-        p = static_cast<uchar>(sum / vec.size());
-    });
-
-    return meanImg;
-}
-
 BedMicroscope::BedMicroscope(QObject *parent) :
     QObject(parent)
 {
@@ -53,6 +10,7 @@ BedMicroscope::BedMicroscope(QObject *parent) :
 
 BedMicroscope::~BedMicroscope()
 {
+    QMutexLocker lock(&m_mutex);
     if (cap.isOpened())
     {
         cap.release();
@@ -62,24 +20,34 @@ BedMicroscope::~BedMicroscope()
 
 bool BedMicroscope::open_capture(int index)
 {
+    QMutexLocker lock(&m_mutex);
     cap.open(index);
     return cap.isOpened();
 }
 
 void BedMicroscope::disconnect_camera()
 {
+    QMutexLocker lock(&m_mutex);
     cap.release();
 }
 
+bool BedMicroscope::is_connected()
+{
+    QMutexLocker lock(&m_mutex);
+    return cap.isOpened();
+}
+
 QImage BedMicroscope::get_frame()
 {
+    QMutexLocker lock(&m_mutex);
     cap >> frame; // Capture frame from camera
 
     if (!frame.empty())
     {
         // Convert OpenCV Mat to QImage
+        // copy since frame is overwritten by the next read
         QImage img(frame.data, frame.cols, frame.rows, frame.step, QImage::Format_BGR888);
-        return img; // why copy here?
+        return img.copy();
     }
     else // if could not get frame
     {
@@ -89,32 +57,164 @@ QImage BedMicroscope::get_frame()
     }
 }
 
-void BedMicroscope::save_image(const QString &filename)
+cv::Mat BedMicroscope::grab_average(int n)
 {
-    // testing
-    const int n = 5;
+    QMutexLocker lock(&m_mutex);
+    if (!cap.isOpened() || n < 1) return cv::Mat();
 
-    std::vector<cv::Mat> frames;
+    cap.grab(); // drop a frame that may have been exposed before the stage stopped
 
-    // Capture and store frames
     cv::Mat grayFrame;
+    cv::Mat sum;
+    int numFrames {0};
     for (int i = 0; i < n; ++i)
     {
-        cap >> frame; // error handling?
+        cap >> frame;
+        if (frame.empty()) continue;
         cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
-        frames.push_back(grayFrame.clone());
+        if (sum.empty()) sum = cv::Mat::zeros(grayFrame.size(), CV_32FC1);
+        cv::accumulate(grayFrame, sum);
+        numFrames++;
+    }
+
+    if (numFrames == 0) return cv::Mat();
+    cv::Mat mean;
+    sum.convertTo(mean, CV_8UC1, 1.0 / numFrames);
+    return mean;
+}
+
+void BedMicroscope::save_image(const QString &filename)
+{
+    cv::Mat meanFrame = grab_average(5);
+    if (!meanFrame.empty()) cv::imwrite(filename.toStdString(), meanFrame);
+}
+
+// ====================================================================
+
+BedScanner::BedScanner(BedMicroscope *microscope) :
+    QObject(),
+    m_microscope(microscope)
+{
+    qRegisterMetaType<BedScanSettings>("BedScanSettings");
+    m_writers.setMaxThreadCount(2);
+    m_thread.reset(new QThread);
+    m_thread->setObjectName("Bed Scanner Thread");
+    moveToThread(m_thread.get());
+    m_thread->start();
+}
+
+BedScanner::~BedScanner()
+{
+    QMetaObject::invokeMethod(this, "cleanup");
+    m_thread->wait();
+    m_writers.waitForDone();
+}
+
+QString BedScanner::tile_file_path(const BedScanSettings &settings, const QString &position)
+{
+    return QString("%1/%2_%3.png").arg(settings.folder, QString::number(settings.bedID).rightJustified(3, '0'), position);
+}
+
+void BedScanner::set_tile_done_handler(std::function<bool()> handler)
+{
+    m_tileDone = std::move(handler);
+}
+
+void BedScanner::start(const BedScanSettings &settings)
+{
+    m_settings = settings;
+    m_settings.mosaicDownsample = std::max(1, m_settings.mosaicDownsample);
+    m_mosaic = cv::Mat();
+    m_numTiles = 0;
+    m_running = true;
+}
+
+void BedScanner::capture_tile(const QString &position)
+{
+    cv::Mat tile = m_microscope->grab_average(m_settings.framesPerTile);
+
+    // the stage can move while the tile is saved
+    if (m_tileDone && !m_tileDone())
+    {
+        emit print_to_output_window(QString("Could not tell the scan program that %1 was captured, "
+                                            "it moves on after its 5 s timeout").arg(position));
     }
+    emit tile_captured(position);
 
-    cv::Mat meanFrame = compute_mean(frames);
+    if (tile.empty())
+    {
+        emit print_to_output_window(QString("Could not capture bed image %1").arg(position));
+        return;
+    }
 
-//    cv::cvtColor(medianFrame, grayFrame, cv::COLOR_BGR2GRAY);
+    const QString fileName = tile_file_path(m_settings, position);
+    m_writers.start([tile, fileName]()
+    {
+        cv::imwrite(fileName.toStdString(), tile);
+    });
 
-//    cap >> frame;
-//    cv::Mat grayFrame;
-//    cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
+    // positions look like "a01": column letter, then row number
+    QRegularExpressionMatch match = QRegularExpression("^([a-z])(\\d+)$").match(position);
+    if (m_running && match.hasMatch())
+    {
+        const int nx = match.captured(1).at(0).toLatin1() - 'a';
+        const int ny = match.captured(2).toInt() - 1;
+        add_to_mosaic(tile, nx, ny);
+    }
 
-    get_frame();
-    cv::imwrite(filename.toStdString(), meanFrame);
+    m_numTiles++;
+}
+
+void BedScanner::add_to_mosaic(const cv::Mat &tile, int nx, int ny)
+{
+    const int ds = m_settings.mosaicDownsample;
+    cv::Mat small;
+    cv::resize(tile, small, cv::Size(), 1.0 / ds, 1.0 / ds, cv::INTER_AREA);
+
+    // tile pitch in mosaic pixels, from the stage spacing if the image scale is known
+    int stepX = small.cols;
+    int stepY = small.rows;
+    if (m_settings.pixelSize_um > 0.0)
+    {
+        stepX = static_cast<int>(std::round(m_settings.xSpacing_mm * 1000.0 / m_settings.pixelSize_um / ds));
+        stepY = static_cast<int>(std::round(m_settings.ySpacing_mm * 1000.0 / m_settings.pixelSize_um / ds));
+    }
+
+    if (m_mosaic.empty())
+    {
+        const int width = (m_settings.numX - 1) * stepX + small.cols;
+        const int height = (m_settings.numY - 1) * stepY + small.rows;
+        m_mosaic = cv::Mat::zeros(std::max(1, height), std::max(1, width), CV_8UC1);
+    }
+
+    const cv::Rect target = cv::Rect(nx * stepX, ny * stepY, small.cols, small.rows) &
+            cv::Rect(0, 0, m_mosaic.cols, m_mosaic.rows);
+    if (target.empty()) return;
+    small(cv::Rect(0, 0, target.width, target.height)).copyTo(m_mosaic(target));
+
+    QImage image(m_mosaic.data, m_mosaic.cols, m_mosaic.rows, m_mosaic.step, QImage::Format_Grayscale8);
+    emit mosaic_updated(image.copy());
+}
+
+void BedScanner::finish()
+{
+    if (!m_running) return;
+    m_running = false;
+    m_writers.waitForDone();
+
+    QString mosaicFile;
+    if (!m_mosaic.empty())
+    {
+        mosaicFile = tile_file_path(m_settings, "mosaic");
+        cv::imwrite(mosaicFile.toStdString(), m_mosaic);
+    }
+    emit print_to_output_window(QString("Bed scan complete: %1 images").arg(m_numTiles));
+    emit scan_finished(mosaicFile);
+}
+
+void BedScanner::cleanup()
+{
+    m_thread->quit();
 }
 
 #include "moc_bedmicroscope.cpp"
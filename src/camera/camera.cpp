@@ -2,6 +2,7 @@
 
 #include "queyeimage.h"
 #include "utils.h"
+#include "eventtimeline.h"
 #include <QDebug>
 #include <QString>
 #include <thread>
@@ -160,6 +161,7 @@ void Camera::eventreceived (unsigned int event)
         //TODO:reOpenCamera();
         break;
     case IS_SET_EVENT_FRAME:
+        Timeline::EventTimeline::instance().instant("camera", "frame captured");
         emit frameReceived();
         break;
     case IS_SET_EVENT_DEVICE_RECONNECTED:
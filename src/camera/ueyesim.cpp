@@ -0,0 +1,1487 @@
+#include "ueyesim.h"
+
+#include <ueye.h>
+#include <ueye_tools.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace UEyeSim
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+const HIDS SIM_CAMERA_HANDLE {1};
+const DWORD SIM_DEVICE_ID {1};
+const double NOMINAL_EXPOSURE_ms {1.0}; // exposure at which the rendered brightness is unscaled
+
+struct Buffer
+{
+    std::vector<char> memory;
+    INT id {0};
+    INT seqNum {0}; // 1-based position in the sequence, 0 if not in it
+    INT width {0};
+    INT height {0};
+    INT bitsPerPixel {0};
+    INT pitch {0};
+    bool locked {false};
+    UEYEIMAGEINFO info {};
+};
+
+struct Event
+{
+    bool manualReset {false};
+    bool signaled {false};
+    bool enabled {false};
+};
+
+struct SimCamera
+{
+    Config config;
+
+    std::mutex mutex;
+    std::condition_variable wake;      // wakes the frame thread when the capture state changes
+    std::condition_variable eventWake; // wakes is_Event(WAIT) and is_FreezeVideo callers
+
+    std::map<UINT, Event> events;
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Buffer*> sequence;
+    INT nextBufferId {1};
+    int lastSeqIndex {-1}; // sequence index of the last completed frame
+
+    IS_RECT aoi {};
+    INT colorMode {IS_CM_MONO8};
+    double frameRate {30.0};
+    double exposure_ms {1.0};
+    double measuredFrameRate {0.0};
+    UINT pixelClock_MHz {86};
+    INT masterGain {0};
+    INT triggerMode {IS_SET_TRIGGER_OFF};
+    INT triggerDelay_us {0};
+    UINT triggerTimeout {0};
+
+    bool live {false};
+    int pendingFrames {0};   // frames requested by is_FreezeVideo
+    int pendingTriggers {0}; // software triggers waiting for the sensor
+    std::uint64_t frameNumber {0};
+
+    Clock::time_point openTime;
+    Clock::time_point nextFrameTime;
+    Clock::time_point lastFrameTime;
+
+    std::mt19937 rng;
+    cv::RNG noise;
+    cv::VideoCapture source;
+
+    std::thread thread;
+    bool running {false};
+};
+
+struct Avi
+{
+    HIDS camera {0};
+    INT colorMode {IS_CM_MONO8};
+    int width {0};
+    int height {0};
+    int posX {0};
+    int posY {0};
+    int quality {75};
+    double frameRate {25.0};
+    std::string fileName;
+    cv::VideoWriter writer;
+};
+
+struct AtomicStats
+{
+    std::atomic<std::uint64_t> framesGenerated {0};
+    std::atomic<std::uint64_t> framesDropped {0};
+    std::atomic<std::uint64_t> framesLost {0};
+    std::atomic<std::uint64_t> triggersIgnored {0};
+};
+
+std::mutex g_mutex;
+Config g_config;
+bool g_configSet {false};
+std::unique_ptr<SimCamera> g_camera;
+AtomicStats g_stats;
+
+std::mutex g_aviMutex;
+std::map<INT, std::unique_ptr<Avi>> g_avis;
+INT g_nextAviId {1};
+
+SimCamera* camera(HIDS hCam)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return (hCam == SIM_CAMERA_HANDLE) ? g_camera.get() : nullptr;
+}
+
+double env_double(const char *name, double fallback)
+{
+    const char *value = std::getenv(name);
+    return (value && *value) ? std::atof(value) : fallback;
+}
+
+int bytes_per_pixel(INT bitsPerPixel)
+{
+    return (bitsPerPixel + 7) / 8;
+}
+
+double min_frame_period_s(const SimCamera &cam)
+{
+    return std::max(1.0 / cam.config.maxFrameRate, cam.exposure_ms / 1000.0);
+}
+
+bool is_software_trigger(INT mode)
+{
+    return (mode & (IS_SET_TRIGGER_SOFTWARE & ~IS_SET_TRIGGER_CONTINUOUS)) != 0;
+}
+
+void copy_string(IS_CHAR *dest, size_t size, const char *src)
+{
+    std::strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+// expects cam.mutex to be locked
+void signal_event(SimCamera &cam, UINT event)
+{
+    auto it = cam.events.find(event);
+    if (it == cam.events.end() || !it->second.enabled) return;
+    it->second.signaled = true;
+    cam.eventWake.notify_all();
+}
+
+Buffer* find_buffer(SimCamera &cam, const char *mem)
+{
+    for (auto &buffer : cam.buffers)
+        if (buffer->memory.data() == mem) return buffer.get();
+    return nullptr;
+}
+
+Buffer* find_buffer(SimCamera &cam, INT id)
+{
+    for (auto &buffer : cam.buffers)
+        if (buffer->id == id) return buffer.get();
+    return nullptr;
+}
+
+// 8 bit image of the AOI, either from the source video or the droplet model
+cv::Mat render_aoi(SimCamera &cam)
+{
+    const cv::Rect aoi(cam.aoi.s32X, cam.aoi.s32Y, cam.aoi.s32Width, cam.aoi.s32Height);
+    const int W = cam.config.sensorWidth;
+    const int H = cam.config.sensorHeight;
+    cv::Mat image;
+
+    if (cam.source.isOpened())
+    {
+        cv::Mat frame;
+        if (!cam.source.read(frame) || frame.empty())
+        {
+            cam.source.set(cv::CAP_PROP_POS_FRAMES, 0); // loop the video
+            cam.source.read(frame);
+        }
+        if (!frame.empty())
+        {
+            cv::Mat gray, sensor;
+            if (frame.channels() == 3) cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            else if (frame.channels() == 4) cv::cvtColor(frame, gray, cv::COLOR_BGRA2GRAY);
+            else gray = frame;
+            cv::resize(gray, sensor, cv::Size(W, H));
+            image = sensor(aoi).clone();
+        }
+    }
+
+    if (image.empty())
+    {
+        // parametric droplet model in sensor coordinates: a dark nozzle at the top
+        // center with a drop (and optional satellites) falling away from it
+        image = cv::Mat(aoi.size(), CV_8UC1, cv::Scalar(200));
+        const cv::Point offset(-aoi.x, -aoi.y);
+
+        const int nozzleWidth = std::max(8, W / 12);
+        const int nozzleBottom = H / 6;
+        cv::rectangle(image, cv::Rect(W / 2 - nozzleWidth / 2, 0, nozzleWidth, nozzleBottom) + offset,
+                      cv::Scalar(40), cv::FILLED);
+
+        const int radius = std::max(3, W / 80);
+        const double travel = std::max(1.0, static_cast<double>(H - nozzleBottom));
+        const double y = nozzleBottom + radius +
+                std::fmod(cam.frameNumber * cam.config.dropletSpeed_px, travel);
+        cv::circle(image, cv::Point(W / 2, static_cast<int>(y)) + offset, radius,
+                   cv::Scalar(30), cv::FILLED, cv::LINE_AA);
+
+        for (int i = 1; i <= cam.config.numSatellites; i++)
+        {
+            const int satY = static_cast<int>(y) - i * 3 * radius;
+            if (satY <= nozzleBottom) break;
+            cv::circle(image, cv::Point(W / 2, satY) + offset, std::max(1, radius / 2),
+                       cv::Scalar(30), cv::FILLED, cv::LINE_AA);
+        }
+    }
+
+    cv::Mat noise(image.size(), CV_16SC1);
+    cam.noise.fill(noise, cv::RNG::NORMAL, 0, 2);
+    cv::Mat noisy;
+    image.convertTo(noisy, CV_16SC1);
+    noisy += noise;
+
+    // brightness follows exposure and gain so auto exposure has something to work with
+    const double scale = (cam.exposure_ms / NOMINAL_EXPOSURE_ms) * (1.0 + cam.masterGain / 100.0 * 3.0);
+    noisy.convertTo(image, CV_8UC1, scale);
+    return image;
+}
+
+// expects cam.mutex to be locked
+void write_to_buffer(const cv::Mat &gray, Buffer &buffer)
+{
+    const int width = std::min(buffer.width, gray.cols);
+    const int height = std::min(buffer.height, gray.rows);
+    const cv::Mat src = gray(cv::Rect(0, 0, width, height));
+
+    switch (buffer.bitsPerPixel)
+    {
+    case 8:
+    {
+        cv::Mat dest(height, width, CV_8UC1, buffer.memory.data(), buffer.pitch);
+        src.copyTo(dest);
+        break;
+    }
+    case 24:
+    {
+        cv::Mat dest(height, width, CV_8UC3, buffer.memory.data(), buffer.pitch);
+        cv::cvtColor(src, dest, cv::COLOR_GRAY2BGR);
+        break;
+    }
+    case 32:
+    {
+        cv::Mat dest(height, width, CV_8UC4, buffer.memory.data(), buffer.pitch);
+        cv::cvtColor(src, dest, cv::COLOR_GRAY2BGRA);
+        break;
+    }
+    case 16:
+    {
+        cv::Mat dest(height, width, CV_16UC1, buffer.memory.data(), buffer.pitch);
+        src.convertTo(dest, CV_16UC1, 256.0);
+        break;
+    }
+    default:
+        std::fill(buffer.memory.begin(), buffer.memory.end(), 0);
+    }
+}
+
+// expects cam.mutex to be locked
+void capture_frame(SimCamera &cam, Clock::time_point exposureTime)
+{
+    cam.frameNumber++;
+    g_stats.framesGenerated++;
+    if (cam.pendingFrames > 0) cam.pendingFrames--;
+
+    const double interval_s = std::chrono::duration<double>(exposureTime - cam.lastFrameTime).count();
+    if (cam.frameNumber > 1 && interval_s > 0.0)
+        cam.measuredFrameRate = 0.9 * cam.measuredFrameRate + 0.1 / interval_s;
+    cam.lastFrameTime = exposureTime;
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    if (cam.config.dropRate > 0.0 && uniform(cam.rng) < cam.config.dropRate)
+    {
+        // the frame number still advances, so dropped frames show up as gaps
+        g_stats.framesDropped++;
+        signal_event(cam, IS_SET_EVENT_CAPTURE_STATUS);
+        cam.eventWake.notify_all();
+        return;
+    }
+
+    // like the driver, fill the next buffer in the sequence that isn't locked
+    Buffer *target {nullptr};
+    int targetIndex {-1};
+    const int numBuffers = static_cast<int>(cam.sequence.size());
+    for (int i = 1; i <= numBuffers; i++)
+    {
+        const int index = (cam.lastSeqIndex + i) % numBuffers;
+        if (!cam.sequence[index]->locked)
+        {
+            target = cam.sequence[index];
+            targetIndex = index;
+            break;
+        }
+    }
+
+    if (!target)
+    {
+        g_stats.framesLost++;
+        signal_event(cam, IS_SET_EVENT_CAPTURE_STATUS);
+        cam.eventWake.notify_all();
+        return;
+    }
+
+    write_to_buffer(render_aoi(cam), *target);
+
+    INT bufferedFrames {0};
+    for (auto buffer : cam.sequence)
+        if (buffer->locked) bufferedFrames++;
+
+    UEYEIMAGEINFO &info = target->info;
+    info = UEYEIMAGEINFO{};
+    info.u64TimestampDevice = static_cast<UINT64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(exposureTime - cam.openTime).count() / 100);
+    info.u64FrameNumber = cam.frameNumber;
+    info.dwImageBuffers = static_cast<DWORD>(numBuffers);
+    info.dwImageBuffersInUse = static_cast<DWORD>(bufferedFrames);
+    info.dwImageWidth = static_cast<DWORD>(target->width);
+    info.dwImageHeight = static_cast<DWORD>(target->height);
+
+    cam.lastSeqIndex = targetIndex;
+    signal_event(cam, IS_SET_EVENT_FRAME);
+    cam.eventWake.notify_all();
+}
+
+void run_frame_thread(SimCamera *cam)
+{
+    std::unique_lock<std::mutex> lock(cam->mutex);
+    Clock::time_point nextTrigger = Clock::now();
+
+    while (cam->running)
+    {
+        const bool capturing = (cam->live || cam->pendingFrames > 0) && !cam->sequence.empty();
+        if (!capturing)
+        {
+            cam->wake.wait(lock);
+            nextTrigger = Clock::now();
+            continue;
+        }
+
+        const auto now = Clock::now();
+        const auto minPeriod = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(min_frame_period_s(*cam)));
+
+        if (cam->triggerMode == IS_SET_TRIGGER_OFF)
+        {
+            if (now < cam->nextFrameTime)
+            {
+                cam->wake.wait_until(lock, cam->nextFrameTime);
+                continue;
+            }
+            capture_frame(*cam, now);
+            const auto period = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(1.0 / cam->frameRate));
+            cam->nextFrameTime += std::max(period, minPeriod);
+            if (cam->nextFrameTime < now) cam->nextFrameTime = now + period; // fell behind
+        }
+        else if (is_software_trigger(cam->triggerMode))
+        {
+            if (cam->pendingTriggers == 0)
+            {
+                cam->wake.wait(lock);
+                continue;
+            }
+            if (now < cam->lastFrameTime + minPeriod)
+            {
+                cam->wake.wait_until(lock, cam->lastFrameTime + minPeriod);
+                continue;
+            }
+            cam->pendingTriggers--;
+            capture_frame(*cam, now + std::chrono::microseconds(cam->triggerDelay_us));
+        }
+        else
+        {
+            // hardware trigger input pulsing at a fixed rate
+            if (now < nextTrigger)
+            {
+                cam->wake.wait_until(lock, nextTrigger);
+                continue;
+            }
+            if (cam->frameNumber > 0 && now < cam->lastFrameTime + minPeriod)
+                g_stats.triggersIgnored++; // sensor still busy with the previous frame
+            else
+                capture_frame(*cam, now + std::chrono::microseconds(cam->triggerDelay_us));
+
+            nextTrigger += std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(1.0 / cam->config.hardwareTriggerRate_Hz));
+            if (nextTrigger < now) nextTrigger = now;
+        }
+    }
+}
+
+}
+
+Config config_from_environment()
+{
+    Config config;
+    if (const char *source = std::getenv("UEYE_SIM_SOURCE")) config.sourceVideo = source;
+    config.sensorWidth = static_cast<int>(env_double("UEYE_SIM_WIDTH", config.sensorWidth));
+    config.sensorHeight = static_cast<int>(env_double("UEYE_SIM_HEIGHT", config.sensorHeight));
+    config.frameRate = env_double("UEYE_SIM_FPS", config.frameRate);
+    config.maxFrameRate = env_double("UEYE_SIM_MAX_FPS", config.maxFrameRate);
+    config.hardwareTriggerRate_Hz = env_double("UEYE_SIM_TRIGGER_HZ", config.hardwareTriggerRate_Hz);
+    config.dropRate = env_double("UEYE_SIM_DROP_RATE", config.dropRate);
+    config.dropletSpeed_px = env_double("UEYE_SIM_DROP_SPEED", config.dropletSpeed_px);
+    config.numSatellites = static_cast<int>(env_double("UEYE_SIM_SATELLITES", config.numSatellites));
+    config.seed = static_cast<unsigned int>(env_double("UEYE_SIM_SEED", config.seed));
+
+    // keep the simulated sensor sane
+    config.sensorWidth = std::max(64, config.sensorWidth);
+    config.sensorHeight = std::max(64, config.sensorHeight);
+    config.maxFrameRate = std::max(1.0, config.maxFrameRate);
+    config.frameRate = std::clamp(config.frameRate, 0.1, config.maxFrameRate);
+    config.hardwareTriggerRate_Hz = std::max(0.1, config.hardwareTriggerRate_Hz);
+    config.dropRate = std::clamp(config.dropRate, 0.0, 1.0);
+    config.numSatellites = std::max(0, config.numSatellites);
+    return config;
+}
+
+void set_config(const Config &config)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_config = config;
+    g_configSet = true;
+}
+
+Config config()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_configSet ? g_config : config_from_environment();
+}
+
+Stats stats()
+{
+    Stats stats;
+    stats.framesGenerated = g_stats.framesGenerated;
+    stats.framesDropped = g_stats.framesDropped;
+    stats.framesLost = g_stats.framesLost;
+    stats.triggersIgnored = g_stats.triggersIgnored;
+    return stats;
+}
+
+void reset_stats()
+{
+    g_stats.framesGenerated = 0;
+    g_stats.framesDropped = 0;
+    g_stats.framesLost = 0;
+    g_stats.triggersIgnored = 0;
+}
+
+}
+
+using namespace UEyeSim;
+
+// --- camera lifetime and information ---
+
+INT is_InitCamera(HIDS *phCam, HWND /*hWnd*/)
+{
+    if (!phCam) return IS_NO_SUCCESS;
+
+    const HIDS requested = *phCam & ~(IS_USE_DEVICE_ID | IS_ALLOW_STARTER_FW_UPLOAD);
+    if (requested != 0 && requested != SIM_DEVICE_ID) return IS_CANT_OPEN_DEVICE;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_camera) return IS_CANT_OPEN_DEVICE; // only one simulated camera
+
+    auto cam = std::make_unique<SimCamera>();
+    cam->config = g_configSet ? g_config : config_from_environment();
+    cam->aoi = {0, 0, cam->config.sensorWidth, cam->config.sensorHeight};
+    cam->frameRate = cam->config.frameRate;
+    cam->exposure_ms = std::min(NOMINAL_EXPOSURE_ms, 1000.0 / cam->frameRate);
+    cam->rng.seed(cam->config.seed);
+    cam->noise = cv::RNG(cam->config.seed);
+    cam->openTime = Clock::now();
+    cam->nextFrameTime = cam->openTime;
+    cam->lastFrameTime = cam->openTime;
+    if (!cam->config.sourceVideo.empty()) cam->source.open(cam->config.sourceVideo);
+
+    cam->running = true;
+    cam->thread = std::thread(run_frame_thread, cam.get());
+
+    g_camera = std::move(cam);
+    *phCam = SIM_CAMERA_HANDLE;
+    return IS_SUCCESS;
+}
+
+INT is_ExitCamera(HIDS hCam)
+{
+    std::unique_ptr<SimCamera> cam;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (hCam != SIM_CAMERA_HANDLE || !g_camera) return IS_INVALID_CAMERA_HANDLE;
+        cam = std::move(g_camera);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        cam->running = false;
+    }
+    cam->wake.notify_all();
+    cam->eventWake.notify_all();
+    if (cam->thread.joinable()) cam->thread.join();
+    return IS_SUCCESS;
+}
+
+INT is_GetNumberOfCameras(INT *pnNumCams)
+{
+    if (!pnNumCams) return IS_NO_SUCCESS;
+    *pnNumCams = 1;
+    return IS_SUCCESS;
+}
+
+INT is_GetCameraList(PUEYE_CAMERA_LIST pucl)
+{
+    if (!pucl) return IS_NO_SUCCESS;
+    if (pucl->dwCount == 0)
+    {
+        pucl->dwCount = 1;
+        return IS_SUCCESS;
+    }
+
+    pucl->dwCount = 1;
+    UEYE_CAMERA_INFO &info = pucl->uci[0];
+    info = UEYE_CAMERA_INFO{};
+    info.dwCameraID = SIM_DEVICE_ID;
+    info.dwDeviceID = SIM_DEVICE_ID;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        info.dwInUse = g_camera ? 1 : 0;
+    }
+    copy_string(info.SerNo, sizeof(info.SerNo), "SIM0000001");
+    copy_string(info.Model, sizeof(info.Model), "UI-SIM");
+    copy_string(info.FullModelName, sizeof(info.FullModelName), "uEye Simulator");
+    return IS_SUCCESS;
+}
+
+INT is_GetCameraInfo(HIDS hCam, PCAMINFO pInfo)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (!pInfo) return IS_NO_SUCCESS;
+
+    *pInfo = CAMINFO{};
+    copy_string(pInfo->SerNo, sizeof(pInfo->SerNo), "SIM0000001");
+    copy_string(pInfo->ID, sizeof(pInfo->ID), "uEye Simulator");
+    copy_string(pInfo->Version, sizeof(pInfo->Version), "V1.00");
+    copy_string(pInfo->Date, sizeof(pInfo->Date), "01.01.2024");
+    pInfo->Select = static_cast<BYTE>(SIM_DEVICE_ID);
+    pInfo->Type = static_cast<BYTE>(IS_CAMERA_TYPE_UEYE_USB3_CP);
+    return IS_SUCCESS;
+}
+
+INT is_GetSensorInfo(HIDS hCam, PSENSORINFO pInfo)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pInfo) return IS_NO_SUCCESS;
+
+    *pInfo = SENSORINFO{};
+    copy_string(pInfo->strSensorName, sizeof(pInfo->strSensorName), "SIMULATED");
+    pInfo->nColorMode = IS_COLORMODE_MONOCHROME;
+    pInfo->nMaxWidth = static_cast<DWORD>(cam->config.sensorWidth);
+    pInfo->nMaxHeight = static_cast<DWORD>(cam->config.sensorHeight);
+    pInfo->bMasterGain = TRUE;
+    pInfo->bGlobShutter = TRUE;
+    pInfo->wPixelSize = 550; // 5.5 um
+    return IS_SUCCESS;
+}
+
+INT is_GetCameraType(HIDS /*hCam*/)
+{
+    return IS_CAMERA_TYPE_UEYE_USB3_CP;
+}
+
+INT is_GetBusSpeed(HIDS /*hCam*/)
+{
+    return IS_USB_30;
+}
+
+INT is_GetUsedBandwidth(HIDS hCam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return 0;
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    return static_cast<INT>(cam->aoi.s32Width * cam->aoi.s32Height * cam->frameRate / 1e6);
+}
+
+INT is_GetError(HIDS /*hCam*/, INT *pErr, IS_CHAR **ppcErr)
+{
+    static IS_CHAR message[] = "no error";
+    if (pErr) *pErr = IS_SUCCESS;
+    if (ppcErr) *ppcErr = message;
+    return IS_SUCCESS;
+}
+
+INT is_ResetToDefault(HIDS hCam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        cam->aoi = {0, 0, cam->config.sensorWidth, cam->config.sensorHeight};
+        cam->colorMode = IS_CM_MONO8;
+        cam->frameRate = cam->config.frameRate;
+        cam->exposure_ms = std::min(NOMINAL_EXPOSURE_ms, 1000.0 / cam->frameRate);
+        cam->masterGain = 0;
+        cam->triggerMode = IS_SET_TRIGGER_OFF;
+        cam->triggerDelay_us = 0;
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_Renumerate(HIDS /*hCam*/, INT /*mode*/)
+{
+    return IS_SUCCESS;
+}
+
+INT is_Configuration(UINT /*nCommand*/, void* /*pParam*/, UINT /*cbSizeOfParam*/)
+{
+    return IS_NOT_SUPPORTED;
+}
+
+// --- image memory and the ring buffer sequence ---
+
+INT is_AllocImageMem(HIDS hCam, INT width, INT height, INT bitspixel, char **ppcImgMem, INT *pid)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!ppcImgMem || !pid || width <= 0 || height <= 0 || bitspixel <= 0) return IS_INVALID_PARAMETER;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    auto buffer = std::make_unique<Buffer>();
+    buffer->width = width;
+    buffer->height = height;
+    buffer->bitsPerPixel = bitspixel;
+    buffer->pitch = width * bytes_per_pixel(bitspixel);
+    buffer->memory.assign(static_cast<size_t>(buffer->pitch) * height, 0);
+    buffer->id = cam->nextBufferId++;
+
+    *ppcImgMem = buffer->memory.data();
+    *pid = buffer->id;
+    cam->buffers.push_back(std::move(buffer));
+    return IS_SUCCESS;
+}
+
+INT is_FreeImageMem(HIDS hCam, char *pcMem, INT id)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    auto it = std::find_if(cam->buffers.begin(), cam->buffers.end(),
+                           [&](const std::unique_ptr<Buffer> &b) { return b->memory.data() == pcMem && b->id == id; });
+    if (it == cam->buffers.end()) return IS_INVALID_MEMORY_POINTER;
+    if ((*it)->seqNum != 0) return IS_SEQ_BUFFER_IS_LOCKED;
+    cam->buffers.erase(it);
+    return IS_SUCCESS;
+}
+
+INT is_AddToSequence(HIDS hCam, char *pcMem, INT nID)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    Buffer *buffer = find_buffer(*cam, pcMem);
+    if (!buffer || buffer->id != nID) return IS_INVALID_MEMORY_POINTER;
+    if (buffer->seqNum != 0) return IS_SUCCESS;
+
+    cam->sequence.push_back(buffer);
+    buffer->seqNum = static_cast<INT>(cam->sequence.size());
+    return IS_SUCCESS;
+}
+
+INT is_ClearSequence(HIDS hCam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    for (auto buffer : cam->sequence)
+        if (buffer->locked) return IS_SEQ_BUFFER_IS_LOCKED;
+
+    for (auto buffer : cam->sequence) buffer->seqNum = 0;
+    cam->sequence.clear();
+    cam->lastSeqIndex = -1;
+    return IS_SUCCESS;
+}
+
+INT is_LockSeqBuf(HIDS hCam, INT nNum, char *pcMem)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    Buffer *buffer = find_buffer(*cam, pcMem);
+    if (!buffer || buffer->seqNum == 0) return IS_INVALID_MEMORY_POINTER;
+    if (nNum != IS_IGNORE_PARAMETER && nNum != buffer->seqNum) return IS_INVALID_PARAMETER;
+    if (buffer->locked) return IS_SEQ_BUFFER_IS_LOCKED;
+    buffer->locked = true;
+    return IS_SUCCESS;
+}
+
+INT is_UnlockSeqBuf(HIDS hCam, INT nNum, char *pcMem)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    Buffer *buffer = find_buffer(*cam, pcMem);
+    if (!buffer || buffer->seqNum == 0) return IS_INVALID_MEMORY_POINTER;
+    if (nNum != IS_IGNORE_PARAMETER && nNum != buffer->seqNum) return IS_INVALID_PARAMETER;
+    buffer->locked = false;
+    return IS_SUCCESS;
+}
+
+INT is_GetActSeqBuf(HIDS hCam, INT *pnNum, char **ppcMem, char **ppcMemLast)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    if (cam->sequence.empty()) return IS_NO_ACTIVE_IMG_MEM;
+
+    const int numBuffers = static_cast<int>(cam->sequence.size());
+    const int last = (cam->lastSeqIndex < 0) ? numBuffers - 1 : cam->lastSeqIndex;
+    Buffer *active = cam->sequence[(last + 1) % numBuffers];
+
+    if (pnNum) *pnNum = active->seqNum;
+    if (ppcMem) *ppcMem = active->memory.data();
+    if (ppcMemLast) *ppcMemLast = cam->sequence[last]->memory.data();
+    return IS_SUCCESS;
+}
+
+INT is_GetImageInfo(HIDS hCam, INT nImageBufferID, UEYEIMAGEINFO *pImageInfo, UINT imageInfoSize)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pImageInfo || imageInfoSize < sizeof(UEYEIMAGEINFO)) return IS_INVALID_PARAMETER;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    Buffer *buffer = find_buffer(*cam, nImageBufferID);
+    if (!buffer) return IS_INVALID_PARAMETER;
+    *pImageInfo = buffer->info;
+    return IS_SUCCESS;
+}
+
+// --- events ---
+
+INT is_Event(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pParam) return IS_INVALID_PARAMETER;
+
+    std::unique_lock<std::mutex> lock(cam->mutex);
+    const UINT *events = static_cast<const UINT*>(pParam);
+    const UINT numEvents = cbSizeOfParam / sizeof(UINT);
+
+    switch (nCommand)
+    {
+    case IS_EVENT_CMD_INIT:
+    {
+        const auto *init = static_cast<const IS_INIT_EVENT*>(pParam);
+        for (UINT i = 0; i < cbSizeOfParam / sizeof(IS_INIT_EVENT); i++)
+        {
+            Event &event = cam->events[init[i].nEvent];
+            event.manualReset = init[i].bManualReset;
+            event.signaled = init[i].bInitialState;
+        }
+        return IS_SUCCESS;
+    }
+    case IS_EVENT_CMD_ENABLE:
+    case IS_EVENT_CMD_DISABLE:
+        for (UINT i = 0; i < numEvents; i++)
+        {
+            auto it = cam->events.find(events[i]);
+            if (it == cam->events.end()) return IS_INVALID_PARAMETER;
+            it->second.enabled = (nCommand == IS_EVENT_CMD_ENABLE);
+        }
+        return IS_SUCCESS;
+    case IS_EVENT_CMD_SET:
+    case IS_EVENT_CMD_RESET:
+        for (UINT i = 0; i < numEvents; i++)
+        {
+            auto it = cam->events.find(events[i]);
+            if (it == cam->events.end()) return IS_INVALID_PARAMETER;
+            it->second.signaled = (nCommand == IS_EVENT_CMD_SET);
+        }
+        cam->eventWake.notify_all();
+        return IS_SUCCESS;
+    case IS_EVENT_CMD_EXIT:
+        for (UINT i = 0; i < numEvents; i++) cam->events.erase(events[i]);
+        cam->eventWake.notify_all();
+        return IS_SUCCESS;
+    case IS_EVENT_CMD_WAIT:
+    {
+        // bWaitAll is not supported; the first signaled event wins
+        auto *wait = static_cast<IS_WAIT_EVENTS*>(pParam);
+        auto signaled = [&]() -> bool
+        {
+            if (!cam->running) return true;
+            for (UINT i = 0; i < wait->nCount; i++)
+            {
+                auto it = cam->events.find(wait->pEvents[i]);
+                if (it == cam->events.end() || !it->second.signaled) continue;
+                if (!it->second.manualReset) it->second.signaled = false;
+                wait->nSignaled = wait->pEvents[i];
+                wait->nSetCount = 1;
+                return true;
+            }
+            return false;
+        };
+
+        bool ok {false};
+        if (wait->nTimeoutMilliseconds == INFINITE) { cam->eventWake.wait(lock, signaled); ok = true; }
+        else ok = cam->eventWake.wait_for(lock, std::chrono::milliseconds(wait->nTimeoutMilliseconds), signaled);
+        return (ok && cam->running) ? IS_SUCCESS : IS_TIMED_OUT;
+    }
+    default:
+        return IS_NOT_SUPPORTED;
+    }
+}
+
+// --- acquisition ---
+
+INT is_CaptureVideo(HIDS hCam, INT Wait)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return (Wait == IS_GET_LIVE) ? FALSE : IS_INVALID_CAMERA_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        if (Wait == IS_GET_LIVE) return cam->live ? TRUE : FALSE;
+        if (cam->sequence.empty()) return IS_NO_ACTIVE_IMG_MEM;
+        cam->live = true;
+        cam->nextFrameTime = Clock::now();
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_StopLiveVideo(HIDS hCam, INT /*Wait*/)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        cam->live = false;
+        cam->pendingFrames = 0;
+        cam->pendingTriggers = 0;
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_FreezeVideo(HIDS hCam, INT Wait)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::unique_lock<std::mutex> lock(cam->mutex);
+    if (cam->sequence.empty()) return IS_NO_ACTIVE_IMG_MEM;
+    cam->live = false;
+    cam->pendingFrames = 1;
+    cam->nextFrameTime = Clock::now();
+    cam->wake.notify_all();
+
+    if (Wait == IS_DONT_WAIT) return IS_SUCCESS;
+
+    // IS_WAIT waits for up to the trigger timeout, other values are in 10 ms steps
+    const auto timeout = std::chrono::milliseconds((Wait == IS_WAIT) ? 5000 : Wait * 10);
+    const bool done = cam->eventWake.wait_for(lock, timeout, [cam]() { return cam->pendingFrames == 0 || !cam->running; });
+    return done ? IS_SUCCESS : IS_TIMED_OUT;
+}
+
+INT is_SetExternalTrigger(HIDS hCam, INT nTriggerMode)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    if (nTriggerMode == IS_GET_SUPPORTED_TRIGGER_MODE)
+        return IS_SET_TRIGGER_SOFTWARE | IS_SET_TRIGGER_HI_LO | IS_SET_TRIGGER_LO_HI;
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        if (nTriggerMode == IS_GET_EXTERNALTRIGGER) return cam->triggerMode;
+        cam->triggerMode = nTriggerMode;
+        cam->pendingTriggers = 0;
+        cam->nextFrameTime = Clock::now();
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_ForceTrigger(HIDS hCam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        const bool capturing = cam->live || cam->pendingFrames > 0;
+        if (!capturing || !is_software_trigger(cam->triggerMode))
+        {
+            g_stats.triggersIgnored++;
+            return IS_SUCCESS;
+        }
+        cam->pendingTriggers++;
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_SetTriggerDelay(HIDS hCam, INT nTriggerDelay)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    switch (nTriggerDelay)
+    {
+    case IS_GET_TRIGGER_DELAY: return cam->triggerDelay_us;
+    case IS_GET_MIN_TRIGGER_DELAY: return 0;
+    case IS_GET_MAX_TRIGGER_DELAY: return 4000000;
+    case IS_GET_TRIGGER_DELAY_GRANULARITY: return 1;
+    default:
+        if (nTriggerDelay < 0 || nTriggerDelay > 4000000) return IS_INVALID_PARAMETER;
+        cam->triggerDelay_us = nTriggerDelay;
+        return IS_SUCCESS;
+    }
+}
+
+INT is_SetTimeout(HIDS hCam, UINT nMode, UINT Timeout)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (nMode != IS_TRIGGER_TIMEOUT) return IS_NOT_SUPPORTED;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    cam->triggerTimeout = Timeout;
+    return IS_SUCCESS;
+}
+
+INT is_GetTimeout(HIDS hCam, UINT nMode, UINT *pTimeout)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (nMode != IS_TRIGGER_TIMEOUT || !pTimeout) return IS_NOT_SUPPORTED;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    *pTimeout = cam->triggerTimeout;
+    return IS_SUCCESS;
+}
+
+// --- timing ---
+
+INT is_SetFrameRate(HIDS hCam, double FPS, double *newFPS)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> lock(cam->mutex);
+        if (FPS != IS_GET_FRAMERATE)
+        {
+            if (FPS == IS_GET_DEFAULT_FRAMERATE) FPS = cam->config.frameRate;
+            cam->frameRate = std::clamp(FPS, 0.1, cam->config.maxFrameRate);
+            cam->exposure_ms = std::min(cam->exposure_ms, 1000.0 / cam->frameRate);
+            cam->nextFrameTime = Clock::now();
+        }
+        if (newFPS) *newFPS = cam->frameRate;
+    }
+    cam->wake.notify_all();
+    return IS_SUCCESS;
+}
+
+INT is_GetFramesPerSecond(HIDS hCam, double *dblFPS)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!dblFPS) return IS_INVALID_PARAMETER;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    *dblFPS = cam->measuredFrameRate;
+    return IS_SUCCESS;
+}
+
+INT is_GetFrameTimeRange(HIDS hCam, double *min, double *max, double *intervall)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    if (min) *min = 1.0 / cam->config.maxFrameRate;
+    if (max) *max = 10.0;
+    if (intervall) *intervall = 1e-5;
+    return IS_SUCCESS;
+}
+
+INT is_Exposure(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pParam) return IS_INVALID_PARAMETER;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    const double maxExposure_ms = 1000.0 / cam->frameRate;
+    double *value = static_cast<double*>(pParam);
+
+    switch (nCommand)
+    {
+    case IS_EXPOSURE_CMD_GET_CAPS:
+        *static_cast<UINT*>(pParam) = IS_EXPOSURE_CAP_EXPOSURE;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE:
+        *value = cam->exposure_ms;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE_DEFAULT:
+        *value = std::min(NOMINAL_EXPOSURE_ms, maxExposure_ms);
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MIN:
+        *value = 0.01;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MAX:
+        *value = maxExposure_ms;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_INC:
+        *value = 0.01;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE:
+        if (cbSizeOfParam < 3 * sizeof(double)) return IS_INVALID_PARAMETER;
+        value[0] = 0.01;
+        value[1] = maxExposure_ms;
+        value[2] = 0.01;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_SET_EXPOSURE:
+        cam->exposure_ms = std::clamp(*value, 0.01, maxExposure_ms);
+        *value = cam->exposure_ms;
+        return IS_SUCCESS;
+    case IS_EXPOSURE_CMD_GET_LONG_EXPOSURE_ENABLE:
+        *static_cast<UINT*>(pParam) = 0;
+        return IS_SUCCESS;
+    default:
+        return IS_NOT_SUPPORTED;
+    }
+}
+
+INT is_PixelClock(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pParam) return IS_INVALID_PARAMETER;
+
+    static const UINT clocks[] {20, 40, 86};
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    UINT *value = static_cast<UINT*>(pParam);
+
+    switch (nCommand)
+    {
+    case IS_PIXELCLOCK_CMD_GET_NUMBER:
+        *value = 3;
+        return IS_SUCCESS;
+    case IS_PIXELCLOCK_CMD_GET_LIST:
+        std::copy_n(clocks, std::min<size_t>(3, cbSizeOfParam / sizeof(UINT)), value);
+        return IS_SUCCESS;
+    case IS_PIXELCLOCK_CMD_GET_RANGE:
+        if (cbSizeOfParam < 3 * sizeof(UINT)) return IS_INVALID_PARAMETER;
+        value[0] = clocks[0];
+        value[1] = clocks[2];
+        value[2] = 1;
+        return IS_SUCCESS;
+    case IS_PIXELCLOCK_CMD_GET_DEFAULT:
+        *value = clocks[2];
+        return IS_SUCCESS;
+    case IS_PIXELCLOCK_CMD_GET:
+        *value = cam->pixelClock_MHz;
+        return IS_SUCCESS;
+    case IS_PIXELCLOCK_CMD_SET:
+        if (*value < clocks[0] || *value > clocks[2]) return IS_INVALID_PARAMETER;
+        cam->pixelClock_MHz = *value;
+        return IS_SUCCESS;
+    default:
+        return IS_NOT_SUPPORTED;
+    }
+}
+
+// --- image format ---
+
+INT is_AOI(HIDS hCam, UINT nCommand, void *pParam, UINT /*cbSizeOfParam*/)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+    if (!pParam) return IS_INVALID_PARAMETER;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    const INT W = cam->config.sensorWidth;
+    const INT H = cam->config.sensorHeight;
+    auto *rect = static_cast<IS_RECT*>(pParam);
+    auto *point = static_cast<IS_POINT_2D*>(pParam);
+    auto *size = static_cast<IS_SIZE_2D*>(pParam);
+
+    auto valid = [&](const IS_RECT &r)
+    {
+        return r.s32X >= 0 && r.s32Y >= 0 && r.s32Width >= 16 && r.s32Height >= 4 &&
+               r.s32X + r.s32Width <= W && r.s32Y + r.s32Height <= H &&
+               r.s32X % 2 == 0 && r.s32Y % 2 == 0 && r.s32Width % 8 == 0 && r.s32Height % 2 == 0;
+    };
+
+    switch (nCommand)
+    {
+    case IS_AOI_IMAGE_GET_AOI:
+        *rect = cam->aoi;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_SET_AOI:
+        if (!valid(*rect)) return IS_INVALID_PARAMETER;
+        cam->aoi = *rect;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_POS:
+        point->s32X = cam->aoi.s32X;
+        point->s32Y = cam->aoi.s32Y;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_SET_POS:
+    {
+        IS_RECT r {point->s32X, point->s32Y, cam->aoi.s32Width, cam->aoi.s32Height};
+        if (!valid(r)) return IS_INVALID_PARAMETER;
+        cam->aoi = r;
+        return IS_SUCCESS;
+    }
+    case IS_AOI_IMAGE_GET_SIZE:
+        size->s32Width = cam->aoi.s32Width;
+        size->s32Height = cam->aoi.s32Height;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_SET_SIZE:
+    {
+        IS_RECT r {cam->aoi.s32X, cam->aoi.s32Y, size->s32Width, size->s32Height};
+        if (!valid(r)) return IS_INVALID_PARAMETER;
+        cam->aoi = r;
+        return IS_SUCCESS;
+    }
+    case IS_AOI_IMAGE_GET_POS_MIN:
+        point->s32X = 0;
+        point->s32Y = 0;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_POS_MAX:
+        point->s32X = W - cam->aoi.s32Width;
+        point->s32Y = H - cam->aoi.s32Height;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_POS_INC:
+        point->s32X = 2;
+        point->s32Y = 2;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_SIZE_MIN:
+        size->s32Width = 16;
+        size->s32Height = 4;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_SIZE_MAX:
+        size->s32Width = W - cam->aoi.s32X;
+        size->s32Height = H - cam->aoi.s32Y;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_SIZE_INC:
+        size->s32Width = 8;
+        size->s32Height = 2;
+        return IS_SUCCESS;
+    case IS_AOI_IMAGE_GET_POS_X_ABS:
+    case IS_AOI_IMAGE_GET_POS_Y_ABS:
+        *static_cast<UINT*>(pParam) = 0;
+        return IS_SUCCESS;
+    default:
+        return IS_NOT_SUPPORTED;
+    }
+}
+
+INT is_SetColorMode(HIDS hCam, INT Mode)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    switch (Mode)
+    {
+    case IS_GET_COLOR_MODE:
+        return cam->colorMode;
+    case IS_CM_MONO8:
+    case IS_CM_SENSOR_RAW8:
+    case IS_CM_BGR8_PACKED:
+    case IS_CM_RGB8_PACKED:
+    case IS_CM_BGRA8_PACKED:
+    case IS_CM_RGBA8_PACKED:
+        cam->colorMode = Mode;
+        return IS_SUCCESS;
+    default:
+        return IS_INVALID_COLOR_FORMAT;
+    }
+}
+
+INT is_ImageFormat(HIDS hCam, UINT nCommand, void *pParam, UINT /*nSizeOfParam*/)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (nCommand == IMGFRMT_CMD_GET_ARBITRARY_AOI_SUPPORTED && pParam)
+    {
+        *static_cast<UINT*>(pParam) = 1;
+        return IS_SUCCESS;
+    }
+    return IS_NOT_SUPPORTED;
+}
+
+INT is_SetBinning(HIDS hCam, INT mode)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (mode & 0x8000) return 0; // every query reports binning as disabled/unsupported
+    return (mode == IS_BINNING_DISABLE) ? IS_SUCCESS : IS_NOT_SUPPORTED;
+}
+
+INT is_SetSubSampling(HIDS hCam, INT mode)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (mode & 0x8000) return 0;
+    return (mode == IS_SUBSAMPLING_DISABLE) ? IS_SUCCESS : IS_NOT_SUPPORTED;
+}
+
+INT is_SetSensorScaler(HIDS /*hCam*/, UINT /*nMode*/, double /*dblFactor*/)
+{
+    return IS_NOT_SUPPORTED;
+}
+
+INT is_GetSensorScalerInfo(HIDS /*hCam*/, SENSORSCALERINFO* /*pSensorScalerInfo*/, INT /*nSensorScalerInfoSize*/)
+{
+    return IS_NOT_SUPPORTED;
+}
+
+// --- gain and image processing ---
+
+INT is_SetHardwareGain(HIDS hCam, INT nMaster, INT /*nRed*/, INT /*nGreen*/, INT /*nBlue*/)
+{
+    SimCamera *cam = camera(hCam);
+    if (!cam) return IS_INVALID_CAMERA_HANDLE;
+
+    std::lock_guard<std::mutex> lock(cam->mutex);
+    if (nMaster == IS_GET_MASTER_GAIN) return cam->masterGain;
+    if (nMaster & 0x8000) return 0; // color channel gains and defaults
+    if (nMaster != IS_IGNORE_PARAMETER) cam->masterGain = std::clamp(nMaster, 0, 100);
+    return IS_SUCCESS;
+}
+
+INT is_SetGainBoost(HIDS hCam, INT mode)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (mode == IS_GET_GAINBOOST) return IS_SET_GAINBOOST_OFF;
+    if (mode == IS_GET_SUPPORTED_GAINBOOST) return 0;
+    return (mode == IS_SET_GAINBOOST_OFF) ? IS_SUCCESS : IS_NOT_SUPPORTED;
+}
+
+INT is_SetHardwareGamma(HIDS hCam, INT nMode)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (nMode == IS_GET_HW_GAMMA) return IS_SET_HW_GAMMA_OFF;
+    if (nMode == IS_GET_HW_SUPPORTED_GAMMA) return 0;
+    return (nMode == IS_SET_HW_GAMMA_OFF) ? IS_SUCCESS : IS_NOT_SUPPORTED;
+}
+
+INT is_SetColorConverter(HIDS hCam, INT /*ColorMode*/, INT /*ConvertMode*/)
+{
+    return camera(hCam) ? IS_SUCCESS : IS_INVALID_CAMERA_HANDLE;
+}
+
+INT is_GetColorConverter(HIDS hCam, INT /*ColorMode*/, INT *pCurrentConvertMode, INT *pDefaultConvertMode,
+                         INT *pSupportedConvertModes)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (pCurrentConvertMode) *pCurrentConvertMode = IS_CONV_MODE_SOFTWARE_3X3;
+    if (pDefaultConvertMode) *pDefaultConvertMode = IS_CONV_MODE_SOFTWARE_3X3;
+    if (pSupportedConvertModes) *pSupportedConvertModes = IS_CONV_MODE_SOFTWARE_3X3;
+    return IS_SUCCESS;
+}
+
+INT is_SetAutoParameter(HIDS hCam, INT param, double *pval1, double *pval2)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (!(param & 0x8000)) return IS_NOT_SUPPORTED;
+    // queries report every auto feature as disabled
+    if (pval1) *pval1 = 0.0;
+    if (pval2) *pval2 = 0.0;
+    return IS_SUCCESS;
+}
+
+INT is_GetAutoInfo(HIDS hCam, UEYE_AUTO_INFO *pInfo)
+{
+    if (!camera(hCam)) return IS_INVALID_CAMERA_HANDLE;
+    if (!pInfo) return IS_INVALID_PARAMETER;
+    *pInfo = UEYE_AUTO_INFO{}; // no auto features
+    return IS_SUCCESS;
+}
+
+// features the simulated sensor doesn't have
+INT is_AutoParameter(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Blacklevel(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_DeviceFeature(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_EdgeEnhancement(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Focus(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Gamma(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_HotPixel(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_ImageFile(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_IO(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_ParameterSet(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Saturation(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Sharpness(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_Trigger(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+INT is_TriggerDebounce(HIDS, UINT, void*, UINT) { return IS_NOT_SUPPORTED; }
+
+// --- AVI recording (ueye_tools), written with OpenCV as MJPG ---
+
+namespace
+{
+
+Avi* avi(INT nAviID)
+{
+    // expects g_aviMutex to be locked
+    auto it = g_avis.find(nAviID);
+    return (it == g_avis.end()) ? nullptr : it->second.get();
+}
+
+}
+
+INT isavi_InitAVI(INT *pnAviID, HIDS hu)
+{
+    if (!pnAviID) return IS_AVI_ERR_PARAMETER;
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    auto recorder = std::make_unique<Avi>();
+    recorder->camera = hu;
+    *pnAviID = g_nextAviId++;
+    g_avis[*pnAviID] = std::move(recorder);
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_ExitAVI(INT nAviID)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    return g_avis.erase(nAviID) ? IS_AVI_NO_ERR : IS_AVI_ERR_INVALID_ID;
+}
+
+INT isavi_SetImageSize(INT nAviID, INT cMode, LONG Width, LONG Height, LONG PosX, LONG PosY, LONG /*LineOffset*/)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    if (Width <= 0 || Height <= 0 || PosX < 0 || PosY < 0) return IS_AVI_ERR_PARAMETER;
+    recorder->colorMode = cMode;
+    recorder->width = static_cast<int>(Width);
+    recorder->height = static_cast<int>(Height);
+    recorder->posX = static_cast<int>(PosX);
+    recorder->posY = static_cast<int>(PosY);
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_SetImageQuality(INT nAviID, INT q)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    recorder->quality = std::clamp(q, 1, 100);
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_SetFrameRate(INT nAviID, double fr)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    if (fr <= 0.0) return IS_AVI_ERR_PARAMETER;
+    recorder->frameRate = fr;
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_OpenAVI(INT nAviID, const IS_CHAR *strFileName)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    if (!strFileName) return IS_AVI_ERR_INVALID_FILE;
+    recorder->fileName = strFileName;
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_StartAVI(INT nAviID)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+
+    // the frame rate is usually set after the file is opened, so the writer is created here
+    recorder->writer.open(recorder->fileName, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                          recorder->frameRate, cv::Size(recorder->width, recorder->height), true);
+    if (!recorder->writer.isOpened()) return IS_AVI_ERR_INVALID_FILE;
+    recorder->writer.set(cv::VIDEOWRITER_PROP_QUALITY, recorder->quality);
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_AddFrame(INT nAviID, char *pcImageMem)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    if (!recorder->writer.isOpened()) return IS_AVI_ERR_CAPTURE_NOT_RUNNING;
+
+    SimCamera *cam = camera(recorder->camera);
+    if (!cam) return IS_AVI_ERR_PARAMETER;
+
+    cv::Mat frame;
+    {
+        std::lock_guard<std::mutex> camLock(cam->mutex);
+        Buffer *buffer = find_buffer(*cam, pcImageMem);
+        if (!buffer) return IS_AVI_ERR_PARAMETER;
+
+        const int type = (buffer->bitsPerPixel == 32) ? CV_8UC4 : (buffer->bitsPerPixel == 24) ? CV_8UC3 : CV_8UC1;
+        const cv::Mat image(buffer->height, buffer->width, type, buffer->memory.data(), buffer->pitch);
+        const cv::Rect roi = cv::Rect(recorder->posX, recorder->posY, recorder->width, recorder->height) &
+                cv::Rect(0, 0, buffer->width, buffer->height);
+        if (roi.empty()) return IS_AVI_ERR_PARAMETER;
+
+        frame = cv::Mat(recorder->height, recorder->width, CV_8UC3, cv::Scalar::all(0));
+        cv::Mat dest = frame(cv::Rect(0, 0, roi.width, roi.height));
+        if (type == CV_8UC1) cv::cvtColor(image(roi), dest, cv::COLOR_GRAY2BGR);
+        else if (type == CV_8UC4) cv::cvtColor(image(roi), dest, cv::COLOR_BGRA2BGR);
+        else image(roi).copyTo(dest);
+    }
+
+    // encoding happens outside the camera lock so the frame thread isn't held up
+    recorder->writer.write(frame);
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_GetnLostFrames(INT nAviID, ULONG *pnLostFrames)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    if (!avi(nAviID)) return IS_AVI_ERR_INVALID_ID;
+    if (pnLostFrames) *pnLostFrames = 0; // frames are encoded synchronously, so none are lost
+    return IS_AVI_NO_ERR;
+}
+
+INT isavi_StopAVI(INT nAviID)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    return avi(nAviID) ? IS_AVI_NO_ERR : IS_AVI_ERR_INVALID_ID;
+}
+
+INT isavi_CloseAVI(INT nAviID)
+{
+    std::lock_guard<std::mutex> lock(g_aviMutex);
+    Avi *recorder = avi(nAviID);
+    if (!recorder) return IS_AVI_ERR_INVALID_ID;
+    recorder->writer.release();
+    return IS_AVI_NO_ERR;
+}
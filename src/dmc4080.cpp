@@ -50,6 +50,11 @@ void DMC4080::disconnect_controller()
     // this needs to go first
     printerThread->stop();
 
+    variableMutex.lock();
+    if (gVariables) GClose(gVariables);
+    gVariables = 0;
+    variableMutex.unlock();
+
     // TODO: don't write the raw commands directly, make API
     if (g) // double check there is actually a connection
     {
@@ -70,4 +75,46 @@ void DMC4080::disconnect_controller()
     //interruptHandler->wait();
 }
 
+bool DMC4080::set_program_variable(const std::string &name, int value)
+{
+    QMutexLocker lock(&variableMutex);
+    if (!open_variable_connection()) return false;
+
+    const std::string set = name + "=" + std::to_string(value);
+    const std::string get = name + "=?";
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+        int readBack {0};
+        if (GCmd(gVariables, set.c_str()) == G_NO_ERROR &&
+            GCmdI(gVariables, get.c_str(), &readBack) == G_NO_ERROR &&
+            readBack == value)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DMC4080::halt_program()
+{
+    QMutexLocker lock(&variableMutex);
+    if (!open_variable_connection()) return false;
+
+    const bool halted = GCmd(gVariables, "HX") == G_NO_ERROR;
+    const bool stopped = GCmd(gVariables, "ST") == G_NO_ERROR;
+    return halted && stopped;
+}
+
+bool DMC4080::open_variable_connection()
+{
+    if (gVariables) return true;
+    if (GOpen(address, &gVariables) != G_NO_ERROR)
+    {
+        gVariables = 0;
+        return false;
+    }
+    GTimeout(gVariables, 500);
+    return true;
+}
+
 #include "moc_dmc4080.cpp"
@@ -2,6 +2,8 @@
 #include <QDebug>
 #include <QTimerEvent>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include "linearanalysis.h"
 
 #include <opencv2/opencv.hpp>
@@ -35,6 +37,57 @@ cv::Mat compute_median(const std::vector<cv::Mat> &vec)
     return medianImg;
 }
 
+// ====================================================================
+// FUNCTIONS FOR READING AND WRITING FRAME STAMPS
+
+bool write_frame_stamps(const std::string &filePath, const std::vector<StrobeFrameStamp> &stamps)
+{
+    std::ofstream file(filePath);
+    if (!file.is_open()) return false;
+
+    file << "FRAME,CAMERA_TIMESTAMP,COMMANDED_DELAY,STROBE_DELAY,COMMAND_TIME,ACK_TIME,ARRIVAL_TIME\n";
+    file << ",100ns,us,us,us,us,us\n";
+    for (size_t i{0}; i < stamps.size(); i++)
+    {
+        const auto& stamp = stamps[i];
+        file << i << ","
+             << stamp.cameraTimestamp_100ns << ","
+             << stamp.commandedDelay_us << ","
+             << stamp.strobeDelay_us << ","
+             << stamp.commandTime_us << ","
+             << stamp.ackTime_us << ","
+             << stamp.arrivalTime_us << "\n";
+    }
+    return true;
+}
+
+std::vector<StrobeFrameStamp> read_frame_stamps(const std::string &filePath)
+{
+    std::vector<StrobeFrameStamp> stamps;
+    std::ifstream file(filePath);
+    if (!file.is_open()) return stamps;
+
+    std::string line;
+    std::getline(file, line); // header
+    std::getline(file, line); // units
+    while (std::getline(file, line))
+    {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream row(line);
+        size_t frame;
+        StrobeFrameStamp stamp;
+        if (!(row >> frame
+                  >> stamp.cameraTimestamp_100ns
+                  >> stamp.commandedDelay_us
+                  >> stamp.strobeDelay_us
+                  >> stamp.commandTime_us
+                  >> stamp.ackTime_us
+                  >> stamp.arrivalTime_us)) break;
+        stamps.push_back(stamp);
+    }
+    return stamps;
+}
+
 // ====================================================================
 
 DropletAnalyzer::DropletAnalyzer() : QObject()
@@ -77,6 +130,16 @@ void DropletAnalyzer::load_video(const std::string& filename)
             cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
             m_video.push_back(frame);
         }
+
+        // use the per-frame strobe delays if they were recorded with the video
+        m_frameStamps = read_frame_stamps(frame_stamp_file_path(filename));
+        if (!m_frameStamps.empty() && !has_frame_stamps())
+        {
+            emit print_to_output_window(QString("Frame stamps do not match the video (%1 stamps, %2 frames), "
+                                                "using the strobe step time instead")
+                                        .arg(m_frameStamps.size()).arg(m_video.size()));
+            m_frameStamps.clear();
+        }
         emit video_loaded();
     }
     else emit video_load_failed();
@@ -85,6 +148,22 @@ void DropletAnalyzer::load_video(const std::string& filename)
     delete m_videoCapture;
 }
 
+void DropletAnalyzer::load_frames(const std::vector<cv::Mat> &frames, const std::vector<StrobeFrameStamp> &stamps)
+{
+    // don't call reset here
+    if (frames.empty())
+    {
+        emit video_load_failed();
+        return;
+    }
+
+    m_video = frames;
+    m_numFrames = m_video.size();
+    m_frameStamps = stamps;
+    if (!m_frameStamps.empty() && !has_frame_stamps()) m_frameStamps.clear();
+    emit video_loaded();
+}
+
 int DropletAnalyzer::get_number_of_frames()
 {
     QMutexLocker lock(&m_mutex);
@@ -168,6 +247,7 @@ void DropletAnalyzer::reset()
     m_dropletContours.clear();
     m_trackerPoints.clear();
     m_trackingData.clear();
+    m_frameStamps.clear();
     m_jetSettings.reset();
 }
 
@@ -244,6 +324,42 @@ void DropletAnalyzer::calculate_droplet_velocity()
     m_trackingData.intercept = fitLine.intercept;
 }
 
+void DropletAnalyzer::count_satellites()
+{
+    // anything detected besides the tracked droplet counts as a satellite
+    std::vector<int> extraContours;
+    for (const auto& contours : m_dropletContours)
+    {
+        if (!contours.empty()) extraContours.push_back(contours.size() - 1);
+    }
+
+    if (extraContours.empty())
+    {
+        m_trackingData.satellites = 0.0;
+        return;
+    }
+    std::nth_element(extraContours.begin(), extraContours.begin() + extraContours.size()/2, extraContours.end());
+    m_trackingData.satellites = extraContours[extraContours.size() / 2];
+}
+
+bool DropletAnalyzer::has_frame_stamps() const
+{
+    return !m_frameStamps.empty() && m_frameStamps.size() == m_video.size();
+}
+
+double DropletAnalyzer::frame_time_us(int frame) const
+{
+    // without stamps, assume every frame advanced the strobe by one step
+    if (!has_frame_stamps()) return frame * m_strobeStepTime_us;
+
+    // time is measured from the first stamped strobe delay so that
+    // the result matches the un-stamped case for a clean sweep
+    auto firstValid = std::find_if(m_frameStamps.begin(), m_frameStamps.end(),
+                                   [](const StrobeFrameStamp& stamp){ return stamp.is_valid(); });
+    if (firstValid == m_frameStamps.end()) return frame * m_strobeStepTime_us;
+    return m_frameStamps[frame].strobeDelay_us - firstValid->strobeDelay_us;
+}
+
 void DropletAnalyzer::analyze_video()
 {
     if (m_medianFrame.empty()) calculate_median_frame();
@@ -261,6 +377,7 @@ void DropletAnalyzer::analyze_video()
 
     calculate_scaled_drop_pos();
     calculate_droplet_velocity();
+    count_satellites();
 
     //generate_tracking_csv();
 
@@ -366,9 +483,10 @@ void DropletAnalyzer::calculate_scaled_drop_pos()
         const auto& point = m_trackerPoints[frame];
         if (point == m_noTrackPoint) continue;
         if (point.y < m_originPoint.y) continue; // don't include points above the nozzle
+        if (has_frame_stamps() && !m_frameStamps[frame].is_valid()) continue; // strobe delay unknown for this frame
         m_trackingData.x.push_back((point.x - m_originPoint.x) * m_cameraSettings.imagePixelSize_um);
         m_trackingData.y.push_back((point.y - m_originPoint.y) * m_cameraSettings.imagePixelSize_um);
-        m_trackingData.t.push_back(frame * m_strobeStepTime_us);
+        m_trackingData.t.push_back(frame_time_us(frame));
     }
 
     // filter by residuals of fit line
@@ -499,6 +617,18 @@ void DropletAnalyzer::set_strobe_step_time(double stepTime)
     m_strobeStepTime_us = stepTime;
 }
 
+void DropletAnalyzer::set_frame_stamps(const std::vector<StrobeFrameStamp> &stamps)
+{
+    QMutexLocker lock(&m_mutex);
+    m_frameStamps = stamps;
+}
+
+std::vector<StrobeFrameStamp> DropletAnalyzer::get_frame_stamps()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_frameStamps;
+}
+
 DropTrackingData DropletAnalyzer::get_droplet_tracking_data()
 {
     QMutexLocker lock(&m_mutex);
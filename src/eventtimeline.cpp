@@ -0,0 +1,224 @@
+#include "eventtimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace Timeline
+{
+
+namespace
+{
+
+const auto startTime = std::chrono::steady_clock::now();
+
+std::atomic<quint32> nextThreadId {1};
+
+std::mutex threadNamesMutex;
+std::map<quint32, std::string> threadNames;
+
+quint32 current_thread_id()
+{
+    thread_local const quint32 id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+template<size_t N>
+void copy_text(char (&dest)[N], std::string_view text)
+{
+    const size_t n = std::min(text.size(), N - 1);
+    std::copy_n(text.data(), n, dest);
+    dest[n] = '\0';
+}
+
+// keep the trace valid JSON whatever a device sends
+std::string json_escape(const char *text)
+{
+    std::string s;
+    for (const char *c = text; *c; c++)
+    {
+        switch (*c)
+        {
+        case '"': s += "\\\""; break;
+        case '\\': s += "\\\\"; break;
+        case '\n': s += "\\n"; break;
+        case '\r': s += "\\r"; break;
+        case '\t': s += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(*c) < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(*c));
+                s += buffer;
+            }
+            else s += *c;
+        }
+    }
+    return s;
+}
+
+}
+
+EventTimeline::EventTimeline() :
+    m_slots(new Slot[capacity_])
+{
+
+}
+
+EventTimeline &EventTimeline::instance()
+{
+    static EventTimeline timeline;
+    return timeline;
+}
+
+qint64 EventTimeline::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+Event &EventTimeline::begin_event(Event::Phase phase, std::string_view category, std::string_view name, quint64 &index)
+{
+    index = m_next.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = m_slots[index % capacity_];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Event &event = slot.event;
+    event.phase = phase;
+    event.thread = current_thread_id();
+    event.duration_ns = 0;
+    event.value = 0.0;
+    event.detail[0] = '\0';
+    copy_text(event.category, category);
+    copy_text(event.name, name);
+    return event;
+}
+
+void EventTimeline::end_event(quint64 index)
+{
+    m_slots[index % capacity_].seq.store(2 * index + 2, std::memory_order_release);
+}
+
+void EventTimeline::instant(std::string_view category, std::string_view name, std::string_view detail)
+{
+    if (!is_enabled()) return;
+    const qint64 now = now_ns();
+    quint64 index {0};
+    Event &event = begin_event(Event::Phase::Instant, category, name, index);
+    event.time_ns = now;
+    copy_text(event.detail, detail);
+    end_event(index);
+}
+
+void EventTimeline::complete(std::string_view category, std::string_view name, qint64 start_ns, std::string_view detail)
+{
+    if (!is_enabled()) return;
+    const qint64 now = now_ns();
+    quint64 index {0};
+    Event &event = begin_event(Event::Phase::Complete, category, name, index);
+    event.time_ns = start_ns;
+    event.duration_ns = now - start_ns;
+    copy_text(event.detail, detail);
+    end_event(index);
+}
+
+void EventTimeline::counter(std::string_view category, std::string_view name, double value)
+{
+    if (!is_enabled()) return;
+    const qint64 now = now_ns();
+    quint64 index {0};
+    Event &event = begin_event(Event::Phase::Counter, category, name, index);
+    event.time_ns = now;
+    event.value = value;
+    end_event(index);
+}
+
+void EventTimeline::clear()
+{
+    // snapshot() skips slots that don't hold the sequence it expects
+    for (size_t i = 0; i < capacity_; i++) m_slots[i].seq.store(0, std::memory_order_release);
+}
+
+std::vector<Event> EventTimeline::snapshot() const
+{
+    const quint64 end = m_next.load(std::memory_order_acquire);
+    const quint64 begin = (end > capacity_) ? end - capacity_ : 0;
+
+    std::vector<Event> events;
+    events.reserve(end - begin);
+    for (quint64 index = begin; index < end; index++)
+    {
+        const Slot &slot = m_slots[index % capacity_];
+        const quint64 expected = 2 * index + 2;
+        if (slot.seq.load(std::memory_order_acquire) != expected) continue; // not written yet or cleared
+        Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != expected) continue; // overwritten while copying
+        events.push_back(event);
+    }
+
+    // complete events are recorded when they end, so sort by start time
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event &a, const Event &b){ return a.time_ns < b.time_ns; });
+    return events;
+}
+
+bool EventTimeline::export_chrome_trace(const std::string &filePath) const
+{
+    std::ofstream file(filePath);
+    if (!file.is_open()) return false;
+
+    const std::vector<Event> events = snapshot();
+    char ts[32];
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Binder Jet Printer\"}}";
+    {
+        std::lock_guard<std::mutex> lock(threadNamesMutex);
+        for (const auto &[thread, name] : threadNames)
+        {
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                 << ",\"args\":{\"name\":\"" << json_escape(name.c_str()) << "\"}}";
+        }
+    }
+
+    for (const auto &event : events)
+    {
+        // trace times are in µs
+        std::snprintf(ts, sizeof(ts), "%.3f", event.time_ns / 1000.0);
+        file << ",\n{\"name\":\"" << json_escape(event.name) << "\""
+             << ",\"cat\":\"" << json_escape(event.category) << "\""
+             << ",\"ph\":\"" << static_cast<char>(event.phase) << "\""
+             << ",\"ts\":" << ts
+             << ",\"pid\":1,\"tid\":" << event.thread;
+
+        switch (event.phase)
+        {
+        case Event::Phase::Complete:
+            std::snprintf(ts, sizeof(ts), "%.3f", event.duration_ns / 1000.0);
+            file << ",\"dur\":" << ts;
+            break;
+        case Event::Phase::Instant:
+            file << ",\"s\":\"t\"";
+            break;
+        case Event::Phase::Counter:
+            file << ",\"args\":{\"value\":" << event.value << "}}";
+            continue;
+        }
+        if (event.detail[0] != '\0') file << ",\"args\":{\"detail\":\"" << json_escape(event.detail) << "\"}";
+        file << "}";
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+void EventTimeline::name_current_thread(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(threadNamesMutex);
+    threadNames[current_thread_id()] = name;
+}
+
+}
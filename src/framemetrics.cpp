@@ -0,0 +1,181 @@
+#include "framemetrics.h"
+
+#include <QDebug>
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+
+// pixel value below which the given fraction of the histogram lies
+int percentile(const cv::Mat &hist, double fraction)
+{
+    const double target = cv::sum(hist)[0] * fraction;
+    double count {0.0};
+    for (int i = 0; i < hist.rows; i++)
+    {
+        count += hist.at<float>(i);
+        if (count >= target) return i;
+    }
+    return hist.rows - 1;
+}
+
+cv::Rect to_decimated_rect(const QRect &rect, int decimation, const cv::Size &size, const cv::Rect &fallback)
+{
+    if (rect.isEmpty()) return fallback;
+    const cv::Rect scaled(rect.x() / decimation, rect.y() / decimation,
+                          std::max(1, rect.width() / decimation), std::max(1, rect.height() / decimation));
+    const cv::Rect clipped = scaled & cv::Rect(cv::Point(0, 0), size);
+    return clipped.empty() ? fallback : clipped;
+}
+
+}
+
+FrameMetricsProcessor::FrameMetricsProcessor() : QObject()
+{
+    qRegisterMetaType<FrameMetrics>("FrameMetrics");
+    m_thread.reset(new QThread);
+    m_thread->setObjectName("Frame Metrics Thread");
+    moveToThread(m_thread.get());
+    m_thread->start();
+}
+
+FrameMetricsProcessor::~FrameMetricsProcessor()
+{
+    QMetaObject::invokeMethod(this, "cleanup");
+    m_thread->wait();
+}
+
+void FrameMetricsProcessor::set_settings(const FrameMetricsSettings &settings)
+{
+    QMutexLocker lock(&m_mutex);
+    m_settings = settings;
+    m_settings.decimation = std::max(1, m_settings.decimation);
+}
+
+FrameMetricsSettings FrameMetricsProcessor::settings() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_settings;
+}
+
+void FrameMetricsProcessor::frame_received(ImageBufferPtr buffer)
+{
+    // drop frames while the previous one is still being analyzed
+    if (m_busy.exchange(true))
+    {
+        m_framesSkipped++;
+        return;
+    }
+
+    const int decimation = settings().decimation;
+    const auto &props = buffer->buffer_props();
+    const int type = (props.bitspp == 32) ? CV_8UC4 : (props.bitspp == 24) ? CV_8UC3 : CV_8UC1;
+    const cv::Mat frame(props.height, props.width, type, buffer->data());
+
+    // only the decimated copy is made while the sequence buffer is locked
+    cv::Mat small;
+    cv::resize(frame, small, cv::Size(), 1.0 / decimation, 1.0 / decimation, cv::INTER_NEAREST);
+    if (type == CV_8UC4) cv::cvtColor(small, small, cv::COLOR_BGRA2GRAY);
+    else if (type == CV_8UC3) cv::cvtColor(small, small, cv::COLOR_BGR2GRAY);
+
+    QMetaObject::invokeMethod(this, [this, small, decimation]()
+    {
+        this->analyze(small, decimation);
+        this->m_busy = false;
+    }, Qt::QueuedConnection);
+}
+
+void FrameMetricsProcessor::reset()
+{
+    m_sum = FrameMetrics();
+    m_framesSkipped = 0;
+    m_publishTimer.restart();
+}
+
+void FrameMetricsProcessor::analyze(const cv::Mat &image, int decimation)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_publishTimer.isValid()) m_publishTimer.start();
+
+    const FrameMetricsSettings s = settings();
+    const cv::Rect whole(cv::Point(0, 0), image.size());
+    const cv::Rect nozzleDefault(0, 0, image.cols, std::max(1, image.rows / 6));
+    const cv::Rect focusRect = to_decimated_rect(s.focusAOI, decimation, image.size(), whole);
+    const cv::Rect nozzleRect = to_decimated_rect(s.nozzleAOI, decimation, image.size(), nozzleDefault);
+
+    // sharpness
+    cv::Mat laplacian;
+    cv::Laplacian(image(focusRect), laplacian, CV_32F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    m_sum.sharpness += stddev[0] * stddev[0];
+
+    // exposure
+    const int channels[] {0};
+    const int histSize[] {256};
+    const float range[] {0, 256};
+    const float *ranges[] {range};
+    cv::Mat hist;
+    cv::calcHist(&image, 1, channels, cv::Mat(), hist, 1, histSize, ranges);
+
+    const double numPixels = static_cast<double>(image.total());
+    double saturated {0.0};
+    double intensity {0.0};
+    for (int i = 0; i < 256; i++)
+    {
+        const double count = hist.at<float>(i);
+        intensity += i * count;
+        if (i >= s.saturationLevel) saturated += count;
+        m_sum.histogram[i * FrameMetrics::numBins / 256] += static_cast<quint32>(count);
+    }
+    m_sum.meanIntensity += intensity / numPixels;
+    m_sum.saturatedFraction += saturated / numPixels;
+
+    // nozzle tip contrast
+    cv::Mat nozzleImage = image(nozzleRect);
+    cv::Mat nozzleHist;
+    cv::calcHist(&nozzleImage, 1, channels, cv::Mat(), nozzleHist, 1, histSize, ranges);
+    const double low = percentile(nozzleHist, 0.05);
+    const double high = percentile(nozzleHist, 0.95);
+    m_sum.nozzleContrast += (high + low > 0.0) ? (high - low) / (high + low) : 0.0;
+
+    m_sum.framesAnalyzed++;
+    m_sum.analysisTime_ms += timer.nsecsElapsed() / 1e6;
+
+    if (m_publishTimer.elapsed() >= s.publishInterval_ms) publish();
+}
+
+void FrameMetricsProcessor::publish()
+{
+    FrameMetrics metrics = m_sum;
+    const int n = std::max(1, m_sum.framesAnalyzed);
+    metrics.sharpness /= n;
+    metrics.meanIntensity /= n;
+    metrics.saturatedFraction /= n;
+    metrics.nozzleContrast /= n;
+    metrics.analysisTime_ms /= n;
+    metrics.framesSkipped = m_framesSkipped.exchange(0);
+
+    m_sum = FrameMetrics();
+    m_publishTimer.restart();
+    emit metrics_updated(metrics);
+}
+
+QString FrameMetricsProcessor::metrics_string(const FrameMetrics &metrics)
+{
+    return QString("Sharpness: %1   Mean: %2   Saturated: %3%   Nozzle contrast: %4")
+            .arg(metrics.sharpness, 0, 'f', 1)
+            .arg(metrics.meanIntensity, 0, 'f', 1)
+            .arg(metrics.saturatedFraction * 100.0, 0, 'f', 2)
+            .arg(metrics.nozzleContrast, 0, 'f', 2);
+}
+
+void FrameMetricsProcessor::cleanup()
+{
+    m_thread->quit();
+}
+
+#include "moc_framemetrics.cpp"
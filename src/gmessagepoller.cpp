@@ -1,5 +1,6 @@
 #include "gmessagepoller.h"
 #include "gclib_errors.h"
+#include "eventtimeline.h"
 
 #include <QDebug>
 
@@ -44,6 +45,13 @@ void GMessagePoller::stop()
     mutex_.unlock();
 }
 
+void GMessagePoller::read_position(char axis)
+{
+    mutex_.lock();
+    if (positionReads_.find(axis) == std::string::npos) positionReads_ += axis;
+    mutex_.unlock();
+}
+
 void GMessagePoller::run()
 {
 
@@ -52,6 +60,7 @@ void GMessagePoller::run()
     int m = 0; //iterator for message
 
     qDebug() << "start message handler";
+    Timeline::EventTimeline::name_current_thread("gclib Messages");
 
     char buf[G_SMALL_BUFFER]; //read buffer
     char messageBuf[G_SMALL_BUFFER];
@@ -64,8 +73,24 @@ void GMessagePoller::run()
             mutex_.unlock();
             break;
         }
+        std::string axes;
+        axes.swap(positionReads_);
         mutex_.unlock();
 
+        if (!axes.empty())
+        {
+            // the handle is non-blocking for messages, a command needs time to be answered
+            GTimeout(g_, commandTimeout_ms_);
+            for (char axis : axes)
+            {
+                const std::string command = std::string("TP") + axis;
+                int counts {0};
+                const bool ok = (GCmdI(g_, command.c_str(), &counts) == G_NO_ERROR);
+                emit position_read(axis, counts, ok);
+            }
+            GTimeout(g_, 0);
+        }
+
         //While still receiving messages
         while ((rc = GMessage(g_, buf, G_SMALL_BUFFER)) == G_NO_ERROR)
         {
@@ -81,6 +106,7 @@ void GMessagePoller::run()
                     messageBuf[m - 1] = '\0'; //Null terminate the message (strip \r\n)
 
                     // handle the complete message here
+                    Timeline::EventTimeline::instance().instant("gclib", "message received", messageBuf);
                     emit message(QString(messageBuf));
 
                     m = 0;  //Reset message index
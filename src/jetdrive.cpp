@@ -1,16 +1,36 @@
 #include "jetdrive.h"
 
+#include <algorithm>
+
 #include <QSerialPort>
 #include <QDebug>
 
 namespace JetDrive
 {
 
+namespace
+{
+
+// the command byte of a response is its second byte, which sets the response length
+class ResponseSizeFramer : public ResponseFramer
+{
+public:
+    int frame_length(const QByteArray &buffer) const override
+    {
+        if (buffer.size() < 2) return 0;
+        const int size = response_size((CMD)(buffer.at(1)));
+        return (buffer.size() >= size) ? size : 0;
+    }
+};
+
+}
+
 Controller::Controller(const QString &portName, QObject *parent) :
     AsyncSerialDevice(portName, parent),
     cmdBuilder (std::make_unique<CommandBuilder>())
 {
     name = "JetDrive";
+    set_framer(std::make_unique<ResponseSizeFramer>());
     // connect timer for handling timeout errors
     connect(serialPort, &QSerialPort::readyRead,
             this, &Controller::handle_ready_read);
@@ -29,7 +49,7 @@ Controller::~Controller()
 
 void Controller::handle_ready_read()
 {
-    readData.append(serialPort->readAll());
+    read_serial_data();
 
     switch (initState)
     {
@@ -57,24 +77,35 @@ void Controller::handle_ready_read()
                 emit response(QString("Connected to %1").arg(name));
                 initState = INITIALIZED;
                 iX200 = 0;
+                // responses are framed by their length from here on,
+                // so several commands can be queued on the device if asked for
+                set_window_size(commandWindow);
             }
             write_next();
         } else readData.clear();
         break;
 
     case INITIALIZED:
-        // the command is in the second byte received
-        if (readData.size() == 2)
-            expectedResponseSize = response_size((CMD)(readData.at(1)));
-        else if (readData.size() >= expectedResponseSize)
+    {
+        QByteArray frame;
+        while (take_response(frame))
         {
             // TODO: can do something with the response here (error checking)
-            // qDebug() << readData;
-            readData.clear();
+            // qDebug() << frame;
+
+            // report the strobe delay the device just accepted so frames
+            // can be stamped with the delay that was actually applied
+            const QByteArray command = pending_command();
+            if ((CMD)(frame.at(1)) == CMD::STROBEDELAY && command.size() >= 6)
+            {
+                const short strobeDelay = (short)(((uchar)command.at(4) << 8) | (uchar)command.at(5));
+                emit strobe_delay_acknowledged(strobeDelay);
+            }
+
             write_next();
         }
-
         break;
+    }
 
     default: break;
     }
@@ -93,6 +124,7 @@ void Controller::initialize_jet_drive()
 {
     // Start-up for MicroJet III.
     initState = InitState::INIT_Q;
+    set_window_size(1); // the Q / X2000 handshake is answered one byte at a time
 
     write("Q");
     // write the X2000 command byte by byte
@@ -103,14 +135,17 @@ void Controller::initialize_jet_drive()
     write(cmdBuilder->build(CMD::RESET, jetParams));        // 1.) Soft Reset
     write(cmdBuilder->build(CMD::GETVERSION, jetParams));   // 2.) Version
                                                             // 3.) Get Number of Channels
-    write(cmdBuilder->build(CMD::PULSE, jetParams));        // 4.) Pulse Waveform
-    write(cmdBuilder->build(CMD::CONTMODE, jetParams));     // 5.) Trigger Mode
-    write(cmdBuilder->build(CMD::DROPS, jetParams));        // 6.) Number of Drops per Trigger
-    write(cmdBuilder->build(CMD::FULLFREQ, jetParams));     // 7.) Frequency
-    write(cmdBuilder->build(CMD::STROBEDIV, jetParams));    // 8.) Strobe Divider
-    write(cmdBuilder->build(CMD::STROBEENABLE, jetParams)); // 9.) Strobe Enable
-    write(cmdBuilder->build(CMD::STROBEDELAY, jetParams));  // 10.) Strobe Delay
-    write(cmdBuilder->build(CMD::SOURCE, jetParams));       // 11.) Trigger Source
+    // the reset clears the device, so every setting is sent
+    QMutexLocker lock(&mutex);
+    sentFrames.clear();
+    send_if_changed(CMD::PULSE);        // 4.) Pulse Waveform
+    send_if_changed(CMD::CONTMODE);     // 5.) Trigger Mode
+    send_if_changed(CMD::DROPS);        // 6.) Number of Drops per Trigger
+    send_if_changed(CMD::FULLFREQ);     // 7.) Frequency
+    send_if_changed(CMD::STROBEDIV);    // 8.) Strobe Divider
+    send_if_changed(CMD::STROBEENABLE); // 9.) Strobe Enable
+    send_if_changed(CMD::STROBEDELAY);  // 10.) Strobe Delay
+    send_if_changed(CMD::SOURCE);       // 11.) Trigger Source
 }
 
 int Controller::connect_to_jet_drive()
@@ -153,73 +188,117 @@ void Controller::clear_members()
     iX200 = 0;
     initState = InitState::NOT_INITIALIZED;
     clear_command_queue();
+    sentFrames.clear(); // device state is unknown until it is initialized again
+}
+
+QByteArray Controller::encode(CMD command)
+{
+    // value bytes of the hot commands (after 'S', length, command)
+    QByteArray values;
+    switch (command)
+    {
+    case CMD::STROBEDELAY:
+        values.append((char)0x01); // keep potentiometer on
+        values.append((char)((jetParams.fStrobeDelay >> 8) & 0xFF));
+        values.append((char)(jetParams.fStrobeDelay & 0xFF));
+        break;
+    case CMD::FULLFREQ:
+        if (jetParams.fFrequency < 0L || jetParams.fFrequency >= 65536L)
+            return cmdBuilder->build(command, jetParams);
+        values.append((char)((jetParams.fFrequency >> 8) & 0xFF));
+        values.append((char)(jetParams.fFrequency & 0xFF));
+        break;
+    case CMD::DROPS:
+        // the same form the builder uses, a change of form rebuilds the frame below
+        if (cmdBuilder->two_byte_drops(jetParams.fDrops)) values.append((char)((jetParams.fDrops >> 8) & 0xFF));
+        values.append((char)(jetParams.fDrops & 0xFF));
+        break;
+    default:
+        return cmdBuilder->build(command, jetParams);
+    }
+
+    // patch the values and checksum into the cached frame
+    QByteArray &frame = hotFrames[command];
+    if (frame.size() != values.size() + 4)
+    {
+        frame = cmdBuilder->build(command, jetParams);
+        return frame;
+    }
+    uchar checksum {0};
+    for (int i = 0; i < values.size(); i++) frame[3 + i] = values[i];
+    for (int i = 1; i < frame.size() - 1; i++) checksum += (uchar)frame[i];
+    frame[frame.size() - 1] = (char)checksum;
+    return frame;
+}
+
+void Controller::send_if_changed(CMD command, Priority priority)
+{
+    // while disconnected the settings are only stored, initialize_jet_drive() sends them all
+    if (!is_connected()) return;
+
+    const QByteArray frame = encode(command);
+    if (frame.isEmpty()) return;
+
+    auto sent = sentFrames.find(command);
+    if (sent != sentFrames.end() && sent->second == frame) return; // device already has this setting
+
+    write(frame, priority);
+    sentFrames[command] = frame;
 }
 
 void Controller::set_waveform(const Waveform &waveform)
 {
     QMutexLocker lock(&mutex);
     jetParams.waveform = waveform;
-    write(cmdBuilder->build(CMD::PULSE, jetParams));
+    send_if_changed(CMD::PULSE);
 }
 
 void Controller::set_continuous_jetting()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fMode != 1)
-    {
-        jetParams.fMode = 1;
-        write(cmdBuilder->build(CMD::CONTMODE, jetParams));
-    }
+    jetParams.fMode = 1;
+    send_if_changed(CMD::CONTMODE);
+}
+
+void Controller::set_command_window(int numCommands)
+{
+    QMutexLocker lock(&mutex);
+    commandWindow = std::max(1, numCommands);
 }
 
 void Controller::set_single_jetting()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fMode != 0)
-    {
-        jetParams.fMode = 0;
-        write(cmdBuilder->build(CMD::CONTMODE, jetParams));
-    }
+    jetParams.fMode = 0;
+    send_if_changed(CMD::CONTMODE);
 }
 
 void Controller::set_continuous_mode_frequency(long frequency_Hz)
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fFrequency != frequency_Hz)
-    {
-        jetParams.fFrequency = frequency_Hz;
-        write(cmdBuilder->build(CMD::FULLFREQ, jetParams));
-    }
+    jetParams.fFrequency = frequency_Hz;
+    send_if_changed(CMD::FULLFREQ);
 }
 
 void Controller::set_num_drops_per_trigger(short numDrops)
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fDrops != numDrops)
-    {
-        jetParams.fDrops = numDrops;
-        write(cmdBuilder->build(CMD::DROPS, jetParams));
-    }
+    jetParams.fDrops = numDrops;
+    send_if_changed(CMD::DROPS);
 }
 
 void Controller::set_external_trigger()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fSource != 1)
-    {
-        jetParams.fSource = 1;
-        write(cmdBuilder->build(CMD::SOURCE, jetParams));
-    }
+    jetParams.fSource = 1;
+    send_if_changed(CMD::SOURCE);
 }
 
 void Controller::set_internal_trigger()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fSource != 0)
-    {
-        jetParams.fSource = 0;
-        write(cmdBuilder->build(CMD::SOURCE, jetParams));
-    }
+    jetParams.fSource = 0;
+    send_if_changed(CMD::SOURCE);
 }
 
 void Controller::start_continuous_jetting()
@@ -232,36 +311,31 @@ void Controller::start_continuous_jetting()
 
 void Controller::stop_continuous_jetting()
 {
-    set_single_jetting();
+    // don't wait behind queued parameter changes to stop jetting
+    QMutexLocker lock(&mutex);
+    jetParams.fMode = 0;
+    send_if_changed(CMD::CONTMODE, Priority::Urgent);
 }
 
 void Controller::enable_strobe()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fStrobeEnable != 1)
-    {
-        jetParams.fStrobeEnable = 1;
-        write(cmdBuilder->build(CMD::STROBEENABLE, jetParams));
-    }
+    jetParams.fStrobeEnable = 1;
+    send_if_changed(CMD::STROBEENABLE);
 }
 
 void Controller::disable_strobe()
 {
     QMutexLocker lock(&mutex);
-    if (jetParams.fStrobeEnable != 0)
-    {
-        jetParams.fStrobeEnable = 0;
-        write(cmdBuilder->build(CMD::STROBEENABLE, jetParams));
-    }
+    jetParams.fStrobeEnable = 0;
+    send_if_changed(CMD::STROBEENABLE);
 }
 
 void Controller::set_strobe_delay(short strobeDelay_microseconds)
 {
-    if (jetParams.fStrobeDelay != strobeDelay_microseconds)
-    {
-        jetParams.fStrobeDelay = strobeDelay_microseconds;
-        write(cmdBuilder->build(CMD::STROBEDELAY, jetParams));
-    }
+    QMutexLocker lock(&mutex);
+    jetParams.fStrobeDelay = strobeDelay_microseconds;
+    send_if_changed(CMD::STROBEDELAY);
 }
 
 const Settings Controller::get_jetting_parameters() const
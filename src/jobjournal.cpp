@@ -0,0 +1,144 @@
+#include "jobjournal.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <cmath>
+
+namespace
+{
+
+const char *header = "time,event,layer,pass,z_mm,y_shift_rows,head_frequency_Hz,head_voltage_V,print_frequency_Hz,print_speed_mm_s,reverse_offset_mm,note";
+
+bool append_lines(const QString &path, const QString &lines, QString &error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        error = QString("could not write %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    QTextStream out(&file);
+    out << lines;
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.flush())
+    {
+        error = QString("could not write %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+}
+
+bool JobJournal::open(const QString &path, const QString &job, int layerCount, QString &error)
+{
+    // every start of a job gets its own header, a resume carries on from the entries above it
+    QString lines;
+    if (!QFileInfo::exists(path)) lines += QString("# MJ print journal\n");
+    lines += QString("# job: %1\n# layers: %2\n%3\n").arg(job).arg(layerCount).arg(header);
+    if (!append_lines(path, lines, error)) return false;
+    m_path = path;
+    return true;
+}
+
+bool JobJournal::write(JournalEntry entry, QString &error)
+{
+    if (!is_open()) return true;
+
+    entry.time = QDateTime::currentDateTime().toString(Qt::ISODate);
+    const QString line = QStringList{
+        entry.time,
+        entry.event,
+        QString::number(entry.layer),
+        QString::number(entry.pass),
+        std::isnan(entry.z_mm) ? QString() : QString::number(entry.z_mm, 'f', 4),
+        QString::number(entry.yShift_rows),
+        QString::number(entry.headFrequency_Hz),
+        QString::number(entry.headVoltage, 'f', 2),
+        QString::number(entry.printFrequency_Hz),
+        QString::number(entry.printSpeed_mm_s, 'f', 3),
+        QString::number(entry.reverseOffset_mm, 'f', 3),
+        QString(entry.note).replace(',', ';').replace('\n', ' ')
+    }.join(',');
+    return append_lines(m_path, line + "\n", error);
+}
+
+bool JobJournal::read(const QString &path, JournalState &state, QString &error)
+{
+    state = JournalState();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        error = QString("could not open %1").arg(path);
+        return false;
+    }
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line == header) continue;
+        if (line.startsWith("# job: "))
+        {
+            state.job = line.mid(7);
+            continue;
+        }
+        if (line.startsWith("# layers: "))
+        {
+            state.layerCount = line.mid(10).toInt();
+            continue;
+        }
+        if (line.startsWith('#')) continue;
+
+        // a line cut short by a crash is ignored
+        const QStringList f = line.split(',');
+        if (f.size() < 12) continue;
+        JournalEntry entry;
+        entry.time = f[0];
+        entry.event = f[1];
+        entry.layer = f[2].toInt();
+        entry.pass = f[3].toInt();
+        if (!f[4].isEmpty()) entry.z_mm = f[4].toDouble();
+        entry.yShift_rows = f[5].toInt();
+        entry.headFrequency_Hz = f[6].toInt();
+        entry.headVoltage = f[7].toDouble();
+        entry.printFrequency_Hz = f[8].toDouble();
+        entry.printSpeed_mm_s = f[9].toDouble();
+        entry.reverseOffset_mm = f[10].toDouble();
+        entry.note = f.mid(11).join(',');
+
+        state.last = entry;
+        if (entry.event == "start")
+        {
+            state.started = true;
+            state.complete = false;
+            state.checkpoint = entry;
+            state.checkpoint.layer = state.checkpoint.pass = 0;
+        }
+        else if (entry.event == "resume")
+        {
+            // a resumed job starts from the checkpoint it was given, which is normally
+            // the last one in this journal and has the machine state of that pass
+            state.started = true;
+            state.complete = false;
+            if (entry.layer != state.checkpoint.layer || entry.pass != state.checkpoint.pass) state.checkpoint = entry;
+        }
+        else if (entry.is_checkpoint())
+        {
+            state.checkpoint = entry;
+        }
+        else if (entry.event == "complete")
+        {
+            state.complete = true;
+        }
+    }
+
+    if (!state.started)
+    {
+        error = QString("%1 has no print job in it").arg(path);
+        return false;
+    }
+    return true;
+}
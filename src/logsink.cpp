@@ -0,0 +1,330 @@
+#include "logsink.h"
+
+#include <QColor>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <chrono>
+
+namespace Log
+{
+
+const char *severity_name(Severity severity)
+{
+    switch (severity)
+    {
+    case Severity::Debug: return "DEBUG";
+    case Severity::Info: return "INFO";
+    case Severity::Warning: return "WARNING";
+    case Severity::Error: return "ERROR";
+    }
+    return "";
+}
+
+Severity severity_from_text(const QString &text)
+{
+    if (text.contains("error", Qt::CaseInsensitive) || text.contains("fail", Qt::CaseInsensitive))
+        return Severity::Error;
+    if (text.contains("warning", Qt::CaseInsensitive)
+            || text.contains("timed out", Qt::CaseInsensitive)
+            || text.contains("timeout", Qt::CaseInsensitive)
+            || text.contains("not connected", Qt::CaseInsensitive))
+        return Severity::Warning;
+    return Severity::Info;
+}
+
+// --- MessageQueue ---
+
+MessageQueue::MessageQueue(size_t capacity) :
+    m_cells(new Cell[capacity]),
+    m_mask(capacity - 1)
+{
+    Q_ASSERT((capacity & m_mask) == 0); // power of 2
+    for (size_t i = 0; i < capacity; i++) m_cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+bool MessageQueue::try_push(Entry &&entry)
+{
+    Cell *cell {nullptr};
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &m_cells[pos & m_mask];
+        const size_t seq = cell->seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            // claim the cell, another producer may have got it first
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) return false; // full, the consumer hasn't freed this cell yet
+        else pos = m_tail.load(std::memory_order_relaxed);
+    }
+    cell->entry = std::move(entry);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool MessageQueue::try_pop(Entry &entry)
+{
+    Cell &cell = m_cells[m_head & m_mask];
+    if (cell.seq.load(std::memory_order_acquire) != m_head + 1) return false; // empty or still being written
+    entry = std::move(cell.entry);
+    cell.entry.text = QString(); // don't hold on to the text until the cell is reused
+    cell.seq.store(m_head + m_mask + 1, std::memory_order_release);
+    m_head++;
+    return true;
+}
+
+// --- Sink ---
+
+Sink::Sink() :
+    m_queue(1 << 14)
+{
+
+}
+
+Sink::~Sink()
+{
+    stop();
+}
+
+Sink &Sink::instance()
+{
+    static Sink sink;
+    return sink;
+}
+
+void Sink::write(Severity severity, const char *source, const QString &text)
+{
+    Entry entry;
+    entry.time_ms = QDateTime::currentMSecsSinceEpoch();
+    entry.severity = severity;
+    entry.source = source ? source : "";
+    entry.text = text;
+    if (!m_queue.try_push(std::move(entry))) m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Sink::start(const QString &directory, const QString &baseName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_directory = directory;
+    m_baseName = baseName;
+    m_running = true;
+    m_thread = std::thread(&Sink::run, this);
+}
+
+void Sink::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+std::vector<Entry> Sink::take_view_entries()
+{
+    std::lock_guard<std::mutex> lock(m_viewMutex);
+    std::vector<Entry> entries(std::make_move_iterator(m_viewEntries.begin()),
+                               std::make_move_iterator(m_viewEntries.end()));
+    m_viewEntries.clear();
+    return entries;
+}
+
+void Sink::run()
+{
+    std::vector<Entry> batch;
+    Entry entry;
+    for (;;)
+    {
+        bool running {true};
+        {
+            // producers don't signal, the queue is simply drained every 50 ms
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(50), [this]{return !m_running;});
+            running = m_running;
+        }
+
+        while (m_queue.try_pop(entry)) batch.push_back(std::move(entry));
+
+        const quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            Entry warning;
+            warning.time_ms = QDateTime::currentMSecsSinceEpoch();
+            warning.severity = Severity::Warning;
+            warning.source = "Log";
+            warning.text = QString("%1 log messages were dropped, the queue was full").arg(dropped);
+            batch.push_back(std::move(warning));
+        }
+
+        if (!batch.empty())
+        {
+            write_to_file(batch);
+            publish_to_view(batch);
+            batch.clear();
+        }
+
+        // anything written before stop() has been drained above
+        if (!running) break;
+    }
+    m_file.close();
+}
+
+void Sink::write_to_file(const std::vector<Entry> &batch)
+{
+    const QDate today = QDate::currentDate();
+    if (!m_file.is_open() || today != m_fileDate) open_file(today);
+    if (!m_file.is_open()) return;
+
+    for (const auto &entry : batch)
+    {
+        std::string line;
+        if (entry.text.trimmed().isEmpty()) line = "\n";
+        else
+        {
+            line = QDateTime::fromMSecsSinceEpoch(entry.time_ms).toString("hh:mm:ss.zzz").toStdString();
+            line += ' ';
+            line += severity_name(entry.severity);
+            line += " [";
+            line += entry.source;
+            line += "] ";
+            line += entry.text.toStdString();
+            line += '\n';
+        }
+        m_file << line;
+        m_fileSize += static_cast<qint64>(line.size());
+        if (m_fileSize >= maxFileSize_) rotate_file();
+    }
+    m_file.flush();
+}
+
+void Sink::publish_to_view(const std::vector<Entry> &batch)
+{
+    std::lock_guard<std::mutex> lock(m_viewMutex);
+    for (const auto &entry : batch)
+    {
+        // one row per line so the view can use uniform row heights
+        // (the MJ board pretty prints its JSON responses)
+        if (!entry.text.contains('\n'))
+        {
+            m_viewEntries.push_back(entry);
+            continue;
+        }
+        const QStringList lines = entry.text.split('\n');
+        for (const auto &text : lines)
+        {
+            Entry line = entry;
+            line.text = text;
+            m_viewEntries.push_back(std::move(line));
+        }
+    }
+    // the output window hasn't kept up, only the newest entries can be shown anyway
+    while (m_viewEntries.size() > viewCapacity_) m_viewEntries.pop_front();
+}
+
+void Sink::open_file(const QDate &date)
+{
+    if (m_file.is_open()) m_file.close();
+    if (!QDir(m_directory).exists()) QDir().mkpath(m_directory);
+    m_fileDate = date;
+    m_filePath = m_directory + "/" + m_baseName + date.toString("yyyy_MM_dd") + ".txt";
+    m_file.open(m_filePath.toStdString(), std::ios::app); // append
+    m_fileSize = QFileInfo(m_filePath).size();
+}
+
+void Sink::rotate_file()
+{
+    // BJ_Log_<date>.txt -> BJ_Log_<date>.1.txt -> ... -> BJ_Log_<date>.<maxBackups>.txt, then removed
+    m_file.close();
+    const QString stem = m_filePath.left(m_filePath.size() - 4); // without .txt
+    auto backup = [&stem](int i){return QString("%1.%2.txt").arg(stem).arg(i);};
+
+    QFile::remove(backup(maxBackups_));
+    for (int i = maxBackups_ - 1; i >= 1; i--) QFile::rename(backup(i), backup(i + 1));
+    if (maxBackups_ > 0) QFile::rename(m_filePath, backup(1));
+
+    m_file.open(m_filePath.toStdString(), std::ios::trunc);
+    m_fileSize = 0;
+}
+
+// --- Model ---
+
+Model::Model(size_t capacity, QObject *parent) :
+    QAbstractListModel(parent),
+    m_entries(capacity)
+{
+
+}
+
+int Model::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return static_cast<int>(m_entries.size());
+}
+
+QVariant Model::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    const Entry &entry = m_entries.at(static_cast<size_t>(index.row()));
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return entry.text;
+    case Qt::ToolTipRole:
+        return QString("%1  %2  %3")
+                .arg(QDateTime::fromMSecsSinceEpoch(entry.time_ms).toString("yyyy.MM.dd hh:mm:ss.zzz"),
+                     severity_name(entry.severity),
+                     entry.source);
+    case Qt::ForegroundRole:
+        switch (entry.severity)
+        {
+        case Severity::Debug: return QColor(Qt::gray);
+        case Severity::Warning: return QColor(200, 120, 0);
+        case Severity::Error: return QColor(Qt::red);
+        default: return QVariant();
+        }
+    default:
+        return QVariant();
+    }
+}
+
+void Model::append(const std::vector<Entry> &entries)
+{
+    if (entries.empty()) return;
+    const size_t capacity = m_entries.capacity();
+
+    // only the newest entries fit
+    const size_t first = (entries.size() > capacity) ? entries.size() - capacity : 0;
+    const size_t count = entries.size() - first;
+
+    const size_t overflow = (m_entries.size() + count > capacity) ? m_entries.size() + count - capacity : 0;
+    if (overflow > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, static_cast<int>(overflow) - 1);
+        m_entries.pop_front(overflow);
+        endRemoveRows();
+    }
+
+    const int row = static_cast<int>(m_entries.size());
+    beginInsertRows(QModelIndex(), row, row + static_cast<int>(count) - 1);
+    for (size_t i = first; i < entries.size(); i++) m_entries.push(entries[i]);
+    endInsertRows();
+}
+
+void Model::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    endResetModel();
+}
+
+}
+
+#include "moc_logsink.cpp"
@@ -13,6 +13,7 @@
 
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QFileDialog>
 #include <QDebug>
 
 #include "gclib.h"
@@ -28,6 +29,7 @@
 #include "printerwidget.h"
 #include "lineprintwidget.h"
 #include "outputwindow.h"
+#include "serialstatswindow.h"
 #include "powdersetupwidget.h"
 #include "highspeedlinewidget.h"
 #include "dropletobservationwidget.h"
@@ -37,6 +39,7 @@
 #include "pcd.h"
 #include "dmc4080.h"
 #include "mister.h"
+#include "eventtimeline.h"
 
 MainWindow::MainWindow(Printer *printer_, QMainWindow *parent) :
     QMainWindow(parent),
@@ -44,6 +47,7 @@ MainWindow::MainWindow(Printer *printer_, QMainWindow *parent) :
     printer(printer_)
 {
     ui->setupUi(this);
+    Timeline::EventTimeline::name_current_thread("GUI");
     ui->homeZAxisCheckBox->setChecked(false); // Set Z-home to off by default as currently it rams the z-axis into the print heads.
 
     // set up widgets (parent is set when adding as a tab)
@@ -69,21 +73,26 @@ MainWindow::MainWindow(Printer *printer_, QMainWindow *parent) :
         widget->setAutoFillBackground(true);
     }
 
-    // open a txt file for logging commands
+    // start the log thread that writes everything shown in the output window to disk
     open_log_file();
-    logFile << "Application opened at "
-            << QDateTime::currentDateTime()
-               .toString("yyyy.MM.dd hh:mm")
-               .toStdString()
-            << "\n";
+    Log::write(Log::Severity::Info, "MainWindow", "Application opened at "
+               + QDateTime::currentDateTime().toString("yyyy.MM.dd hh:mm"));
 
     // add dock widget for showing console output
     dockWidget = new QDockWidget("Output Window", this);
     this->addDockWidget(Qt::RightDockWidgetArea, dockWidget);
-    outputWindow = new OutputWindow(this, logFile);
+    outputWindow = new OutputWindow(this);
     dockWidget->setWidget(outputWindow);
-    outputWindow->print_string("Starting Program...");
-    outputWindow->print_string("Program Started");
+    print_to_output_window("Starting Program...");
+    print_to_output_window("Program Started");
+
+    // dock widget with serial device latency and throughput (hidden until shown from the Window menu)
+    serialStatsDockWidget = new QDockWidget("Serial Statistics", this);
+    this->addDockWidget(Qt::BottomDockWidgetArea, serialStatsDockWidget);
+    serialStatsWindow = new SerialStatsWindow({printer->jetDrive, printer->pressureController,
+                                               printer->mister, printer->mjController}, this);
+    serialStatsDockWidget->setWidget(serialStatsWindow);
+    serialStatsDockWidget->hide();
 
     // disable all buttons that require a controller connection
     allow_user_input(false);
@@ -114,13 +123,10 @@ MainWindow::~MainWindow()
 
     delete ui;
 
-    // log application close and close the file
-    logFile << "Application closed at "
-            << QDateTime::currentDateTime()
-               .toString("yyyy.MM.dd hh:mm")
-               .toStdString()
-            << "\n";
-    logFile.close();
+    // log application close and flush the log file
+    Log::write(Log::Severity::Info, "MainWindow", "Application closed at "
+               + QDateTime::currentDateTime().toString("yyyy.MM.dd hh:mm"));
+    Log::Sink::instance().stop();
 }
 
 // runs from main.cpp right after the object is initialized
@@ -194,8 +200,8 @@ void MainWindow::setup()
 
     // connect response from jetDrive to output window
     connect(printer->jetDrive, &JetDrive::Controller::response, this, &MainWindow::print_to_output_window);
-    connect(printer->jetDrive, &JetDrive::Controller::timeout, this, &MainWindow::print_to_output_window);
-    connect(printer->jetDrive, &JetDrive::Controller::error, this, &MainWindow::print_to_output_window);
+    connect(printer->jetDrive, &JetDrive::Controller::timeout, this, &MainWindow::print_warning_to_output_window);
+    connect(printer->jetDrive, &JetDrive::Controller::error, this, &MainWindow::print_error_to_output_window);
 
     connect(ui->connectToJetDriveButton, &QPushButton::clicked, this, &MainWindow::connect_to_jet_drive_button_pressed);
     connect(ui->connecttoPCDButton, &QPushButton::clicked, this, &MainWindow::connect_to_pressure_controller_button_pressed);
@@ -205,16 +211,16 @@ void MainWindow::setup()
     // connect response from pressure controller to output window
     // TODO: Do I want these here?
     connect(printer->pressureController, &PCD::Controller::response, this, &MainWindow::print_to_output_window);
-    connect(printer->pressureController, &PCD::Controller::timeout, this, &MainWindow::print_to_output_window);
-    connect(printer->pressureController, &PCD::Controller::error, this, &MainWindow::print_to_output_window);
+    connect(printer->pressureController, &PCD::Controller::timeout, this, &MainWindow::print_warning_to_output_window);
+    connect(printer->pressureController, &PCD::Controller::error, this, &MainWindow::print_error_to_output_window);
 
     connect(printer->mister, &Mister::Controller::response, this, &MainWindow::print_to_output_window);
-    connect(printer->mister, &Mister::Controller::timeout, this, &MainWindow::print_to_output_window);
-    connect(printer->mister, &Mister::Controller::error, this, &MainWindow::print_to_output_window);
+    connect(printer->mister, &Mister::Controller::timeout, this, &MainWindow::print_warning_to_output_window);
+    connect(printer->mister, &Mister::Controller::error, this, &MainWindow::print_error_to_output_window);
 
     connect(printer->mjController, &Added_Scientific::Controller::response, this, &MainWindow::print_to_output_window);
-    connect(printer->mjController, &Added_Scientific::Controller::timeout, this, &MainWindow::print_to_output_window);
-    connect(printer->mjController, &Added_Scientific::Controller::error, this, &MainWindow::print_to_output_window);
+    connect(printer->mjController, &Added_Scientific::Controller::timeout, this, &MainWindow::print_warning_to_output_window);
+    connect(printer->mjController, &Added_Scientific::Controller::error, this, &MainWindow::print_error_to_output_window);
 
     // Connect the new Y-Axis Init button (added 12/11)
     connect(ui->initYAxisButton, &QPushButton::clicked, this, &MainWindow::initialize_y_axis_commutation);
@@ -681,7 +687,17 @@ void MainWindow::moveToY_clicked(){
 
 void MainWindow::print_to_output_window(QString s)
 {
-    outputWindow->print_string(s);
+    outputWindow->log(Log::severity_from_text(s), sender() ? sender()->metaObject()->className() : "MainWindow", s);
+}
+
+void MainWindow::print_warning_to_output_window(QString s)
+{
+    outputWindow->log(Log::Severity::Warning, sender() ? sender()->metaObject()->className() : "MainWindow", s);
+}
+
+void MainWindow::print_error_to_output_window(QString s)
+{
+    outputWindow->log(Log::Severity::Error, sender() ? sender()->metaObject()->className() : "MainWindow", s);
 }
 
 void MainWindow::on_removeBuildBox_clicked()
@@ -727,6 +743,28 @@ void MainWindow::on_actionShow_Hide_Console_triggered()
     else                         dockWidget->show();
 }
 
+void MainWindow::on_actionShow_Hide_Serial_Statistics_triggered()
+{
+    if (serialStatsDockWidget->isVisible()) serialStatsDockWidget->hide();
+    else
+    {
+        serialStatsDockWidget->show();
+        serialStatsWindow->refresh();
+    }
+}
+
+void MainWindow::on_actionExport_Event_Timeline_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export event timeline", "", "Chrome Trace (*.json)");
+    if (fileName.isEmpty()) return;
+
+    const auto &timeline = Timeline::EventTimeline::instance();
+    if (timeline.export_chrome_trace(fileName.toStdString()))
+        print_to_output_window("Event timeline saved to " + fileName + " (open in ui.perfetto.dev or chrome://tracing)");
+    else
+        print_to_output_window("Could not save the event timeline to " + fileName);
+}
+
 void MainWindow::show_hide_droplet_analyzer_window()
 {
     if (!dropletObservationWidget->is_droplet_anlyzer_window_visible())
@@ -822,12 +860,8 @@ void MainWindow::open_log_file()
             + "/"
             + folderName;
     if(!QDir(logDir).exists()) QDir().mkdir(logDir);
-    QDateTime date = QDateTime::currentDateTime();
-    QString fileName = logDir
-            + "/BJ_Log_"
-            + date.toString("yyyy_MM_dd")
-            + ".txt";
-    logFile.open(fileName.toStdString(), std::ios::app); // append
+    // BJ_Log_yyyy_MM_dd.txt, rotated into numbered backups once it gets large
+    Log::Sink::instance().start(logDir, "BJ_Log_");
 }
 
 void MainWindow::connect_to_jet_drive_button_pressed()
@@ -915,7 +949,7 @@ void MainWindow::initialize_y_axis_commutation()
     if (printer->mcu->g)
     {
         // Print "Starting" message
-        outputWindow->print_string("Starting Y-Axis Initialization (Negative Dir)...");
+        print_to_output_window("Starting Y-Axis Initialization (Negative Dir)...");
 
         // 1. Download the program to the controller
         GProgramDownload(printer->mcu->g, program.c_str(), "");
@@ -927,7 +961,7 @@ void MainWindow::initialize_y_axis_commutation()
     }
     else
     {
-        outputWindow->print_string("Error: Controller not connected.");
+        print_to_output_window("Error: Controller not connected.");
     }
 }
 
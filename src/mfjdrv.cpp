@@ -48,7 +48,7 @@ const QByteArray CommandBuilder::build(
         break;
 
     case CMD::DROPS:
-        if (gDreamController || jetParams.fDrops > 255)
+        if (two_byte_drops(jetParams.fDrops))
         {
             jetCmd.resize(5);
             jetCmd[3] = high_byte(jetParams.fDrops);
@@ -11,6 +11,7 @@ Controller::Controller(const QString &portName, QObject *parent) :
     AsyncSerialDevice(portName, parent)
 {
     name = "Mister";
+    set_framer(std::make_unique<TerminatorFramer>('\r'));
     // connect timer for handling timeout errors
     connect(serialPort, &QSerialPort::readyRead, this, &Controller::handle_ready_read);
     connect(timer, &QTimer::timeout, this, &Controller::handle_timeout);
@@ -26,48 +27,45 @@ Controller::~Controller()
 
 void Controller::handle_ready_read()
 {
-    auto inData = serialPort->readAll();
-    readData.append(inData);
-    QString responseString = QString(readData).simplified(); // simplified() removes whitespace, including \n\r
+    read_serial_data();
 
-    // Check if a complete line (ending with \r) has been received
-    if (!inData.contains("\r")) {
-        return;
-    }
-
-    // Clear readData for the next incoming message once a full message is processed
-    readData.clear();
-
-    switch (initState)
+    // handle each complete line (ending with \r) that has been received
+    QByteArray frame;
+    while (take_response(frame))
     {
-    case NOT_INITIALIZED:
-        // Arduino sends "MISTER\n\r". simplified() makes it "MISTER".
-        if (responseString == initString)
-        {
-            initState = INITIALIZED;
-            emit response(QString("Connected to %1").arg(name));
-            write_next(); // Process next command in queue, if any
-        }
-        else
+        QString responseString = QString(frame).simplified(); // simplified() removes whitespace, including \n\r
+
+        switch (initState)
         {
-            emit error(QString("Unexpected response from device."
-                               " Expected '%1' from device but got '%2'")
-                           .arg(initString)
-                           .arg(responseString));
-            disconnect_serial();
+        case NOT_INITIALIZED:
+            // Arduino sends "MISTER\n\r". simplified() makes it "MISTER".
+            if (responseString == initString)
+            {
+                initState = INITIALIZED;
+                emit response(QString("Connected to %1").arg(name));
+                write_next(); // Process next command in queue, if any
+            }
+            else
+            {
+                emit error(QString("Unexpected response from device."
+                                   " Expected '%1' from device but got '%2'")
+                               .arg(initString)
+                               .arg(responseString));
+                disconnect_serial();
+                return;
+            }
+            break;
+        case INITIALIZED:
+            // In the INITIALIZED state, we expect an "OK" or "ERROR" or "STATUS" response
+            // after each command. The current logic just moves on to the next command.
+            // If you need to parse specific responses (e.g., "STATUS:LON,ROFF"),
+            // you would add more `if/else if` conditions here.
+            qDebug() << "Arduino responded:" << responseString; // Log the response for debugging
+            write_next(); // Arduino processed the command, send the next one
+            break;
+
+        default: break;
         }
-        break;
-    case INITIALIZED:
-        // In the INITIALIZED state, we expect an "OK" or "ERROR" or "STATUS" response
-        // after each command. The current logic just clears data and writes next.
-        // If you need to parse specific responses (e.g., "STATUS:LON,ROFF"),
-        // you would add more `if/else if` conditions here.
-        // For now, simply receiving any response ending in '\r' is enough to proceed.
-        qDebug() << "Arduino responded:" << responseString; // Log the response for debugging
-        write_next(); // Arduino processed the command, send the next one
-        break;
-
-    default: break;
     }
 }
 
@@ -120,7 +118,7 @@ void Controller::disconnect_serial()
  * This function now maps the CMD enum to the actual string command.
  * @param command The CMD enum value representing the command.
  */
-void Controller::send_command(CMD command)
+void Controller::send_command(CMD command, Priority priority)
 {
     QString cmdString;
     switch (command) {
@@ -144,7 +142,7 @@ void Controller::send_command(CMD command)
         return; // Do not send an unknown command
     }
     // Append carriage return and send as UTF-8 bytes
-    write(QString("%1\r").arg(cmdString).toUtf8());
+    write(QString("%1\r").arg(cmdString).toUtf8(), priority);
 }
 
 void Controller::initialize_misters()
@@ -159,7 +157,7 @@ void Controller::turn_on_misters()
 
 void Controller::turn_off_misters()
 {
-    send_command(MIST_OFF);
+    send_command(MIST_OFF, Priority::Urgent);
 }
 
 void Controller::turn_on_left_mister()
@@ -12,6 +12,7 @@
 #include <QPainter>
 #include <format>
 #include <QTimer>
+#include <algorithm>
 
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
@@ -21,16 +22,65 @@ namespace Added_Scientific
 
 using json = nlohmann::json;
 
+namespace
+{
+
+double number_or(const json &j, const char *key, double fallback)
+{
+    const auto it = j.find(key);
+    return (it != j.end() && it->is_number()) ? it->get<double>() : fallback;
+}
+
+HeadStatus head_status(const json &h)
+{
+    HeadStatus status;
+    status.head = static_cast<int>(number_or(h, "head", 0));
+    const auto power = h.find("power");
+    if (power != h.end() && power->is_boolean()) status.powered = power->get<bool>();
+    status.voltage = number_or(h, "voltage", 0.0);
+    status.temperature_C = number_or(h, "temp", HeadTemperatures::notReported);
+    return status;
+}
+
+// the board sums the bytes after 'W' and the head the same way convert_image does
+ImageReceipt image_receipt(const QByteArray &imageData)
+{
+    ImageReceipt receipt;
+    if (imageData.size() >= 2) receipt.head = static_cast<unsigned char>(imageData[1]) - 100;
+    for (int i = 2; i < imageData.size(); i++)
+    {
+        receipt.count++;
+        receipt.sum += static_cast<unsigned char>(imageData[i]);
+    }
+    return receipt;
+}
+
+}
+
 Controller::Controller(const QString &portName, QObject *parent) :
-    AsyncSerialDevice(portName, parent)
+    AsyncSerialDevice(portName, parent),
+    textReplyTimer(new QTimer(this))
 {
     name = "MJ_Controller";
+    qRegisterMetaType<BoardStatus>("Added_Scientific::BoardStatus");
+    qRegisterMetaType<HeadTemperatures>("Added_Scientific::HeadTemperatures");
+    qRegisterMetaType<ImageReceipt>("Added_Scientific::ImageReceipt");
+    set_framer(std::make_unique<JsonFramer>('\n'));
+    textReplyTimer->setSingleShot(true);
+    connect(textReplyTimer, &QTimer::timeout, this, &Controller::flush_text_reply);
     // connect timer for handling timeout errors
     connect(serialPort, &QSerialPort::readyRead, this, &Controller::handle_ready_read);
     connect(timer, &QTimer::timeout, this, &Controller::handle_timeout);
     connect(serialPort, &QSerialPort::errorOccurred, this, &Controller::handle_serial_error);
 
     serialPort->setBaudRate(1'000'000); // 1 million baud rate.
+
+    // report image uploads once the last chunk has gone out
+    connect(this, &AsyncSerialDevice::bulk_write_progress, this, [this](qint64 written, qint64 total, double bytesPerSecond)
+    {
+        if (written < total) return;
+        emit response(QString("Image sent: %1 bytes at %2 kB/s").arg(total).arg(bytesPerSecond / 1000.0, 0, 'f', 1));
+    });
 }
 
 Controller::~Controller()
@@ -42,52 +92,164 @@ void Controller::handle_ready_read()
 {
     // look at DataRecievedHandler in "MJ Driver Board/Software/DriverBoardDropwatcher/Form1.cs"
     while (serialPort->bytesAvailable())
+        read_serial_data();
+
+    // the board replies with JSON objects or lines of text. A reply can be split
+    // over several reads and one read can hold several replies
+    QByteArray frame;
+    while (take_response(frame))
+    {
+        const QByteArray trimmed = frame.trimmed();
+        if (trimmed.isEmpty()) continue; // line ending left after a JSON object
+        handle_reply(trimmed);
+    }
+
+    // a text reply without a line ending is only complete once the board goes quiet
+    const QByteArray pending = readData.trimmed();
+    if (!pending.isEmpty() && !pending.startsWith('{')) textReplyTimer->start(textReplyQuiet_ms);
+    else textReplyTimer->stop();
+}
+
+void Controller::flush_text_reply()
+{
+    const QByteArray trimmed = take_unframed().trimmed();
+    if (!trimmed.isEmpty()) handle_reply(trimmed);
+}
+
+void Controller::handle_reply(const QByteArray &frame)
+{
+    if (!frame.startsWith('{'))
+    {
+        emit response(QString::fromUtf8(frame));
+        write_next();
+        return;
+    }
+
+    json j;
+    try
+    {
+        j = json::parse(frame.constData(), frame.constData() + frame.size());
+    }
+    catch (const nlohmann::json::parse_error &e)
     {
-        auto inData = serialPort->readAll();
-        readData.append(inData);
+        QString errorMessage = "Failed to parse JSON: ";
+        errorMessage += e.what();
+        emit error(errorMessage);
+        write_next();
+        return;
     }
+    echo_json(frame);
+
+    // the image receipt answers the upload, the next command can go once it is checked
+    const bool answersImage = j.is_object() && j.contains("image");
+    if (!answersImage) write_next();
+    if (!j.is_object()) return;
 
-    if (readData[0] == '{')
+    const auto heads = j.find("heads");
+    if (heads != j.end() && heads->is_array())
     {
-        json j;
-        try
+        BoardStatus status;
+        for (const json &h : *heads)
         {
-            j = json::parse(readData.toStdString());
-            // handle the json here
-            emit response( QString::fromStdString(j.dump(4)) ); // this probably doesn't need to be here and clogs the output window
+            if (h.is_object()) status.heads.push_back(head_status(h));
+        }
+        status.mode = static_cast<int>(number_or(j, "mode", -1));
+        const auto position = j.find("position");
+        if (position != j.end() && position->is_number_integer()) status.position = position->get<qint64>();
+        emit status_received(status);
+    }
 
+    const auto temps = j.find("temps");
+    if (temps != j.end() && temps->is_array())
+    {
+        HeadTemperatures temperatures;
+        for (size_t i = 0; i < std::min(temps->size(), temperatures.temperature_C.size()); i++)
+        {
+            if ((*temps)[i].is_number()) temperatures.temperature_C[i] = (*temps)[i].get<double>();
         }
-        catch (const nlohmann::json::parse_error &e)
+        emit head_temperatures_received(temperatures);
+    }
+
+    if (answersImage)
+    {
+        const json &image = j["image"];
+        ImageReceipt receipt;
+        if (image.is_object())
         {
-            QString errorMessage = "Failed to parse JSON: ";
-            errorMessage += e.what();
-            emit error(errorMessage);
+            receipt.head = static_cast<int>(number_or(image, "head", 0));
+            receipt.count = static_cast<qint64>(number_or(image, "count", -1));
+            receipt.sum = static_cast<qint64>(number_or(image, "sum", -1));
         }
+        emit image_received(receipt);
+        check_image(receipt);
+    }
+}
+
+void Controller::check_image(const ImageReceipt &receipt)
+{
+    // a receipt that comes after the upload was given up on changes nothing
+    if (!bulk_in_flight()) return;
 
+    const ImageReceipt sentImage = image_receipt(pending_command());
+    if (receipt == sentImage)
+    {
+        write_next();
+        return;
     }
+    abort_bulk(QString("the board got %1 bytes with checksum %2 for head %3, %4 bytes with checksum %5 for head %6 were sent")
+               .arg(receipt.count).arg(receipt.sum).arg(receipt.head)
+               .arg(sentImage.count).arg(sentImage.sum).arg(sentImage.head));
+}
 
-    else
+void Controller::echo_json(const QByteArray &frame)
+{
+    if (!jsonEcho) return;
+
+    // throttle so high-rate status polling doesn't flood the output window
+    if (jsonEchoTimer.isValid() && jsonEchoTimer.elapsed() < jsonEchoInterval_ms)
     {
-        emit response(QString(readData));
+        jsonEchoSkipped++;
+        return;
     }
+    jsonEchoTimer.start();
+
+    QString text = QString::fromUtf8(frame);
+    if (jsonEchoSkipped > 0) text += QString(" (%1 more not shown)").arg(jsonEchoSkipped);
+    jsonEchoSkipped = 0;
+    emit response(text);
+}
 
-    readData.clear();
-    write_next();
+void Controller::set_json_echo(bool enabled, int minInterval_ms)
+{
+    jsonEcho = enabled;
+    jsonEchoInterval_ms = std::max(0, minInterval_ms);
+    jsonEchoTimer.invalidate();
+    jsonEchoSkipped = 0;
 }
 
 void Controller::handle_timeout()
 {
     timer->stop();
-    emit error(QString("Serial IO Timeout: No response from %1").arg(name));
-    emit error(readData);
+    textReplyTimer->stop();
+    const QByteArray partial = take_unframed();
+    if (bulk_in_flight())
+    {
+        // the image may only be partly in the board, whoever sent it sends it again
+        if (!partial.isEmpty()) emit error(partial);
+        abort_bulk(QString("no response from %1 to the image upload").arg(name));
+        return;
+    }
+    emit error(QString("Serial IO Timeout: No response from %1 to %2")
+               .arg(name, QString::fromUtf8(pending_command().left(32).trimmed())));
+    emit error(partial);
     disconnect_serial();
 }
 
 // writes to serial device, adding a LF character ('\n')
 // the controller expects LF after every command
-void Controller::write_line(const QByteArray &data)
+void Controller::write_line(const QByteArray &data, Priority priority)
 {
-    write(data + "\n");
+    write(data + "\n", priority);
 }
 
 void Controller::connect_board()
@@ -132,7 +294,7 @@ void Controller::power_on()
 
 void Controller::power_off()
 {
-    write_line("F");
+    write_line("F", Priority::Urgent);
 }
 
 void Controller::report_status()
@@ -251,15 +413,12 @@ QByteArray Controller::convert_image(int headIdx, const QImage &image, int white
         }
     }
 
-    // Check image is correct by reconstructing and saving it to view
-    reconstructed_bitmap(headIdx, imageData, width, height);
-
-    emit response(QString("lastval = %1, sumofval = %2, copnt = %3").arg(lastval).arg(sumofval).arg(copnt));
+    emit response(QString("Image for head %1: %2 bytes, checksum %3 (last byte %4)").arg(headIdx).arg(copnt).arg(sumofval).arg(lastval));
 
     return imageData;
 }
 
-void Controller::reconstructed_bitmap(int headIdx, const QByteArray &imageData, int width, int height)
+QImage Controller::reconstructed_bitmap(const QByteArray &imageData, int width, int height)
 {
     // Skip first two bytes
     int startIdx = 2;
@@ -292,23 +451,17 @@ void Controller::reconstructed_bitmap(int headIdx, const QByteArray &imageData,
 
     painter.end();
 
-    // Convert to QImage for saving
-    QImage image = newBitmap.toImage();
-
-    // save to file library
-    QString filePath = QString("C:\\Users\\CB140LAB\\Desktop\\Noah\\debugBitmap%1.bmp").arg(headIdx); // 12/1 saves separate files for head 1/2
-    image.save(filePath);
-
-    emit response(QString("Bitmap reconstructed and saved: %1").arg(filePath));
+    return newBitmap.toImage();
 }
 
 void Controller::send_image_data(int headIdx, const QImage &image, int whiteSpace)
 {
-    QByteArray imageData = convert_image(headIdx, image, whiteSpace);
-
-
+    send_packed_image_data(convert_image(headIdx, image, whiteSpace));
+}
 
-    write(imageData);
+void Controller::send_packed_image_data(const QByteArray &imageData)
+{
+    write_bulk(imageData, imageChunkSize);
 }
 
 void Controller::create_bitmap_lines(int numLines, int width)
@@ -455,6 +608,7 @@ void Controller::clear_all_heads_of_data()
 
 void Controller::clear_members()
 {
+    textReplyTimer->stop();
     clear_command_queue();
 }
 
@@ -1,6 +1,11 @@
 #include "outputwindow.h"
 #include "ui_outputwindow.h"
-#include <QDateTime>
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QScrollBar>
+#include <QTimer>
+#include <algorithm>
 
 bool printComplete = false;
 bool atLocation = false;
@@ -8,13 +13,16 @@ bool recoatComplete = false;
 
 void OutputWindow::print_string(QString outS)
 {
+    const char *source = sender() ? sender()->metaObject()->className() : "OutputWindow";
+
     // Debug value for mjprinthead encoder ticks
     const QString positionPrefix = "Encoder current count: ";
-    // output to window
-    if(!outS.startsWith(positionPrefix)){
-        ui->mOutputText->appendPlainText(outS);
-    }
+    if(outS.startsWith(positionPrefix)) log(Log::Severity::Debug, source, outS);
+    else log(Log::severity_from_text(outS), source, outS);
+}
 
+void OutputWindow::log(Log::Severity severity, const char *source, const QString &outS)
+{
     // check print completion status
     if(outS.contains(QString("Print Complete"))){
         printComplete = true;
@@ -29,26 +37,43 @@ void OutputWindow::print_string(QString outS)
         recoatComplete = true;
     }
 
-    // write to log
-    auto currentTime = QDateTime::currentDateTime()
-            .toString("hh:mm:ss")
-            .toStdString();
-    m_logFile << outS.toStdString();
-    if (outS.trimmed().isEmpty()) m_logFile << "\n";
-    else m_logFile << " | " << currentTime << "\n";
+    // the log thread writes it to disk and hands it back for display
+    Log::write(severity, source, outS);
 }
 
-OutputWindow::OutputWindow(QWidget *parent, std::ofstream& logFile)
+OutputWindow::OutputWindow(QWidget *parent)
     : QWidget(parent),
-      ui(new Ui::OutputWindow),
-      m_logFile(logFile)
+      ui(new Ui::OutputWindow)
 {
     ui->setupUi(this);
-    ui->mOutputText->setReadOnly(true);
+
+    m_model = new Log::Model(Log::Sink::viewCapacity_, this);
+    ui->mOutputView->setModel(m_model);
+    ui->mOutputView->setUniformItemSizes(true); // only the visible rows are laid out
+    ui->mOutputView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+
+    ui->severityFilter->addItem("Debug", static_cast<int>(Log::Severity::Debug));
+    ui->severityFilter->addItem("Info", static_cast<int>(Log::Severity::Info));
+    ui->severityFilter->addItem("Warning", static_cast<int>(Log::Severity::Warning));
+    ui->severityFilter->addItem("Error", static_cast<int>(Log::Severity::Error));
+    ui->severityFilter->setCurrentIndex(1);
+
+    auto copyAction = new QAction("Copy", ui->mOutputView);
+    copyAction->setShortcut(QKeySequence::Copy);
+    copyAction->setShortcutContext(Qt::WidgetShortcut);
+    ui->mOutputView->addAction(copyAction);
+    ui->mOutputView->setContextMenuPolicy(Qt::ActionsContextMenu);
+    connect(copyAction, &QAction::triggered, this, &OutputWindow::copy_selection);
+
     connect(ui->clearText,
             &QPushButton::clicked,
             this,
             &OutputWindow::clear_text);
+
+    // new messages are shown in batches so a burst of output doesn't stall the GUI
+    m_refreshTimer = new QTimer(this);
+    connect(m_refreshTimer, &QTimer::timeout, this, &OutputWindow::refresh);
+    m_refreshTimer->start(100);
 }
 
 OutputWindow::~OutputWindow()
@@ -58,7 +83,36 @@ OutputWindow::~OutputWindow()
 
 void OutputWindow::clear_text()
 {
-    ui->mOutputText->clear();
+    m_model->clear();
+}
+
+void OutputWindow::refresh()
+{
+    std::vector<Log::Entry> entries = Log::Sink::instance().take_view_entries();
+    if (entries.empty()) return;
+
+    // the filter applies to new messages, everything is still written to the log file
+    const auto minSeverity = static_cast<Log::Severity>(ui->severityFilter->currentData().toInt());
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [minSeverity](const Log::Entry &e){return e.severity < minSeverity;}),
+                  entries.end());
+    if (entries.empty()) return;
+
+    // only follow the output if the user hasn't scrolled up
+    QScrollBar *scrollBar = ui->mOutputView->verticalScrollBar();
+    const bool atBottom = scrollBar->value() == scrollBar->maximum();
+    m_model->append(entries);
+    if (atBottom) ui->mOutputView->scrollToBottom();
+}
+
+void OutputWindow::copy_selection()
+{
+    QModelIndexList selected = ui->mOutputView->selectionModel()->selectedRows();
+    std::sort(selected.begin(), selected.end(),
+              [](const QModelIndex &a, const QModelIndex &b){return a.row() < b.row();});
+    QStringList lines;
+    for (const auto &index : selected) lines << index.data().toString();
+    QApplication::clipboard()->setText(lines.join('\n'));
 }
 
 #include "moc_outputwindow.cpp"
@@ -1,7 +1,9 @@
 #include "pcd.h"
 
 #include <QSerialPort>
+#include <QDateTime>
 #include <QDebug>
+#include "eventtimeline.h"
 
 namespace PCD
 {
@@ -10,12 +12,17 @@ Controller::Controller(const QString &portName, QObject *parent) :
     AsyncSerialDevice(portName, parent)
 {
     name = "Pressure Controller";
+    set_framer(std::make_unique<TerminatorFramer>('\r'));
     // connect timer for handling timeout errors
     connect(serialPort, &QSerialPort::readyRead, this, &Controller::handle_ready_read);
     connect(timer, &QTimer::timeout, this, &Controller::handle_timeout);
     connect(serialPort, &QSerialPort::errorOccurred, this, &Controller::handle_serial_error);
 
     serialPort->setBaudRate(QSerialPort::Baud19200);
+
+    qRegisterMetaType<PCD::PressureSample>("PCD::PressureSample");
+    telemetryTimer = new QTimer(this);
+    connect(telemetryTimer, &QTimer::timeout, this, &Controller::poll_pressure);
 }
 
 Controller::~Controller()
@@ -25,37 +32,50 @@ Controller::~Controller()
 
 void Controller::handle_ready_read()
 {
-    auto inData = serialPort->readAll();
-    readData.append(inData);
-    QString responseString = QString(readData).simplified();
+    read_serial_data();
 
-    if (!inData.contains("\r")) {return;}
-    switch (initState)
+    QByteArray frame;
+    while (take_response(frame))
     {
-    case NOT_INITIALIZED:
-        if (responseString == initString)
+        QString responseString = QString(frame).simplified();
+        switch (initState)
+        {
+        case NOT_INITIALIZED:
+            if (responseString == initString)
+            {
+                initState = INITIALIZED;
+                emit response(QString("Connected to %1").arg(name));
+                write_next();
+            }
+            else
+            {
+                emit error(QString("Unexpected response from device."
+                                   " Expected %1 from device but got %2")
+                           .arg(initString)
+                           .arg(responseString));
+                disconnect_serial();
+                return;
+            }
+            break;
+        case INITIALIZED:
         {
-            readData.clear();
-            initState = INITIALIZED;
-            emit response(QString("Connected to %1").arg(name));
+            // polls and set point commands are answered with a data frame
+            PressureSample sample;
+            if (parse_data_frame(responseString, sample))
+            {
+                {
+                    QMutexLocker lock(&mutex);
+                    history.push(sample);
+                }
+                Timeline::EventTimeline::instance().counter("pcd", "pressure (psig)", sample.pressure_psig);
+                emit pressure_sample_received(sample);
+            }
             write_next();
+            break;
         }
-        else
-        {
-            emit error(QString("Unexpected response from device."
-                               " Expected %1 from device but got %2")
-                       .arg(initString)
-                       .arg(responseString));
-            disconnect_serial();
+
+        default: break;
         }
-        break;
-    case INITIALIZED:
-        // handle response from PCD here
-        readData.clear();
-        write_next();
-        break;
-
-    default: break;
     }
 }
 
@@ -105,10 +125,82 @@ void Controller::disconnect_serial()
 
 void Controller::update_set_point(double setPoint_PSIG)
 {
+    {
+        QMutexLocker lock(&mutex);
+        setPoint_psig = setPoint_PSIG;
+    }
     QString command =  QString("%1s%2\r").arg((char)UNIT_ID).arg(setPoint_PSIG);
     write(command.toUtf8());
 }
 
+double Controller::set_point() const
+{
+    QMutexLocker lock(&mutex);
+    return setPoint_psig;
+}
+
+void Controller::set_telemetry_interval(int interval_ms)
+{
+    if (interval_ms > 0) telemetryTimer->start(interval_ms);
+    else telemetryTimer->stop();
+}
+
+int Controller::telemetry_interval() const
+{
+    return telemetryTimer->isActive() ? telemetryTimer->interval() : 0;
+}
+
+std::vector<PressureSample> Controller::pressure_history() const
+{
+    QMutexLocker lock(&mutex);
+    return history.to_vector();
+}
+
+void Controller::clear_pressure_history()
+{
+    QMutexLocker lock(&mutex);
+    history.clear();
+}
+
+void Controller::set_telemetry_command(const QString &pollCommand, QChar unitID)
+{
+    QMutexLocker lock(&mutex);
+    telemetryPoll = pollCommand;
+    telemetryUnitID = unitID;
+}
+
+void Controller::poll_pressure()
+{
+    // don't pile polls up behind a slow or busy controller
+    if (initState != INITIALIZED || num_in_flight() > 0) return;
+
+    QString poll;
+    {
+        QMutexLocker lock(&mutex);
+        poll = telemetryPoll;
+    }
+    write((poll + "\r").toUtf8());
+}
+
+bool Controller::parse_data_frame(const QString &frame, PressureSample &sample) const
+{
+    // "<unit ID> <pressure> <set point> ..." e.g. "A +001.25 +001.20"
+    const QStringList fields = frame.split(' '); // already simplified
+    QChar unitID;
+    {
+        QMutexLocker lock(&mutex);
+        unitID = telemetryUnitID;
+    }
+    if (fields.size() < 3 || fields[0].compare(QString(unitID), Qt::CaseInsensitive) != 0) return false;
+
+    bool pressureOk {false};
+    bool setPointOk {false};
+    sample.pressure_psig = fields[1].toDouble(&pressureOk);
+    sample.setPoint_psig = fields[2].toDouble(&setPointOk);
+    sample.time_ms = QDateTime::currentMSecsSinceEpoch();
+    return pressureOk && setPointOk;
+}
+
 void Controller::purge()
 {
     write(QString("%1\r").arg((char)PURGE_ON).toUtf8());
@@ -116,7 +208,7 @@ void Controller::purge()
 
 void Controller::stop_purge()
 {
-    write(QString("%1\r").arg((char)PURGE_OFF).toUtf8());
+    write(QString("%1\r").arg((char)PURGE_OFF).toUtf8(), Priority::Urgent);
 }
 
 void Controller::initialize_pressure_controller()
@@ -0,0 +1,115 @@
+#include "pressureregulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "printer.h"
+#include "pcd.h"
+#include "dmc4080.h"
+
+PressureRegulator::PressureRegulator(Printer *printer, QObject *parent) :
+    QObject(parent),
+    mPrinter(printer)
+{
+    m_reservoirTimer = new QTimer(this);
+    connect(m_reservoirTimer, &QTimer::timeout, this, &PressureRegulator::poll_reservoir);
+    // the axis is read on the message poller's thread so the GUI doesn't wait on the controller
+    connect(mPrinter->mcu->messagePoller, &GMessagePoller::position_read, this, &PressureRegulator::reservoir_position_read);
+}
+
+void PressureRegulator::start(const PressureRegulatorSettings &settings)
+{
+    m_settings = settings;
+    m_baseSetPoint_psig = mPrinter->pressureController->set_point();
+
+    if (m_settings.source == PressureRegulatorSettings::Source::ReservoirLevel)
+    {
+        if (!mPrinter->mcu->messagePoller->isRunning())
+        {
+            emit print_to_output_window("Pressure loop: motion controller not connected, can't read the reservoir axis");
+            return;
+        }
+        m_referenceKnown = false;
+        m_failedReads = 0;
+        poll_reservoir();
+        m_reservoirTimer->start(m_settings.reservoirPollInterval_ms);
+    }
+    else
+    {
+        emit print_to_output_window(QString("Pressure loop targeting %1 m/s from %2 psi")
+                                    .arg(m_settings.targetVelocity_m_s).arg(m_baseSetPoint_psig));
+    }
+    m_running = true;
+}
+
+void PressureRegulator::stop()
+{
+    if (!m_running) return;
+    m_reservoirTimer->stop();
+    m_running = false;
+    emit print_to_output_window(QString("Pressure loop stopped at %1 psi")
+                                .arg(mPrinter->pressureController->set_point()));
+}
+
+void PressureRegulator::droplet_velocity_measured(double velocity_m_s)
+{
+    if (!m_running || m_settings.source != PressureRegulatorSettings::Source::DropletVelocity) return;
+    if (velocity_m_s <= 0.0 || !std::isfinite(velocity_m_s)) return; // no droplet was tracked
+
+    // integral action, one step per measurement
+    const double error = m_settings.targetVelocity_m_s - velocity_m_s;
+    const double step = std::clamp(m_settings.velocityGain * error, -m_settings.maxStep_psi, m_settings.maxStep_psi);
+    apply_set_point(mPrinter->pressureController->set_point() + step);
+}
+
+void PressureRegulator::poll_reservoir()
+{
+    mPrinter->mcu->messagePoller->read_position('E');
+}
+
+void PressureRegulator::reservoir_position_read(char axis, int counts, bool ok)
+{
+    if (!m_running || axis != 'E' || m_settings.source != PressureRegulatorSettings::Source::ReservoirLevel) return;
+
+    if (!ok)
+    {
+        // a missed reading leaves the set point where it is, a string of them stops the loop
+        if (++m_failedReads >= 5)
+        {
+            emit print_to_output_window("Pressure loop: can't read the reservoir axis");
+            stop();
+        }
+        return;
+    }
+    m_failedReads = 0;
+
+    const double position_mm = counts / (double)R_CNTS_PER_MM;
+    if (!m_referenceKnown)
+    {
+        m_referencePosition_mm = position_mm;
+        m_referenceKnown = true;
+        emit print_to_output_window(QString("Pressure loop following the reservoir axis from %1 mm at %2 psi")
+                                    .arg(m_referencePosition_mm, 0, 'f', 2).arg(m_baseSetPoint_psig));
+        return;
+    }
+
+    // the set point follows the head change, but never jumps more than maxStep per poll
+    const double target = m_baseSetPoint_psig + m_settings.reservoirGain * (position_mm - m_referencePosition_mm);
+    const double current = mPrinter->pressureController->set_point();
+    const double step = std::clamp(target - current, -m_settings.maxStep_psi, m_settings.maxStep_psi);
+    if (std::abs(step) < 0.001) return; // below the controller's resolution
+    apply_set_point(current + step);
+}
+
+void PressureRegulator::apply_set_point(double setPoint_psig)
+{
+    setPoint_psig = std::clamp(setPoint_psig, m_settings.minSetPoint_psig, m_settings.maxSetPoint_psig);
+    // round to what the controller is sent with
+    setPoint_psig = std::round(setPoint_psig * 1000.0) / 1000.0;
+    if (setPoint_psig == mPrinter->pressureController->set_point()) return;
+
+    mPrinter->pressureController->update_set_point(setPoint_psig);
+    emit set_point_changed(setPoint_psig);
+}
+
+#include "moc_pressureregulator.cpp"
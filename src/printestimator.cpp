@@ -0,0 +1,221 @@
+#include "printestimator.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+QString format_duration(double seconds)
+{
+    const long long s = std::llround(std::max(0.0, seconds));
+    if (s >= 3600) return QString("%1 h %2 min").arg(s / 3600).arg((s % 3600) / 60, 2, 10, QChar('0'));
+    if (s >= 60) return QString("%1 min %2 s").arg(s / 60).arg(s % 60, 2, 10, QChar('0'));
+    return QString("%1 s").arg(s);
+}
+
+}
+
+double JobEstimate::total_s() const
+{
+    double total = 0.0;
+    for (const auto &layer : layers) total += layer.total_s();
+    return total;
+}
+
+LayerEstimate JobEstimate::sum() const
+{
+    LayerEstimate sum;
+    for (const auto &layer : layers)
+    {
+        sum.passes += layer.passes;
+        sum.recoat_s += layer.recoat_s;
+        sum.travel_s += layer.travel_s;
+        sum.upload_s += layer.upload_s;
+        sum.printing_s += layer.printing_s;
+        sum.overhead_s += layer.overhead_s;
+    }
+    return sum;
+}
+
+QString JobEstimate::summary() const
+{
+    const LayerEstimate s = sum();
+    const double total = std::max(s.total_s(), 1e-9);
+    auto part = [total](const char *name, double t)
+    {
+        return QString("%1 %2 (%3%)").arg(name, format_duration(t)).arg(qRound(100.0 * t / total));
+    };
+
+    // the slowest layer is where shortening passes or travel pays off most
+    auto slowest = std::max_element(layers.begin(), layers.end(), [](const LayerEstimate &a, const LayerEstimate &b)
+    {
+        return a.total_s() < b.total_s();
+    });
+
+    QString text = QString("Estimated %1 for %2 layers, %3 passes\n").arg(format_duration(s.total_s())).arg(layers.size()).arg(s.passes);
+    text += part("recoat", s.recoat_s) + ", " + part("travel", s.travel_s) + ", " + part("upload", s.upload_s) + ",\n"
+            + part("printing", s.printing_s) + ", " + part("overhead", s.overhead_s);
+    if (slowest != layers.end())
+        text += QString("\nSlowest layer %1: %2 over %3 passes").arg(slowest->layer).arg(format_duration(slowest->total_s())).arg(slowest->passes);
+    return text;
+}
+
+bool JobEstimate::write_csv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream out(&file);
+    out << "layer,passes,recoat_s,travel_s,upload_s,printing_s,overhead_s,total_s\n";
+    for (const auto &l : layers)
+    {
+        out << l.layer << "," << l.passes << ","
+            << QString::number(l.recoat_s, 'f', 2) << "," << QString::number(l.travel_s, 'f', 2) << ","
+            << QString::number(l.upload_s, 'f', 2) << "," << QString::number(l.printing_s, 'f', 2) << ","
+            << QString::number(l.overhead_s, 'f', 2) << "," << QString::number(l.total_s(), 'f', 2) << "\n";
+    }
+    return out.status() == QTextStream::Ok;
+}
+
+PrintEstimator::PrintEstimator(const PrintEstimatorSettings &settings, const RecoatSettings &recoat, const RecoatPlanner &recoatPlanner) :
+    m_settings(settings),
+    m_recoat(recoat),
+    m_recoatPlanner(recoatPlanner)
+{
+}
+
+double PrintEstimator::move_time(double distance_mm, double speed_mm_s, double acceleration_mm_s2, double deceleration_mm_s2)
+{
+    distance_mm = std::abs(distance_mm);
+    speed_mm_s = std::abs(speed_mm_s);
+    if (distance_mm <= 0.0 || speed_mm_s <= 0.0 || acceleration_mm_s2 <= 0.0 || deceleration_mm_s2 <= 0.0) return 0.0;
+
+    // trapezoid, or a triangle if the move is too short to reach full speed
+    const double rampDistance = speed_mm_s * speed_mm_s * (0.5 / acceleration_mm_s2 + 0.5 / deceleration_mm_s2);
+    if (distance_mm >= rampDistance)
+        return speed_mm_s / acceleration_mm_s2 + speed_mm_s / deceleration_mm_s2 + (distance_mm - rampDistance) / speed_mm_s;
+
+    const double peak = std::sqrt(2.0 * distance_mm * acceleration_mm_s2 * deceleration_mm_s2 / (acceleration_mm_s2 + deceleration_mm_s2));
+    return peak / acceleration_mm_s2 + peak / deceleration_mm_s2;
+}
+
+LayerEstimate PrintEstimator::estimate_layer(int layer, const std::vector<PassPlan> &passes, double &x_mm, double &y_mm) const
+{
+    const PrintEstimatorSettings &s = m_settings;
+    LayerEstimate e;
+    e.layer = layer;
+    e.passes = static_cast<int>(passes.size());
+
+    // every layer after the first parks the heads and recoats (PrintJob::start_recoat)
+    if (layer > 1)
+    {
+        const RecoatPlan recoat = m_recoatPlanner.plan(m_recoat, y_mm);
+        e.recoat_s = move_time(x_mm - s.parkX_mm, s.moveXSpeed_mm_s, s.moveXAcceleration_mm_s2, s.moveXAcceleration_mm_s2)
+                     + 2.0 * s.programStart_s + 0.1 + recoat.cycle_s;
+        x_mm = s.parkX_mm;
+        y_mm = std::isnan(recoat.endY_mm) ? s.yAfterRecoat_mm : recoat.endY_mm;
+    }
+
+    const double runway = s.printSpeed_mm_s * s.printSpeed_mm_s / (2.0 * s.printAcceleration_mm_s2) * s.runwaySafetyFactor;
+    for (const PassPlan &pass : passes)
+    {
+        const double printDistance = pass.columns / s.printFrequency_Hz * s.printSpeed_mm_s;
+        double start {0.0}, end {0.0};
+        if (pass.reversed)
+        {
+            const double right = pass.startX_mm + printDistance;
+            start = right + runway;
+            end = std::max(0.0, right - printDistance - runway);
+        }
+        else
+        {
+            const double left = (pass.startX_mm - runway < 0.0) ? 0.0 : pass.startX_mm;
+            start = left - runway;
+            end = left + printDistance + runway;
+        }
+
+        e.travel_s += move_time(pass.y_mm - y_mm, s.moveYSpeed_mm_s, s.moveYAcceleration_mm_s2, s.moveYAcceleration_mm_s2)
+                      + move_time(start - x_mm, s.moveXSpeed_mm_s, s.moveXAcceleration_mm_s2, s.moveXAcceleration_mm_s2);
+        e.upload_s += pass.uploadBytes * 10.0 / s.serialBaud;
+        e.printing_s += move_time(end - start, s.printSpeed_mm_s, s.printAcceleration_mm_s2, s.printAcceleration_mm_s2);
+        e.overhead_s += 2.0 * s.programStart_s + s.passSleeps_s + pass.headsLoaded * s.headStatusCheck_s;
+
+        x_mm = end;
+        y_mm = pass.y_mm;
+    }
+    return e;
+}
+
+JobEstimate PrintEstimator::estimate(const std::vector<PassPlan> &passes, int layerCount) const
+{
+    JobEstimate job;
+    double x = m_settings.parkX_mm;
+    double y = m_settings.yAfterRecoat_mm;
+
+    auto next = passes.begin();
+    for (int layer = 1; layer <= layerCount; layer++)
+    {
+        auto end = std::find_if(next, passes.end(), [layer](const PassPlan &p) {return p.layer != layer;});
+        job.layers.push_back(estimate_layer(layer, std::vector<PassPlan>(next, end), x, y));
+        next = end;
+    }
+    return job;
+}
+
+void EtaTracker::start(const JobEstimate &estimate)
+{
+    m_estimated_s.clear();
+    for (const auto &layer : estimate.layers) m_estimated_s.push_back(layer.total_s());
+    m_finished.assign(m_estimated_s.size(), false);
+    m_finishedEstimate_s = 0.0;
+    m_finishedMeasured_s = 0.0;
+}
+
+void EtaTracker::set_layer_estimate(const LayerEstimate &layer)
+{
+    if (layer.layer < 1 || layer.layer > static_cast<int>(m_estimated_s.size())) return;
+    m_estimated_s[layer.layer - 1] = layer.total_s();
+}
+
+void EtaTracker::layer_finished(int layer, double measured_s)
+{
+    if (layer < 1 || layer > static_cast<int>(m_estimated_s.size()) || m_finished[layer - 1]) return;
+    m_finished[layer - 1] = true;
+    m_finishedEstimate_s += m_estimated_s[layer - 1];
+    m_finishedMeasured_s += measured_s;
+}
+
+double EtaTracker::correction() const
+{
+    if (m_finishedEstimate_s <= 0.0) return 1.0;
+    return m_finishedMeasured_s / m_finishedEstimate_s;
+}
+
+double EtaTracker::remaining_s() const
+{
+    // layers without an estimate yet (0) count as the average of those that have one
+    double known = 0.0;
+    int knownCount = 0;
+    for (double t : m_estimated_s)
+    {
+        if (t <= 0.0) continue;
+        known += t;
+        knownCount++;
+    }
+    const double average = knownCount ? known / knownCount : 0.0;
+
+    double remaining = 0.0;
+    for (size_t i = 0; i < m_estimated_s.size(); i++)
+    {
+        if (!m_finished[i]) remaining += (m_estimated_s[i] > 0.0) ? m_estimated_s[i] : average;
+    }
+    return remaining * correction();
+}
+
+QString EtaTracker::status_text() const
+{
+    return QString("About %1 left (x%2 of estimate)").arg(format_duration(remaining_s())).arg(correction(), 0, 'f', 2);
+}
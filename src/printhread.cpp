@@ -5,6 +5,7 @@
 #include "gclibo.h"
 #include "gclib_errors.h"
 #include "gclib_record.h"
+#include "eventtimeline.h"
 
 #include <QDebug>
 
@@ -42,6 +43,7 @@ void PrintThread::setup(DMC4080 *printer)
 
 void PrintThread::stop()
 {
+    emit stopped();
     mutex.lock();
     running = false;
     mutex.unlock();
@@ -54,13 +56,13 @@ void PrintThread::print_gcmds(bool print)
     mutex.unlock();
 }
 
-void PrintThread::execute_command(std::stringstream &ss)
+bool PrintThread::execute_command(std::stringstream &ss)
 {
     const QMutexLocker locker(&mutex);
     if (queue.size() != 0) // if the queue is not empty
     {
         emit error("command queue was not empty when new commands were attempted");
-        return;
+        return false;
     }
 
     // start or wake the thread
@@ -73,6 +75,7 @@ void PrintThread::execute_command(std::stringstream &ss)
     { start(); } // start a new thread if one has not been created before
     else
     { waitCondition.wakeOne(); } // else wake the thread
+    return true;
 }
 
 void PrintThread::clear_queue()
@@ -85,6 +88,7 @@ void PrintThread::clear_queue()
 
 void PrintThread::run()
 {
+    Timeline::EventTimeline::name_current_thread("Print Thread");
     while (!mQuit)
     {
         while (queue.size() > 0)
@@ -122,6 +126,8 @@ void PrintThread::run()
                     commandString = "";
                 }
 
+                // covers the command until the controller is done with it (e.g. the whole motion for GMotionComplete)
+                Timeline::ScopedEvent timelineEvent("motion", commandType, commandString);
 
                 if (commandType == "GCmd")
                 {
@@ -253,8 +259,9 @@ void PrintThread::run()
 
         emit ended();
         mutex.lock();
-        // wait until thread is woken again by transaction call
-        waitCondition.wait(&mutex);
+        // wait until thread is woken again by transaction call, unless one came in
+        // between ended() and here (whoever waits on ended() can send the next commands straight away)
+        if (queue.empty() && !mQuit) waitCondition.wait(&mutex);
         // Once the thread is woken again
         running = true;
         mutex.unlock();
@@ -0,0 +1,1209 @@
+#include "printjob.h"
+
+#include "dmc4080.h"
+#include "gmessagepoller.h"
+#include "mjdriver.h"
+#include "printer.h"
+#include "printhread.h"
+
+#include <QImage>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FolderJobSource::FolderJobSource(Added_Scientific::Controller *controller, std::vector<PassPlan> plan, QStringList passFiles, int headGapColumns, int layerCount) :
+    m_controller(controller),
+    m_plan(std::move(plan)),
+    m_passFiles(std::move(passFiles)),
+    m_headGapColumns(headGapColumns),
+    m_layerCount(layerCount)
+{
+
+}
+
+PrintJobSource::Next FolderJobSource::next_layer(JobLayer &layer, QString &error)
+{
+    if (m_next >= m_plan.size()) return Next::Finished;
+
+    layer = JobLayer();
+    layer.layer = m_plan[m_next].layer;
+    for (; m_next < m_plan.size() && m_plan[m_next].layer == layer.layer; m_next++)
+    {
+        const PassPlan &plan = m_plan[m_next];
+        QImage image(m_passFiles[static_cast<int>(m_next)]);
+        if (image.isNull())
+        {
+            error = QString("Failed to load image from %1").arg(m_passFiles[static_cast<int>(m_next)]);
+            return Next::Failed;
+        }
+
+        // as read_in_file sends it: head 1 leads in with the gap going +X, head 2 going -X
+        // where the image goes last column first
+        if (plan.reversed) image = image.mirrored(true, false);
+        JobPass pass;
+        pass.plan = plan;
+        pass.head1 = m_controller->convert_image(1, image, plan.reversed ? 0 : m_headGapColumns);
+        pass.head2 = m_controller->convert_image(2, image, plan.reversed ? m_headGapColumns : 0);
+        layer.passes.push_back(std::move(pass));
+    }
+    return Next::Ready;
+}
+
+void FolderJobSource::skip_layers_before(int layer)
+{
+    while (m_next < m_plan.size() && m_plan[m_next].layer < layer) m_next++;
+}
+
+// ====================================================================
+
+StreamingJobSource::StreamingJobSource(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job,
+                                       const Slicer::PipelineSettings &settings, Planner planner) :
+    m_pipeline(std::move(slicer), job, settings),
+    m_planner(std::move(planner))
+{
+
+}
+
+bool StreamingJobSource::start(QString &error)
+{
+    std::string pipelineError;
+    if (m_pipeline.start(pipelineError)) return true;
+    error = QString("Could not start slicing: %1").arg(QString::fromStdString(pipelineError));
+    return false;
+}
+
+void StreamingJobSource::stop()
+{
+    m_pipeline.stop();
+}
+
+PrintJobSource::Next StreamingJobSource::next_layer(JobLayer &layer, QString &error)
+{
+    Slicer::PreparedLayer prepared;
+    if (!m_pipeline.try_next(prepared))
+    {
+        if (m_pipeline.failed())
+        {
+            error = QString("Slicing failed: %1").arg(QString::fromStdString(m_pipeline.error()));
+            return Next::Failed;
+        }
+        return m_pipeline.finished() ? Next::Finished : Next::Waiting;
+    }
+
+    const std::vector<PassPlan> plan = m_planner(prepared);
+    layer = JobLayer();
+    layer.layer = prepared.index + 1;
+    for (size_t i = 0; i < prepared.passes.size(); i++)
+    {
+        const Slicer::PreparedPass &p = prepared.passes[i];
+        JobPass pass;
+        pass.plan = plan[i];
+        pass.head1 = QByteArray(reinterpret_cast<const char *>(p.head1.data()), static_cast<int>(p.head1.size()));
+        pass.head2 = QByteArray(reinterpret_cast<const char *>(p.head2.data()), static_cast<int>(p.head2.size()));
+        layer.passes.push_back(std::move(pass));
+    }
+    return Next::Ready;
+}
+
+// ====================================================================
+
+PrintJob::PrintJob(Printer *printer) :
+    QObject(),
+    m_printer(printer)
+{
+    qRegisterMetaType<PrintJob::Result>("PrintJob::Result");
+
+    // made before the move so it goes to the job's thread with it
+    m_headTimer = new QTimer(this);
+    m_headTimer->setSingleShot(true);
+    connect(m_headTimer, &QTimer::timeout, this, &PrintJob::head_timeout);
+    m_settleTimer = new QTimer(this);
+    m_settleTimer->setSingleShot(true);
+    connect(m_settleTimer, &QTimer::timeout, this, &PrintJob::settled);
+    m_layerProgramTimer = new QTimer(this);
+    m_layerProgramTimer->setSingleShot(true);
+    m_layerProgramTimer->setInterval(60000);
+    connect(m_layerProgramTimer, &QTimer::timeout, this, &PrintJob::layer_program_timeout);
+
+    // queued onto the job's thread
+    connect(m_printer->mcu->printerThread, &PrintThread::stopped, this, &PrintJob::motion_stopped);
+    connect(m_printer->mcu->printerThread, &PrintThread::ended, this, &PrintJob::motion_finished);
+    connect(m_printer->mjController, &AsyncSerialDevice::response, this, &PrintJob::head_response);
+    connect(m_printer->mjController, &AsyncSerialDevice::bulk_write_failed, this, &PrintJob::head_upload_failed);
+    connect(m_printer->mcu->messagePoller, &GMessagePoller::message, this, &PrintJob::controller_message);
+
+    m_thread.reset(new QThread);
+    m_thread->setObjectName("Print Job Thread");
+    moveToThread(m_thread.get());
+    m_thread->start();
+}
+
+PrintJob::~PrintJob()
+{
+    QMetaObject::invokeMethod(this, "cleanup");
+    m_thread->wait();
+}
+
+void PrintJob::cleanup()
+{
+    if (m_source) m_source->stop();
+    m_thread->quit();
+}
+
+void PrintJob::start(std::shared_ptr<PrintJobSource> source, const PrintJobSettings &settings, const JobCheckpoint &resumeAfter)
+{
+    if (m_state != State::Idle && m_state != State::Finished)
+    {
+        message("ERROR: A print job is already running");
+        return;
+    }
+
+    m_source = std::move(source);
+    m_settings = settings;
+    m_resumeAfter = resumeAfter;
+    m_checkpoint = resumeAfter;
+    m_pauseRequested = false;
+    m_cancelRequested = false;
+    m_finishing = false;
+    m_motionStopped = false;
+    m_afterMotion = nullptr;
+    m_afterSettle = nullptr;
+    m_afterHeads = nullptr;
+    m_afterPark = State::Idle;
+    m_layer = JobLayer();
+    m_next = JobLayer();
+    m_passIndex = 0;
+    m_nextReady = false;
+    m_sourceDone = false;
+    m_recoating = false;
+    m_loadingHeads = false;
+    m_headsPreloaded = false;
+    m_layerProgramRunning = false;
+    // the powder for layer 1, or for the layer the job stopped in, is already down
+    m_recoatedLayer = std::max(1, m_resumeAfter.layer);
+    m_eta.start(m_settings.estimate);
+    m_estimateX_mm = m_settings.estimator.settings().parkX_mm;
+    m_estimateY_mm = m_settings.estimator.settings().yAfterRecoat_mm;
+    m_jobTimer.start();
+    m_layerTimer.start();
+    set_state(State::WaitingForLayer);
+
+    QString error;
+    if (!m_source->start(error))
+    {
+        finish(Result::Failed, error);
+        return;
+    }
+    if (!m_settings.journalPath.isEmpty())
+    {
+        // a job that can't keep its journal still prints, it just can't be resumed after a crash
+        if (m_journal.open(m_settings.journalPath, m_settings.jobName, m_source->layer_count(), error))
+        {
+            message(QString("Print journal: %1").arg(m_settings.journalPath));
+        }
+        else
+        {
+            message(QString("WARNING: No print journal for this job, %1").arg(error));
+        }
+    }
+    if (m_resumeAfter.layer > 0)
+    {
+        message(QString("--- Resuming after layer %1 pass %2 ---").arg(m_resumeAfter.layer).arg(m_resumeAfter.pass));
+        m_source->skip_layers_before(m_resumeAfter.layer);
+    }
+    m_z_mm = z_position_mm();
+    // the recoat settings aren't checked on a resume, the journal keeps them for the record
+    const RecoatProfile &profile = m_settings.estimator.recoat_planner().profile();
+    const QString rollerOffset = std::isnan(profile.rollerOffsetY_mm) ? QString("unknown") : QString("%1 mm").arg(profile.rollerOffsetY_mm, 0, 'f', 2);
+    journal(m_resumeAfter.layer > 0 ? "resume" : "start",
+            QString("roller Y offset %1, fast roller speed %2 mm/s").arg(rollerOffset).arg(profile.rollerFastSpeed_mm_s));
+    fetch_layer();
+}
+
+void PrintJob::pause()
+{
+    if (m_state == State::Idle || m_state == State::Finished || m_state == State::Paused) return;
+    m_pauseRequested = true;
+    message("--- PAUSE REQUESTED, pausing after this layer ---");
+}
+
+void PrintJob::resume()
+{
+    m_pauseRequested = false;
+    if (m_state != State::Paused) return;
+
+    message(QString("--- Resuming after layer %1 ---").arg(m_layer.layer));
+    journal("resumed");
+    emit paused_changed(false);
+    continue_after_layer();
+}
+
+void PrintJob::cancel()
+{
+    if (m_state == State::Idle || m_state == State::Finished) return;
+    m_cancelRequested = true;
+    message("--- CANCELLATION REQUESTED ---");
+    emit status_changed("Cancelling print job, please wait...");
+    stop_layer_program();
+
+    // otherwise the job stops at the end of the current pass
+    if (m_state == State::Paused) finish(Result::Cancelled);
+}
+
+void PrintJob::continue_after_layer()
+{
+    // the next layer is read in, converted and planned while the roller runs,
+    // and its first pass goes to the heads before the recoat is done
+    m_nextReady = false;
+    m_sourceDone = false;
+    m_headsPreloaded = false;
+    m_layerTimer.start();
+    set_state(State::WaitingForLayer);
+    if (m_layer.layer < m_source->layer_count()) start_recoat();
+    fetch_layer();
+}
+
+void PrintJob::fetch_layer()
+{
+    if (m_finishing) return;
+    if (m_cancelRequested && !m_recoating)
+    {
+        finish(Result::Cancelled);
+        return;
+    }
+
+    QString error;
+    switch (m_source->next_layer(m_next, error))
+    {
+    case PrintJobSource::Next::Waiting:
+        // the next layer is still being sliced
+        if (!m_recoating) emit status_changed(QString("Layer %1 / %2\nSlicing...").arg(m_checkpoint.layer + 1).arg(m_source->layer_count()));
+        QTimer::singleShot(50, this, &PrintJob::fetch_layer);
+        return;
+    case PrintJobSource::Next::Finished:
+        m_sourceDone = true;
+        break;
+    case PrintJobSource::Next::Failed:
+        finish(Result::Failed, error);
+        return;
+    case PrintJobSource::Next::Ready:
+        if (m_next.layer < m_resumeAfter.layer)
+        {
+            // a streamed job slices the layers that were already printed
+            QMetaObject::invokeMethod(this, &PrintJob::fetch_layer, Qt::QueuedConnection);
+            return;
+        }
+        if (m_next.layer == m_resumeAfter.layer)
+        {
+            // the layer a resumed job stopped in has some of its passes already
+            auto printed = [this](const JobPass &pass) {return pass.plan.pass <= m_resumeAfter.pass;};
+            m_next.passes.erase(std::remove_if(m_next.passes.begin(), m_next.passes.end(), printed), m_next.passes.end());
+        }
+        if (!prepare_layer(m_next, error))
+        {
+            finish(Result::Failed, error);
+            return;
+        }
+        m_nextReady = true;
+        break;
+    }
+    layer_arrived();
+}
+
+bool PrintJob::prepare_layer(JobLayer &layer, QString &error) const
+{
+    const PrintEstimatorSettings &motion = m_settings.estimator.settings();
+    const double speed = m_settings.printSpeed_mm_s;
+    const double runway = (std::pow(speed, 2.0) / (2.0 * motion.printAcceleration_mm_s2)) * motion.runwaySafetyFactor;
+
+    for (JobPass &pass : layer.passes)
+    {
+        const PassPlan &plan = pass.plan;
+        if (plan.columns <= 0 || (pass.head1.isEmpty() && pass.head2.isEmpty()))
+        {
+            error = QString("layer %1 pass %2 has no image data").arg(plan.layer).arg(plan.pass);
+            return false;
+        }
+        if (std::abs(plan.y_mm) > Y_STAGE_LEN_MM)
+        {
+            error = QString("layer %1 pass %2 is at Y=%3mm, off the stage").arg(plan.layer).arg(plan.pass).arg(plan.y_mm);
+            return false;
+        }
+
+        // same runway and clamps as MJPrintheadWidget::runEncoderPass
+        pass.runway_mm = runway;
+        const double printDistance = (static_cast<double>(plan.columns) / m_settings.printFrequency_Hz) * speed;
+        double xLocation = plan.startX_mm;
+        if (plan.reversed)
+        {
+            xLocation += printDistance + m_settings.reverseOffset_mm;
+            pass.startX_mm = xLocation + runway;
+            pass.endX_mm = xLocation - printDistance - runway;
+            if (pass.endX_mm < 0.0)
+            {
+                pass.warnings << "WARNING: Reverse pass ends below 0.0mm. Stopping at 0.0mm";
+                pass.endX_mm = 0.0;
+            }
+        }
+        else
+        {
+            if ((xLocation - runway) < 0.0)
+            {
+                pass.warnings << "WARNING: Start X too low. Shifting to 0.0mm";
+                xLocation = 0.0;
+            }
+            pass.startX_mm = xLocation - runway;
+            pass.endX_mm = xLocation + printDistance + runway;
+        }
+        if (std::max(pass.startX_mm, pass.endX_mm) > X_STAGE_LEN_MM)
+        {
+            pass.warnings << QString("WARNING: Pass runs to X=%1mm, past the end of the stage").arg(std::max(pass.startX_mm, pass.endX_mm));
+        }
+
+        // as moveToLocation, Y then X
+        std::stringstream move;
+        move << CMD::set_accleration(Axis::Y, motion.moveYAcceleration_mm_s2);
+        move << CMD::set_deceleration(Axis::Y, motion.moveYAcceleration_mm_s2);
+        move << CMD::set_speed(Axis::Y, motion.moveYSpeed_mm_s);
+        move << CMD::position_absolute(Axis::Y, plan.y_mm);
+        move << CMD::begin_motion(Axis::Y);
+        move << CMD::after_motion(Axis::Y);
+        move << CMD::set_accleration(Axis::X, motion.moveXAcceleration_mm_s2);
+        move << CMD::set_deceleration(Axis::X, motion.moveXAcceleration_mm_s2);
+        move << CMD::set_speed(Axis::X, motion.moveXSpeed_mm_s);
+        move << CMD::position_absolute(Axis::X, pass.startX_mm);
+        move << CMD::begin_motion(Axis::X);
+        move << CMD::after_motion(Axis::X);
+        pass.moveProgram = CMD::cmd_buf_to_dmc(move);
+
+        // as printEnc, a -X pass holds the MJ direction output high while it moves
+        std::stringstream print;
+        print << CMD::set_accleration(Axis::X, motion.printAcceleration_mm_s2);
+        print << CMD::set_deceleration(Axis::X, motion.printAcceleration_mm_s2);
+        print << CMD::set_speed(Axis::X, speed);
+        print << CMD::position_absolute(Axis::X, pass.endX_mm);
+        if (plan.reversed) print << CMD::start_MJ_dir();
+        print << CMD::begin_motion(Axis::X);
+        print << CMD::after_motion(Axis::X);
+        if (plan.reversed) print << CMD::disable_MJ_dir();
+        pass.printProgram = CMD::cmd_buf_to_dmc(print);
+    }
+    if (m_settings.controllerSequenced) layer.program = layer_program(layer);
+    return true;
+}
+
+void PrintJob::layer_arrived()
+{
+    if (m_finishing) return;
+
+    // the layer starts once it is ready and the recoat and head loading are done
+    if (m_recoating || m_loadingHeads)
+    {
+        if (m_recoating && m_nextReady && !m_loadingHeads && !m_headsPreloaded && !m_next.passes.empty()) preload_heads();
+        return;
+    }
+    if (m_cancelRequested)
+    {
+        finish(Result::Cancelled);
+        return;
+    }
+    if (!m_nextReady)
+    {
+        if (m_sourceDone) finish(Result::Complete);
+        return;
+    }
+
+    // every layer after the first gets powder, even a blank one or one
+    // that has no bitmaps in a job folder
+    if (m_next.layer > m_recoatedLayer)
+    {
+        start_recoat();
+        return;
+    }
+    begin_layer();
+}
+
+void PrintJob::begin_layer()
+{
+    m_layer = std::move(m_next);
+    m_next = JobLayer();
+    m_nextReady = false;
+
+    if (m_settings.estimateLayers)
+    {
+        std::vector<PassPlan> plan;
+        for (const JobPass &pass : m_layer.passes) plan.push_back(pass.plan);
+        m_eta.set_layer_estimate(m_settings.estimator.estimate_layer(m_layer.layer, plan, m_estimateX_mm, m_estimateY_mm));
+    }
+    m_passIndex = 0;
+
+    emit layer_started(m_layer.layer, m_source->layer_count());
+    message(QString("--- Starting Layer %1 (%2 passes) ---").arg(m_layer.layer).arg(m_layer.passes.size()));
+    start_pass();
+}
+
+void PrintJob::start_recoat()
+{
+    m_recoating = true;
+    message("Moving nozzle to park position for recoat.");
+    park(State::Recoating);
+}
+
+void PrintJob::recoat()
+{
+    // planned from where Y really is, so the return is only as long as it has to be
+    const RecoatPlan plan = m_settings.estimator.recoat_planner().plan(m_settings.recoat, y_position_mm());
+    message("Performing recoat operation...");
+    message(plan.summary());
+    run_program(plan.program, State::Recoating, [this]() {recoat_done();});
+}
+
+void PrintJob::recoat_done()
+{
+    m_recoating = false;
+    m_recoatedLayer++;
+
+    // the recoat ends a fixed distance from where the back limit stopped Y,
+    // the next one moves back most of the way without jogging into the switch
+    RecoatProfile &profile = m_settings.estimator.recoat_planner().profile();
+    const double y = y_position_mm();
+    if (!std::isnan(y))
+    {
+        if (std::isnan(profile.backLimitY_mm)) message(QString("Back limit found at Y %1 mm").arg(y - profile.hopperTravel_mm - profile.rollerTravel_mm, 0, 'f', 2));
+        profile.backLimitY_mm = y - profile.hopperTravel_mm - profile.rollerTravel_mm;
+    }
+
+    // Z only moves in the recoat, the journal uses this until the next one
+    m_z_mm = z_position_mm();
+
+    // the layer has its powder, a resumed job must not recoat it again
+    m_checkpoint = {m_recoatedLayer, 0};
+    journal("recoat");
+    emit checkpoint_reached(m_checkpoint.layer, m_checkpoint.pass);
+    layer_arrived();
+}
+
+void PrintJob::start_pass()
+{
+    if (m_finishing) return;
+    if (m_cancelRequested)
+    {
+        finish(Result::Cancelled);
+        return;
+    }
+    if (m_passIndex >= m_layer.passes.size())
+    {
+        layer_done();
+        return;
+    }
+
+    const JobPass &pass = current_pass();
+    announce_pass();
+
+    // the first pass of a layer went to the heads during the recoat
+    auto next = [this]()
+    {
+        if (m_settings.controllerSequenced) start_layer_program();
+        else move_to_start();
+    };
+    if (m_headsPreloaded)
+    {
+        m_headsPreloaded = false;
+        next();
+        return;
+    }
+    set_state(State::LoadingHeads);
+    load_heads(pass, [this, next]() {settle(50, next);});
+}
+
+void PrintJob::announce_pass()
+{
+    const JobPass &pass = current_pass();
+    emit status_changed(QString("Layer %1 / %2\nPrinting Pass: %3\n%4")
+                            .arg(m_layer.layer).arg(m_source->layer_count()).arg(pass.plan.pass).arg(m_eta.status_text()));
+    message(QString("Printing Pass %1 at Y=%2mm, X=%3mm over %4 columns (%5)")
+                .arg(pass.plan.pass).arg(pass.plan.y_mm + Y_HEAD_OFFSET).arg(pass.plan.startX_mm).arg(pass.plan.columns)
+                .arg(pass.head1.isEmpty() ? "head 2" : pass.head2.isEmpty() ? "head 1" : "both heads"));
+}
+
+void PrintJob::preload_heads()
+{
+    const JobPass &pass = m_next.passes.front();
+    message(QString("Loading layer %1 pass %2 into the heads during the recoat").arg(pass.plan.layer).arg(pass.plan.pass));
+    load_heads(pass, [this]()
+    {
+        m_headsPreloaded = true;
+        layer_arrived();
+    });
+}
+
+void PrintJob::load_heads(const JobPass &pass, std::function<void()> done)
+{
+    // a head with nothing to print gets no data, clear what it held from the last pass
+    m_headData.clear();
+    for (const QByteArray &data : {pass.head1, pass.head2})
+    {
+        if (!data.isEmpty()) m_headData.push_back(data);
+    }
+    m_headPlan = pass.plan;
+    m_headAttempt = 0;
+    m_afterHeads = std::move(done);
+    reload_heads();
+}
+
+void PrintJob::reload_heads()
+{
+    m_loadingHeads = true;
+    m_headsToLoad = m_headData;
+    const int frequency = static_cast<int>(m_settings.printFrequency_Hz);
+    on_controller([frequency](Added_Scientific::Controller *controller)
+    {
+        controller->write_line("M 4");
+        controller->set_printing_frequency(frequency);
+        controller->clear_all_heads_of_data();
+    }, [this]() {send_head();});
+}
+
+void PrintJob::send_head()
+{
+    if (m_finishing) return;
+    if (m_headsToLoad.empty())
+    {
+        m_loadingHeads = false;
+        std::function<void()> next = std::move(m_afterHeads);
+        m_afterHeads = nullptr;
+        if (next) next();
+        return;
+    }
+
+    const QByteArray data = m_headsToLoad.front();
+    const int upload = ++m_headUpload;
+    on_controller([data](Added_Scientific::Controller *controller)
+    {
+        controller->send_packed_image_data(data);
+    }, [this, upload]()
+    {
+        if (upload == m_headUpload) request_head_status();
+    });
+}
+
+void PrintJob::request_head_status()
+{
+    if (m_finishing) return;
+    on_controller([](Added_Scientific::Controller *controller)
+    {
+        controller->request_status_of_all_heads();
+    });
+    m_headTimer->start(2000);
+}
+
+void PrintJob::head_response(const QString &response)
+{
+    if (!m_loadingHeads || !m_headTimer->isActive()) return;
+
+    // the same replies readyHeads takes as a status
+    if (!response.contains("10") && !response.contains("-") && response.toInt() == 0) return;
+    m_headTimer->stop();
+
+    if (response.trimmed().contains("10"))
+    {
+        m_headAttempt = 0;
+        m_headsToLoad.erase(m_headsToLoad.begin());
+        send_head();
+        return;
+    }
+
+    message(QString("Error: Invalid Status '%1'. Initiating Auto-Power Cycle...").arg(response.trimmed()));
+    recover_heads();
+}
+
+void PrintJob::head_timeout()
+{
+    if (!m_loadingHeads) return;
+
+    message("Warning: Timeout waiting for status.");
+    if (++m_headAttempt >= 2)
+    {
+        head_failed();
+        return;
+    }
+    request_head_status();
+}
+
+void PrintJob::head_upload_failed(const QString &reason)
+{
+    if (!m_loadingHeads || m_finishing) return;
+
+    // the board may hold part of the image, all the heads of the pass are loaded again
+    m_headUpload++;
+    m_headTimer->stop();
+    message(QString("Warning: Head data upload failed, %1.").arg(reason));
+    if (++m_headAttempt >= 2)
+    {
+        head_failed();
+        return;
+    }
+    reload_heads();
+}
+
+void PrintJob::head_failed()
+{
+    message("CRITICAL: Unable to recover head status 10.");
+    finish(Result::Failed, QString("the heads did not report ready for layer %1 pass %2").arg(m_headPlan.layer).arg(m_headPlan.pass));
+}
+
+void PrintJob::recover_heads()
+{
+    on_controller([](Added_Scientific::Controller *controller) {controller->power_off();});
+    message("Heads off...");
+
+    // the heads drain, come back on and boot before the settings go back on
+    const int frequency = m_settings.headFrequency_Hz;
+    const double voltage = m_settings.headVoltage;
+    QTimer::singleShot(2000, this, [this, frequency, voltage]()
+    {
+        if (m_finishing) return;
+        on_controller([](Added_Scientific::Controller *controller) {controller->power_on();});
+        message("Heads on...");
+
+        QTimer::singleShot(2000, this, [this, frequency, voltage]()
+        {
+            if (m_finishing) return;
+            on_controller([frequency, voltage](Added_Scientific::Controller *controller)
+            {
+                controller->set_printing_frequency(frequency);
+                controller->set_head_voltage(Added_Scientific::Controller::HEAD1, voltage);
+                controller->set_head_voltage(Added_Scientific::Controller::HEAD2, voltage);
+            }, [this]()
+            {
+                if (m_finishing) return;
+                if (++m_headAttempt >= 2)
+                {
+                    head_failed();
+                    return;
+                }
+                message("Recovery Complete. Retrying status check...");
+                reload_heads(); // the heads lost their data
+            });
+        });
+    });
+}
+
+void PrintJob::move_to_start()
+{
+    if (m_finishing) return;
+    const JobPass &pass = current_pass();
+    for (const QString &warning : pass.warnings) message(warning);
+    message(QString("Runway: %1 mm, Start: %2 mm, End: %3 mm, Direction: %4")
+                .arg(pass.runway_mm).arg(pass.startX_mm).arg(pass.endX_mm).arg(pass.plan.reversed ? "-X" : "+X"));
+    run_program(pass.moveProgram, State::MovingToStart, [this]() {settle(100, [this]() {arm_and_print();});});
+}
+
+void PrintJob::arm_and_print()
+{
+    if (m_finishing) return;
+
+    // the trigger has to be on the board before the head reaches it
+    const int runwayCounts = static_cast<int>(current_pass().runway_mm * X_CNTS_PER_MM);
+    on_controller([runwayCounts](Added_Scientific::Controller *controller)
+    {
+        controller->set_absolute_start(runwayCounts);
+    }, [this]() {print_pass();});
+}
+
+void PrintJob::print_pass()
+{
+    if (m_finishing) return;
+    run_program(current_pass().printProgram, State::Printing, [this]() {settle(100, [this]() {pass_done();});});
+}
+
+void PrintJob::pass_done()
+{
+    record_pass();
+    settle(100, [this]() {start_pass();});
+}
+
+void PrintJob::record_pass()
+{
+    // the roller slows down over everything printed so far
+    m_settings.estimator.recoat_planner().box().include(current_pass().plan.y_mm);
+    m_checkpoint = {m_layer.layer, current_pass().plan.pass};
+    journal("pass");
+    emit checkpoint_reached(m_checkpoint.layer, m_checkpoint.pass);
+    m_passIndex++;
+}
+
+void PrintJob::layer_done()
+{
+    m_eta.layer_finished(m_layer.layer, m_layerTimer.elapsed() / 1000.0);
+    message(QString("--- Finished Layer %1, %2 ---").arg(m_layer.layer).arg(m_eta.status_text()));
+
+    if (m_cancelRequested)
+    {
+        finish(Result::Cancelled);
+        return;
+    }
+    if (m_pauseRequested)
+    {
+        message("Moving nozzle to park position to pause.");
+        park(State::Paused);
+        return;
+    }
+    continue_after_layer();
+}
+
+std::string PrintJob::layer_program(const JobLayer &layer) const
+{
+    // the same moves as the programs of each pass (see prepare_layer), with the
+    // pass table written into the program like the positions of the bed scan
+    const PrintEstimatorSettings &motion = m_settings.estimator.settings();
+    auto x = [](double mm) {return static_cast<int>(mm * X_CNTS_PER_MM);};
+    auto y = [](double mm) {return static_cast<int>(mm * Y_CNTS_PER_MM);};
+    const size_t count = layer.passes.size();
+
+    std::stringstream s;
+    s << "#MJLAYER\n";
+    s << "JS #mjstore\n";
+    s << "mjPass = 0\n";
+    s << "#mjnext\n";
+    // as moveToLocation, Y then X
+    s << "ACY = " << y(motion.moveYAcceleration_mm_s2) << "\n";
+    s << "DCY = " << y(motion.moveYAcceleration_mm_s2) << "\n";
+    s << "SPY = " << y(motion.moveYSpeed_mm_s) << "\n";
+    s << "PAY = mjY[mjPass]\n";
+    s << "BGY\n";
+    s << "AMY\n";
+    s << "ACX = " << x(motion.moveXAcceleration_mm_s2) << "\n";
+    s << "DCX = " << x(motion.moveXAcceleration_mm_s2) << "\n";
+    s << "SPX = " << x(motion.moveXSpeed_mm_s) << "\n";
+    s << "PAX = mjX0[mjPass]\n";
+    s << "BGX\n";
+    s << "AMX\n";
+    // the PC sets mjHeads to the number of passes it has put in the heads
+    s << "#mjwait\n";
+    s << "JP #mjwait, ((mjHeads <= mjPass) & (mjStop = 0))\n";
+    s << "JP #mjend, (mjStop = 1)\n";
+    s << "WT 100\n";
+    // as printEnc, a -X pass holds the MJ direction output high while it moves
+    s << "ACX = " << x(motion.printAcceleration_mm_s2) << "\n";
+    s << "DCX = " << x(motion.printAcceleration_mm_s2) << "\n";
+    s << "SPX = mjSpd[mjPass]\n";
+    s << "IF (mjDir[mjPass] = 1)\n";
+    s << "SB " << MJ_DIR_BIT << "\n";
+    s << "ENDIF\n";
+    s << "PAX = mjX1[mjPass]\n";
+    s << "BGX\n";
+    s << "AMX\n";
+    s << "CB " << MJ_DIR_BIT << "\n";
+    s << "mjPass = mjPass + 1\n";
+    s << "MG \"MJ PASS \", mjPass{Z4.0}\n";
+    s << "WT 100\n";
+    s << "JP #mjnext, (mjPass < " << count << ")\n";
+    s << "#mjend\n";
+    s << "EN\n";
+    s << "\n";
+
+    s << "#mjstore\n";
+    s << "DA *[0]\n"; // deallocate all arrays
+    s << "DM mjY[" << count << "]\n";
+    s << "DM mjX0[" << count << "]\n";
+    s << "DM mjX1[" << count << "]\n";
+    s << "DM mjSpd[" << count << "]\n";
+    s << "DM mjDir[" << count << "]\n";
+    for (size_t i = 0; i < count; i++)
+    {
+        const JobPass &pass = layer.passes[i];
+        s << "mjY[" << i << "] = " << y(pass.plan.y_mm) << "\n";
+        s << "mjX0[" << i << "] = " << x(pass.startX_mm) << "\n";
+        s << "mjX1[" << i << "] = " << x(pass.endX_mm) << "\n";
+        s << "mjSpd[" << i << "] = " << x(m_settings.printSpeed_mm_s) << "\n";
+        s << "mjDir[" << i << "] = " << (pass.plan.reversed ? 1 : 0) << "\n";
+    }
+    s << "EN\n";
+    return s.str();
+}
+
+void PrintJob::start_layer_program()
+{
+    if (m_finishing) return;
+    for (const JobPass &pass : m_layer.passes)
+    {
+        for (const QString &warning : pass.warnings) message(warning);
+    }
+    message(QString("Layer %1 runs on the controller: %2 passes, runway %3 mm")
+                .arg(m_layer.layer).arg(m_layer.passes.size()).arg(current_pass().runway_mm));
+
+    // the trigger has to be on the board before the head reaches it
+    const int runwayCounts = static_cast<int>(current_pass().runway_mm * X_CNTS_PER_MM);
+    on_controller([runwayCounts](Added_Scientific::Controller *controller)
+    {
+        controller->set_absolute_start(runwayCounts);
+    }, [this]()
+    {
+        if (m_finishing) return;
+
+        // the first pass is in the heads, and the flags are set before the
+        // program starts so a cancel that came during the loading isn't lost
+        if (!m_printer->mcu->set_program_variable("mjHeads", 1) ||
+            !m_printer->mcu->set_program_variable("mjStop", m_cancelRequested ? 1 : 0))
+        {
+            finish(Result::Failed, QString("could not set up the program of layer %1 on the motion controller").arg(m_layer.layer));
+            return;
+        }
+        m_layerProgramRunning = true;
+        m_layerProgramTimer->start();
+        run_program(m_layer.program, State::Printing, [this]() {layer_program_ended();});
+    });
+}
+
+void PrintJob::controller_message(const QString &text)
+{
+    // "MJ PASS n" from the layer program once n passes of the layer are printed
+    if (!m_layerProgramRunning || !text.startsWith("MJ PASS")) return;
+    bool ok {false};
+    const int printed = text.mid(7).trimmed().toInt(&ok);
+    if (!ok) return;
+    m_layerProgramTimer->start();
+    passes_printed(printed);
+}
+
+void PrintJob::passes_printed(int printed)
+{
+    // a pass is only recorded once however late its message comes
+    while (m_passIndex < m_layer.passes.size() && static_cast<int>(m_passIndex) < printed) record_pass();
+    if (!m_layerProgramRunning || m_finishing || m_cancelRequested || m_passIndex >= m_layer.passes.size()) return;
+
+    // the next pass goes to the heads while the controller moves to it
+    announce_pass();
+    const int loaded = static_cast<int>(m_passIndex) + 1;
+    const int runwayCounts = static_cast<int>(current_pass().runway_mm * X_CNTS_PER_MM);
+    load_heads(current_pass(), [this, loaded, runwayCounts]()
+    {
+        on_controller([runwayCounts](Added_Scientific::Controller *controller)
+        {
+            controller->set_absolute_start(runwayCounts);
+        }, [this, loaded]()
+        {
+            if (!m_layerProgramRunning) return;
+            if (!m_printer->mcu->set_program_variable("mjHeads", loaded))
+            {
+                layer_program_failed(QString("could not tell the program of layer %1 that pass %2 is in the heads").arg(m_layer.layer).arg(loaded));
+                return;
+            }
+            // the wait for the heads doesn't count against the program
+            m_layerProgramTimer->start();
+        });
+    });
+}
+
+void PrintJob::layer_program_ended()
+{
+    m_layerProgramRunning = false;
+    m_layerProgramTimer->stop();
+
+    // the message of the last pass can come in after the program has ended
+    int printed {0};
+    if (read_controller("mjPass=?", printed)) passes_printed(printed);
+    if (m_passIndex < m_layer.passes.size())
+    {
+        if (m_cancelRequested) finish(Result::Cancelled);
+        else finish(Result::Failed, QString("the layer program stopped after %1 of %2 passes").arg(m_passIndex).arg(m_layer.passes.size()));
+        return;
+    }
+    layer_done();
+}
+
+void PrintJob::stop_layer_program()
+{
+    // the program ends at the start of its next pass, the one printing is finished
+    if (!m_layerProgramRunning || m_printer->mcu->set_program_variable("mjStop", 1)) return;
+
+    // one that can't be told to stop is halted where it is, it then ends as if it had stopped
+    message("WARNING: Could not tell the layer program to stop, halting it");
+    if (!m_printer->mcu->halt_program()) message("WARNING: Could not halt the layer program, stop the printer");
+}
+
+void PrintJob::layer_program_timeout()
+{
+    if (!m_layerProgramRunning) return;
+    layer_program_failed(QString("the program of layer %1 reported no pass in %2 s")
+                             .arg(m_layer.layer).arg(m_layerProgramTimer->interval() / 1000));
+}
+
+void PrintJob::layer_program_failed(const QString &reason)
+{
+    // the job can't follow the program any more, it is halted and the job ends once it has
+    m_layerProgramRunning = false;
+    m_layerProgramTimer->stop();
+    if (!m_printer->mcu->halt_program()) message("WARNING: Could not halt the layer program, stop the printer");
+    finish(Result::Failed, reason);
+}
+
+void PrintJob::park(State after)
+{
+    // as moveNozzleOffPlate, X only so Y stays where it is
+    const PrintEstimatorSettings &motion = m_settings.estimator.settings();
+    m_afterPark = after;
+    std::stringstream s;
+    s << CMD::set_accleration(Axis::X, motion.moveXAcceleration_mm_s2);
+    s << CMD::set_deceleration(Axis::X, motion.moveXAcceleration_mm_s2);
+    s << CMD::set_speed(Axis::X, motion.moveXSpeed_mm_s);
+    s << CMD::position_absolute(Axis::X, motion.parkX_mm);
+    s << CMD::begin_motion(Axis::X);
+    s << CMD::after_motion(Axis::X);
+    run_program(CMD::cmd_buf_to_dmc(s), State::Parking, [this]() {settle(100, [this]() {parked();});});
+}
+
+void PrintJob::parked()
+{
+    switch (m_afterPark)
+    {
+    case State::Recoating:
+        recoat();
+        break;
+    case State::Paused:
+        set_state(State::Paused);
+        m_pauseRequested = false;
+        emit paused_changed(true);
+        emit status_changed(QString("Paused after layer %1 / %2\n%3").arg(m_layer.layer).arg(m_source->layer_count()).arg(m_eta.status_text()));
+        message(QString("--- PAUSED AFTER LAYER %1 ---").arg(m_layer.layer));
+        journal("paused");
+        break;
+    default:
+    {
+        set_state(State::Finished);
+        const double minutes = m_jobTimer.elapsed() / 60000.0;
+        QString summary;
+        switch (m_result)
+        {
+        case Result::Complete:
+            summary = QString("--- Print Job Complete in %1 min").arg(minutes, 0, 'f', 1);
+            if (m_settings.estimate.total_s() > 0.0) summary += QString(" (estimated %1 min)").arg(m_settings.estimate.total_s() / 60.0, 0, 'f', 1);
+            summary += " ---";
+            break;
+        case Result::Cancelled:
+            summary = QString("--- PRINT JOB CANCELLED BY USER after layer %1 pass %2 ---").arg(m_checkpoint.layer).arg(m_checkpoint.pass);
+            break;
+        case Result::Failed:
+            summary = QString("ERROR: Print job stopped after layer %1 pass %2: %3").arg(m_checkpoint.layer).arg(m_checkpoint.pass).arg(m_reason);
+            break;
+        }
+        message(summary);
+        journal(m_result == Result::Complete ? "complete" : m_result == Result::Cancelled ? "cancelled" : "failed", m_reason);
+        m_journal.close();
+        m_source.reset();
+        emit job_finished(m_result, summary);
+        break;
+    }
+    }
+}
+
+void PrintJob::finish(Result result, const QString &reason)
+{
+    if (m_finishing) return;
+
+    m_finishing = true;
+    m_result = result;
+    m_reason = reason;
+    m_headTimer->stop();
+    m_layerProgramTimer->stop();
+    m_loadingHeads = false;
+    m_afterHeads = nullptr;
+    if (m_source) m_source->stop();
+    stop_layer_program();
+
+    if (m_motionStopped)
+    {
+        // whoever stopped the printer has it, the heads stay where they are
+        m_afterMotion = nullptr;
+        m_afterSettle = nullptr;
+        m_settleTimer->stop();
+        m_afterPark = State::Finished;
+        parked();
+        return;
+    }
+
+    // the heads always end up off the plate so they don't drip on the part,
+    // once the printer is done with what it is doing (a failure can come mid recoat)
+    if (m_afterMotion)
+    {
+        m_afterMotion = [this]() {park(State::Finished);};
+        return;
+    }
+    if (m_settleTimer->isActive())
+    {
+        m_afterSettle = [this]() {park(State::Finished);};
+        return;
+    }
+    park(State::Finished);
+}
+
+void PrintJob::motion_finished()
+{
+    // PrintThread::ended also comes for commands the job didn't send
+    if (!m_afterMotion) return;
+    std::function<void()> next = std::move(m_afterMotion);
+    m_afterMotion = nullptr;
+    if (m_motionStopped)
+    {
+        // the stopped commands ended early, what was waiting on them doesn't run
+        if (m_finishing)
+        {
+            m_afterPark = State::Finished;
+            parked();
+        }
+        else finish(Result::Cancelled, "the printer was stopped");
+        return;
+    }
+    next();
+}
+
+void PrintJob::motion_stopped()
+{
+    // the stop button (or a disconnect) stops a running job at its next step
+    if (m_state == State::Idle || m_state == State::Finished || m_state == State::Paused) return;
+    m_motionStopped = true;
+    message("--- PRINTER STOPPED ---");
+    if (!m_afterMotion) finish(Result::Cancelled, "the printer was stopped");
+}
+
+void PrintJob::set_state(State state)
+{
+    m_state = state;
+}
+
+void PrintJob::settle(int milliseconds, std::function<void()> next)
+{
+    set_state(State::Settling);
+    m_afterSettle = std::move(next);
+    m_settleTimer->start(milliseconds);
+}
+
+void PrintJob::settled()
+{
+    std::function<void()> next = std::move(m_afterSettle);
+    m_afterSettle = nullptr;
+    if (next) next();
+}
+
+void PrintJob::run_program(const std::string &program, State state, std::function<void()> next)
+{
+    set_state(state);
+
+    if (m_motionStopped)
+    {
+        motion_failed("the printer was stopped");
+        return;
+    }
+    if (!m_printer->mcu->g)
+    {
+        motion_failed("the motion controller is not connected");
+        return;
+    }
+    const GReturn rc = GProgramDownload(m_printer->mcu->g, program.c_str(), "");
+    if (rc != G_NO_ERROR)
+    {
+        motion_failed(QString("could not download the program to the motion controller (error %1)").arg(rc));
+        return;
+    }
+
+    std::stringstream run;
+    run << "GCmd," << "XQ" << "\n";
+    run << "GProgramComplete," << "\n";
+    run_commands(run, state, std::move(next));
+}
+
+void PrintJob::run_commands(std::stringstream &s, State state, std::function<void()> next)
+{
+    set_state(state);
+    m_afterMotion = std::move(next);
+    if (!m_printer->mcu->printerThread->execute_command(s))
+    {
+        m_afterMotion = nullptr;
+        motion_failed("the motion controller was still busy with other commands");
+    }
+}
+
+void PrintJob::motion_failed(const QString &reason)
+{
+    // a job that can't even park ends where it is
+    if (m_finishing)
+    {
+        message(QString("WARNING: Could not park the heads, %1").arg(reason));
+        m_afterPark = State::Finished;
+        parked();
+        return;
+    }
+    finish(m_motionStopped ? Result::Cancelled : Result::Failed, reason);
+}
+
+void PrintJob::on_controller(std::function<void(Added_Scientific::Controller *)> call, std::function<void()> next)
+{
+    Added_Scientific::Controller *controller = m_printer->mjController;
+    QMetaObject::invokeMethod(controller, [this, controller, call, next]()
+    {
+        call(controller);
+        if (next) QMetaObject::invokeMethod(this, next, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void PrintJob::message(const QString &text)
+{
+    emit print_to_output_window(text);
+}
+
+void PrintJob::journal(const QString &event, const QString &note)
+{
+    if (!m_journal.is_open()) return;
+
+    JournalEntry entry;
+    entry.event = event;
+    entry.layer = m_checkpoint.layer;
+    entry.pass = m_checkpoint.pass;
+    entry.z_mm = m_z_mm;
+    // a recoat is logged before the layer it is for has started
+    const JobLayer &layer = (m_nextReady && m_next.layer == m_checkpoint.layer) ? m_next : m_layer;
+    if (layer.layer == m_checkpoint.layer && !layer.passes.empty()) entry.yShift_rows = layer.passes.front().plan.yShift_rows;
+    entry.headFrequency_Hz = m_settings.headFrequency_Hz;
+    entry.headVoltage = m_settings.headVoltage;
+    entry.printFrequency_Hz = m_settings.printFrequency_Hz;
+    entry.printSpeed_mm_s = m_settings.printSpeed_mm_s;
+    entry.reverseOffset_mm = m_settings.reverseOffset_mm;
+    entry.note = note;
+
+    QString error;
+    if (!m_journal.write(entry, error))
+    {
+        message(QString("WARNING: Print journal stopped, %1").arg(error));
+        m_journal.close();
+    }
+}
+
+double PrintJob::z_position_mm() const
+{
+    return position_mm("TPZ", Z_CNTS_PER_MM);
+}
+
+double PrintJob::y_position_mm() const
+{
+    return position_mm("TPY", Y_CNTS_PER_MM);
+}
+
+double PrintJob::position_mm(const char *command, double countsPerMM) const
+{
+    int counts {0};
+    if (!read_controller(command, counts)) return std::numeric_limits<double>::quiet_NaN();
+    return counts / countsPerMM;
+}
+
+bool PrintJob::read_controller(const char *command, int &value) const
+{
+    // only called while the print thread is idle between programs (before a recoat,
+    // after one ends, after the layer program ends), never while one runs
+    if (!m_printer->mcu->g) return false;
+    return GCmdI(m_printer->mcu->g, command, &value) == G_NO_ERROR;
+}
+
+#include "moc_printjob.cpp"
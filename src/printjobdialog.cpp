@@ -0,0 +1,79 @@
+#include "printjobdialog.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+PrintJobDialog::PrintJobDialog(int layerCount, QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle("Print Job Status");
+    setWindowModality(Qt::WindowModal);
+
+    m_status = new QLabel("Starting print job...", this);
+    m_status->setMinimumWidth(300);
+    m_progress = new QProgressBar(this);
+    m_progress->setRange(0, layerCount);
+    m_progress->setValue(0);
+    m_progress->setFormat("Layer %v / %m");
+
+    m_pauseButton = new QPushButton("Pause", this);
+    m_pauseButton->setToolTip("Park the heads once the current layer is printed");
+    m_cancelButton = new QPushButton("Cancel", this);
+    m_cancelButton->setToolTip("Stop the job after the current pass");
+    auto buttonLayout = new QHBoxLayout;
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_pauseButton);
+    buttonLayout->addWidget(m_cancelButton);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(m_status);
+    layout->addWidget(m_progress);
+    layout->addLayout(buttonLayout);
+
+    connect(m_pauseButton, &QPushButton::clicked, this, &PrintJobDialog::pause_clicked);
+    connect(m_cancelButton, &QPushButton::clicked, this, &PrintJobDialog::reject);
+}
+
+void PrintJobDialog::set_status(const QString &text)
+{
+    m_status->setText(text);
+}
+
+void PrintJobDialog::set_layer(int layer, int layerCount)
+{
+    m_progress->setMaximum(layerCount);
+    m_progress->setValue(layer);
+}
+
+void PrintJobDialog::set_paused(bool paused)
+{
+    m_paused = paused;
+    m_pauseButton->setText(paused ? "Resume" : "Pause");
+    m_pauseButton->setEnabled(m_cancelButton->isEnabled());
+}
+
+void PrintJobDialog::reject()
+{
+    if (!m_cancelButton->isEnabled()) return;
+    m_cancelButton->setEnabled(false);
+    m_pauseButton->setEnabled(false);
+    emit cancel_requested();
+}
+
+void PrintJobDialog::pause_clicked()
+{
+    if (m_paused)
+    {
+        emit resume_requested();
+        return;
+    }
+    // the button comes back as Resume once the heads are parked
+    m_pauseButton->setEnabled(false);
+    m_pauseButton->setText("Pausing...");
+    emit pause_requested();
+}
+
+#include "moc_printjobdialog.cpp"
@@ -0,0 +1,230 @@
+#include "recoatplanner.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <sstream>
+
+#include "printestimator.h"
+
+void RecoatBuildBox::include(double y_mm)
+{
+    if (is_empty())
+    {
+        minY_mm = y_mm - swath_mm;
+        maxY_mm = y_mm + swath_mm;
+        return;
+    }
+    minY_mm = std::min(minY_mm, y_mm - swath_mm);
+    maxY_mm = std::max(maxY_mm, y_mm + swath_mm);
+}
+
+QString RecoatPlan::summary() const
+{
+    QStringList changes {"Z raise during the hopper dwell"};
+    if (zRetractOverlapped) changes << "Z retract during the Y return";
+    if (rollerSpeedZoned) changes << "fast roller away from the part";
+    return QString("Recoat %1 s, spread_layer %2 s (%3 s less): %4")
+        .arg(cycle_s, 0, 'f', 1).arg(baseline_s, 0, 'f', 1).arg(baseline_s - cycle_s, 0, 'f', 1).arg(changes.join(", "));
+}
+
+RecoatPlanner::RecoatPlanner(const RecoatProfile &profile, const RecoatBuildBox &box) :
+    m_profile(profile),
+    m_box(box)
+{
+}
+
+double RecoatPlanner::segment_time(double distance_mm, double speedIn_mm_s, double speed_mm_s, double speedOut_mm_s, double acceleration_mm_s2)
+{
+    if (distance_mm <= 0.0 || acceleration_mm_s2 <= 0.0) return 0.0;
+    speed_mm_s = std::max({speed_mm_s, speedIn_mm_s, speedOut_mm_s});
+    if (speed_mm_s <= 0.0) return 0.0;
+
+    const double rampIn = (speed_mm_s * speed_mm_s - speedIn_mm_s * speedIn_mm_s) / (2.0 * acceleration_mm_s2);
+    const double rampOut = (speed_mm_s * speed_mm_s - speedOut_mm_s * speedOut_mm_s) / (2.0 * acceleration_mm_s2);
+    if (rampIn + rampOut <= distance_mm)
+        return (speed_mm_s - speedIn_mm_s) / acceleration_mm_s2 + (speed_mm_s - speedOut_mm_s) / acceleration_mm_s2
+               + (distance_mm - rampIn - rampOut) / speed_mm_s;
+
+    // too short to cruise, and if too short to reach the end speed the speed just ramps between the two
+    const double peak = std::sqrt(acceleration_mm_s2 * distance_mm + 0.5 * (speedIn_mm_s * speedIn_mm_s + speedOut_mm_s * speedOut_mm_s));
+    if (peak < std::max(speedIn_mm_s, speedOut_mm_s)) return 2.0 * distance_mm / (speedIn_mm_s + speedOut_mm_s);
+    return (peak - speedIn_mm_s) / acceleration_mm_s2 + (peak - speedOut_mm_s) / acceleration_mm_s2;
+}
+
+double RecoatPlanner::distance_after(double time_s, double distance_mm, double speed_mm_s, double acceleration_mm_s2)
+{
+    if (time_s <= 0.0 || speed_mm_s <= 0.0 || acceleration_mm_s2 <= 0.0) return 0.0;
+    const double rampTime = speed_mm_s / acceleration_mm_s2;
+    const double x = (time_s <= rampTime) ? 0.5 * acceleration_mm_s2 * time_s * time_s
+                                          : 0.5 * speed_mm_s * rampTime + speed_mm_s * (time_s - rampTime);
+    return std::min(x, distance_mm);
+}
+
+double RecoatPlanner::return_travel(double fromY_mm) const
+{
+    if (std::isnan(fromY_mm) || std::isnan(m_profile.backLimitY_mm)) return m_profile.returnTravel_mm;
+    return std::max(0.0, fromY_mm - m_profile.backLimitY_mm);
+}
+
+double RecoatPlanner::z_raise(const RecoatSettings &settings) const
+{
+    // a level recoat puts the bed back where it was
+    if (settings.isLevelRecoat) return m_profile.zOffsetUnderRoller_mm;
+    return m_profile.zOffsetUnderRoller_mm - settings.layerHeight_microns / 1000.0;
+}
+
+double RecoatPlanner::baseline_time(const RecoatSettings &settings, double fromY_mm) const
+{
+    // the moves and waits of CMD::spread_layer in order
+    const double zOffsetUnderRoller = 0.5;
+    const double zRaise = settings.isLevelRecoat ? zOffsetUnderRoller : zOffsetUnderRoller - settings.layerHeight_microns / 1000.0;
+    double t = PrintEstimator::move_time(zOffsetUnderRoller, 2.0, 10.0, 10.0);
+    t += PrintEstimator::move_time(return_travel(fromY_mm), 50.0, 400.0, 400.0);
+    t += PrintEstimator::move_time(zRaise, 2.0, 10.0, 10.0);
+    t += settings.waitAfterHopperOn_millisecs / 1000.0;
+    t += PrintEstimator::move_time(100.0, settings.recoatSpeed_mm_s, 1000.0, 1000.0);
+    t += PrintEstimator::move_time(175.0, settings.rollerTraverseSpeed_mm_s, 1000.0, 1000.0);
+    return t;
+}
+
+RecoatPlan RecoatPlanner::plan(const RecoatSettings &settings, double fromY_mm) const
+{
+    const RecoatProfile &p = m_profile;
+    const Axis y {Axis::Y};
+    const bool backKnown = !std::isnan(p.backLimitY_mm);
+    RecoatPlan plan;
+    plan.baseline_s = baseline_time(settings, fromY_mm);
+
+    // where the roller is over the part, in stage Y
+    const bool partKnown = !m_box.is_empty() && !std::isnan(p.rollerOffsetY_mm);
+    const double partBack = m_box.minY_mm + p.rollerOffsetY_mm - p.partMargin_mm;
+    const double partFront = m_box.maxY_mm + p.rollerOffsetY_mm + p.partMargin_mm;
+
+    // the return only jogs into the limit switch at the end once it knows where the switch is
+    const double travel = return_travel(fromY_mm);
+    const bool approach = backKnown && !std::isnan(fromY_mm) && travel > p.yLimitApproach_mm;
+    const double returnSpeed = approach ? p.yReturnSpeed_mm_s : p.yLimitJogSpeed_mm_s;
+    double return_s = PrintEstimator::move_time(travel, p.yLimitJogSpeed_mm_s, p.yReturnAcceleration_mm_s2, p.yReturnAcceleration_mm_s2);
+    if (approach)
+    {
+        return_s = PrintEstimator::move_time(travel - p.yLimitApproach_mm, p.yReturnSpeed_mm_s, p.yReturnAcceleration_mm_s2, p.yReturnAcceleration_mm_s2)
+                   + PrintEstimator::move_time(p.yLimitApproach_mm, p.yLimitJogSpeed_mm_s, p.yReturnAcceleration_mm_s2, p.yReturnAcceleration_mm_s2);
+    }
+
+    // the Z retract keeps the roller off the printed layer on the way back, so Y
+    // can only start with it if the roller doesn't reach the part before Z is down.
+    // The loose powder around the part is spread again straight after.
+    const double zRetract_s = PrintEstimator::move_time(p.zOffsetUnderRoller_mm, p.zSpeed_mm_s, p.zAcceleration_mm_s2, p.zAcceleration_mm_s2);
+    if (partKnown && !std::isnan(fromY_mm))
+    {
+        const double swept = distance_after(zRetract_s, travel, returnSpeed, p.yReturnAcceleration_mm_s2);
+        plan.zRetractOverlapped = fromY_mm - swept > partFront || fromY_mm < partBack;
+    }
+
+    std::stringstream s;
+    s << CMD::set_accleration(Axis::Z, p.zAcceleration_mm_s2)
+      << CMD::set_deceleration(Axis::Z, p.zAcceleration_mm_s2)
+      << CMD::set_speed(Axis::Z, p.zSpeed_mm_s)
+      << CMD::position_relative(Axis::Z, -p.zOffsetUnderRoller_mm)
+      << CMD::begin_motion(Axis::Z);
+    if (!plan.zRetractOverlapped) s << CMD::after_motion(Axis::Z);
+
+    s << CMD::set_accleration(y, p.yReturnAcceleration_mm_s2)
+      << CMD::set_deceleration(y, p.yReturnAcceleration_mm_s2);
+    if (approach)
+    {
+        s << CMD::set_speed(y, p.yReturnSpeed_mm_s)
+          << CMD::position_absolute(y, p.backLimitY_mm + p.yLimitApproach_mm)
+          << CMD::begin_motion(y)
+          << CMD::after_motion(y);
+    }
+    s << CMD::set_jog(y, -p.yLimitJogSpeed_mm_s)
+      << CMD::begin_motion(y)
+      << CMD::after_motion(y);
+    if (plan.zRetractOverlapped) s << CMD::after_motion(Axis::Z);
+    plan.cycle_s = plan.zRetractOverlapped ? std::max(zRetract_s, return_s) : zRetract_s + return_s;
+
+    // the hopper fills from the back limit whatever the bed height, so the
+    // dwell is timed from the hopper turning on and Z rises during it
+    const double zRaise_s = PrintEstimator::move_time(z_raise(settings), p.zSpeed_mm_s, p.zAcceleration_mm_s2, p.zAcceleration_mm_s2);
+    s << CMD::position_relative(Axis::Z, z_raise(settings))
+      << CMD::set_hopper_mode_and_intensity(settings.ultrasonicMode, settings.ultrasonicIntensityLevel)
+      << CMD::enable_hopper()
+      << CMD::set_reference_time()
+      << CMD::begin_motion(Axis::Z)
+      << CMD::after_motion(Axis::Z)
+      << CMD::at_time_milliseconds(settings.waitAfterHopperOn_millisecs);
+    plan.cycle_s += std::max(zRaise_s, settings.waitAfterHopperOn_millisecs / 1000.0);
+
+    s << CMD::set_accleration(y, p.yStrokeAcceleration_mm_s2)
+      << CMD::set_deceleration(y, p.yStrokeAcceleration_mm_s2)
+      << CMD::set_speed(y, settings.recoatSpeed_mm_s)
+      << CMD::position_relative(y, p.hopperTravel_mm)
+      << CMD::begin_motion(y)
+      << CMD::after_motion(y);
+    plan.cycle_s += PrintEstimator::move_time(p.hopperTravel_mm, settings.recoatSpeed_mm_s, p.yStrokeAcceleration_mm_s2, p.yStrokeAcceleration_mm_s2);
+
+    s << CMD::disable_hopper()
+      << CMD::enable_roller1()
+      << CMD::enable_roller2();
+
+    // the roller only has to go slowly over the part, the speed changes at
+    // positions in the stroke so it never stops on the powder
+    const double slow = settings.rollerTraverseSpeed_mm_s;
+    const double fast = p.rollerFastSpeed_mm_s;
+    const double a = p.yStrokeAcceleration_mm_s2;
+    const double strokeStart = p.backLimitY_mm + p.hopperTravel_mm;
+    const double strokeEnd = strokeStart + p.rollerTravel_mm;
+    if (backKnown && partKnown && fast > slow)
+    {
+        plan.rollerSpeedZoned = true;
+        const double slowFrom = std::clamp(partBack, strokeStart, strokeEnd);
+        const double slowTo = std::clamp(partFront, strokeStart, strokeEnd);
+        // slowing down starts early enough to be at the traverse speed when the roller reaches the part
+        const bool crossesPart = slowFrom < slowTo;
+        const double slowDownAt = slowFrom - (fast * fast - slow * slow) / (2.0 * a);
+        const bool startFast = !crossesPart || slowDownAt > strokeStart;
+        const bool endFast = crossesPart && slowTo < strokeEnd;
+
+        s << CMD::set_speed(y, startFast ? fast : slow)
+          << CMD::position_relative(y, p.rollerTravel_mm)
+          << CMD::begin_motion(y);
+        if (startFast && crossesPart)
+        {
+            s << CMD::after_absolute_position(y, slowDownAt)
+              << CMD::set_speed(y, slow);
+        }
+        if (endFast)
+        {
+            s << CMD::after_absolute_position(y, slowTo)
+              << CMD::set_speed(y, fast);
+        }
+        s << CMD::after_motion(y);
+
+        if (!crossesPart)
+        {
+            plan.cycle_s += PrintEstimator::move_time(p.rollerTravel_mm, fast, a, a);
+        }
+        else
+        {
+            plan.cycle_s += segment_time(slowFrom - strokeStart, 0.0, startFast ? fast : slow, slow, a);
+            plan.cycle_s += segment_time(slowTo - slowFrom, slow, slow, endFast ? slow : 0.0, a);
+            plan.cycle_s += segment_time(strokeEnd - slowTo, slow, fast, 0.0, a);
+        }
+    }
+    else
+    {
+        s << CMD::set_speed(y, slow)
+          << CMD::position_relative(y, p.rollerTravel_mm)
+          << CMD::begin_motion(y)
+          << CMD::after_motion(y);
+        plan.cycle_s += PrintEstimator::move_time(p.rollerTravel_mm, slow, a, a);
+    }
+
+    s << CMD::disable_roller1()
+      << CMD::disable_roller2();
+
+    if (backKnown) plan.endY_mm = strokeEnd;
+    plan.program = CMD::cmd_buf_to_dmc(s);
+    return plan;
+}
@@ -0,0 +1,139 @@
+#include "serialstats.h"
+
+#include <QJsonArray>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+
+qint64 now_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int bucket_index(qint64 duration_us)
+{
+    int i {0};
+    while (duration_us > 1 && i < LatencyHistogram::numBuckets - 1)
+    {
+        duration_us >>= 1;
+        i++;
+    }
+    return i;
+}
+
+}
+
+void LatencyHistogram::record(qint64 duration_us)
+{
+    duration_us = std::max<qint64>(0, duration_us);
+    m_counts[bucket_index(duration_us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total_us.fetch_add(duration_us, std::memory_order_relaxed);
+
+    qint64 max = m_max_us.load(std::memory_order_relaxed);
+    while (duration_us > max && !m_max_us.compare_exchange_weak(max, duration_us, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot s;
+    for (int i = 0; i < numBuckets; i++)
+        s.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    s.count = m_count.load(std::memory_order_relaxed);
+    s.total_us = m_total_us.load(std::memory_order_relaxed);
+    s.max_us = m_max_us.load(std::memory_order_relaxed);
+    return s;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &count : m_counts) count.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_total_us.store(0, std::memory_order_relaxed);
+    m_max_us.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Snapshot::mean_ms() const
+{
+    return (count == 0) ? 0.0 : total_us / 1000.0 / count;
+}
+
+double LatencyHistogram::Snapshot::percentile_ms(double fraction) const
+{
+    quint64 total {0};
+    for (const auto c : counts) total += c;
+    if (total == 0) return 0.0;
+
+    const double target = total * fraction;
+    quint64 sum {0};
+    for (int i = 0; i < numBuckets; i++)
+    {
+        sum += counts[i];
+        if (sum >= target)
+        {
+            // the last bucket has no upper edge, so report the largest duration seen
+            if (i == numBuckets - 1) return max_us / 1000.0;
+            return std::min<qint64>(qint64(1) << (i + 1), max_us) / 1000.0;
+        }
+    }
+    return max_us / 1000.0;
+}
+
+QJsonObject LatencyHistogram::Snapshot::to_json() const
+{
+    QJsonArray buckets;
+    for (const auto c : counts) buckets.append(static_cast<double>(c));
+
+    QJsonObject obj;
+    obj["count"] = static_cast<double>(count);
+    obj["mean_ms"] = mean_ms();
+    obj["p50_ms"] = percentile_ms(0.50);
+    obj["p95_ms"] = percentile_ms(0.95);
+    obj["p99_ms"] = percentile_ms(0.99);
+    obj["max_ms"] = max_us / 1000.0;
+    obj["buckets_log2_us"] = buckets; // buckets[i] counts durations in [2^i, 2^(i+1)) us
+    return obj;
+}
+
+// ====================================================================
+
+SerialStats::SerialStats()
+{
+    m_start_ms = now_ms();
+}
+
+double SerialStats::elapsed_s() const
+{
+    return (now_ms() - m_start_ms.load(std::memory_order_relaxed)) / 1000.0;
+}
+
+void SerialStats::reset()
+{
+    queueWait.reset();
+    roundTrip.reset();
+    commandsSent = 0;
+    timeouts = 0;
+    bytesWritten = 0;
+    bytesRead = 0;
+    m_start_ms = now_ms();
+}
+
+QJsonObject SerialStats::to_json() const
+{
+    const double elapsed = std::max(1e-3, elapsed_s());
+
+    QJsonObject obj;
+    obj["elapsed_s"] = elapsed;
+    obj["commands_sent"] = static_cast<double>(commandsSent.load());
+    obj["timeouts"] = static_cast<double>(timeouts.load());
+    obj["bytes_written"] = static_cast<double>(bytesWritten.load());
+    obj["bytes_read"] = static_cast<double>(bytesRead.load());
+    obj["write_bytes_per_s"] = bytesWritten.load() / elapsed;
+    obj["read_bytes_per_s"] = bytesRead.load() / elapsed;
+    obj["queue_wait"] = queueWait.snapshot().to_json();
+    obj["round_trip"] = roundTrip.snapshot().to_json();
+    return obj;
+}
@@ -0,0 +1,138 @@
+#include "serialstatswindow.h"
+#include "asyncserialdevice.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTimer>
+#include <QFileDialog>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonArray>
+
+namespace
+{
+
+const QStringList columnNames {"Device", "Commands", "Timeouts",
+                               "Queue mean (ms)", "Queue p95 (ms)", "Queue max (ms)",
+                               "RTT mean (ms)", "RTT p95 (ms)", "RTT max (ms)",
+                               "Write (B/s)", "Read (B/s)"};
+
+}
+
+SerialStatsWindow::SerialStatsWindow(const QVector<AsyncSerialDevice*> &devices, QWidget *parent) :
+    QWidget(parent),
+    m_devices(devices),
+    m_lastSample(devices.size()),
+    m_table(new QTableWidget(devices.size(), columnNames.size(), this)),
+    m_refreshTimer(new QTimer(this))
+{
+    m_table->setHorizontalHeaderLabels(columnNames);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    auto resetButton = new QPushButton("Reset", this);
+    auto saveButton = new QPushButton("Save JSON...", this);
+    auto buttonLayout = new QHBoxLayout;
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(resetButton);
+    buttonLayout->addWidget(saveButton);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(m_table);
+    layout->addLayout(buttonLayout);
+
+    connect(resetButton, &QPushButton::clicked, this, &SerialStatsWindow::reset_statistics);
+    connect(saveButton, &QPushButton::clicked, this, &SerialStatsWindow::save_json);
+    connect(m_refreshTimer, &QTimer::timeout, this, &SerialStatsWindow::refresh);
+    m_refreshTimer->start(1000);
+    refresh();
+}
+
+void SerialStatsWindow::refresh()
+{
+    // skip the work while the panel is hidden, the counters keep running
+    if (!isVisible()) return;
+
+    for (int row = 0; row < m_devices.size(); row++)
+    {
+        const SerialStats &stats = m_devices[row]->statistics();
+        const auto queueWait = stats.queueWait.snapshot();
+        const auto roundTrip = stats.roundTrip.snapshot();
+
+        // throughput over the last refresh interval
+        RateSample sample;
+        sample.bytesWritten = stats.bytesWritten.load();
+        sample.bytesRead = stats.bytesRead.load();
+        sample.time_s = stats.elapsed_s();
+        RateSample &last = m_lastSample[row];
+        const double dt = sample.time_s - last.time_s;
+        const bool validRate = (dt > 0.0) && (sample.bytesWritten >= last.bytesWritten) && (sample.bytesRead >= last.bytesRead);
+        const double writeRate = validRate ? (sample.bytesWritten - last.bytesWritten) / dt : 0.0;
+        const double readRate = validRate ? (sample.bytesRead - last.bytesRead) / dt : 0.0;
+        last = sample;
+
+        const QStringList values {m_devices[row]->device_name(),
+                                  QString::number(stats.commandsSent.load()),
+                                  QString::number(stats.timeouts.load()),
+                                  QString::number(queueWait.mean_ms(), 'f', 2),
+                                  QString::number(queueWait.percentile_ms(0.95), 'f', 2),
+                                  QString::number(queueWait.max_us / 1000.0, 'f', 2),
+                                  QString::number(roundTrip.mean_ms(), 'f', 2),
+                                  QString::number(roundTrip.percentile_ms(0.95), 'f', 2),
+                                  QString::number(roundTrip.max_us / 1000.0, 'f', 2),
+                                  QString::number(writeRate, 'f', 0),
+                                  QString::number(readRate, 'f', 0)};
+
+        for (int col = 0; col < values.size(); col++)
+        {
+            QTableWidgetItem *item = m_table->item(row, col);
+            if (!item)
+            {
+                item = new QTableWidgetItem;
+                m_table->setItem(row, col, item);
+            }
+            item->setText(values[col]);
+        }
+    }
+}
+
+void SerialStatsWindow::reset_statistics()
+{
+    for (auto device : m_devices) device->reset_statistics();
+    m_lastSample.fill(RateSample());
+    refresh();
+}
+
+QJsonDocument SerialStatsWindow::to_json() const
+{
+    QJsonArray devices;
+    for (const auto device : m_devices)
+    {
+        QJsonObject obj = device->statistics().to_json();
+        obj["device"] = device->device_name();
+        obj["connected"] = device->is_connected();
+        devices.append(obj);
+    }
+
+    QJsonObject root;
+    root["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["devices"] = devices;
+    return QJsonDocument(root);
+}
+
+void SerialStatsWindow::save_json()
+{
+    const QString defaultName = QString("serial_stats_%1.json")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    const QString fileName = QFileDialog::getSaveFileName(this, "Save Serial Statistics", defaultName, "JSON (*.json)");
+    if (fileName.isEmpty()) return;
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly)) file.write(to_json().toJson());
+}
+
+#include "moc_serialstatswindow.cpp"
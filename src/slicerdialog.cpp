@@ -0,0 +1,427 @@
+#include "slicerdialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDir>
+#include <QDoubleSpinBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QImage>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPixmap>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSlider>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace
+{
+
+enum Column {NameColumn, RoleColumn, XColumn, YColumn, ColumnCount};
+
+// default folder the print job dialog opens in
+const QString defaultSlicingFolder = "C:\\Users\\CB140LAB\\Desktop\\Noah\\ComplexMultiNozzle\\Slicing";
+
+QDoubleSpinBox *make_spin_box(double min, double max, double value, int decimals, double step, const QString &suffix)
+{
+    auto box = new QDoubleSpinBox;
+    box->setRange(min, max);
+    box->setDecimals(decimals);
+    box->setSingleStep(step);
+    box->setValue(value);
+    box->setSuffix(suffix);
+    return box;
+}
+
+}
+
+SlicerDialog::SlicerDialog(QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle("STL Slicer");
+    const Slicer::SliceSettings defaults;
+    const Slicer::JobSettings jobDefaults;
+
+    // --- parts ---
+    m_modelTable = new QTableWidget(0, ColumnCount, this);
+    m_modelTable->setHorizontalHeaderLabels({"Part", "Material", "X (mm)", "Y (mm)"});
+    m_modelTable->verticalHeader()->hide();
+    m_modelTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_modelTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_modelTable->horizontalHeader()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+    m_modelTable->setToolTip("X and Y place the front left corner of each part on the bed.\n"
+                             "Negative parts are printed by the second head.");
+    auto addButton = new QPushButton("Add STL...", this);
+    auto removeButton = new QPushButton("Remove", this);
+    auto partButtons = new QHBoxLayout;
+    partButtons->addWidget(addButton);
+    partButtons->addWidget(removeButton);
+    partButtons->addStretch();
+    auto partsGroup = new QGroupBox("Parts", this);
+    auto partsLayout = new QVBoxLayout(partsGroup);
+    partsLayout->addWidget(m_modelTable);
+    partsLayout->addLayout(partButtons);
+
+    // --- settings ---
+    m_layerHeight = make_spin_box(0.005, 1.0, defaults.layerHeight_mm, 4, 0.005, " mm");
+    m_dropletSpacing = make_spin_box(0.005, 1.0, defaults.dropletSpacing_mm, 4, 0.005, " mm");
+    m_lineSpacing = make_spin_box(0.005, 1.0, defaults.lineSpacing_mm, 4, 0.005, " mm");
+    m_frequency = make_spin_box(1.0, 50000.0, jobDefaults.printFrequency_Hz, 0, 100.0, " Hz");
+    m_startX = make_spin_box(-200.0, 200.0, jobDefaults.startX_mm, 3, 0.5, " mm");
+    m_startY = make_spin_box(-200.0, 200.0, jobDefaults.startY_mm, 3, 0.5, " mm");
+    m_yShift = new QCheckBox("Shift each layer to stagger pass seams", this);
+    m_outputFolder = new QLineEdit(defaultSlicingFolder, this);
+    auto browseButton = new QPushButton("...", this);
+    auto folderLayout = new QHBoxLayout;
+    folderLayout->addWidget(m_outputFolder);
+    folderLayout->addWidget(browseButton);
+
+    auto settingsGroup = new QGroupBox("Slicing", this);
+    auto form = new QFormLayout(settingsGroup);
+    form->addRow("Layer height", m_layerHeight);
+    form->addRow("Droplet spacing (X)", m_dropletSpacing);
+    form->addRow("Line spacing (Y)", m_lineSpacing);
+    form->addRow("Print frequency", m_frequency);
+    form->addRow("Start X", m_startX);
+    form->addRow("Start Y", m_startY);
+    form->addRow(m_yShift);
+    form->addRow("Output folder", folderLayout);
+    m_archive = new QCheckBox("Archive bitmaps when printing", this);
+    m_archive->setToolTip("Slice && Print sends the layers straight to the heads.\n"
+                          "Check to also write the job folder to the output folder.");
+    form->addRow(m_archive);
+
+    // --- preview ---
+    m_preview = new QLabel(this);
+    m_preview->setMinimumSize(400, 400);
+    m_preview->setAlignment(Qt::AlignCenter);
+    m_preview->setStyleSheet("background-color: white; border: 1px solid gray;");
+    m_previewInfo = new QLabel(this);
+    m_layerSlider = new QSlider(Qt::Horizontal, this);
+    m_layerSlider->setEnabled(false);
+
+    auto previewGroup = new QGroupBox("Layer Preview", this);
+    auto previewLayout = new QVBoxLayout(previewGroup);
+    previewLayout->addWidget(m_preview, 1);
+    previewLayout->addWidget(m_layerSlider);
+    previewLayout->addWidget(m_previewInfo);
+
+    // --- slice ---
+    m_progress = new QProgressBar(this);
+    m_sliceButton = new QPushButton("Slice", this);
+    m_sliceButton->setStyleSheet("font-weight: bold;");
+    m_printButton = new QPushButton("Slice && Print", this);
+    m_printButton->setToolTip("Slice a few layers ahead of the printer and print without writing bitmaps");
+    m_estimateButton = new QPushButton("Estimate", this);
+    m_estimateButton->setToolTip("Estimate how long Slice && Print would take");
+    m_cancelButton = new QPushButton("Cancel", this);
+    m_cancelButton->setEnabled(false);
+    auto sliceLayout = new QHBoxLayout;
+    sliceLayout->addWidget(m_progress, 1);
+    sliceLayout->addWidget(m_estimateButton);
+    sliceLayout->addWidget(m_sliceButton);
+    sliceLayout->addWidget(m_printButton);
+    sliceLayout->addWidget(m_cancelButton);
+
+    auto leftLayout = new QVBoxLayout;
+    leftLayout->addWidget(partsGroup, 1);
+    leftLayout->addWidget(settingsGroup);
+    auto mainLayout = new QHBoxLayout;
+    mainLayout->addLayout(leftLayout, 2);
+    mainLayout->addWidget(previewGroup, 3);
+    auto layout = new QVBoxLayout(this);
+    layout->addLayout(mainLayout, 1);
+    layout->addLayout(sliceLayout);
+
+    // the preview is rebuilt shortly after the last change rather than on every keystroke
+    m_previewTimer = new QTimer(this);
+    m_previewTimer->setSingleShot(true);
+    m_previewTimer->setInterval(200);
+    connect(m_previewTimer, &QTimer::timeout, this, &SlicerDialog::rebuild_preview);
+
+    connect(addButton, &QPushButton::clicked, this, &SlicerDialog::add_models);
+    connect(removeButton, &QPushButton::clicked, this, &SlicerDialog::remove_model);
+    connect(browseButton, &QPushButton::clicked, this, &SlicerDialog::browse_output_folder);
+    connect(m_layerSlider, &QSlider::valueChanged, this, &SlicerDialog::show_layer);
+    connect(m_sliceButton, &QPushButton::clicked, this, &SlicerDialog::slice);
+    connect(m_printButton, &QPushButton::clicked, this, &SlicerDialog::slice_and_print);
+    connect(m_estimateButton, &QPushButton::clicked, this, &SlicerDialog::estimate);
+    connect(m_cancelButton, &QPushButton::clicked, this, &SlicerDialog::cancel_slicing);
+    for (auto box : {m_layerHeight, m_dropletSpacing, m_lineSpacing})
+        connect(box, QOverload<double>::of(&QDoubleSpinBox::valueChanged), m_previewTimer, QOverload<>::of(&QTimer::start));
+
+    resize(1100, 700);
+}
+
+SlicerDialog::~SlicerDialog()
+{
+    m_cancel = true;
+    if (m_worker.joinable()) m_worker.join();
+}
+
+void SlicerDialog::add_models()
+{
+    const QStringList files = QFileDialog::getOpenFileNames(this, "Add STL Files", QString(), "STL Files (*.stl);;All Files (*)");
+    for (const auto &file : files)
+    {
+        Slicer::Mesh mesh;
+        std::string error;
+        if (!Slicer::load_stl(QDir::toNativeSeparators(file).toStdString(), mesh, error))
+        {
+            QMessageBox::warning(this, "STL Slicer", QString::fromStdString(error));
+            continue;
+        }
+        add_model_row(mesh);
+        m_models.push_back(std::move(mesh));
+    }
+    rebuild_preview();
+}
+
+void SlicerDialog::add_model_row(const Slicer::Mesh &mesh)
+{
+    const Slicer::Bounds b = mesh.bounds();
+    const Slicer::SliceSettings settings = slice_settings();
+
+    // keep the part where it is if it's already on the bed, otherwise centre it
+    double x = b.min.x;
+    double y = b.min.y;
+    if (x < 0.0 || b.max.x > settings.bedWidth_mm) x = (settings.bedWidth_mm - (b.max.x - b.min.x)) / 2.0;
+    if (y < 0.0 || b.max.y > settings.bedDepth_mm) y = (settings.bedDepth_mm - (b.max.y - b.min.y)) / 2.0;
+
+    const int row = m_modelTable->rowCount();
+    m_modelTable->insertRow(row);
+    m_modelTable->setItem(row, NameColumn, new QTableWidgetItem(QString::fromStdString(mesh.name)));
+
+    auto role = new QComboBox;
+    role->addItems({"Positive", "Negative"});
+    m_modelTable->setCellWidget(row, RoleColumn, role);
+    connect(role, QOverload<int>::of(&QComboBox::currentIndexChanged), m_previewTimer, QOverload<>::of(&QTimer::start));
+
+    auto xBox = make_spin_box(-500.0, 500.0, x, 2, 0.5, "");
+    auto yBox = make_spin_box(-500.0, 500.0, y, 2, 0.5, "");
+    m_modelTable->setCellWidget(row, XColumn, xBox);
+    m_modelTable->setCellWidget(row, YColumn, yBox);
+    connect(xBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), m_previewTimer, QOverload<>::of(&QTimer::start));
+    connect(yBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), m_previewTimer, QOverload<>::of(&QTimer::start));
+}
+
+void SlicerDialog::remove_model()
+{
+    const int row = m_modelTable->currentRow();
+    if (row < 0 || row >= static_cast<int>(m_models.size())) return;
+    m_modelTable->removeRow(row);
+    m_models.erase(m_models.begin() + row);
+    rebuild_preview();
+}
+
+void SlicerDialog::browse_output_folder()
+{
+    const QString folder = QFileDialog::getExistingDirectory(this, "Output Folder", m_outputFolder->text());
+    if (!folder.isEmpty()) m_outputFolder->setText(QDir::toNativeSeparators(folder));
+}
+
+std::vector<Slicer::Mesh> SlicerDialog::placed_meshes() const
+{
+    std::vector<Slicer::Mesh> meshes = m_models;
+    for (int row = 0; row < static_cast<int>(meshes.size()); row++)
+    {
+        auto role = qobject_cast<QComboBox*>(m_modelTable->cellWidget(row, RoleColumn));
+        auto xBox = qobject_cast<QDoubleSpinBox*>(m_modelTable->cellWidget(row, XColumn));
+        auto yBox = qobject_cast<QDoubleSpinBox*>(m_modelTable->cellWidget(row, YColumn));
+
+        Slicer::Mesh &mesh = meshes[row];
+        const Slicer::Bounds b = mesh.bounds();
+        mesh.role = (role->currentIndex() == 1) ? Slicer::Role::Negative : Slicer::Role::Positive;
+        mesh.translate(static_cast<float>(xBox->value() - b.min.x), static_cast<float>(yBox->value() - b.min.y), 0.0f);
+    }
+    return meshes;
+}
+
+Slicer::SliceSettings SlicerDialog::slice_settings() const
+{
+    Slicer::SliceSettings settings;
+    settings.layerHeight_mm = m_layerHeight->value();
+    settings.dropletSpacing_mm = m_dropletSpacing->value();
+    settings.lineSpacing_mm = m_lineSpacing->value();
+    return settings;
+}
+
+Slicer::JobSettings SlicerDialog::job_settings() const
+{
+    Slicer::JobSettings job;
+    job.printFrequency_Hz = m_frequency->value();
+    job.startX_mm = m_startX->value();
+    job.startY_mm = m_startY->value();
+    job.yShiftPerLayer = m_yShift->isChecked();
+    return job;
+}
+
+void SlicerDialog::rebuild_preview()
+{
+    m_previewSlicer = std::make_unique<Slicer::LayerSlicer>(placed_meshes(), slice_settings());
+
+    const int layers = m_previewSlicer->layer_count();
+    m_layerSlider->setEnabled(layers > 0);
+    m_layerSlider->setRange(0, std::max(0, layers - 1));
+    show_layer(m_layerSlider->value());
+}
+
+void SlicerDialog::show_layer(int layer)
+{
+    if (!m_previewSlicer || m_previewSlicer->layer_count() == 0)
+    {
+        m_preview->clear();
+        m_previewInfo->setText("No parts loaded");
+        return;
+    }
+
+    // one layer slices in a few ms, so the preview follows the slider directly
+    const Slicer::LayerImage image = m_previewSlicer->slice_layer(layer);
+    const QImage view(image.pixels.data(), image.width, image.height, image.width, QImage::Format_Grayscale8);
+    m_preview->setPixmap(QPixmap::fromImage(view).scaled(m_preview->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+    std::string error;
+    const bool fits = m_previewSlicer->validate(error);
+    m_previewInfo->setText(QString("Layer %1 / %2 at Z = %3 mm (%4 x %5 px)%6")
+                           .arg(layer + 1)
+                           .arg(m_previewSlicer->layer_count())
+                           .arg(image.z_mm, 0, 'f', 3)
+                           .arg(image.width)
+                           .arg(image.height)
+                           .arg(fits ? QString() : "\n" + QString::fromStdString(error)));
+}
+
+void SlicerDialog::slice()
+{
+    if (m_slicing) return;
+
+    auto slicer = validated_slicer();
+    if (!slicer) return;
+
+    const QString folder = new_job_folder();
+    const Slicer::JobSettings job = job_settings();
+
+    if (m_worker.joinable()) m_worker.join();
+    m_cancel = false;
+    set_slicing(true);
+    m_progress->setRange(0, slicer->layer_count());
+    m_progress->setValue(0);
+    emit print_to_output_window(QString("Slicing %1 layers into %2").arg(slicer->layer_count()).arg(folder));
+
+    // layers are sliced and written on worker threads, progress comes back through the event loop
+    m_worker = std::thread([this, slicer, job, folder]
+    {
+        auto progress = [this](int done, int)
+        {
+            QMetaObject::invokeMethod(this, [this, done]{m_progress->setValue(std::max(done, m_progress->value()));}, Qt::QueuedConnection);
+        };
+        Slicer::JobResult result;
+        std::string error;
+        const bool ok = Slicer::write_job(*slicer, job, QDir::toNativeSeparators(folder).toStdString(), progress, &m_cancel, result, error);
+        QMetaObject::invokeMethod(this, [this, ok, result, error, folder]
+        {
+            slicing_finished(ok, result, QString::fromStdString(error), folder);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SlicerDialog::slice_and_print()
+{
+    if (m_slicing || m_printJobRunning) return;
+
+    auto slicer = validated_slicer();
+    if (!slicer) return;
+
+    const QString archiveFolder = m_archive->isChecked() ? QDir::toNativeSeparators(new_job_folder()) : QString();
+    emit print_to_output_window(QString("Printing %1 layers as they are sliced").arg(slicer->layer_count()));
+
+    // the job prints on its own thread once it has started, the MJ widget
+    // turns print and estimate back on when it is done (set_print_job_running)
+    emit print_requested(slicer, job_settings(), archiveFolder);
+}
+
+void SlicerDialog::estimate()
+{
+    if (m_slicing || m_printJobRunning) return;
+
+    auto slicer = validated_slicer();
+    if (!slicer) return;
+
+    set_slicing(true);
+    m_cancelButton->setEnabled(false);
+    emit estimate_requested(slicer, job_settings());
+}
+
+void SlicerDialog::estimate_finished()
+{
+    set_slicing(false);
+}
+
+std::shared_ptr<Slicer::LayerSlicer> SlicerDialog::validated_slicer()
+{
+    auto slicer = std::make_shared<Slicer::LayerSlicer>(placed_meshes(), slice_settings());
+    std::string error;
+    if (!slicer->validate(error))
+    {
+        QMessageBox::critical(this, "Slicing Error", QString::fromStdString(error) + "\n\nSlicing aborted.");
+        return nullptr;
+    }
+    return slicer;
+}
+
+QString SlicerDialog::new_job_folder() const
+{
+    return QDir(m_outputFolder->text()).filePath(QString::fromStdString(Slicer::default_job_name()));
+}
+
+void SlicerDialog::cancel_slicing()
+{
+    m_cancel = true;
+    m_cancelButton->setEnabled(false);
+}
+
+void SlicerDialog::slicing_finished(bool ok, const Slicer::JobResult &result, const QString &error, const QString &folder)
+{
+    if (m_worker.joinable()) m_worker.join();
+    set_slicing(false);
+
+    if (!ok)
+    {
+        emit print_to_output_window("Slicing stopped: " + error);
+        if (!m_cancel) QMessageBox::critical(this, "Slicing Error", error);
+        return;
+    }
+
+    const QString message = QString("Sliced %1 layers into %2 passes (%3 blank passes skipped) in %4 s\nOutput saved in: %5")
+            .arg(result.layers).arg(result.passes).arg(result.emptyPasses)
+            .arg(result.seconds, 0, 'f', 1).arg(folder);
+    emit print_to_output_window(message);
+    emit job_sliced(folder);
+    QMessageBox::information(this, "Slicing Complete", message);
+}
+
+void SlicerDialog::set_print_job_running(bool running)
+{
+    m_printJobRunning = running;
+    set_slicing(m_slicing);
+}
+
+void SlicerDialog::set_slicing(bool slicing)
+{
+    m_slicing = slicing;
+    m_sliceButton->setEnabled(!slicing);
+    m_printButton->setEnabled(!slicing && !m_printJobRunning);
+    m_estimateButton->setEnabled(!slicing && !m_printJobRunning);
+    m_cancelButton->setEnabled(slicing);
+    m_modelTable->setEnabled(!slicing);
+}
+
+#include "moc_slicerdialog.cpp"
@@ -0,0 +1,170 @@
+#include "strobesweeper.h"
+
+#include <numeric>
+#include <algorithm>
+
+#include "jetdrive.h"
+
+StrobeSweeper::StrobeSweeper(JetDrive::Controller *jetDrive, QObject *parent) :
+    QObject(parent),
+    m_jetDrive(jetDrive)
+{
+    qRegisterMetaType<StrobeSweepReport>("StrobeSweepReport");
+
+    // the serial port lives on the JetDrive's thread, so commands are always queued to it
+    connect(this, &StrobeSweeper::request_strobe_delay,
+            m_jetDrive, &JetDrive::Controller::set_strobe_delay, Qt::QueuedConnection);
+
+    // acks only update the sweep state, so handle them right away on the serial thread
+    connect(m_jetDrive, &JetDrive::Controller::strobe_delay_acknowledged,
+            this, &StrobeSweeper::strobe_delay_acknowledged, Qt::DirectConnection);
+}
+
+void StrobeSweeper::start(const StrobeSweepSettings &settings)
+{
+    int numSteps {0};
+    {
+        QMutexLocker lock(&m_mutex);
+        m_settings = settings;
+        m_report = StrobeSweepReport();
+        m_report.numSteps = settings.num_steps();
+        m_currentStamp = StrobeFrameStamp();
+        m_step = 0;
+        m_framesAtStep = 0;
+        m_clock.start();
+        m_running = true;
+        numSteps = m_report.numSteps;
+        command_step();
+    }
+    emit progress(0, numSteps);
+}
+
+void StrobeSweeper::stop()
+{
+    QMutexLocker lock(&m_mutex);
+    m_running = false;
+}
+
+bool StrobeSweeper::is_running() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_running;
+}
+
+StrobeFrameStamp StrobeSweeper::frame_received(quint64 cameraTimestamp_100ns)
+{
+    bool stepComplete {false};
+    bool sweepComplete {false};
+    int completedSteps {0};
+    int numSteps {0};
+    StrobeFrameStamp stamp;
+    StrobeSweepReport report;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        stamp = m_currentStamp;
+        stamp.cameraTimestamp_100ns = cameraTimestamp_100ns;
+        if (!m_running) return stamp;
+
+        stamp.arrivalTime_us = now_us();
+        m_report.numFrames++;
+
+        // the frame only counts toward the step if the delay was applied
+        // before the frame could have been exposed
+        const bool settled = stamp.is_valid() &&
+                (stamp.arrivalTime_us - stamp.ackTime_us) >= m_settings.settleTime_us;
+        if (!settled)
+        {
+            stamp.strobeDelay_us = -1;
+            m_report.numUnsettledFrames++;
+            return stamp;
+        }
+
+        if (++m_framesAtStep >= m_settings.framesPerStep)
+        {
+            m_report.stepLatency_ms.push_back((stamp.arrivalTime_us - stamp.commandTime_us) / 1000.0);
+            m_framesAtStep = 0;
+            m_step++;
+            stepComplete = true;
+            completedSteps = m_step;
+            numSteps = m_report.numSteps;
+
+            if (m_step >= m_report.numSteps)
+            {
+                finish();
+                sweepComplete = true;
+                report = m_report;
+            }
+            else command_step(); // pipeline the next delay right away
+        }
+    }
+
+    if (stepComplete) emit progress(completedSteps, numSteps);
+    if (sweepComplete) emit sweep_complete(report);
+    return stamp;
+}
+
+void StrobeSweeper::strobe_delay_acknowledged(short strobeDelay_us)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_running) return;
+
+    // ignore stale acks (e.g. from a command sent before the sweep started)
+    if (strobeDelay_us != m_currentStamp.commandedDelay_us) return;
+
+    m_currentStamp.strobeDelay_us = strobeDelay_us;
+    m_currentStamp.ackTime_us = now_us();
+    m_report.ackLatency_ms.push_back((m_currentStamp.ackTime_us - m_currentStamp.commandTime_us) / 1000.0);
+}
+
+void StrobeSweeper::command_step()
+{
+    // expects m_mutex to be locked
+    const int strobeDelay_us = m_settings.startDelay_us + m_step * m_settings.stepDelay_us;
+    const qint64 commandTime_us = now_us();
+
+    m_currentStamp.commandedDelay_us = strobeDelay_us;
+    m_currentStamp.commandTime_us = commandTime_us;
+
+    // the JetDrive doesn't send anything if the delay is unchanged,
+    // so treat that case as already acknowledged
+    if (m_jetDrive->get_jetting_parameters().fStrobeDelay == strobeDelay_us)
+    {
+        m_currentStamp.strobeDelay_us = strobeDelay_us;
+        m_currentStamp.ackTime_us = commandTime_us;
+        m_report.ackLatency_ms.push_back(0.0);
+    }
+    else emit request_strobe_delay(strobeDelay_us);
+}
+
+void StrobeSweeper::finish()
+{
+    // expects m_mutex to be locked
+    m_running = false;
+    m_report.duration_s = now_us() / 1e6;
+    if (m_report.duration_s > 0.0)
+        m_report.stepRate_Hz = m_report.numSteps / m_report.duration_s;
+}
+
+QString StrobeSweeper::report_string(const StrobeSweepReport &report)
+{
+    auto mean = [](const std::vector<double>& v)
+    { return v.empty() ? 0.0 : std::accumulate(v.begin(), v.end(), 0.0) / v.size(); };
+    auto max = [](const std::vector<double>& v)
+    { return v.empty() ? 0.0 : *std::max_element(v.begin(), v.end()); };
+
+    return QString("Strobe sweep: %1 steps in %2 s (%3 steps/s), %4 frames (%5 unsettled)\n"
+                   "  ack latency mean %6 ms, max %7 ms\n"
+                   "  step latency mean %8 ms, max %9 ms")
+            .arg(report.numSteps)
+            .arg(report.duration_s, 0, 'f', 2)
+            .arg(report.stepRate_Hz, 0, 'f', 1)
+            .arg(report.numFrames)
+            .arg(report.numUnsettledFrames)
+            .arg(mean(report.ackLatency_ms), 0, 'f', 2)
+            .arg(max(report.ackLatency_ms), 0, 'f', 2)
+            .arg(mean(report.stepLatency_ms), 0, 'f', 2)
+            .arg(max(report.stepLatency_ms), 0, 'f', 2);
+}
+
+#include "moc_strobesweeper.cpp"
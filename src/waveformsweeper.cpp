@@ -0,0 +1,532 @@
+#include "waveformsweeper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <opencv2/imgproc.hpp>
+#include <nlohmann/json.hpp>
+
+#include "jetdrive.h"
+#include "dropletanalyzer.h"
+
+using json = nlohmann::json;
+
+// ====================================================================
+// SETTINGS
+
+std::vector<double> SweepRange::values(double currentValue) const
+{
+    if (is_empty()) return {currentValue};
+    if (step <= 0.0 || start == end) return {start};
+
+    std::vector<double> v;
+    const double direction = (end >= start) ? 1.0 : -1.0;
+    const int numSteps = static_cast<int>(std::floor(std::abs(end - start) / step + 1e-6));
+    for (int i = 0; i <= numSteps; i++) v.push_back(start + direction * i * step);
+    return v;
+}
+
+namespace
+{
+
+// a range is either a single value or [start, end, step]
+void read_range(const json &j, const char *key, SweepRange &range)
+{
+    if (!j.contains(key)) return;
+    const json &value = j.at(key);
+    if (value.is_number())
+    {
+        range.start = range.end = value.get<double>();
+        range.step = 1.0;
+    }
+    else
+    {
+        range.start = value.at(0).get<double>();
+        range.end = value.at(1).get<double>();
+        range.step = value.at(2).get<double>();
+    }
+}
+
+template<typename T>
+void read_value(const json &j, const char *key, T &value)
+{
+    if (j.contains(key)) value = j.at(key).get<T>();
+}
+
+bool same_timing(const WaveformSweepPoint &a, const WaveformSweepPoint &b)
+{
+    return a.frequency_Hz == b.frequency_Hz &&
+           a.waveform.fTRise == b.waveform.fTRise &&
+           a.waveform.fTDwell == b.waveform.fTDwell &&
+           a.waveform.fTFall == b.waveform.fTFall &&
+           a.waveform.fTEcho == b.waveform.fTEcho &&
+           a.waveform.fTFinal == b.waveform.fTFinal;
+}
+
+}
+
+bool WaveformSweepSettings::from_json(const QByteArray &text, WaveformSweepSettings &settings, QString &error)
+{
+    try
+    {
+        const json j = json::parse(text.constData(), text.constData() + text.size());
+
+        read_range(j, "rise_us", settings.rise_us);
+        read_range(j, "dwell_us", settings.dwell_us);
+        read_range(j, "fall_us", settings.fall_us);
+        read_range(j, "echo_us", settings.echo_us);
+        read_range(j, "final_us", settings.final_us);
+        read_range(j, "voltage_V", settings.voltage_V);
+        read_range(j, "frequency_Hz", settings.frequency_Hz);
+        read_value(j, "echo_follows_dwell", settings.echoFollowsDwell);
+
+        if (j.contains("strobe"))
+        {
+            const json &strobe = j.at("strobe");
+            read_value(strobe, "start_us", settings.strobe.startDelay_us);
+            read_value(strobe, "end_us", settings.strobe.endDelay_us);
+            read_value(strobe, "step_us", settings.strobe.stepDelay_us);
+            read_value(strobe, "frames_per_step", settings.strobe.framesPerStep);
+        }
+        read_value(j, "settle_ms", settings.settleTime_ms);
+        read_value(j, "point_timeout_ms", settings.pointTimeout_ms);
+
+        read_value(j, "target_velocity_m_s", settings.targetVelocity_m_s);
+        if (j.contains("weights"))
+        {
+            const json &weights = j.at("weights");
+            read_value(weights, "velocity", settings.velocityWeight);
+            read_value(weights, "angle", settings.angleWeight);
+            read_value(weights, "satellites", settings.satelliteWeight);
+        }
+        read_value(j, "max_velocity_m_s", settings.maxVelocity_m_s);
+        read_value(j, "max_satellites", settings.maxSatellites);
+        read_value(j, "min_tracked_points", settings.minTrackedPoints);
+    }
+    catch (const json::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+
+    if (settings.strobe.stepDelay_us <= 0 || settings.strobe.endDelay_us < settings.strobe.startDelay_us)
+    {
+        error = "the strobe sweep needs a positive step and an end delay after the start delay";
+        return false;
+    }
+    return true;
+}
+
+QString WaveformSweepPoint::status_string(Status status)
+{
+    switch (status)
+    {
+    case Status::Pending: return "PENDING";
+    case Status::Ok: return "OK";
+    case Status::NoDroplet: return "NO_DROPLET";
+    case Status::TooFast: return "TOO_FAST";
+    case Status::TooManySatellites: return "SATELLITES";
+    case Status::Skipped: return "SKIPPED";
+    case Status::TimedOut: return "TIMED_OUT";
+    }
+    return QString();
+}
+
+// ====================================================================
+// SWEEPER
+
+WaveformSweeper::WaveformSweeper(JetDrive::Controller *jetDrive, QObject *parent) :
+    QObject(parent),
+    m_jetDrive(jetDrive)
+{
+    qRegisterMetaType<WaveformSweepPoint>("WaveformSweepPoint");
+
+    // a separate analyzer so the sweep doesn't touch the video loaded in the analyzer window
+    m_analyzer = std::make_unique<DropletAnalyzer>();
+    connect(m_analyzer.get(), &DropletAnalyzer::print_to_output_window, this, &WaveformSweeper::print_to_output_window);
+
+    m_strobeSweeper = new StrobeSweeper(m_jetDrive, this);
+
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+    connect(m_timeoutTimer, &QTimer::timeout, this, &WaveformSweeper::point_timed_out);
+}
+
+WaveformSweeper::~WaveformSweeper()
+{
+    m_collecting = false;
+    disconnect(m_frameConnection);
+    if (m_running) restore_jet_drive();
+}
+
+bool WaveformSweeper::start(const WaveformSweepSettings &settings, Camera *camera,
+                            const DropletCameraSettings &cameraSettings, const QString &resultsFile)
+{
+    if (m_running || !camera) return false;
+
+    m_results.open(resultsFile.toStdString());
+    if (!m_results.is_open())
+    {
+        emit print_to_output_window("Could not open " + resultsFile);
+        return false;
+    }
+    m_results << "POINT,"
+                 "RISE_TIME_1,DWELL_TIME,FALL_TIME,ECHO_TIME,RISE_TIME_2,"
+                 "IDLE_VOLTAGE,DWELL_VOLTAGE,ECHO_VOLTAGE,"
+                 "FREQUENCY,"
+                 "STATUS,"
+                 "TRACKED_POINTS,"
+                 "DROPLET_VELOCITY,"
+                 "JET_ANGLE,"
+                 "SATELLITES,"
+                 "SCORE"
+                 "\n";
+    m_results << ","
+                 "us,us,us,us,us,"
+                 "V,V,V,"
+                 "Hz,"
+                 ","
+                 ","
+                 "m/s,"
+                 "deg,"
+                 ","
+                 "\n";
+
+    m_settings = settings;
+    m_camera = camera;
+    m_analyzer->camera_settings() = cameraSettings;
+    m_originalSettings = m_jetDrive->get_jetting_parameters();
+    build_points();
+    m_pointIndex = 0;
+    m_running = true;
+    m_clock.start();
+
+    // frames go straight from the camera event thread into memory, no video file is written
+    m_frameConnection = connect(m_camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
+                                this, [this](ImageBufferPtr buffer){ this->frame_received(buffer); }, Qt::DirectConnection);
+
+    emit print_to_output_window(QString("Waveform sweep: %1 points, results are saved to %2")
+                                .arg(m_points.size()).arg(resultsFile));
+
+    m_jetDrive->set_num_drops_per_trigger(1);
+    m_jetDrive->set_continuous_mode_frequency(m_points.front().frequency_Hz);
+    m_jetDrive->start_continuous_jetting();
+    run_point();
+    return true;
+}
+
+void WaveformSweeper::stop()
+{
+    if (!m_running) return;
+    finish(true);
+}
+
+void WaveformSweeper::build_points()
+{
+    const JetDrive::Waveform current = m_originalSettings.waveform;
+
+    // voltage is the innermost loop (and always increasing) so hopeless voltages can be skipped
+    std::vector<double> voltages = m_settings.voltage_V.values(current.fUDwell);
+    std::sort(voltages.begin(), voltages.end());
+
+    m_points.clear();
+    for (double frequency : m_settings.frequency_Hz.values(m_originalSettings.fFrequency))
+    for (double rise : m_settings.rise_us.values(current.fTRise))
+    for (double dwell : m_settings.dwell_us.values(current.fTDwell))
+    for (double fall : m_settings.fall_us.values(current.fTFall))
+    for (double echo : m_settings.echo_us.values(current.fTEcho))
+    for (double finalRise : m_settings.final_us.values(current.fTFinal))
+    for (double voltage : voltages)
+    {
+        WaveformSweepPoint point;
+        point.index = m_points.size();
+        point.frequency_Hz = std::lround(frequency);
+        point.waveform = current;
+        point.waveform.fTRise = rise;
+        point.waveform.fTDwell = dwell;
+        point.waveform.fTFall = fall;
+        point.waveform.fTEcho = echo;
+        point.waveform.fTFinal = finalRise;
+        point.waveform.fUDwell = static_cast<short>(std::lround(voltage));
+        if (m_settings.echoFollowsDwell) point.waveform.fUEcho = -point.waveform.fUDwell;
+        m_points.push_back(point);
+    }
+}
+
+void WaveformSweeper::run_point()
+{
+    if (!m_running) return;
+
+    // points in a hopeless region are still listed in the table
+    while (m_pointIndex < m_points.size() && m_points[m_pointIndex].status == WaveformSweepPoint::Status::Skipped)
+    {
+        write_row(m_points[m_pointIndex]);
+        emit point_complete(m_points[m_pointIndex], m_points.size());
+        m_pointIndex++;
+    }
+    if (m_pointIndex >= m_points.size())
+    {
+        finish(false);
+        return;
+    }
+
+    const WaveformSweepPoint &point = m_points[m_pointIndex];
+    m_jetDrive->set_waveform(point.waveform);
+    m_jetDrive->set_continuous_mode_frequency(point.frequency_Hz);
+
+    // let the jet settle into the new waveform before looking at it
+    const int generation = ++m_generation;
+    QTimer::singleShot(m_settings.settleTime_ms, this, [this, generation]()
+    {
+        if (m_running && generation == m_generation) start_strobe_sweep();
+    });
+}
+
+void WaveformSweeper::start_strobe_sweep()
+{
+    {
+        QMutexLocker lock(&m_frameMutex);
+        m_frames.clear();
+        m_stamps.clear();
+        m_frames.reserve(m_settings.strobe.num_steps() * m_settings.strobe.framesPerStep);
+        m_stamps.reserve(m_settings.strobe.num_steps() * m_settings.strobe.framesPerStep);
+    }
+    m_strobeSweeper->start(m_settings.strobe);
+    m_collecting = true;
+    m_timeoutTimer->start(m_settings.pointTimeout_ms);
+}
+
+void WaveformSweeper::frame_received(ImageBufferPtr buffer)
+{
+    // runs on the camera event thread
+    if (!m_collecting) return;
+
+    const StrobeFrameStamp stamp = m_strobeSweeper->frame_received(buffer->image_info().u64TimestampDevice);
+
+    const auto &props = buffer->buffer_props();
+    const int type = (props.bitspp == 32) ? CV_8UC4 : (props.bitspp == 24) ? CV_8UC3 : CV_8UC1;
+    const cv::Mat image(props.height, props.width, type, buffer->data());
+    cv::Mat gray;
+    if (type == CV_8UC4) cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    else if (type == CV_8UC3) cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    else gray = image.clone(); // the sequence buffer is reused by the camera
+
+    {
+        QMutexLocker lock(&m_frameMutex);
+        m_frames.push_back(gray);
+        m_stamps.push_back(stamp);
+    }
+
+    if (!m_strobeSweeper->is_running() && m_collecting.exchange(false))
+    {
+        const int generation = m_generation;
+        QMetaObject::invokeMethod(this, [this, generation](){ this->analyze_point(generation); }, Qt::QueuedConnection);
+    }
+}
+
+void WaveformSweeper::analyze_point(int generation)
+{
+    if (!m_running || generation != m_generation) return;
+    m_timeoutTimer->stop();
+
+    std::vector<cv::Mat> frames;
+    std::vector<StrobeFrameStamp> stamps;
+    {
+        QMutexLocker lock(&m_frameMutex);
+        frames.swap(m_frames);
+        stamps.swap(m_stamps);
+    }
+    if (frames.empty())
+    {
+        point_analyzed(generation, DropTrackingData());
+        return;
+    }
+
+    const double stepTime_us = m_settings.strobe.stepDelay_us;
+    const JetDrive::Settings jetSettings = m_jetDrive->get_jetting_parameters();
+
+    // same analysis as the analyzer window, on the analyzer's thread
+    QMetaObject::invokeMethod(m_analyzer.get(), [this, generation, frames, stamps, stepTime_us, jetSettings]()
+    {
+        m_analyzer->reset();
+        m_analyzer->set_jetting_settings(jetSettings);
+        m_analyzer->set_strobe_step_time(stepTime_us);
+        m_analyzer->load_frames(frames, stamps);
+        m_analyzer->analyze_video();
+        const DropTrackingData data = m_analyzer->get_droplet_tracking_data();
+        QMetaObject::invokeMethod(this, [this, generation, data](){ this->point_analyzed(generation, data); }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void WaveformSweeper::point_analyzed(int generation, const DropTrackingData &data)
+{
+    if (!m_running || generation != m_generation) return;
+
+    WaveformSweepPoint &point = m_points[m_pointIndex];
+    score(point, data);
+    write_row(point);
+    emit point_complete(point, m_points.size());
+    emit print_to_output_window(point_string(point));
+
+    skip_hopeless_points(point);
+    next_point();
+}
+
+void WaveformSweeper::point_timed_out()
+{
+    if (!m_running) return;
+
+    m_collecting = false;
+    m_strobeSweeper->stop();
+    m_generation++; // a late sweep result belongs to this point, not the next one
+
+    WaveformSweepPoint &point = m_points[m_pointIndex];
+    point.status = WaveformSweepPoint::Status::TimedOut;
+    write_row(point);
+    emit point_complete(point, m_points.size());
+    emit print_to_output_window(point_string(point));
+    next_point();
+}
+
+void WaveformSweeper::score(WaveformSweepPoint &point, const DropTrackingData &data) const
+{
+    point.trackedPoints = data.t.size();
+    if (point.trackedPoints < m_settings.minTrackedPoints)
+    {
+        point.status = WaveformSweepPoint::Status::NoDroplet;
+        point.score = std::numeric_limits<double>::quiet_NaN();
+        return;
+    }
+
+    point.velocity_m_s = data.velocity_m_s;
+    point.angle_deg = data.drop_angle_rad * 180.0 / CV_PI;
+    point.satellites = data.satellites;
+
+    const double velocityError = (m_settings.targetVelocity_m_s > 0.0) ?
+                std::abs(point.velocity_m_s - m_settings.targetVelocity_m_s) / m_settings.targetVelocity_m_s : 0.0;
+    point.score = m_settings.velocityWeight * velocityError +
+                  m_settings.angleWeight * std::abs(point.angle_deg) +
+                  m_settings.satelliteWeight * point.satellites;
+
+    if (point.velocity_m_s > m_settings.maxVelocity_m_s) point.status = WaveformSweepPoint::Status::TooFast;
+    else if (point.satellites > m_settings.maxSatellites) point.status = WaveformSweepPoint::Status::TooManySatellites;
+    else point.status = WaveformSweepPoint::Status::Ok;
+}
+
+void WaveformSweeper::skip_hopeless_points(const WaveformSweepPoint &point)
+{
+    // more voltage only makes the droplet faster and break up more
+    if (point.status != WaveformSweepPoint::Status::TooFast &&
+        point.status != WaveformSweepPoint::Status::TooManySatellites) return;
+
+    int numSkipped {0};
+    for (size_t i = m_pointIndex + 1; i < m_points.size() && same_timing(m_points[i], point); i++)
+    {
+        m_points[i].status = WaveformSweepPoint::Status::Skipped;
+        numSkipped++;
+    }
+    if (numSkipped > 0)
+        emit print_to_output_window(QString("  skipping %1 higher voltage point(s)").arg(numSkipped));
+}
+
+void WaveformSweeper::write_row(const WaveformSweepPoint &point)
+{
+    const auto &w = point.waveform;
+    m_results << point.index << ","
+              << w.fTRise << "," << w.fTDwell << "," << w.fTFall << "," << w.fTEcho << "," << w.fTFinal << ","
+              << w.fUIdle << "," << w.fUDwell << "," << w.fUEcho << ","
+              << point.frequency_Hz << ","
+              << WaveformSweepPoint::status_string(point.status).toStdString() << ",";
+    if (point.has_droplet())
+    {
+        m_results << point.trackedPoints << ","
+                  << point.velocity_m_s << ","
+                  << point.angle_deg << ","
+                  << point.satellites << ","
+                  << point.score;
+    }
+    else m_results << point.trackedPoints << ",,,,";
+    m_results << "\n";
+    m_results.flush(); // keep what has been measured if the sweep is interrupted
+}
+
+void WaveformSweeper::next_point()
+{
+    m_pointIndex++;
+    run_point();
+}
+
+void WaveformSweeper::finish(bool stopped)
+{
+    m_running = false;
+    m_collecting = false;
+    m_generation++;
+    m_timeoutTimer->stop();
+    m_strobeSweeper->stop();
+    disconnect(m_frameConnection);
+    m_results.close();
+
+    restore_jet_drive();
+
+    WaveformSweepPoint best;
+    int numMeasured {0};
+    int numSkipped {0};
+    for (const auto &point : m_points)
+    {
+        if (point.status == WaveformSweepPoint::Status::Skipped) numSkipped++;
+        else if (point.status != WaveformSweepPoint::Status::Pending) numMeasured++;
+        if (point.status == WaveformSweepPoint::Status::Ok &&
+            (best.status != WaveformSweepPoint::Status::Ok || point.score < best.score)) best = point;
+    }
+
+    emit print_to_output_window(QString("Waveform sweep %1: %2 points measured, %3 skipped in %4 min")
+                                .arg(stopped ? "stopped" : "complete")
+                                .arg(numMeasured).arg(numSkipped)
+                                .arg(m_clock.elapsed() / 60000.0, 0, 'f', 1));
+    if (best.status == WaveformSweepPoint::Status::Ok)
+        emit print_to_output_window("Best " + point_string(best));
+    else
+        emit print_to_output_window("No point met the limits");
+    emit sweep_finished(best, stopped);
+}
+
+void WaveformSweeper::restore_jet_drive()
+{
+    // put the JetDrive back the way it was, including its trigger source and mode
+    m_jetDrive->stop_continuous_jetting();
+    m_jetDrive->set_waveform(m_originalSettings.waveform);
+    m_jetDrive->set_continuous_mode_frequency(m_originalSettings.fFrequency);
+    m_jetDrive->set_num_drops_per_trigger(m_originalSettings.fDrops);
+
+    if (m_originalSettings.fMode == 1 && m_originalSettings.fSource == 0)
+    {
+        // it was jetting on its own trigger
+        m_jetDrive->start_continuous_jetting();
+        return;
+    }
+    if (m_originalSettings.fSource == 0) m_jetDrive->set_internal_trigger();
+    else m_jetDrive->set_external_trigger();
+    if (m_originalSettings.fMode == 1) m_jetDrive->set_continuous_jetting();
+}
+
+QString WaveformSweeper::point_string(const WaveformSweepPoint &point)
+{
+    const auto &w = point.waveform;
+    QString s = QString("point %1: rise %2, dwell %3, fall %4, echo %5, final %6 us, %7 V, %8 Hz -> %9")
+            .arg(point.index)
+            .arg(w.fTRise).arg(w.fTDwell).arg(w.fTFall).arg(w.fTEcho).arg(w.fTFinal)
+            .arg(w.fUDwell).arg(point.frequency_Hz)
+            .arg(WaveformSweepPoint::status_string(point.status));
+    if (point.has_droplet())
+    {
+        s += QString(" (%1 m/s, %2 deg, %3 satellites, score %4)")
+                .arg(point.velocity_m_s, 0, 'f', 2)
+                .arg(point.angle_deg, 0, 'f', 2)
+                .arg(point.satellites, 0, 'f', 1)
+                .arg(point.score, 0, 'f', 3);
+    }
+    return s;
+}
+
+#include "moc_waveformsweeper.cpp"
@@ -88,17 +88,35 @@ BedMicroscopeWidget::BedMicroscopeWidget(Printer *printer, QWidget *parent) :
     connect(ui->setSaveFolderButton, &QPushButton::clicked, this, &BedMicroscopeWidget::set_save_folder);
     connect(ui->captureImagesButton, &QPushButton::clicked, this, &BedMicroscopeWidget::capture_images);
 
+    scanner = new BedScanner(mPrinter->bedMicroscope);
+    // let the running DMC program move to the next position as soon as the frames are captured.
+    // The write is checked and can take a while, so it is made on the scanner's thread
+    DMC4080 *mcu = mPrinter->mcu;
+    scanner->set_tile_done_handler([mcu]() {return mcu->set_program_variable("capDone", 1);});
+    connect(scanner, &BedScanner::mosaic_updated, this, [this](const QImage &mosaic)
+    {
+        if (isScanning) ui->imageDisplay->setImage(mosaic);
+    });
+    connect(scanner, &BedScanner::scan_finished, this, &BedMicroscopeWidget::scan_finished);
+    connect(scanner, &BedScanner::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+
 //    update_display(createImage());
 }
 
 BedMicroscopeWidget::~BedMicroscopeWidget()
 {
+    delete scanner;
     delete ui;
 }
 
 void BedMicroscopeWidget::allow_widget_input(bool allowed)
 {
     ui->frame->setEnabled(allowed);
+    // input is allowed again once the scan program has finished
+    if (allowed && isScanning)
+    {
+        QMetaObject::invokeMethod(scanner, &BedScanner::finish, Qt::QueuedConnection);
+    }
 }
 
 void BedMicroscopeWidget::connect_to_camera()
@@ -149,6 +167,7 @@ void BedMicroscopeWidget::connect_to_camera()
 
 void BedMicroscopeWidget::update_display(const QImage &image)
 {
+    if (isScanning) return;
     ui->imageDisplay->setImage(image);
 }
 
@@ -199,9 +218,12 @@ void BedMicroscopeWidget::capture_images()
     s << "AM XY;\n"; // after motion complete
     s << "WT 500;\n"; // wait for 0.5 seconds
     s << "nxStr = (97+nx)*$1000000;\n";
+    s << "capDone = 0;\n";
     s << "MG \"CMD MICRO_CAP \", nxStr{S1}, (ny+1){Z2.0}\n"; // request image
 //    s << "MG \"CMD MICRO_CAP \" {^(97+nx)}, (ny+1){Z1.0}\n"; // request image
-    s << "WT 1000;\n"; // wait for 1 second
+    s << "t0 = TIME;\n";
+    s << "#waitCap;\n"; // wait until the host has captured the image (5 second timeout)
+    s << "JP #waitCap, ((capDone = 0) & ((TIME - t0) < 5000));\n";
     s << "nx = nx + 1\n";
     s << "JP #loopX, (nx < " << ui->numXSpinBox->value() << ");\n";
     s << "nx = 0;\n"; // reset x variable
@@ -214,6 +236,7 @@ void BedMicroscopeWidget::capture_images()
     s << "DA *,*[0];\n"; //Deallocate all variables and all arrays
     s << "DM xPos[" << ui->numXSpinBox->value() << "];\n"; // define x array
     s << "DM yPos[" << ui->numYSpinBox->value() << "];\n"; // define x array
+    s << "capDone = 0;\n";
     s << "\n";
     // populate x-values
     for (int i = 0; i < ui->numXSpinBox->value(); ++i)
@@ -243,6 +266,16 @@ void BedMicroscopeWidget::capture_images()
     {
         GProgramDownload(mPrinter->mcu->g, program, "--max 4");
     }
+    BedScanSettings settings;
+    settings.numX = ui->numXSpinBox->value();
+    settings.numY = ui->numYSpinBox->value();
+    settings.xSpacing_mm = ui->xSpacingSpinBox->value();
+    settings.ySpacing_mm = ui->ySpacingSpinBox->value();
+    settings.folder = saveFolderPath;
+    settings.bedID = ui->bedIDSpinBox->value();
+    QMetaObject::invokeMethod(scanner, [this, settings]() { scanner->start(settings); }, Qt::QueuedConnection);
+    isScanning = true;
+
     std::stringstream s2;
     s2 << "GCmd," << "XQ #BEGIN" << "\n";
     s2 << "GProgramComplete," << "\n";
@@ -255,11 +288,16 @@ void BedMicroscopeWidget::capture_images()
 
 void BedMicroscopeWidget::export_image(const QString &position)
 {
-    int bedID = ui->bedIDSpinBox->value();
-    QString fileName = QString("%1/%2_%3.png").arg(saveFolderPath).arg(QString::number(bedID).rightJustified(3, '0')).arg(position);
-    mPrinter->bedMicroscope->save_image(fileName);
+    // frames are captured and saved on the scanner's thread
+    QMetaObject::invokeMethod(scanner, [this, position]() { scanner->capture_tile(position); }, Qt::QueuedConnection);
 //    ui->imageDisplay->saveCurrentFrame(fileName);
 }
 
+void BedMicroscopeWidget::scan_finished(const QString &mosaicFile)
+{
+    isScanning = false;
+    if (!mosaicFile.isEmpty()) emit print_to_output_window(QString("Bed mosaic saved to %1").arg(mosaicFile));
+}
+
 #include "bedmicroscopewidget.moc"
 #include "moc_bedmicroscopewidget.cpp"
@@ -5,6 +5,8 @@
 #include <QStandardPaths>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QLabel>
+#include <QPushButton>
 
 #include "ueye.h"
 #include "ueye_tools.h"
@@ -89,6 +91,34 @@ DropletObservationWidget::DropletObservationWidget(Printer *printer, QWidget *pa
     // allow the droplet analyzer and widget to print to the sidebar ouput window
     connect(m_analyzerWidget, &DropletAnalyzerWidget::print_to_output_window, this, &PrinterWidget::print_to_output_window);
     connect(m_analyzer.get(), &DropletAnalyzer::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+
+    m_sweeper = new StrobeSweeper(mPrinter->jetDrive, this);
+    connect(m_sweeper, &StrobeSweeper::progress, this, [this](int completedSteps, int numSteps)
+    {
+        ui->sweepProgressBar->setMaximum(numSteps);
+        ui->sweepProgressBar->setValue(completedSteps);
+    });
+    connect(m_sweeper, &StrobeSweeper::sweep_complete, this, &DropletObservationWidget::strobe_sweep_complete);
+
+    // unattended waveform design of experiments, set up from a JSON file
+    m_waveformSweeper = new WaveformSweeper(mPrinter->jetDrive, this);
+    connect(m_waveformSweeper, &WaveformSweeper::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+    connect(m_waveformSweeper, &WaveformSweeper::point_complete, this, [this](const WaveformSweepPoint &point, int numPoints)
+    {
+        ui->sweepProgressBar->setMaximum(numPoints);
+        ui->sweepProgressBar->setValue(point.index + 1);
+    });
+    connect(m_waveformSweeper, &WaveformSweeper::sweep_finished, this, &DropletObservationWidget::waveform_sweep_finished);
+    m_waveformSweepButton = new QPushButton("Waveform Sweep...", this);
+    ui->sweepLayout->addWidget(m_waveformSweepButton, ui->sweepLayout->rowCount(), 0, 1, -1);
+    connect(m_waveformSweepButton, &QPushButton::clicked, this, &DropletObservationWidget::waveform_sweep_clicked);
+
+    // live focus / exposure metrics shown under the camera settings
+    m_frameMetrics = std::make_unique<FrameMetricsProcessor>();
+    connect(m_frameMetrics.get(), &FrameMetricsProcessor::metrics_updated, this, &DropletObservationWidget::frame_metrics_updated);
+    m_frameMetricsLabel = new QLabel(this);
+    m_frameMetricsLabel->setWordWrap(true);
+    ui->cameraSettingsLayout->addWidget(m_frameMetricsLabel, ui->cameraSettingsLayout->rowCount(), 0, 1, -1);
     setup();
 }
 
@@ -112,6 +142,12 @@ void DropletObservationWidget::setup()
 
     // enable droplet analyzer widget when analysis is complete
     connect(m_analyzer.get(), &DropletAnalyzer::video_analysis_successful, this, [this](){this->ui->frame->setEnabled(true);});
+
+    // measured velocities feed the pressure loop when it is running on droplet velocity
+    connect(m_analyzer.get(), &DropletAnalyzer::video_analysis_successful, this, [this]()
+    {
+        this->pressureControllerWidget->droplet_velocity_measured(this->m_analyzer->get_droplet_tracking_data().velocity_m_s);
+    });
 }
 
 void DropletObservationWidget::allow_widget_input(bool allowed)
@@ -237,6 +273,18 @@ void DropletObservationWidget::connect_to_camera()
                         // There has to be a better way to get these pointers / shared pointers...
                         m_cameraHandle = subWindow->camera()->handle();
                         m_Camera = subWindow->camera().get();
+
+                        // focus on the region below the nozzle and show it on the display
+                        FrameMetricsSettings metricsSettings = m_frameMetrics->settings();
+                        metricsSettings.focusAOI = QRect(m_AOIWidth / 4, 0, m_AOIWidth / 2, 512);
+                        m_frameMetrics->set_settings(metricsSettings);
+                        AUTOFOCUS_AOI focusAOI {};
+                        focusAOI.rcAOI = {metricsSettings.focusAOI.x(), metricsSettings.focusAOI.y(),
+                                          metricsSettings.focusAOI.width(), metricsSettings.focusAOI.height()};
+                        subWindow->setFocusAOI(focusAOI, true);
+
+                        connect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
+                                m_frameMetrics.get(), &FrameMetricsProcessor::frame_received, Qt::DirectConnection);
                     }
 
                     if (numCams == 1) subWindow->showMaximized();
@@ -259,6 +307,10 @@ void DropletObservationWidget::connect_to_camera()
 void DropletObservationWidget::camera_closed()
 {
     // runs when SubWindow is destroyed (camera is closed)
+    m_sweeper->stop();
+    m_waveformSweeper->stop();
+    QMetaObject::invokeMethod(m_frameMetrics.get(), &FrameMetricsProcessor::reset, Qt::QueuedConnection);
+    m_frameMetricsLabel->clear();
     m_Camera = nullptr; // no need to delete, this is handled by SubWindow
     m_cameraHandle = 0;
     // update GUI
@@ -342,6 +394,11 @@ void DropletObservationWidget::capture_video()
     isavi_StartAVI(m_aviID);
 
     m_numFramesToCapture = std::round((ui->endTimeSpinBox->value() - ui->startTimeSpinBox->value()) / ui->stepTimeSpinBox->value()) + 1;
+    {
+        QMutexLocker lock(&m_frameStampMutex);
+        m_frameStamps.clear();
+        m_frameStamps.reserve(m_numFramesToCapture);
+    }
     allow_widget_input(false);
     m_captureVideoWithSweep = true;
     start_strobe_sweep();
@@ -418,37 +475,53 @@ void DropletObservationWidget::update_progress_bar()
 
 void DropletObservationWidget::start_strobe_sweep()
 {
-    // TODO: something here very occasionally sometimes causes a crash
-    // probably either calling from the wrong thread or
-    // a missing mutex lock
+    StrobeSweepSettings settings;
+    settings.startDelay_us = ui->startTimeSpinBox->value();
+    settings.endDelay_us = ui->endTimeSpinBox->value();
+    settings.stepDelay_us = ui->stepTimeSpinBox->value();
+
+    // a frame that arrives less than an exposure after the ack may have been lit at the old delay
+    double exposure_ms{0.0};
+    is_Exposure(m_cameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE, &exposure_ms, sizeof(exposure_ms));
+    settings.settleTime_us = static_cast<int>(exposure_ms * 1000.0);
+
+    // the sweep is advanced from the camera event thread as frames arrive,
+    // so it doesn't wait on the GUI to process each frame. It is running before
+    // the first frame gets to it, or that frame would end the sweep (and the video)
+    m_sweeper->start(settings);
+    connect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
+            this, &DropletObservationWidget::frame_received_during_sweep,
+            static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
+}
 
-    // start strobe sweep
-    update_strobe_sweep_offset();
+void DropletObservationWidget::frame_received_during_sweep(ImageBufferPtr buffer)
+{
+    const StrobeFrameStamp stamp = m_sweeper->frame_received(buffer->image_info().u64TimestampDevice);
+    const bool sweepComplete = !m_sweeper->is_running();
 
-    // update the strobe sweep offset when a new frame is received
-    // framereceived from eventthread
-    // update must be done from the main thread (accesses ui) (default queued connection)
-    connect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
-            this, &DropletObservationWidget::update_strobe_sweep_offset);
+    if (m_captureVideoWithSweep) add_frame_to_avi(buffer, stamp, sweepComplete);
 
-    if (m_captureVideoWithSweep) // if also capturing a video
+    if (sweepComplete)
     {
-        // when a frame is added to the camera, add it to the avi file
-        // framereceived signal from event thread
-        connect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
-                this, &DropletObservationWidget::add_frame_to_avi, Qt::DirectConnection);
+        disconnect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
+                   this, &DropletObservationWidget::frame_received_during_sweep);
     }
 }
 
-void DropletObservationWidget::add_frame_to_avi(ImageBufferPtr buffer)
+void DropletObservationWidget::add_frame_to_avi(ImageBufferPtr buffer, const StrobeFrameStamp &stamp, bool sweepComplete)
 {
-    isavi_AddFrame(m_aviID, reinterpret_cast<char*>(buffer->data()));
-    m_numCapturedFrames++;
-    if (m_numCapturedFrames >= m_numFramesToCapture)
+    // frames the encoder drops are not in the video, so they don't get a stamp
+    if (isavi_AddFrame(m_aviID, reinterpret_cast<char*>(buffer->data())) == IS_AVI_NO_ERR)
+    {
+        QMutexLocker lock(&m_frameStampMutex);
+        m_frameStamps.push_back(stamp);
+        m_numCapturedFrames++;
+    }
+
+    if (sweepComplete)
     {
         // don't add any more frames
-        disconnect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
-                   this, &DropletObservationWidget::add_frame_to_avi);
+        m_captureVideoWithSweep = false;
         emit video_capture_complete();
         unsigned long nLostFrames {777};
         isavi_GetnLostFrames(m_aviID, &nLostFrames);
@@ -462,39 +535,85 @@ void DropletObservationWidget::stop_avi_capture()
     isavi_StopAVI(m_aviID);
     isavi_CloseAVI(m_aviID);
     isavi_ExitAVI(m_aviID);
+    {
+        QMutexLocker lock(&m_frameStampMutex);
+        if (!write_frame_stamps(frame_stamp_file_path(m_tempFileName.toStdString()), m_frameStamps))
+            emit print_to_output_window("Could not save the strobe delay of each frame");
+    }
     this->allow_widget_input(true);
     this->m_videoHasBeenTaken = true;
     this->ui->SaveVideoButton->setEnabled(true);
-    this->m_captureVideoWithSweep = false;
 }
 
-void DropletObservationWidget::update_strobe_sweep_offset()
+void DropletObservationWidget::strobe_sweep_complete(const StrobeSweepReport &report)
 {
+    ui->sweepProgressBar->setValue(0);
+    emit print_to_output_window(StrobeSweeper::report_string(report));
+}
 
-    //mSweepTimer->stop();
-
-    if (m_currentStrobeOffset == -1) // if starting strobe sweep
+void DropletObservationWidget::waveform_sweep_clicked()
+{
+    if (m_waveformSweeper->is_running())
     {
-        m_currentStrobeOffset = ui->startTimeSpinBox->value();
-        mPrinter->jetDrive->set_strobe_delay(m_currentStrobeOffset);
-        const int timeToStepThrough = (ui->endTimeSpinBox->value() - ui->startTimeSpinBox->value());
-        ui->sweepProgressBar->setMaximum(timeToStepThrough);
-        //emit print_to_output_window(QString::number(mCurrentStrobeOffset));
+        m_waveformSweeper->stop();
+        return;
     }
-    else if (m_currentStrobeOffset >= ui->endTimeSpinBox->value()) // if sweep complete
+    if (m_isJetting)
     {
-        disconnect(m_Camera, static_cast<void (Camera::*)(ImageBufferPtr)>(&Camera::frameReceived),
-                   this, &DropletObservationWidget::update_strobe_sweep_offset);
-        m_currentStrobeOffset = -1;
-        ui->sweepProgressBar->setValue(0);
+        QMessageBox::warning(this, "Waveform Sweep", "Stop jetting before starting a waveform sweep");
+        return;
+    }
+
+    QString settingsFile = QFileDialog::getOpenFileName(this, "Waveform sweep settings", "", "Sweep Settings (*.json)");
+    if (settingsFile.isEmpty()) return;
+    QFile file(settingsFile);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        QMessageBox::warning(this, "Waveform Sweep", "Could not open " + settingsFile);
+        return;
     }
-    else // increment strobe sweep offset
+
+    // the strobe sweep defaults to the one set up in this widget
+    WaveformSweepSettings settings;
+    settings.strobe.startDelay_us = ui->startTimeSpinBox->value();
+    settings.strobe.endDelay_us = ui->endTimeSpinBox->value();
+    settings.strobe.stepDelay_us = ui->stepTimeSpinBox->value();
+    double exposure_ms{0.0};
+    is_Exposure(m_cameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE, &exposure_ms, sizeof(exposure_ms));
+    settings.strobe.settleTime_us = static_cast<int>(exposure_ms * 1000.0);
+
+    QString error;
+    if (!WaveformSweepSettings::from_json(file.readAll(), settings, error))
     {
-        m_currentStrobeOffset += ui->stepTimeSpinBox->value();
-        mPrinter->jetDrive->set_strobe_delay(m_currentStrobeOffset);
-        // update progress bar
-        ui->sweepProgressBar->setValue(m_currentStrobeOffset - ui->startTimeSpinBox->value());
+        QMessageBox::warning(this, "Waveform Sweep", "Invalid sweep settings: " + error);
+        return;
     }
+
+    QString resultsFile = QFileDialog::getSaveFileName(this, "Save results as", "", "CSV File (*.csv)");
+    if (resultsFile.isEmpty()) return;
+
+    if (!m_waveformSweeper->start(settings, m_Camera, m_analyzer->camera_settings(), resultsFile)) return;
+
+    m_waveformSweepButton->setText("Stop Waveform Sweep");
+    ui->takeVideoButton->setEnabled(false);
+    ui->sweepButton->setEnabled(false);
+    ui->TriggerJetButton->setEnabled(false);
+    ui->jetForMinutesButton->setEnabled(false);
+}
+
+void DropletObservationWidget::waveform_sweep_finished(const WaveformSweepPoint &, bool)
+{
+    m_waveformSweepButton->setText("Waveform Sweep...");
+    ui->sweepProgressBar->setValue(0);
+    ui->takeVideoButton->setEnabled(m_cameraIsConnected);
+    ui->sweepButton->setEnabled(true);
+    ui->TriggerJetButton->setEnabled(true);
+    ui->jetForMinutesButton->setEnabled(true);
+}
+
+void DropletObservationWidget::frame_metrics_updated(const FrameMetrics &metrics)
+{
+    m_frameMetricsLabel->setText(FrameMetricsProcessor::metrics_string(metrics));
 }
 
 void DropletObservationWidget::trigger_jet_clicked()
@@ -542,6 +661,9 @@ void DropletObservationWidget::save_video_clicked()
         QMessageBox::warning(this, "Warning", "Did not save file");
         return;
     }
+    // keep the frame stamps with the video so it can be re-analyzed later
+    QFile::copy(QString::fromStdString(frame_stamp_file_path(m_tempFileName.toStdString())),
+                QString::fromStdString(frame_stamp_file_path(fileName.toStdString())));
 }
 
 #include "moc_dropletobservationwidget.cpp"
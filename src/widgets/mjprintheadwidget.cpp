@@ -6,6 +6,8 @@
 #include "mainwindow.h"
 #include "dmc4080.h"
 #include "outputwindow.h"
+#include "slicerdialog.h"
+#include "printjobdialog.h"
 
 #include <QLineEdit>
 #include <QDebug>
@@ -18,22 +20,19 @@
 #include <cmath>
 #include <QTimer>
 #include <QFileDialog>
-#include <QProcess>
 #include <QFileInfo>
 #include <QTextStream>
 #include <map>
 #include <QStringList>
 #include <QRegularExpression>
 #include <QRegularExpressionMatch>
-#include <QProgressDialog>
 #include <QApplication>
+#include <QMessageBox>
 
 
 MJPrintheadWidget::MJPrintheadWidget(Printer *printer, QWidget *parent) :
     PrinterWidget(printer, parent),
-    ui(new Ui::MJPrintheadWidget),
-    //  New addition for STL processing 06/24 !!! TODO
-    m_pythonProcess(nullptr)
+    ui(new Ui::MJPrintheadWidget)
 {
     ui->setupUi(this);
 
@@ -112,15 +111,26 @@ MJPrintheadWidget::MJPrintheadWidget(Printer *printer, QWidget *parent) :
     // --- 7. **Connect Full Bed & Recoating** ---
     connect(ui->sliceStlButton, &QPushButton::clicked, this, &MJPrintheadWidget::sliceStlButton_clicked);
     connect(ui->startFullPrintButton, &QPushButton::clicked, this, &MJPrintheadWidget::on_startFullPrintButton_clicked);
+    connect(ui->registrationTestButton, &QPushButton::clicked, this, &MJPrintheadWidget::printRegistrationTest);
+    connect(ui->estimateJobButton, &QPushButton::clicked, this, &MJPrintheadWidget::estimateJobButton_clicked);
+    connect(ui->resumeJobButton, &QPushButton::clicked, this, &MJPrintheadWidget::resumeJobButton_clicked);
     connect(ui->levelRecoatMJ, &QPushButton::clicked, this, &MJPrintheadWidget::levelRecoat_MJ);
     connect(ui->normalRecoatMJ, &QPushButton::clicked, this, &MJPrintheadWidget::normalRecoat_MJ);
     connect(ui->reRollLayerMJ, &QPushButton::clicked, this, &MJPrintheadWidget::reRollLayer);
     connect(ui->rollerButton, &QPushButton::clicked, this, &MJPrintheadWidget::onRollerButtonClicked);
+
+    // --- 8. **Print Job Thread** ---
+    m_printJob.reset(new PrintJob(mPrinter));
+    connect(m_printJob.get(), &PrintJob::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+    connect(m_printJob.get(), &PrintJob::checkpoint_reached, this, [this](int layer, int pass) {m_checkpoint = {layer, pass};});
+    connect(m_printJob.get(), &PrintJob::job_finished, this, &MJPrintheadWidget::printJobFinished);
 }
 
 
 MJPrintheadWidget::~MJPrintheadWidget()
 {
+    m_estimateCancel = true;
+    if (m_estimateWorker.joinable()) m_estimateWorker.join();
     m_positionTimer->stop();
     delete ui;
 }
@@ -165,6 +175,9 @@ void MJPrintheadWidget::allow_widget_input(bool allowed)
     ui->testPrintButton->setEnabled(allowed);
     ui->testJetButton->setEnabled(allowed);
     ui->startFullPrintButton->setEnabled(allowed);
+    ui->registrationTestButton->setEnabled(allowed);
+    ui->estimateJobButton->setEnabled(allowed);
+    ui->resumeJobButton->setEnabled(allowed);
     ui->normalRecoatMJ->setEnabled(allowed);
     ui->levelRecoatMJ->setEnabled(allowed);
     ui->reRollLayerMJ->setEnabled(allowed);
@@ -323,7 +336,7 @@ void MJPrintheadWidget::file_name_entered()
 
 
 // Reads an image file and sends its data to the printhead controller.
-void MJPrintheadWidget::read_in_file(const QString &fileNameOrPath, int headIdx)
+void MJPrintheadWidget::read_in_file(const QString &fileNameOrPath, int headIdx, bool reversed)
 {
     QString filePath = fileNameOrPath;
     QFileInfo fileInfo(filePath);
@@ -347,13 +360,14 @@ void MJPrintheadWidget::read_in_file(const QString &fileNameOrPath, int headIdx)
 
     int whitespace = 0;
 
-    if (headIdx == 2) {
-        whitespace = 0;
-    } else if (headIdx == 1) {
+    // head 1 trails head 2 by the gap, so it leads in with blank columns going +X
+    // and head 2 does going -X, where the image is sent last column first
+    if (headIdx == (reversed ? 2 : 1)) {
         whitespace = calculate_gap(fileNameOrPath);
         // check for failed calculation
         if (whitespace == -1) return;
     }
+    if (reversed) image = image.mirrored(true, false);
 
     mPrinter->mjController->send_image_data(headIdx, image, whitespace);
 }
@@ -386,8 +400,17 @@ void MJPrintheadWidget::checkMapsPressed() {
     if (whitespace2 == -1) return;
 
 
-    mPrinter->mjController->convert_image(1, image, whitespace1);
-    mPrinter->mjController->convert_image(2, image, whitespace2);
+    // save what each head will print next to the selected bitmap
+    const QFileInfo fileInfo(filePath);
+    const int whitespace[] {whitespace1, whitespace2};
+    for (int headIdx = 1; headIdx <= 2; headIdx++)
+    {
+        const QByteArray imageData = mPrinter->mjController->convert_image(headIdx, image, whitespace[headIdx - 1]);
+        const QImage check = mPrinter->mjController->reconstructed_bitmap(imageData, image.width() + whitespace[headIdx - 1], image.height());
+        const QString checkPath = fileInfo.absoluteDir().filePath(QString("%1_head%2_check.bmp").arg(fileInfo.completeBaseName()).arg(headIdx));
+        check.save(checkPath);
+        mPrinter->mjController->outputMessage(QString("Bitmap reconstructed and saved: %1").arg(checkPath));
+    }
 
 }
 
@@ -691,7 +714,29 @@ void MJPrintheadWidget::printBMPatLocation(double xLocation, double yLocation, d
 }
 
 // Prints a bitmap at a specified location using precise encoder-based triggering.
-void MJPrintheadWidget::printBMPatLocationEncoder(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, QString fileName)
+void MJPrintheadWidget::printBMPatLocationEncoder(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, QString fileName, bool reversed)
+{
+    // going -X the pass has to start where head 1 prints the last column
+    if (reversed) {
+        const int gap = calculate_gap(fileName);
+        if (gap == -1) return;
+        imageWidth += gap;
+    }
+
+    runEncoderPass(xLocation, yLocation, frequency, printSpeed, imageWidth, QString("File: %1").arg(fileName), [this, fileName, reversed]()
+    {
+        // Load image data for both heads
+        read_in_file(fileName, 1, reversed); // Head 1
+        if (!readyHeads()) return false;
+
+        read_in_file(fileName, 2, reversed); // Head 2
+        return readyHeads();
+    }, reversed);
+}
+
+// Runs one encoder-triggered pass, loadHeads sends the image data for both heads.
+// xLocation is the left edge of the image whichever way the pass goes.
+void MJPrintheadWidget::runEncoderPass(double xLocation, double yLocation, double frequency, double printSpeed, int imageWidth, const QString &description, const std::function<bool()> &loadHeads, bool reversed)
 {
     mPrinter->mjController->outputMessage("--- Encoder-Based Print Initiated ---");
 
@@ -704,22 +749,38 @@ void MJPrintheadWidget::printBMPatLocationEncoder(double xLocation, double yLoca
     double backUpDistance = (pow(printSpeed, 2.0) / (2.0 * accelerationSpeed)) * safetyFactor;
     double printDistance = (static_cast<double>(imageWidth) / frequency) * printSpeed;
 
-    // Safety clamp: if xLocation is too close to 0, force it to 0
-    if ((xLocation - backUpDistance) < 0.0) {
-        mPrinter->mjController->outputMessage("WARNING: Start X too low. Shifting to 0.0mm");
-        xLocation = 0.0;
-    }
+    double backedUpStartX = 0.0;
+    double endTargetMM = 0.0;
+    if (reversed) {
+        // A -X pass starts at the right edge, moved by the calibrated offset so it lands on the +X passes
+        xLocation += printDistance + ui->reverseOffsetSpinBox->value();
+        backedUpStartX = xLocation + backUpDistance;
+        endTargetMM = xLocation - printDistance - backUpDistance;
+
+        // the runway has a safety factor, so the deceleration can be cut short
+        if (endTargetMM < 0.0) {
+            mPrinter->mjController->outputMessage("WARNING: Reverse pass ends below 0.0mm. Stopping at 0.0mm");
+            endTargetMM = 0.0;
+        }
+    } else {
+        // Safety clamp: if xLocation is too close to 0, force it to 0
+        if ((xLocation - backUpDistance) < 0.0) {
+            mPrinter->mjController->outputMessage("WARNING: Start X too low. Shifting to 0.0mm");
+            xLocation = 0.0;
+        }
 
-    // Determine physical start and stop coordinates
-    double backedUpStartX = xLocation - backUpDistance;
-    double endTargetMM = xLocation + printDistance + backUpDistance; // Start + Print + Decel
+        // Determine physical start and stop coordinates
+        backedUpStartX = xLocation - backUpDistance;
+        endTargetMM = xLocation + printDistance + backUpDistance; // Start + Print + Decel
+    }
 
     // Convert runway distance to encoder counts for the trigger
     int backUpDistanceEnc = backUpDistance * X_CNTS_PER_MM;
 
     // Log job details
-    mPrinter->mjController->outputMessage(QString("File: %1\n X: %2, Y: %3, Freq: %4, Speed: %5")
-                                              .arg(fileName).arg(xLocation).arg(yLocation).arg(frequency).arg(printSpeed));
+    mPrinter->mjController->outputMessage(QString("%1\n X: %2, Y: %3, Freq: %4, Speed: %5, Direction: %6")
+                                              .arg(description).arg(xLocation).arg(yLocation).arg(frequency).arg(printSpeed)
+                                              .arg(reversed ? "-X" : "+X"));
     mPrinter->mjController->outputMessage(QString("Runway: %1 mm, Start: %2 mm, End: %3 mm")
                                               .arg(backUpDistance).arg(backedUpStartX).arg(endTargetMM));
 
@@ -728,11 +789,7 @@ void MJPrintheadWidget::printBMPatLocationEncoder(double xLocation, double yLoca
     mPrinter->mjController->set_printing_frequency(frequency);
 
     // Load image data for both heads
-    read_in_file(fileName); // Head 1
-    if (!readyHeads()) return;
-
-    read_in_file(fileName, 2); // Head 2
-    if (!readyHeads()) return;
+    if (!loadHeads()) return;
 
     GSleep(50);
 
@@ -748,7 +805,7 @@ void MJPrintheadWidget::printBMPatLocationEncoder(double xLocation, double yLoca
     mPrinter->mjController->set_absolute_start(backUpDistanceEnc);
     printComplete = false;
 
-    printEnc(accelerationSpeed, printSpeed, endTargetMM, "Encoder Print Motion Complete");
+    printEnc(accelerationSpeed, printSpeed, endTargetMM, "Encoder Print Motion Complete", reversed);
 
     while (!printComplete) {
         QCoreApplication::processEvents();
@@ -787,6 +844,50 @@ void MJPrintheadWidget::verifyPrintStartAlignment(double xStart, double yStart){
     GSleep(80);
 }
 
+// Prints a vernier to measure where -X passes land relative to +X passes. Nozzles 1-64
+// print a tick every 2 mm going +X and nozzles 65-128 print the same ticks going -X, each
+// one droplet further right than the one before, around the wide centre tick. If the tick
+// k places right of the centre lines up (negative to the left), add k droplets to the reverse offset.
+void MJPrintheadWidget::printRegistrationTest()
+{
+    const double dropletSpacing = 0.05;
+    const double xStart = 65.0;
+    const double yStart = -65.0;
+    const double frequency = ui->setFreqSpinBox->value();
+    const double printSpeed = frequency * dropletSpacing;
+    const int tickCount = 11;
+    const int tickPitch = 40; // columns
+    const int width = tickCount * tickPitch;
+
+    QImage forward(width, 128, QImage::Format_Grayscale8);
+    forward.fill(255);
+    QImage reverse = forward;
+    for (int k = 0; k < tickCount; k++) {
+        const int step = k - tickCount / 2;
+        const int x = tickPitch / 2 + k * tickPitch;
+        for (int y = 0; y < 64; y++) {
+            for (int dx = (step == 0 ? -1 : 0); dx <= (step == 0 ? 1 : 0); dx++) forward.scanLine(y)[x + dx] = 0;
+            reverse.scanLine(64 + y)[x + step] = 0;
+        }
+    }
+    reverse = reverse.mirrored(true, false); // sent last column first
+
+    mPrinter->mjController->outputMessage(QString("--- Registration Test, reverse offset %1 mm ---").arg(ui->reverseOffsetSpinBox->value()));
+    for (bool reversed : {false, true}) {
+        const QImage &image = reversed ? reverse : forward;
+        runEncoderPass(xStart, yStart, frequency, printSpeed, width, reversed ? "Registration -X" : "Registration +X", [this, &image]()
+        {
+            mPrinter->mjController->clear_all_heads_of_data();
+            mPrinter->mjController->send_image_data(1, image, 0);
+            return readyHeads();
+        }, reversed);
+    }
+    moveNozzleOffPlate();
+
+    mPrinter->mjController->outputMessage(QString("Find the lower tick that lines up with the one above it, counting from the wide tick "
+                                                  "(right is positive), and add that many times %1 mm to the reverse X offset.").arg(dropletSpacing));
+}
+
 // Generates and executes commands to move the printhead to a specified X, Y location.
 void MJPrintheadWidget::moveToLocation(double xLocation, double yLocation, QString endMessage){
     atLocation = false;
@@ -870,7 +971,8 @@ void MJPrintheadWidget::print(double acceleration, double speed, double endTarge
 }
 
 // Generates and executes commands for an encoder-based print motion.
-void MJPrintheadWidget::printEnc(double acceleration, double speed, double endTargetMM, QString endMessage){
+// A reversed pass holds the MJ direction output high while it moves so the board counts the encoder down.
+void MJPrintheadWidget::printEnc(double acceleration, double speed, double endTargetMM, QString endMessage, bool reversed){
     printComplete = false;
     mPrinter->mjController->outputMessage(QString("Executing encoder print to %1mm at %2mm/s").arg(endTargetMM).arg(speed));
     std::stringstream s_cmd;
@@ -880,8 +982,10 @@ void MJPrintheadWidget::printEnc(double acceleration, double speed, double endTa
     s_cmd << CMD::set_deceleration(Axis::X, acceleration);
     s_cmd << CMD::set_speed(Axis::X, speed);
     s_cmd << CMD::position_absolute(Axis::X, endTargetMM);
+    if (reversed) s_cmd << CMD::start_MJ_dir();
     s_cmd << CMD::begin_motion(Axis::X);
     s_cmd << CMD::after_motion(Axis::X);
+    if (reversed) s_cmd << CMD::disable_MJ_dir();
 
     // --- 2. **Add completion message and compile program** ---
     s_cmd << CMD::display_message("Print Complete");
@@ -996,55 +1100,18 @@ QString MJPrintheadWidget::verifyPrintStartStop(int xStart, int xStop){
     }
 }
 
-// Launches a Python script to slice an STL file based on UI parameters.
+// Opens the native slicer, which writes a job folder for the full print job or prints straight away
 void MJPrintheadWidget::sliceStlButton_clicked() {
-    mPrinter->mjController->outputMessage(QString("Launching Python STL Slicer..."));
-
-    // --- 1. Define executable and the Python GUI script path ---
-    // IMPORTANT: Update this path to the final Python script you are using.
-    QString pythonScriptPath = "C:\\Users\\CB140LAB\\Documents\\GitHub\\CREATE_LAB_Binder_Jet_Printer\\STL_Slicer_Dual.py";
-    QString pythonExecutable = "C:\\Users\\CB140LAB\\AppData\\Local\\Microsoft\\WindowsApps\\python3.11.exe";
-
-    // --- 2. Check if the process is already running ---
-    if (m_pythonProcess && m_pythonProcess->state() == QProcess::Running) {
-        mPrinter->mjController->outputMessage(QString("Slicer script is already running."));
-        // Optionally, bring the existing window to the front if possible, or just return.
-        return;
-    }
-
-    // --- 3. Setup and connect the QProcess for running the script ---
-    m_pythonProcess = new QProcess(this);
-    connect(m_pythonProcess, &QProcess::readyReadStandardOutput, this, &MJPrintheadWidget::readPythonOutput);
-    connect(m_pythonProcess, &QProcess::readyReadStandardError, this, &MJPrintheadWidget::handlePythonError);
-    connect(m_pythonProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &MJPrintheadWidget::onPythonScriptFinished);
-
-    // --- 4. Launch the script ---
-    // The Python script is a GUI app and no longer needs command-line arguments.
-    QStringList args;
-    args << pythonScriptPath;
-
-    mPrinter->mjController->outputMessage(QString("Command: %1 %2").arg(pythonExecutable, args.join(" ")));
-    m_pythonProcess->start(pythonExecutable, args);
-}
-
-void MJPrintheadWidget::readPythonOutput()
-{
-    QByteArray output = m_pythonProcess->readAllStandardOutput();
-    qDebug() << "Python output:" << output;
-}
-
-void MJPrintheadWidget::handlePythonError()
-{
-    QByteArray errorOutput = m_pythonProcess->readAllStandardError();
-    qWarning() << "Python error:" << errorOutput;
-}
-
-void MJPrintheadWidget::onPythonScriptFinished(int exitCode, QProcess::ExitStatus exitStatus)
-{
-    qDebug() << "Python script finished with exit code:" << exitCode;
-    if (exitStatus == QProcess::CrashExit) {
-        qWarning() << "The Python script crashed.";
+    if (!m_slicerDialog) {
+        m_slicerDialog = new SlicerDialog(this);
+        m_slicerDialog->set_print_job_running(m_printJobRunning);
+        connect(m_slicerDialog, &SlicerDialog::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+        connect(m_slicerDialog, &SlicerDialog::print_requested, this, &MJPrintheadWidget::startStreamingPrintJob);
+        connect(m_slicerDialog, &SlicerDialog::estimate_requested, this, &MJPrintheadWidget::estimateStreamingJob);
     }
+    m_slicerDialog->show();
+    m_slicerDialog->raise();
+    m_slicerDialog->activateWindow();
 }
 
 
@@ -1362,21 +1429,16 @@ bool MJPrintheadWidget::parseLayerShifts(const QString& filePath, std::map<int,
     return true;
 }
 
-// Main function for executing a multi-layer print from a sliced STL job folder.
-void MJPrintheadWidget::startFullPrintJob(const QString& jobFolderPath) {
-    mPrinter->mjController->outputMessage(QString("--- Starting Full Print Job from folder: %1 ---").arg(jobFolderPath));
-    m_printJobCancelled = false; // Reset cancellation flag
-
+// Reads the parameters, layer shifts and sorted pass bitmaps of a job folder.
+bool MJPrintheadWidget::readFolderJob(const QString& jobFolderPath, PrintParameters& params, std::map<int, int>& layerShifts, QStringList& fileList, int& totalLayers) {
     // --- 1. **Parse Parameter and Shift Files** ---
-    PrintParameters params;
     if (!parsePrintParameters(jobFolderPath + "\\print_parameters.txt", params)) {
         mPrinter->mjController->outputMessage("FATAL: Failed to parse parameters. Aborting print.");
-        return;
+        return false;
     }
-    std::map<int, int> layerShifts;
     if (params.yShiftEnabled && !parseLayerShifts(jobFolderPath + "\\layer_y_shifts.txt", layerShifts)) {
         mPrinter->mjController->outputMessage("FATAL: Failed to parse layer shifts. Aborting print.");
-        return;
+        return false;
     }
 
     // --- 2. **Get and Alphabetically Sort All Print Files** ---
@@ -1384,130 +1446,428 @@ void MJPrintheadWidget::startFullPrintJob(const QString& jobFolderPath) {
     dividedDir.setNameFilters(QStringList() << "layer_*.bmp");
     dividedDir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
     dividedDir.setSorting(QDir::Name); // Sort alphabetically to ensure correct order
-    QStringList fileList = dividedDir.entryList();
+    fileList = dividedDir.entryList();
 
     if (fileList.isEmpty()) {
         mPrinter->mjController->outputMessage("FATAL: No 'layer_*.bmp' files found. Aborting print.");
-        return;
+        return false;
     }
     mPrinter->mjController->outputMessage(QString("Found %1 files to print.").arg(fileList.count()));
 
     // Calculate the total number of layers ---
+    totalLayers = 0;
+    QRegularExpression re("layer_(\\d+)_pass_(\\d+)\\.bmp");
+    QRegularExpressionMatch match = re.match(fileList.last());
+    if (match.hasMatch()) {
+        totalLayers = match.captured(1).toInt();
+    }
+    return true;
+}
+
+// Main function for executing a multi-layer print from a sliced STL job folder.
+void MJPrintheadWidget::startFullPrintJob(const QString& jobFolderPath, bool resume) {
+    if (printJobBusy()) return;
+    mPrinter->mjController->outputMessage(QString("--- %1 Full Print Job from folder: %2 ---").arg(resume ? "Resuming" : "Starting", jobFolderPath));
+
+    PrintParameters params;
+    std::map<int, int> layerShifts;
+    QStringList fileList;
     int totalLayers = 0;
-    if (!fileList.isEmpty()) {
-        QRegularExpression re("layer_(\\d+)_pass_(\\d+)\\.bmp");
-        QRegularExpressionMatch match = re.match(fileList.last());
-        if (match.hasMatch()) {
-            totalLayers = match.captured(1).toInt();
+    if (!readFolderJob(jobFolderPath, params, layerShifts, fileList, totalLayers)) return;
+
+    // --- 3. **Plan and Estimate the Job** ---
+    QStringList passFiles;
+    std::vector<PassPlan> plan = planFolderJob(params, layerShifts, fileList, passFiles);
+    const QDir dividedDir(jobFolderPath + "\\divided");
+    for (QString& fileName : passFiles) fileName = dividedDir.absoluteFilePath(fileName);
+
+    PrintJobSettings settings = printJobSettings(params, plan);
+    settings.journalPath = QDir(jobFolderPath).filePath(JobJournal::fileName);
+    settings.jobName = jobFolderPath;
+
+    // a resumed job continues after the last pass in its journal, once the printer matches it
+    JobCheckpoint resumeAfter;
+    if (resume && !confirmResume(settings, totalLayers, &layerShifts, resumeAfter)) return;
+    settings.estimate = estimateFolderJob(jobFolderPath, params, plan, totalLayers);
+    m_resumeShifts = layerShifts;
+
+    // --- 4. **Hand the Passes to the Print Job** ---
+    Added_Scientific::Controller *controller = mPrinter->mjController;
+    const int gap = static_cast<int>(HEAD_GAP_MM / params.dropletSpacingX);
+    startPrintJob([controller, plan, passFiles, gap, totalLayers]()
+    {
+        return std::make_shared<FolderJobSource>(controller, plan, passFiles, gap, totalLayers);
+    }, settings, resumeAfter);
+}
+
+// Starts a print job and shows its status. makeSource is kept so a job that is
+// cancelled or fails can be started again after its last checkpoint.
+void MJPrintheadWidget::startPrintJob(std::function<std::shared_ptr<PrintJobSource>()> makeSource, const PrintJobSettings &settings, const JobCheckpoint &resumeAfter)
+{
+    if (printJobBusy()) return;
+
+    std::shared_ptr<PrintJobSource> source = makeSource();
+    m_resumeSource = std::move(makeSource);
+    m_resumeSettings = settings;
+    m_checkpoint = resumeAfter;
+    ui->resumeJobButton->setEnabled(false);
+    m_printJobRunning = true;
+    if (m_slicerDialog) m_slicerDialog->set_print_job_running(true);
+
+    m_printJobDialog = new PrintJobDialog(source->layer_count(), this);
+    PrintJob *job = m_printJob.get();
+    connect(m_printJobDialog, &PrintJobDialog::pause_requested, job, &PrintJob::pause);
+    connect(m_printJobDialog, &PrintJobDialog::resume_requested, job, &PrintJob::resume);
+    connect(m_printJobDialog, &PrintJobDialog::cancel_requested, job, &PrintJob::cancel);
+    connect(job, &PrintJob::status_changed, m_printJobDialog, &PrintJobDialog::set_status);
+    connect(job, &PrintJob::layer_started, m_printJobDialog, &PrintJobDialog::set_layer);
+    connect(job, &PrintJob::paused_changed, m_printJobDialog, &PrintJobDialog::set_paused);
+    m_printJobDialog->show();
+
+    QMetaObject::invokeMethod(job, [job, source, settings, resumeAfter]()
+    {
+        job->start(source, settings, resumeAfter);
+    }, Qt::QueuedConnection);
+}
+
+void MJPrintheadWidget::printJobFinished(PrintJob::Result result, const QString &summary)
+{
+    Q_UNUSED(summary);
+    m_printJobRunning = false;
+    if (m_slicerDialog) m_slicerDialog->set_print_job_running(false);
+    if (m_printJobDialog) {
+        m_printJobDialog->accept();
+        m_printJobDialog->deleteLater();
+        m_printJobDialog = nullptr;
+    }
+
+    // a finished job has nothing left to resume
+    if (result == PrintJob::Result::Complete) m_resumeSource = nullptr;
+    ui->resumeJobButton->setEnabled(ui->startFullPrintButton->isEnabled());
+}
+
+bool MJPrintheadWidget::printJobBusy()
+{
+    if (!m_printJobRunning) return false;
+    mPrinter->mjController->outputMessage("ERROR: A print job is already running, cancel it or wait for it to finish");
+    return true;
+}
+
+// Starts the last cancelled or failed job again after the last pass it printed, or
+// a job folder after the last pass in its journal (after a crash or a restart)
+void MJPrintheadWidget::resumeJobButton_clicked()
+{
+    if (printJobBusy()) return;
+    if (!m_resumeSource) {
+        QString jobFolderPath = QFileDialog::getExistingDirectory(this, tr("Select Print Job Folder to Resume"),
+                                                                  "C:\\Users\\CB140LAB\\Desktop\\Noah\\ComplexMultiNozzle\\Slicing",
+                                                                  QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+        if (jobFolderPath.isEmpty()) return;
+        startFullPrintJob(jobFolderPath, true);
+        return;
+    }
+
+    // a streamed job without an archive has no journal, only what this session saw
+    JobCheckpoint resumeAfter = m_checkpoint;
+    if (!m_resumeSettings.journalPath.isEmpty() && !confirmResume(m_resumeSettings, static_cast<int>(m_resumeSettings.estimate.layers.size()), &m_resumeShifts, resumeAfter)) return;
+    mPrinter->mjController->outputMessage(QString("--- Resuming Print Job after layer %1 pass %2 ---").arg(resumeAfter.layer).arg(resumeAfter.pass));
+    startPrintJob(m_resumeSource, m_resumeSettings, resumeAfter);
+}
+
+// Reads the journal of a job and asks before resuming it, listing anything about the
+// printer that doesn't match the last pass printed. resumeAfter gets that pass.
+bool MJPrintheadWidget::confirmResume(const PrintJobSettings &settings, int layerCount, const std::map<int, int> *layerShifts, JobCheckpoint &resumeAfter)
+{
+    JournalState state;
+    QString error;
+    if (!JobJournal::read(settings.journalPath, state, error)) {
+        mPrinter->mjController->outputMessage(QString("ERROR: Can't resume, %1").arg(error));
+        return false;
+    }
+    if (state.complete) {
+        mPrinter->mjController->outputMessage(QString("Nothing to resume, the journal says %1 is complete").arg(settings.jobName));
+        return false;
+    }
+
+    const JournalEntry &checkpoint = state.checkpoint;
+    QStringList problems;
+    if (state.layerCount != layerCount) {
+        problems << QString("the job has %1 layers, the journal %2").arg(layerCount).arg(state.layerCount);
+    }
+    if (!std::isnan(checkpoint.z_mm) && mPrinter->mcu->g) {
+        int zCounts = 0;
+        GCmdI(mPrinter->mcu->g, "TPZ", &zCounts);
+        const double z_mm = zCounts / static_cast<double>(Z_CNTS_PER_MM);
+        if (std::abs(z_mm - checkpoint.z_mm) > 0.005) {
+            problems << QString("Z is at %1 mm, it was at %2 mm").arg(z_mm, 0, 'f', 4).arg(checkpoint.z_mm, 0, 'f', 4);
+        }
+    }
+    if (layerShifts && checkpoint.pass > 0) {
+        const auto shift = layerShifts->find(checkpoint.layer);
+        const int yPixelShift = (shift != layerShifts->end()) ? shift->second : 0;
+        if (yPixelShift != checkpoint.yShift_rows) {
+            problems << QString("layer %1 is shifted %2 rows, it was printed shifted %3").arg(checkpoint.layer).arg(yPixelShift).arg(checkpoint.yShift_rows);
         }
     }
+    if (checkpoint.headFrequency_Hz != settings.headFrequency_Hz || std::abs(checkpoint.headVoltage - settings.headVoltage) > 0.01) {
+        problems << QString("the heads are set to %1 Hz, %2 V, they printed at %3 Hz, %4 V")
+                        .arg(settings.headFrequency_Hz).arg(settings.headVoltage).arg(checkpoint.headFrequency_Hz).arg(checkpoint.headVoltage);
+    }
+    if (std::abs(checkpoint.printFrequency_Hz - settings.printFrequency_Hz) > 0.01 || std::abs(checkpoint.printSpeed_mm_s - settings.printSpeed_mm_s) > 0.001) {
+        problems << QString("the job prints at %1 Hz, %2 mm/s, it printed at %3 Hz, %4 mm/s")
+                        .arg(settings.printFrequency_Hz).arg(settings.printSpeed_mm_s).arg(checkpoint.printFrequency_Hz).arg(checkpoint.printSpeed_mm_s);
+    }
+    if (std::abs(checkpoint.reverseOffset_mm - settings.reverseOffset_mm) > 0.001) {
+        problems << QString("the reverse X offset is %1 mm, it was %2 mm").arg(settings.reverseOffset_mm).arg(checkpoint.reverseOffset_mm);
+    }
 
-    // --- 3. **Setup and Show the Progress Dialog** ---
-    m_printStatusDialog = new QProgressDialog("Starting print job...", "Cancel", 0, totalLayers, this); // Use totalLayers
-    m_printStatusDialog->setWindowTitle("Print Job Status");
-    m_printStatusDialog->setWindowModality(Qt::WindowModal);
-    m_printStatusDialog->setMinimumDuration(0);
-    connect(m_printStatusDialog, &QProgressDialog::canceled, this, &MJPrintheadWidget::cancelPrintJob);
-    m_printStatusDialog->show();
-    QApplication::processEvents();
+    QString text = QString("Resume %1 after layer %2 pass %3?\nLast journal entry: %4 at %5")
+                       .arg(settings.jobName).arg(checkpoint.layer).arg(checkpoint.pass).arg(state.last.event, state.last.time);
+    if (!problems.isEmpty()) {
+        for (const QString &problem : problems) mPrinter->mjController->outputMessage(QString("WARNING: Resume check: %1").arg(problem));
+        text += "\n\nThe printer doesn't match the journal:\n- " + problems.join("\n- ") + "\n\nResume anyway?";
+    }
+    if (QMessageBox::question(this, "Resume Print Job", text) != QMessageBox::Yes) return false;
 
+    resumeAfter = {checkpoint.layer, checkpoint.pass};
+    return true;
+}
 
-    // --- 4. **Main Print Loop** ---
-    int lastLayerProcessed = -1;
-    double layerBaseY = params.startY;
+// Settings shared by the folder and streaming jobs, plan is every pass of the job if it is known up front
+PrintJobSettings MJPrintheadWidget::printJobSettings(const PrintParameters &params, const std::vector<PassPlan> &plan) const
+{
+    PrintJobSettings settings;
+    settings.printFrequency_Hz = params.printFrequency;
+    settings.printSpeed_mm_s = params.printSpeed;
+    settings.reverseOffset_mm = ui->reverseOffsetSpinBox->value();
+    settings.recoat = currentRecoatSettings(&params, true);
+    settings.headFrequency_Hz = ui->setFreqSpinBox->value();
+    settings.headVoltage = ui->setVoltageSpinBox->value();
+    settings.estimator = printEstimator(params, plan);
+    settings.controllerSequenced = ui->controllerPassesCheckBox->isChecked();
+    return settings;
+}
+
+// Estimates a job folder without printing it
+void MJPrintheadWidget::estimateJobButton_clicked()
+{
+    QString jobFolderPath = QFileDialog::getExistingDirectory(this, tr("Select Print Job Folder"),
+                                                              "C:\\Users\\CB140LAB\\Desktop\\Noah\\ComplexMultiNozzle\\Slicing",
+                                                              QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+    if (jobFolderPath.isEmpty()) return;
 
-    for (const QString& fileName : fileList) {
-        if (m_printJobCancelled) break; // Check for cancellation at the start of each pass
+    PrintParameters params;
+    std::map<int, int> layerShifts;
+    QStringList fileList;
+    int totalLayers = 0;
+    if (!readFolderJob(jobFolderPath, params, layerShifts, fileList, totalLayers)) return;
+    QStringList passFiles;
+    estimateFolderJob(jobFolderPath, params, planFolderJob(params, layerShifts, fileList, passFiles), totalLayers);
+}
+
+// Builds the motion model of the print job from the parameters and the recoat settings in the UI.
+// The recoat is planned around the passes of the plan, a streamed job adds its layers as they print.
+PrintEstimator MJPrintheadWidget::printEstimator(const PrintParameters &params, const std::vector<PassPlan> &plan) const
+{
+    PrintEstimatorSettings settings;
+    settings.printFrequency_Hz = params.printFrequency;
+    settings.printSpeed_mm_s = params.printSpeed;
+
+    RecoatBuildBox box;
+    box.swath_mm = params.nozzleCount * params.lineSpacingY;
+    for (const PassPlan &pass : plan) box.include(pass.y_mm);
+
+    // the roller settings stay at the planner's defaults until they are measured on the printer
+    RecoatProfile profile;
+    if (ui->rollerOffsetYSpinBox->value() > ui->rollerOffsetYSpinBox->minimum()) profile.rollerOffsetY_mm = ui->rollerOffsetYSpinBox->value();
+    profile.rollerFastSpeed_mm_s = ui->rollerFastSpeedSpinBox->value();
+    return PrintEstimator(settings, currentRecoatSettings(&params, true), RecoatPlanner(profile, box));
+}
+
+// Plans every pass of a job folder in the order the print job prints them,
+// passFiles gets the bitmap of each pass.
+std::vector<PassPlan> MJPrintheadWidget::planFolderJob(const PrintParameters& params, const std::map<int, int>& layerShifts, const QStringList& fileList, QStringList& passFiles) const
+{
+    const int imageWidthPixels = static_cast<int>(ceil(100.0 / params.dropletSpacingX));
+    const int gap = static_cast<int>(HEAD_GAP_MM / params.dropletSpacingX);
+    const bool bidirectional = ui->bidirectionalCheckBox->isChecked();
 
-        // --- 4a. Update Progress and Parse Filename ---
-        QApplication::processEvents();
-        QRegularExpression re("layer_(\\d+)_pass_(\\d+)\\.bmp");
+    std::vector<PassPlan> plan;
+    passFiles.clear();
+    QRegularExpression re("layer_(\\d+)_pass_(\\d+)\\.bmp");
+    for (const QString& fileName : fileList) {
         QRegularExpressionMatch match = re.match(fileName);
         if (!match.hasMatch()) {
             mPrinter->mjController->outputMessage(QString("WARNING: Skipping file with unexpected name: %1").arg(fileName));
             continue;
         }
-        int currentLayer = match.captured(1).toInt();
-        int currentPass = match.captured(2).toInt();
-        m_printStatusDialog->setLabelText(QString("Layer %1 / %2\nPrinting Pass: %3")
-                                              .arg(currentLayer)
-                                              .arg(totalLayers)
-                                              .arg(currentPass));        QApplication::processEvents();
-
-        // --- 4b. New Layer Detection and Operations ---
-        if (currentLayer != lastLayerProcessed) {
-            m_printStatusDialog->setValue(currentLayer);
-
-            if (lastLayerProcessed != -1) {
-                mPrinter->mjController->outputMessage(QString("--- Finished Layer %1 ---").arg(lastLayerProcessed));
-            }
-            mPrinter->mjController->outputMessage(QString("--- Starting Layer %1 ---").arg(currentLayer));
 
-            // Perform recoat for all layers after the first one
-            if (currentLayer > 1) {
-                // 1. Move nozzle to park position FIRST.
-                mPrinter->mjController->outputMessage("Moving nozzle to park position for recoat.");
-
-                moveNozzleOffPlate();
+        PassPlan pass;
+        pass.layer = match.captured(1).toInt();
+        pass.pass = match.captured(2).toInt();
+        const bool newLayer = plan.empty() || plan.back().layer != pass.layer;
+        pass.reversed = bidirectional && !newLayer && !plan.back().reversed;
+
+        const auto shift = layerShifts.find(pass.layer);
+        const int yPixelShift = (params.yShiftEnabled && shift != layerShifts.end()) ? shift->second : 0;
+        pass.y_mm = layerBaseY(params, yPixelShift) - (pass.pass - 1) * params.nozzleCount * params.lineSpacingY - Y_HEAD_OFFSET;
+        pass.yShift_rows = yPixelShift;
+        pass.startX_mm = params.startX;
+        pass.columns = imageWidthPixels + (pass.reversed ? gap : 0);
+        pass.uploadBytes = 2 * 2 + 16 * (2 * imageWidthPixels + gap);
+        plan.push_back(pass);
+        passFiles << fileName;
+    }
+    return plan;
+}
 
-                // 2. Now that the head is parked, perform the recoat operation.
-                mPrinter->mjController->outputMessage("Performing recoat operation...");
-                recoatComplete = false;
-                performRecoat(&params, true);
-                while (!recoatComplete) {
-                    QCoreApplication::processEvents();
-                }
-            } else {
-                recoatComplete = true; // Skip recoat for the very first layer
-            }
+// Logs the estimate of a planned job folder and saves the per-layer breakdown next to the bitmaps
+JobEstimate MJPrintheadWidget::estimateFolderJob(const QString& jobFolderPath, const PrintParameters& params, const std::vector<PassPlan>& plan, int totalLayers)
+{
+    const PrintEstimator estimator = printEstimator(params, plan);
+    const JobEstimate estimate = estimator.estimate(plan, totalLayers);
+    mPrinter->mjController->outputMessage(estimate.summary());
+    mPrinter->mjController->outputMessage(estimator.recoat_planner().plan(currentRecoatSettings(&params, true), plan.empty() ? NAN : plan.back().y_mm).summary());
+    const QString csvPath = QDir(jobFolderPath).filePath("print_estimate.csv");
+    if (estimate.write_csv(csvPath)) {
+        mPrinter->mjController->outputMessage(QString("Per-layer estimate saved to %1").arg(csvPath));
+    }
+    return estimate;
+}
 
-            // Calculate base Y position for the new layer, including any dithering shift
-            if (params.yShiftEnabled) {
-                int yPixelShift = layerShifts.count(currentLayer) ? layerShifts[currentLayer] : 0;
-                double yShiftForLayer_mm = static_cast<double>(yPixelShift) * params.lineSpacingY;
-                layerBaseY = params.startY - yShiftForLayer_mm;
-            } else {
-                layerBaseY = params.startY;
-            }
-            lastLayerProcessed = currentLayer;
-        }
+// Passes of a streamed layer as startStreamingPrintJob prints them
+std::vector<PassPlan> MJPrintheadWidget::planPreparedLayer(const PrintParameters &params, const Slicer::PreparedLayer &layer)
+{
+    std::vector<PassPlan> plan;
+    const double baseY = layerBaseY(params, layer.yShift_rows);
+    for (const Slicer::PreparedPass &pass : layer.passes) {
+        PassPlan p;
+        p.layer = layer.index + 1;
+        p.pass = pass.pass;
+        p.startX_mm = params.startX + pass.firstColumn * params.dropletSpacingX;
+        p.y_mm = baseY - (pass.pass - 1) * params.nozzleCount * params.lineSpacingY - Y_HEAD_OFFSET;
+        p.columns = pass.width;
+        p.reversed = pass.reversed;
+        p.yShift_rows = layer.yShift_rows;
+        p.uploadBytes = static_cast<int>(pass.head1.size() + pass.head2.size());
+        p.headsLoaded = (pass.head1.empty() ? 0 : 1) + (pass.head2.empty() ? 0 : 1);
+        plan.push_back(p);
+    }
+    return plan;
+}
 
-        // --- 4c. Calculate Y Location for Current Pass and Print ---
-        double yOffsetForPass_mm = static_cast<double>(currentPass - 1) * params.nozzleCount * params.lineSpacingY;
-        double currentYLocation = layerBaseY - yOffsetForPass_mm;
+// Slices the whole scene as Slice & Print would and estimates the print. The slicing
+// takes a while, it runs on a worker and the slicer dialog waits for the result.
+void MJPrintheadWidget::estimateStreamingJob(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &job)
+{
+    // the dialog asks for one estimate at a time, the last one has posted its result
+    if (m_estimateWorker.joinable()) m_estimateWorker.join();
 
-        mPrinter->mjController->outputMessage(QString("Printing Pass %1 at Y=%2mm").arg(currentPass).arg(currentYLocation));
+    const PrintParameters params = streamingPrintParameters(*slicer, job);
+    Slicer::PipelineSettings pipelineSettings = streamingPipelineSettings(params, QString());
+    pipelineSettings.lookahead = std::max(1, slicer->layer_count()); // nothing is printing, slice as fast as possible
+    const PrintEstimator estimator = printEstimator(params);
+    m_estimateCancel = false;
 
-        const int imageWidthPixels = static_cast<int>(ceil(100.0 / params.dropletSpacingX));
-        QString passFilePath = dividedDir.absoluteFilePath(fileName);
+    m_estimateWorker = std::thread([this, slicer, job, pipelineSettings, params, estimator]
+    {
+        QString result;
+        Slicer::PrintPipeline pipeline(slicer, job, pipelineSettings);
+        std::string error;
+        if (!pipeline.start(error)) {
+            result = QString("ERROR: Could not estimate: %1").arg(QString::fromStdString(error));
+        } else {
+            std::vector<PassPlan> plan;
+            Slicer::PreparedLayer layer;
+            while (!m_estimateCancel && pipeline.next(layer)) {
+                const std::vector<PassPlan> layerPlan = planPreparedLayer(params, layer);
+                plan.insert(plan.end(), layerPlan.begin(), layerPlan.end());
+            }
+            if (pipeline.failed()) {
+                result = QString("ERROR: Slicing failed: %1").arg(QString::fromStdString(pipeline.error()));
+            } else if (!m_estimateCancel) {
+                result = estimator.estimate(plan, pipeline.layer_count()).summary();
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, result]
+        {
+            if (!result.isEmpty()) mPrinter->mjController->outputMessage(result);
+            if (m_slicerDialog) m_slicerDialog->estimate_finished();
+        }, Qt::QueuedConnection);
+    });
+}
 
-        printBMPatLocationEncoder(
-            params.startX,// check this
-            (currentYLocation - Y_HEAD_OFFSET),
-            params.printFrequency,
-            params.printSpeed,
-            imageWidthPixels,
-            passFilePath
-            );
-        GSleep(100);
+// Prints a scene straight from the slicer. Layers are sliced a few ahead of the
+// printer and their passes go to the heads from memory, so the print starts as
+// soon as the first layer is ready and no bitmaps are needed on disk.
+void MJPrintheadWidget::startStreamingPrintJob(std::shared_ptr<const Slicer::LayerSlicer> slicer, const Slicer::JobSettings &jobSettings, const QString &archiveFolder)
+{
+    if (printJobBusy()) return;
+    mPrinter->mjController->outputMessage("--- Starting Streaming Print Job ---");
+    if (!archiveFolder.isEmpty()) {
+        mPrinter->mjController->outputMessage(QString("Archiving bitmaps to %1").arg(archiveFolder));
     }
 
-    // --- 5. **Post-Print Cleanup** ---
-    if (m_printStatusDialog) {
-        m_printStatusDialog->close();
-        delete m_printStatusDialog;
-        m_printStatusDialog = nullptr;
+    // the seed goes with the job (and into the archive's print_parameters.txt) so
+    // resuming it slices every layer with the shift it was printed with
+    const Slicer::JobSettings job = Slicer::fixed_seed(jobSettings);
+    const std::vector<int> shifts = Slicer::layer_shifts(job, slicer->layer_count());
+    m_resumeShifts.clear();
+    for (size_t i = 0; i < shifts.size(); i++) m_resumeShifts[static_cast<int>(i) + 1] = shifts[i];
+    if (job.yShiftPerLayer) mPrinter->mjController->outputMessage(QString("Y-Shift Seed: %1").arg(job.seed));
+
+    const PrintParameters params = streamingPrintParameters(*slicer, job);
+    const Slicer::PipelineSettings pipelineSettings = streamingPipelineSettings(params, archiveFolder);
+
+    // layers are estimated as they come out of the slicer, the rest are assumed to be like them
+    PrintJobSettings settings = printJobSettings(params);
+    settings.estimate.layers.resize(slicer->layer_count());
+    settings.estimateLayers = true;
+    if (!archiveFolder.isEmpty()) {
+        // the archive is a job folder, so it can be resumed like one after a crash
+        settings.journalPath = QDir(archiveFolder).filePath(JobJournal::fileName);
+        settings.jobName = archiveFolder;
     }
 
-    if (m_printJobCancelled) {
-        mPrinter->mjController->outputMessage(QString("--- PRINT JOB CANCELLED BY USER ---"));
-    } else {
-        if (lastLayerProcessed != -1) {
-            mPrinter->mjController->outputMessage(QString("--- Finished Layer %1 ---").arg(lastLayerProcessed));
-        }
-        mPrinter->mjController->outputMessage(QString("--- Print Job Complete ---"));
-    }
-    moveNozzleOffPlate();
+    startPrintJob([slicer, job, pipelineSettings, params]()
+    {
+        return std::make_shared<StreamingJobSource>(slicer, job, pipelineSettings, [params](const Slicer::PreparedLayer &layer)
+        {
+            return planPreparedLayer(params, layer);
+        });
+    }, settings, JobCheckpoint());
+}
+
+// Same parameters the full print job would parse from print_parameters.txt
+PrintParameters MJPrintheadWidget::streamingPrintParameters(const Slicer::LayerSlicer &slicer, const Slicer::JobSettings &job) const
+{
+    const Slicer::SliceSettings &settings = slicer.settings();
+    PrintParameters params;
+    params.printFrequency = job.printFrequency_Hz;
+    params.printSpeed = job.printFrequency_Hz * settings.dropletSpacing_mm;
+    params.dropletSpacingX = settings.dropletSpacing_mm;
+    params.lineSpacingY = settings.lineSpacing_mm;
+    params.layerHeight = settings.layerHeight_mm;
+    params.startX = job.startX_mm;
+    params.startY = -job.startY_mm;
+    params.nozzleCount = job.nozzleCount;
+    params.yShiftEnabled = job.yShiftPerLayer;
+    return params;
+}
+
+Slicer::PipelineSettings MJPrintheadWidget::streamingPipelineSettings(const PrintParameters &params, const QString &archiveFolder) const
+{
+    Slicer::PipelineSettings pipelineSettings;
+    pipelineSettings.head1LeadColumns = static_cast<int>(HEAD_GAP_MM / params.dropletSpacingX);
+    pipelineSettings.archiveDirectory = archiveFolder.toStdString();
+    pipelineSettings.bidirectional = ui->bidirectionalCheckBox->isChecked();
+    return pipelineSettings;
+}
+
+// Y of pass 1 for a layer shifted yPixelShift rows toward the front of the bed
+double MJPrintheadWidget::layerBaseY(const PrintParameters &params, int yPixelShift)
+{
+    return params.startY - static_cast<double>(yPixelShift) * params.lineSpacingY;
 }
 
 // Does a Level Recoat (this is used to create a smooth top layer without moving the Z)
@@ -1562,10 +1922,9 @@ void MJPrintheadWidget::normalRecoat_MJ()
     emit generate_printing_message_box("Normal recoat is in progress.");
 }
 
-// Executes a single recoat cycle, using either UI settings or parsed print parameters.
-void MJPrintheadWidget::performRecoat(const PrintParameters* params, bool usePrintParameters)
+// Recoat settings from the UI, with the layer height from the print parameters if given.
+RecoatSettings MJPrintheadWidget::currentRecoatSettings(const PrintParameters* params, bool usePrintParameters) const
 {
-    std::stringstream s;
     RecoatSettings recoatSettings{};
 
     // --- 1. **Get settings from UI or parsed parameters** ---
@@ -1580,6 +1939,14 @@ void MJPrintheadWidget::performRecoat(const PrintParameters* params, bool usePri
     recoatSettings.ultrasonicIntensityLevel = ui->ultrasonicIntensityComboBoxMJ->currentIndex();
     recoatSettings.ultrasonicMode = ui->ultrasonicModeComboBoxMJ->currentIndex();
     recoatSettings.waitAfterHopperOn_millisecs = ui->hopperDwellTimeMsSpinBox->value();
+    return recoatSettings;
+}
+
+// Executes a single recoat cycle, using either UI settings or parsed print parameters.
+void MJPrintheadWidget::performRecoat(const PrintParameters* params, bool usePrintParameters)
+{
+    std::stringstream s;
+    const RecoatSettings recoatSettings = currentRecoatSettings(params, usePrintParameters);
 
     // --- 2. **Build and execute the recoat command** ---
     s << CMD::display_message("Recoating for new layer...");
@@ -1653,12 +2020,8 @@ void MJPrintheadWidget::reRollLayer()
 // Sets the flag to cancel an ongoing multi-layer print job.
 void MJPrintheadWidget::cancelPrintJob()
 {
-    mPrinter->mjController->outputMessage("--- CANCELLATION REQUESTED ---");
-    m_printJobCancelled = true;
-    if (m_printStatusDialog) {
-        m_printStatusDialog->setLabelText("Cancelling print job, please wait...");
-        m_printStatusDialog->setCancelButton(nullptr); // Disable button after click
-    }
+    // the job finishes the pass it is printing and parks the heads
+    QMetaObject::invokeMethod(m_printJob.get(), &PrintJob::cancel, Qt::QueuedConnection);
 }
 
 
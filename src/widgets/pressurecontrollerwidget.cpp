@@ -2,6 +2,19 @@
 #include "ui_pressurecontrollerwidget.h"
 #include "pcd.h"
 #include "dmc4080.h"
+#include "pressureregulator.h"
+#include "qcustomplot.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QTimer>
+#include <QFileDialog>
+#include <QDateTime>
+#include <fstream>
 
 
 PressureControllerWidget::PressureControllerWidget(Printer *printer, QWidget *parent) :
@@ -16,6 +29,8 @@ PressureControllerWidget::PressureControllerWidget(Printer *printer, QWidget *pa
     connect(ui->quickPurgeButton, &QPushButton::clicked, this, &PressureControllerWidget::quick_purge_clicked);
     connect(ui->moveDistButton, &QPushButton::clicked, this, & PressureControllerWidget::move_reservoir);
 
+    setup_telemetry();
+
     //mPrinter->pressureController->connect_to_pressure_controller();
 }
 
@@ -70,6 +85,188 @@ void PressureControllerWidget::send_command(const QString &command)
     emit execute_command(s);
 }
 
+void PressureControllerWidget::setup_telemetry()
+{
+    QGridLayout *layout = ui->gridLayout;
+
+    // measured pressure and set point over the last few minutes
+    m_pressurePlot = new QCustomPlot(this);
+    m_pressurePlot->setMinimumHeight(160);
+    m_pressurePlot->addGraph(); // graph 0 measured
+    m_pressurePlot->graph(0)->setPen(QPen(Qt::black));
+    m_pressurePlot->addGraph(); // graph 1 set point
+    m_pressurePlot->graph(1)->setPen(QPen(Qt::red, 1, Qt::DashLine));
+    m_pressurePlot->xAxis->setLabel("Time (min)");
+    m_pressurePlot->yAxis->setLabel("Pressure (psig)");
+    m_pressurePlot->xAxis->setRange(-m_plotWindow_min, 0);
+    m_pressurePlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    int row = layout->rowCount();
+    layout->addWidget(m_pressurePlot, row++, 0, 1, 4);
+
+    m_monitorCheckBox = new QCheckBox("Monitor Pressure", this);
+    auto *saveLogButton = new QPushButton("Save Log...", this);
+    layout->addWidget(m_monitorCheckBox, row, 0, 1, 2);
+    layout->addWidget(saveLogButton, row++, 2, 1, 2);
+
+    // what is sent to ask for a reading and the unit ID the reply starts with (Alicat unit 'a' by default)
+    m_pollCommandLineEdit = new QLineEdit("a", this);
+    m_unitIDLineEdit = new QLineEdit("a", this);
+    m_unitIDLineEdit->setMaxLength(1);
+    layout->addWidget(new QLabel("Poll", this), row, 0);
+    layout->addWidget(m_pollCommandLineEdit, row, 1);
+    layout->addWidget(new QLabel("Unit ID", this), row, 2);
+    layout->addWidget(m_unitIDLineEdit, row++, 3);
+
+    // closed loop set point adjustment
+    m_closedLoopCheckBox = new QCheckBox("Closed Loop", this);
+    m_loopSourceComboBox = new QComboBox(this);
+    m_loopSourceComboBox->addItem("Droplet Velocity");
+    m_loopSourceComboBox->addItem("Reservoir Level");
+    layout->addWidget(m_closedLoopCheckBox, row, 0, 1, 2);
+    layout->addWidget(m_loopSourceComboBox, row++, 2, 1, 2);
+
+    PressureRegulatorSettings defaults;
+    m_targetVelocitySpinBox = new QDoubleSpinBox(this);
+    m_targetVelocitySpinBox->setRange(0.1, 20.0);
+    m_targetVelocitySpinBox->setSingleStep(0.1);
+    m_targetVelocitySpinBox->setSuffix(" m/s");
+    m_targetVelocitySpinBox->setValue(defaults.targetVelocity_m_s);
+    layout->addWidget(new QLabel("Target", this), row, 0);
+    layout->addWidget(m_targetVelocitySpinBox, row++, 1, 1, 3);
+
+    m_loopGainSpinBox = new QDoubleSpinBox(this);
+    m_loopGainSpinBox->setDecimals(5);
+    m_loopGainSpinBox->setRange(-1.0, 1.0);
+    m_loopGainSpinBox->setSingleStep(0.001);
+    layout->addWidget(new QLabel("Gain", this), row, 0);
+    layout->addWidget(m_loopGainSpinBox, row++, 1, 1, 3);
+    loop_source_changed();
+
+    m_regulator = new PressureRegulator(mPrinter, this);
+    connect(m_regulator, &PressureRegulator::print_to_output_window, this, &PrinterWidget::print_to_output_window);
+    connect(m_regulator, &PressureRegulator::set_point_changed, ui->pressureSpinBox, &QDoubleSpinBox::setValue);
+
+    m_plotTimer = new QTimer(this);
+    connect(m_plotTimer, &QTimer::timeout, this, &PressureControllerWidget::update_pressure_plot);
+
+    connect(m_monitorCheckBox, &QCheckBox::toggled, this, &PressureControllerWidget::toggle_monitoring);
+    connect(m_pollCommandLineEdit, &QLineEdit::editingFinished, this, &PressureControllerWidget::telemetry_command_changed);
+    connect(m_unitIDLineEdit, &QLineEdit::editingFinished, this, &PressureControllerWidget::telemetry_command_changed);
+    connect(saveLogButton, &QPushButton::clicked, this, &PressureControllerWidget::save_pressure_log);
+    connect(m_closedLoopCheckBox, &QCheckBox::toggled, this, &PressureControllerWidget::toggle_closed_loop);
+    connect(m_loopSourceComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &PressureControllerWidget::loop_source_changed);
+}
+
+void PressureControllerWidget::toggle_monitoring(bool enabled)
+{
+    mPrinter->pressureController->set_telemetry_interval(enabled ? m_telemetryInterval_ms : 0);
+    if (enabled) m_plotTimer->start(1000);
+    else m_plotTimer->stop();
+}
+
+void PressureControllerWidget::telemetry_command_changed()
+{
+    const QString poll = m_pollCommandLineEdit->text().trimmed();
+    const QString unitID = m_unitIDLineEdit->text().trimmed();
+    if (poll.isEmpty() || unitID.isEmpty()) return;
+    mPrinter->pressureController->set_telemetry_command(poll, unitID.at(0));
+}
+
+void PressureControllerWidget::toggle_closed_loop(bool enabled)
+{
+    if (!enabled)
+    {
+        m_regulator->stop();
+        m_loopSourceComboBox->setEnabled(true);
+        return;
+    }
+
+    PressureRegulatorSettings settings;
+    if (m_loopSourceComboBox->currentIndex() == 0)
+    {
+        settings.source = PressureRegulatorSettings::Source::DropletVelocity;
+        settings.targetVelocity_m_s = m_targetVelocitySpinBox->value();
+        settings.velocityGain = m_loopGainSpinBox->value();
+    }
+    else
+    {
+        settings.source = PressureRegulatorSettings::Source::ReservoirLevel;
+        settings.reservoirGain = m_loopGainSpinBox->value();
+    }
+    m_regulator->start(settings);
+
+    if (!m_regulator->is_running())
+    {
+        m_closedLoopCheckBox->setChecked(false);
+        return;
+    }
+    m_loopSourceComboBox->setEnabled(false);
+    // the loop is only useful if the result can be seen
+    m_monitorCheckBox->setChecked(true);
+}
+
+void PressureControllerWidget::loop_source_changed()
+{
+    PressureRegulatorSettings defaults;
+    const bool velocity = (m_loopSourceComboBox->currentIndex() == 0);
+    m_targetVelocitySpinBox->setEnabled(velocity);
+    m_loopGainSpinBox->setSuffix(velocity ? " psi/(m/s)" : " psi/mm");
+    m_loopGainSpinBox->setValue(velocity ? defaults.velocityGain : defaults.reservoirGain);
+}
+
+void PressureControllerWidget::droplet_velocity_measured(double velocity_m_s)
+{
+    m_regulator->droplet_velocity_measured(velocity_m_s);
+}
+
+void PressureControllerWidget::update_pressure_plot()
+{
+    const auto samples = mPrinter->pressureController->pressure_history();
+    const qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+    const qint64 start_ms = now_ms - static_cast<qint64>(m_plotWindow_min * 60000.0);
+
+    QVector<double> t, pressure, setPoint;
+    for (const auto &sample : samples)
+    {
+        if (sample.time_ms < start_ms) continue;
+        t.push_back((sample.time_ms - now_ms) / 60000.0);
+        pressure.push_back(sample.pressure_psig);
+        setPoint.push_back(sample.setPoint_psig);
+    }
+
+    m_pressurePlot->graph(0)->setData(t, pressure, true);
+    m_pressurePlot->graph(1)->setData(t, setPoint, true);
+    if (!t.isEmpty())
+    {
+        m_pressurePlot->graph(0)->rescaleValueAxis(false, true);
+        m_pressurePlot->graph(1)->rescaleValueAxis(true, true);
+    }
+    m_pressurePlot->replot();
+}
+
+void PressureControllerWidget::save_pressure_log()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Save pressure log", "", "CSV File (*.csv)");
+    if (fileName.isEmpty()) return;
+
+    std::ofstream file(fileName.toStdString());
+    if (!file.is_open())
+    {
+        emit print_to_output_window("Could not open " + fileName);
+        return;
+    }
+
+    file << "DATE_TIME,TIME,PRESSURE,SET_POINT\n";
+    file << ",ms,psig,psig\n";
+    for (const auto &sample : mPrinter->pressureController->pressure_history())
+    {
+        file << QDateTime::fromMSecsSinceEpoch(sample.time_ms).toString("yyyy/MM/dd hh:mm:ss.zzz").toStdString() << ","
+             << sample.time_ms << ","
+             << sample.pressure_psig << ","
+             << sample.setPoint_psig << "\n";
+    }
+}
+
 // MAX 03/04 !!! New thing idk
 void PressureControllerWidget::move_reservoir()
 {
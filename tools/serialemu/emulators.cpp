@@ -0,0 +1,354 @@
+#include "emulators.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace SerialEmu
+{
+
+namespace
+{
+
+std::string format_double(double value, int precision)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    return buffer;
+}
+
+}
+
+// ====================================================================
+// JetDrive
+
+JetDriveEmulator::JetDriveEmulator(const FaultConfig &faults) :
+    DeviceEmulator("jetdrive", faults)
+{
+
+}
+
+void JetDriveEmulator::handle_bytes(const char *data, size_t size)
+{
+    static const std::string xCmd {"X2000"};
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const char c = data[i];
+
+        if (!m_binary || (m_packet.empty() && c == 'Q'))
+        {
+            if (c == 'Q') // (re)start the handshake
+            {
+                m_binary = false;
+                m_xIndex = 0;
+                m_packet.clear();
+                received("Q");
+                reply("MFJET32\r\n>");
+            }
+            else if (m_xIndex < xCmd.size() && c == xCmd[m_xIndex])
+            {
+                received(std::string(1, c));
+                reply(std::string(1, c));
+                if (++m_xIndex == xCmd.size()) m_binary = true;
+            }
+            else received("unexpected byte during handshake: " + hex(std::string(1, c)));
+            continue;
+        }
+
+        if (m_packet.empty() && c != 'S')
+        {
+            received("unexpected byte: " + hex(std::string(1, c)));
+            continue;
+        }
+
+        m_packet += c;
+        // 'S', length (bytes after 'S' before the checksum), ..., checksum
+        if (m_packet.size() >= 2 && m_packet.size() == static_cast<unsigned char>(m_packet[1]) + 2u)
+        {
+            handle_packet(m_packet);
+            m_packet.clear();
+        }
+    }
+}
+
+void JetDriveEmulator::handle_packet(const std::string &packet)
+{
+    unsigned int sum {0};
+    for (size_t i = 1; i + 1 < packet.size(); i++) sum += static_cast<unsigned char>(packet[i]);
+    const bool checksumOk = static_cast<unsigned char>(sum & 0xFF) == static_cast<unsigned char>(packet.back());
+
+    const unsigned char command = (packet.size() > 2) ? static_cast<unsigned char>(packet[2]) : 0;
+    received(std::string(command_name(command)) + " " + hex(packet) + (checksumOk ? "" : " (bad checksum)"));
+
+    // response: 'R', command, status (0 = ok), [version], checksum
+    std::string response(static_cast<size_t>(response_size(command)), '\0');
+    response[0] = 'R';
+    response[1] = static_cast<char>(command);
+    response[2] = checksumOk ? 0x00 : 0x01;
+    if (command == 0xF0) response[3] = 0x20; // GETVERSION
+    unsigned int responseSum {0};
+    for (size_t i = 1; i + 1 < response.size(); i++) responseSum += static_cast<unsigned char>(response[i]);
+    response.back() = static_cast<char>(responseSum & 0xFF);
+    reply(response);
+}
+
+int JetDriveEmulator::response_size(unsigned char command)
+{
+    // same as JetDrive::response_size() in include/mfjdrv.h
+    switch (command)
+    {
+    default: return 4;
+    case 0xF0: return 5; // GETVERSION
+    case 0x0D: return 5; // MULTITRIGGER
+    case 0x60: return 27; // DUMPINPUT
+    }
+}
+
+const char *JetDriveEmulator::command_name(unsigned char command)
+{
+    switch (command)
+    {
+    case 0x01: return "RESET";
+    case 0x02: return "POLLSTATUS";
+    case 0x03: return "DROPS";
+    case 0x04: return "CONTMODE";
+    case 0x06: return "PULSE";
+    case 0x07: return "STROBEDIV";
+    case 0x08: return "SOURCE";
+    case 0x09: return "SOFTTRIGGER";
+    case 0x0C: return "EXTERNENABLE";
+    case 0x0D: return "MULTITRIGGER";
+    case 0x10: return "STROBEENABLE";
+    case 0x12: return "FULLFREQ";
+    case 0x13: return "STROBEDELAY";
+    case 0x60: return "DUMPINPUT";
+    case 0x61: return "DEBUG";
+    case 0xF0: return "GETVERSION";
+    default: return "UNKNOWN";
+    }
+}
+
+// ====================================================================
+// PCD
+
+PcdEmulator::PcdEmulator(const FaultConfig &faults) :
+    DeviceEmulator("pcd", faults)
+{
+
+}
+
+void PcdEmulator::handle_bytes(const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (data[i] == '\n') continue;
+        if (data[i] != '\r')
+        {
+            m_line += data[i];
+            continue;
+        }
+        handle_line(m_line);
+        m_line.clear();
+    }
+}
+
+void PcdEmulator::handle_line(const std::string &line)
+{
+    received(printable(line));
+    if (line.empty()) return;
+
+    switch (line[0])
+    {
+    case 'Q': reply("PCD\r"); return;
+    case 'P': m_purging = true; break;
+    case 'O': m_purging = false; break;
+    case 'a':
+        // "as<psi>" (unit ID 'a', set point)
+        if (line.size() > 2 && line[1] == 's') m_setPoint_psig = std::atof(line.c_str() + 2);
+        break;
+    case 'S':
+    case 'X':
+        break;
+    default:
+        reply("?\r");
+        return;
+    }
+
+    // Alicat style data frame: unit ID, pressure, set point
+    const double pressure = m_purging ? m_setPoint_psig + 5.0 : m_setPoint_psig + (random_uniform() - 0.5) * 0.02;
+    reply("A " + format_double(pressure, 2) + " " + format_double(m_setPoint_psig, 2) + (m_purging ? " PURGE" : "") + "\r");
+}
+
+// ====================================================================
+// Mister
+
+MisterEmulator::MisterEmulator(const FaultConfig &faults) :
+    DeviceEmulator("mister", faults)
+{
+
+}
+
+void MisterEmulator::handle_bytes(const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        const char c = data[i];
+        if (c == '\n') continue; // ignore line-feed characters
+
+        if (c != '\r')
+        {
+            if (m_message.size() < maxMessageLength - 1)
+            {
+                m_message += c;
+                continue;
+            }
+            received("message too long: " + printable(m_message));
+            m_message.clear();
+            reply("Error\n\r");
+            continue;
+        }
+
+        if (!m_message.empty()) handle_message(m_message);
+        m_message.clear();
+    }
+}
+
+void MisterEmulator::handle_message(const std::string &message)
+{
+    received(printable(message));
+    switch (message[0])
+    {
+    case 'Q': reply("MISTER\n\r"); return;
+    case 'O': m_left = m_right = true; break;
+    case 'C': m_left = m_right = false; break;
+    case 'L': m_left = true; break;
+    case 'R': m_right = true; break;
+    default: reply("Error\n\r"); return;
+    }
+    reply("Placeholder\n\r");
+}
+
+// ====================================================================
+// MJ board
+
+MjEmulator::MjEmulator(const FaultConfig &faults) :
+    DeviceEmulator("mj", faults)
+{
+
+}
+
+void MjEmulator::handle_bytes(const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+
+        if (m_inImage)
+        {
+            if (m_imageHead < 0) m_imageHead = c - 100;
+            else
+            {
+                m_imageBytes++;
+                m_imageSum += c;
+            }
+            continue;
+        }
+
+        if (m_line.empty() && c == 'W') // image data follows, without a line ending
+        {
+            m_inImage = true;
+            m_imageHead = -1;
+            m_imageBytes = 0;
+            m_imageSum = 0;
+            continue;
+        }
+
+        if (c == '\r') continue;
+        if (c != '\n')
+        {
+            m_line += static_cast<char>(c);
+            continue;
+        }
+        handle_line(m_line);
+        m_line.clear();
+    }
+}
+
+void MjEmulator::idle()
+{
+    // the image is over once the host stops sending
+    if (m_inImage) finish_image();
+}
+
+void MjEmulator::finish_image()
+{
+    m_inImage = false;
+    std::ostringstream s;
+    s << "image head " << m_imageHead << ": " << m_imageBytes << " bytes, checksum " << m_imageSum;
+    received(s.str());
+    reply("{\"image\": {\"head\": " + std::to_string(m_imageHead) +
+          ", \"count\": " + std::to_string(m_imageBytes) +
+          ", \"sum\": " + std::to_string(m_imageSum) + "}}\r\n");
+}
+
+void MjEmulator::handle_line(const std::string &line)
+{
+    received(printable(line));
+    if (line.empty()) return;
+
+    const std::string args = (line.size() > 1) ? line.substr(1) : std::string();
+    switch (line[0])
+    {
+    case 'O': m_powered = true; reply("Power on\r\n"); break;
+    case 'F': m_powered = false; reply("Power off\r\n"); break;
+    case 'b':
+    case 'B': reply(status_json() + "\r\n"); break;
+    case 't':
+    {
+        std::string temps = "{\"temps\": [";
+        for (int i = 0; i < 4; i++)
+            temps += (i ? ", " : "") + format_double(30.0 + (random_uniform() - 0.5), 1);
+        reply(temps + "]}\r\n");
+        break;
+    }
+    case '>':
+        // moves along while printing in encoder mode
+        if (m_mode == 4) m_position += 100;
+        reply("Encoder current count: " + std::to_string(m_position) + "\r\n");
+        break;
+    case 'p': m_frequency = std::atoi(args.c_str()); reply("Frequency " + std::to_string(m_frequency) + "\r\n"); break;
+    case 'M': m_mode = std::atoi(args.c_str()); reply("Mode " + std::to_string(m_mode) + "\r\n"); break;
+    case ',': m_position = std::atoll(args.c_str()); reply("Absolute start " + std::to_string(m_position) + "\r\n"); break;
+    case 'v':
+    {
+        int head {0};
+        double voltage {0.0};
+        std::istringstream(args) >> head >> voltage;
+        if (head >= 1 && head <= 4) m_voltage[head - 1] = voltage;
+        reply("Head " + std::to_string(head) + " voltage " + format_double(voltage, 2) + "\r\n");
+        break;
+    }
+    case 'r': m_mode = 0; m_powered = false; reply("Reset\r\n"); break;
+    case 'C': reply("Heads cleared\r\n"); break;
+    case 'I': reply("Nozzles enabled\r\n"); break;
+    default: reply("Unknown command " + line + "\r\n"); break;
+    }
+}
+
+std::string MjEmulator::status_json() const
+{
+    std::string s = "{\"heads\": [";
+    for (int i = 0; i < 4; i++)
+    {
+        s += (i ? ", " : "");
+        s += "{\"head\": " + std::to_string(i + 1) +
+             ", \"power\": " + (m_powered ? "true" : "false") +
+             ", \"voltage\": " + format_double(m_voltage[i], 2) +
+             ", \"temp\": 30.0}";
+    }
+    s += "], \"mode\": " + std::to_string(m_mode) + ", \"position\": " + std::to_string(m_position) + "}";
+    return s;
+}
+
+}
@@ -0,0 +1,107 @@
+#ifndef EMULATORS_H
+#define EMULATORS_H
+
+#include "serialemu.h"
+
+#include <array>
+#include <string>
+
+namespace SerialEmu
+{
+
+// MicroJet JetDrive (MFJDRV protocol)
+// handshake: "Q" -> "MFJET32>", then "X2000" echoed a byte at a time.
+// after that, commands are 'S', length, command, data..., checksum and each
+// is answered with response_size(command) bytes, the command in the second byte
+class JetDriveEmulator final : public DeviceEmulator
+{
+public:
+    explicit JetDriveEmulator(const FaultConfig &faults);
+
+protected:
+    void handle_bytes(const char *data, size_t size) override;
+
+private:
+    void handle_packet(const std::string &packet);
+    static int response_size(unsigned char command);
+    static const char *command_name(unsigned char command);
+
+private:
+    bool m_binary {false}; // finished the Q / X2000 handshake
+    size_t m_xIndex {0};   // next byte of "X2000" expected
+    std::string m_packet;
+};
+
+// pressure controller (Arduino relaying to an Alicat PCD)
+// '\r' terminated ASCII commands: "Q" -> "PCD", "a<psi>" sets the set point,
+// "P" / "O" purge on / off
+class PcdEmulator final : public DeviceEmulator
+{
+public:
+    explicit PcdEmulator(const FaultConfig &faults);
+
+protected:
+    void handle_bytes(const char *data, size_t size) override;
+
+private:
+    void handle_line(const std::string &line);
+
+private:
+    std::string m_line;
+    double m_setPoint_psig {0.0};
+    bool m_purging {false};
+};
+
+// misters, following arduino/mister.ino
+class MisterEmulator final : public DeviceEmulator
+{
+public:
+    explicit MisterEmulator(const FaultConfig &faults);
+
+protected:
+    void handle_bytes(const char *data, size_t size) override;
+
+private:
+    void handle_message(const std::string &message);
+
+private:
+    static constexpr size_t maxMessageLength {16};
+    std::string m_message;
+    bool m_left {false};
+    bool m_right {false};
+};
+
+// Added Scientific MJ driver board
+// '\n' terminated single letter commands answered with text or JSON.
+// image data ('W', 100 + head, 16 bytes per column) is read until the host stops sending
+class MjEmulator final : public DeviceEmulator
+{
+public:
+    explicit MjEmulator(const FaultConfig &faults);
+
+protected:
+    void handle_bytes(const char *data, size_t size) override;
+    void idle() override;
+
+private:
+    void handle_line(const std::string &line);
+    std::string status_json() const;
+    void finish_image();
+
+private:
+    std::string m_line;
+    bool m_inImage {false};
+    int m_imageHead {-1}; // -1 until the head byte after 'W' arrives
+    uint64_t m_imageBytes {0};
+    uint64_t m_imageSum {0};
+
+    bool m_powered {false};
+    int m_mode {0};
+    int m_frequency {0};
+    long long m_position {0};
+    std::array<double, 4> m_voltage {0.0, 0.0, 0.0, 0.0};
+};
+
+}
+
+#endif // EMULATORS_H
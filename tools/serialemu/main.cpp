@@ -0,0 +1,142 @@
+// Emulates the printer's serial devices on Linux pseudo-terminals so the
+// serial code can be exercised without hardware.
+//
+//   serialemu [options] device[=link] ...
+//
+//   device   jetdrive, pcd, mister or mj
+//   link     path of a symlink to the pty to point the application at (e.g. /tmp/ttyJetDrive)
+//
+// options (apply to every device)
+//   --latency <ms>   delay before each reply
+//   --jitter <ms>    extra random delay, 0 to <ms>
+//   --drop <f>       fraction of replies that are never sent
+//   --corrupt <f>    fraction of replies with one byte flipped
+//   --split <f>      fraction of replies written in two parts
+//   --log <file>     write everything received to a csv file (time_s,device,command)
+//   --quiet          don't print what is received
+
+#include "emulators.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::atomic<bool> running {true};
+
+void stop(int)
+{
+    running = false;
+}
+
+void usage()
+{
+    std::cerr << "usage: serialemu [--latency ms] [--jitter ms] [--drop f] [--corrupt f] [--split f]\n"
+                 "                 [--log file] [--quiet] device[=link] ...\n"
+                 "devices: jetdrive, pcd, mister, mj\n";
+}
+
+std::unique_ptr<SerialEmu::DeviceEmulator> make_emulator(const std::string &device, const SerialEmu::FaultConfig &faults)
+{
+    using namespace SerialEmu;
+    if (device == "jetdrive") return std::make_unique<JetDriveEmulator>(faults);
+    if (device == "pcd") return std::make_unique<PcdEmulator>(faults);
+    if (device == "mister") return std::make_unique<MisterEmulator>(faults);
+    if (device == "mj") return std::make_unique<MjEmulator>(faults);
+    return nullptr;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    SerialEmu::FaultConfig faults;
+    std::string logPath;
+    bool quiet {false};
+    std::vector<std::string> devices;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+        if (arg == "--latency" && hasValue) faults.latency_ms = std::atoi(argv[++i]);
+        else if (arg == "--jitter" && hasValue) faults.jitter_ms = std::atoi(argv[++i]);
+        else if (arg == "--drop" && hasValue) faults.dropRate = std::atof(argv[++i]);
+        else if (arg == "--corrupt" && hasValue) faults.corruptRate = std::atof(argv[++i]);
+        else if (arg == "--split" && hasValue) faults.splitRate = std::atof(argv[++i]);
+        else if (arg == "--log" && hasValue) logPath = argv[++i];
+        else if (arg == "--quiet") quiet = true;
+        else if (!arg.empty() && arg[0] != '-') devices.push_back(arg);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (devices.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    std::mutex logMutex;
+    std::ofstream logFile;
+    if (!logPath.empty())
+    {
+        logFile.open(logPath);
+        if (!logFile)
+        {
+            std::cerr << "can't open " << logPath << "\n";
+            return 1;
+        }
+        logFile << "time_s,device,command\n";
+    }
+
+    std::vector<std::unique_ptr<SerialEmu::DeviceEmulator>> emulators;
+    for (const auto &spec : devices)
+    {
+        const size_t eq = spec.find('=');
+        const std::string device = spec.substr(0, eq);
+        const std::string link = (eq == std::string::npos) ? std::string() : spec.substr(eq + 1);
+
+        auto emulator = make_emulator(device, faults);
+        if (!emulator)
+        {
+            std::cerr << "unknown device " << device << "\n";
+            usage();
+            return 1;
+        }
+        if (!emulator->open(link)) return 1;
+        emulator->set_verbose(!quiet);
+        emulator->set_log_file(logFile.is_open() ? &logFile : nullptr, &logMutex);
+
+        std::cout << device << ": " << emulator->pty().slave_path();
+        if (!link.empty()) std::cout << " (" << link << ")";
+        std::cout << std::endl;
+        emulators.push_back(std::move(emulator));
+    }
+
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    std::vector<std::thread> threads;
+    for (auto &emulator : emulators)
+        threads.emplace_back([&emulator]() {emulator->run(running);});
+    for (auto &thread : threads) thread.join();
+
+    // summary of the traffic each device saw
+    for (const auto &emulator : emulators)
+    {
+        const auto &c = emulator->counters();
+        std::cout << emulator->name() << ": "
+                  << c.bytesIn << " bytes in, " << c.bytesOut << " bytes out, "
+                  << c.repliesDropped << " replies dropped, " << c.repliesCorrupted << " corrupted\n";
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "serialemu.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace SerialEmu
+{
+
+PseudoTerminal::~PseudoTerminal()
+{
+    if (!m_linkPath.empty()) ::unlink(m_linkPath.c_str());
+    if (m_slave >= 0) ::close(m_slave);
+    if (m_master >= 0) ::close(m_master);
+}
+
+bool PseudoTerminal::open(const std::string &linkPath)
+{
+    m_master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (m_master < 0 || ::grantpt(m_master) != 0 || ::unlockpt(m_master) != 0)
+    {
+        std::perror("posix_openpt");
+        return false;
+    }
+
+    const char *name = ::ptsname(m_master);
+    if (!name) return false;
+    m_slavePath = name;
+
+    m_slave = ::open(m_slavePath.c_str(), O_RDWR | O_NOCTTY);
+    if (m_slave < 0)
+    {
+        std::perror("open pty slave");
+        return false;
+    }
+
+    // raw bytes, no echo or line editing (the host sets its own port settings when it opens the port)
+    termios tio {};
+    ::tcgetattr(m_slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(m_slave, TCSANOW, &tio);
+
+    if (!linkPath.empty())
+    {
+        ::unlink(linkPath.c_str());
+        if (::symlink(m_slavePath.c_str(), linkPath.c_str()) != 0)
+        {
+            std::perror("symlink");
+            return false;
+        }
+        m_linkPath = linkPath;
+    }
+    return true;
+}
+
+// ====================================================================
+
+DeviceEmulator::DeviceEmulator(const std::string &name, const FaultConfig &faults) :
+    m_name(name),
+    m_faults(faults),
+    m_rng(std::random_device{}()),
+    m_start(Clock::now()),
+    m_lastReceive(Clock::now())
+{
+
+}
+
+bool DeviceEmulator::open(const std::string &linkPath)
+{
+    return m_pty.open(linkPath);
+}
+
+void DeviceEmulator::set_log_file(std::ofstream *logFile, std::mutex *logMutex)
+{
+    m_logFile = logFile;
+    m_logMutex = logMutex;
+}
+
+void DeviceEmulator::run(const std::atomic<bool> &running)
+{
+    char buffer[4096];
+    while (running)
+    {
+        pollfd pfd {m_pty.fd(), POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, poll_timeout_ms());
+        if (ready < 0 && errno != EINTR)
+        {
+            std::perror("poll");
+            return;
+        }
+
+        if (ready > 0 && (pfd.revents & POLLIN))
+        {
+            const ssize_t n = ::read(m_pty.fd(), buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                m_counters.bytesIn += n;
+                m_lastReceive = Clock::now();
+                m_idleCalled = false;
+                handle_bytes(buffer, static_cast<size_t>(n));
+            }
+        }
+
+        if (!m_idleCalled && Clock::now() - m_lastReceive > std::chrono::milliseconds(20))
+        {
+            m_idleCalled = true;
+            idle();
+        }
+
+        flush_due_writes();
+    }
+}
+
+int DeviceEmulator::poll_timeout_ms() const
+{
+    int timeout = 50; // check the running flag regularly
+    if (!m_idleCalled) timeout = 5;
+    if (!m_pending.empty())
+    {
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(m_pending.front().due - Clock::now()).count();
+        timeout = std::min<int>(timeout, static_cast<int>(std::max<long long>(0, wait)));
+    }
+    return timeout;
+}
+
+void DeviceEmulator::reply(const std::string &bytes)
+{
+    if (bytes.empty()) return;
+
+    if (random_uniform() < m_faults.dropRate)
+    {
+        m_counters.repliesDropped++;
+        received("(reply dropped)");
+        return;
+    }
+
+    std::string data = bytes;
+    if (random_uniform() < m_faults.corruptRate)
+    {
+        data[static_cast<size_t>(random_uniform() * data.size()) % data.size()] ^= 0x5A;
+        m_counters.repliesCorrupted++;
+    }
+
+    int delay_ms = m_faults.latency_ms;
+    if (m_faults.jitter_ms > 0) delay_ms += static_cast<int>(random_uniform() * (m_faults.jitter_ms + 1));
+
+    // replies go out in order even when a later one has less jitter
+    Clock::time_point due = Clock::now() + std::chrono::milliseconds(delay_ms);
+    if (!m_pending.empty()) due = std::max(due, m_pending.back().due);
+
+    if (data.size() > 1 && random_uniform() < m_faults.splitRate)
+    {
+        const size_t half = data.size() / 2;
+        m_pending.push_back({due, data.substr(0, half)});
+        m_pending.push_back({due + std::chrono::milliseconds(5), data.substr(half)});
+    }
+    else m_pending.push_back({due, data});
+
+    flush_due_writes();
+}
+
+void DeviceEmulator::flush_due_writes()
+{
+    const auto now = Clock::now();
+    while (!m_pending.empty() && m_pending.front().due <= now)
+    {
+        std::string &bytes = m_pending.front().bytes;
+        const ssize_t n = ::write(m_pty.fd(), bytes.data(), bytes.size());
+        if (n < 0) return; // pty buffer is full, try again next loop
+        m_counters.bytesOut += n;
+        if (static_cast<size_t>(n) < bytes.size())
+        {
+            bytes.erase(0, static_cast<size_t>(n));
+            return;
+        }
+        m_pending.pop_front();
+    }
+}
+
+void DeviceEmulator::received(const std::string &description)
+{
+    const double t = std::chrono::duration<double>(Clock::now() - m_start).count();
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3) << t << "," << m_name << "," << description;
+
+    if (m_verbose)
+    {
+        if (m_logMutex) m_logMutex->lock();
+        std::cout << line.str() << std::endl;
+        if (m_logMutex) m_logMutex->unlock();
+    }
+    if (m_logFile)
+    {
+        std::lock_guard<std::mutex> lock(*m_logMutex);
+        *m_logFile << line.str() << "\n";
+    }
+}
+
+std::string DeviceEmulator::hex(const std::string &bytes)
+{
+    std::ostringstream s;
+    s << std::hex << std::setfill('0');
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        if (i > 0) s << ' ';
+        s << std::setw(2) << static_cast<int>(static_cast<unsigned char>(bytes[i]));
+    }
+    return s.str();
+}
+
+std::string DeviceEmulator::printable(const std::string &text)
+{
+    std::string s;
+    for (const char c : text)
+    {
+        if (c == '\r') s += "\\r";
+        else if (c == '\n') s += "\\n";
+        else if (c == ',') s += ' '; // keep the log a valid csv
+        else if (c < 0x20 || c > 0x7E) s += '.';
+        else s += c;
+    }
+    return s;
+}
+
+double DeviceEmulator::random_uniform()
+{
+    return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng);
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef SERIALEMU_H
+#define SERIALEMU_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace SerialEmu
+{
+
+using Clock = std::chrono::steady_clock;
+
+// faults applied to every reply an emulator sends
+struct FaultConfig
+{
+    int latency_ms {0};      // delay before a reply is written
+    int jitter_ms {0};       // extra random delay, 0 to jitter_ms
+    double dropRate {0.0};   // fraction of replies that are never sent (host should time out)
+    double corruptRate {0.0};// fraction of replies with one byte flipped
+    double splitRate {0.0};  // fraction of replies written in two parts, 5 ms apart
+};
+
+// Linux pseudo-terminal. The host application opens slave_path()
+// (or the symlink) as if it were the device's serial port
+class PseudoTerminal
+{
+public:
+    PseudoTerminal() = default;
+    ~PseudoTerminal();
+    PseudoTerminal(const PseudoTerminal&) = delete;
+    PseudoTerminal &operator=(const PseudoTerminal&) = delete;
+
+    bool open(const std::string &linkPath); // linkPath may be empty
+    int fd() const {return m_master;}
+    const std::string &slave_path() const {return m_slavePath;}
+    const std::string &link_path() const {return m_linkPath;}
+
+private:
+    int m_master {-1};
+    int m_slave {-1}; // kept open so the master doesn't hang up while the host is disconnected
+    std::string m_slavePath;
+    std::string m_linkPath;
+};
+
+// Base class for an emulated serial device. Subclasses parse the bytes the
+// host sends in handle_bytes() and answer with reply(); faults, latency and
+// logging of what was received are handled here.
+class DeviceEmulator
+{
+public:
+    struct Counters
+    {
+        std::atomic<uint64_t> bytesIn {0};
+        std::atomic<uint64_t> bytesOut {0};
+        std::atomic<uint64_t> commands {0};
+        std::atomic<uint64_t> repliesDropped {0};
+        std::atomic<uint64_t> repliesCorrupted {0};
+    };
+
+    DeviceEmulator(const std::string &name, const FaultConfig &faults);
+    virtual ~DeviceEmulator() = default;
+
+    bool open(const std::string &linkPath);
+    void run(const std::atomic<bool> &running); // serve the pty until running is false
+
+    const std::string &name() const {return m_name;}
+    const PseudoTerminal &pty() const {return m_pty;}
+    const Counters &counters() const {return m_counters;}
+    void set_log_file(std::ofstream *logFile, std::mutex *logMutex);
+    void set_verbose(bool verbose) {m_verbose = verbose;}
+
+protected:
+    virtual void handle_bytes(const char *data, size_t size) = 0;
+    virtual void idle() {} // called when nothing has been received for a few ms
+
+    void reply(const std::string &bytes);
+    void received(const std::string &description); // log a command that was received
+    static std::string hex(const std::string &bytes);
+    static std::string printable(const std::string &text);
+    double random_uniform();
+
+private:
+    struct PendingWrite
+    {
+        Clock::time_point due;
+        std::string bytes;
+    };
+
+    void flush_due_writes();
+    int poll_timeout_ms() const;
+
+private:
+    std::string m_name;
+    FaultConfig m_faults;
+    PseudoTerminal m_pty;
+    Counters m_counters;
+    std::deque<PendingWrite> m_pending; // in order, each due no earlier than the one before it
+    std::mt19937 m_rng;
+    Clock::time_point m_start;
+    Clock::time_point m_lastReceive;
+    bool m_idleCalled {true};
+    bool m_verbose {true};
+    std::ofstream *m_logFile {nullptr};
+    std::mutex *m_logMutex {nullptr};
+};
+
+}
+
+#endif // SERIALEMU_H